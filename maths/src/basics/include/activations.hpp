@@ -3,6 +3,8 @@
 #define ACTIVATIONS_HPP 1
 
 #include <vector>
+#include <cstddef>
+#include <span>
 
 // activations.cpp
 
@@ -20,6 +22,25 @@ std::vector<double> LOTA(std::vector<double> y);
 std::vector<std::vector<double>> LOTA(std::vector<std::vector<double>>);
 std::vector<std::vector<double>> LOTA(std::vector<std::vector<double>>, int);
 
+// softmax.cpp
+
+double softmax(const double* x, double* y, size_t n, double temp = 1.0);
+void softmax(const double* x, double* y, size_t rows, size_t n, double temp = 1.0);
+void softmaxvjp(const double* p, const double* g, double* out, size_t n, double temp = 1.0);
+double softmaxcrossentropy(const double* z, const double* y, double* grad, size_t n);
+double softmaxcrossentropy(const double* z, unsigned int label, double* grad, size_t n);
+double softmaxcrossentropy(const double* z, const double* y, double* grad, size_t rows, size_t n);
+double softmaxcrossentropy(const double* z, const unsigned int* labels, double* grad, size_t rows, size_t n);
+
+// lota.cpp
+
+void LOTA(std::span<const double> x, std::span<double> y);
+void LOTAder(std::span<const double> x, std::span<double> y);
+void LOTA(const double* x, size_t ldx, double* y, size_t ldy, size_t rows, size_t cols);
+void LOTAder(const double* x, size_t ldx, double* y, size_t ldy, size_t rows, size_t cols);
+void LOTArows(const double* x, double* y, size_t rows, size_t cols);
+void LOTAderrows(const double* x, double* y, size_t rows, size_t cols);
+
 // activationsder.cpp
 
 double sigmoidder(double);
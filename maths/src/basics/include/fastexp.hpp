@@ -0,0 +1,52 @@
+
+#ifndef FASTEXP_HPP
+#define FASTEXP_HPP 1
+
+#include <cmath>
+
+#ifdef MATHS_FAST_EXP
+#include <bit>
+#include <cstdint>
+#include "expapprox.hpp"    // generated at build time by minimaxgen (src/poly)
+
+/**
+ * @brief e^x from the generated minimax polynomial. The argument is reduced
+ *      as x = k ln2 + r with |r| <= ln2 / 2 (Cody-Waite, ln2 split in two so
+ *      k ln2 is exact), e^r comes from the table and 2^k is put directly into
+ *      the exponent bits. The error is the table error (expapprox_error)
+ *      plus a few ulps.
+ * @param x exponent
+ * @return e^x, 0 below -708 and +inf above 709
+ */
+inline double fastexp(double x) {
+    if (x != x)
+        return x;
+    if (x < -708.0)
+        return 0.0;
+    if (x > 709.0)
+        return HUGE_VAL;
+    const double log2e = 1.4426950408889634;
+    const double ln2hi = 6.93147180369123816490e-01;
+    const double ln2lo = 1.90821492927058770002e-10;
+    double k = std::nearbyint(x * log2e);
+    double r = std::fma(-k, ln2hi, x);
+    r = std::fma(-k, ln2lo, r);
+    uint64_t bits = (uint64_t)((int64_t)k + 1023) << 52;
+    return expapprox(r) * std::bit_cast<double>(bits);
+}
+#endif
+
+/**
+ * @brief exponential used by the activation kernels: the generated minimax
+ *      approximation when built with MATHS_FAST_EXP, std::exp otherwise
+ * @param x exponent
+ */
+inline double expfn(double x) {
+#ifdef MATHS_FAST_EXP
+    return fastexp(x);
+#else
+    return std::exp(x);
+#endif
+}
+
+#endif
@@ -0,0 +1,59 @@
+
+#ifndef LUT_HPP
+#define LUT_HPP 1
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/**
+ * @brief Interpolation used between table entries
+ * - linear: one multiply-add per element, error O(h^2 f'')
+ * - quadratic: two multiply-adds per element, error O(h^3 f''')
+ */
+enum class lutinterp { linear, quadratic };
+
+/**
+ * @brief CLASS: Lookup table of a scalar function on a clamp range [lo, hi]
+ *      split into size equal intervals. Inputs outside the range are clamped,
+ *      so f should be flat (or irrelevant) beyond it. Each interval stores
+ *      its polynomial coefficients in separate arrays, so evaluation is an
+ *      index computation, one gather per coefficient and a short Horner step.
+ *      A table is immutable after construction and safe to share.
+ * @param lo lower end of the clamp range
+ * @param hi upper end of the clamp range
+ * @param size number of intervals
+ * @param interp interpolation order
+ */
+class lut {
+public:
+    double lo;                  // lower end of the clamp range
+    double hi;                  // upper end of the clamp range
+    size_t size;                // number of intervals
+    double invstep;             // size / (hi - lo)
+    lutinterp interp;           // interpolation order
+    std::vector<double> c0;     // constant coefficient per interval
+    std::vector<double> c1;     // linear coefficient per interval
+    std::vector<double> c2;     // quadratic coefficient per interval (quadratic only)
+
+    lut(const std::function<double(double)>& f, double lo, double hi, size_t size,
+        lutinterp interp = lutinterp::linear);
+    double operator()(double x) const;                  // table value at x
+    void apply(const double* x, double* y, size_t n) const;    // batched table lookup
+    double maxerror(const std::function<double(double)>& f, size_t samples = 1000000) const;
+
+    ~lut() {};
+};
+
+// shared tables for the activation functions (lut.cpp)
+
+void configureLUT(size_t size, double range, lutinterp interp);     // before first use only
+const lut& sigmoidLUT();        // sigmoid on [-range, range]
+const lut& expLUT();            // e^x on [-range, 0], for max-shifted softmax
+
+double sigmoidlut(double);
+void sigmoidlut(const double*, double*, size_t);
+std::vector<double> sigmoidlut(const std::vector<double>&);
+std::vector<double> softmaxlut(const std::vector<double>&, double temp = 1.0);
+
+#endif
@@ -0,0 +1,84 @@
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP 1
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * @brief Number of worker threads available to the parallel kernels.
+ * @return hardware concurrency, at least 1
+ */
+inline unsigned int hardwareThreads() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return (n == 0) ? 1 : n;
+}
+
+/**
+ * @brief Split the range [0, n) into contiguous chunks and run f(begin, end)
+ *      on each chunk in its own thread. Ranges smaller than grain run on the
+ *      calling thread, so small problems do not pay for thread creation.
+ * @param n number of work items
+ * @param grain minimum number of items per chunk
+ * @param f callable taking (size_t begin, size_t end)
+ */
+template <typename F>
+void parallelFor(size_t n, size_t grain, F f) {
+    if (n == 0)
+        return;
+    size_t chunks = std::min<size_t>(hardwareThreads(), (n + grain - 1) / std::max<size_t>(grain, 1));
+    if (chunks <= 1) {
+        f(size_t(0), n);
+        return;
+    }
+    size_t step = (n + chunks - 1) / chunks;
+    std::vector<std::thread> pool;
+    pool.reserve(chunks - 1);
+    for (size_t c = 1; c < chunks; c++) {
+        size_t begin = c * step;
+        size_t end = std::min(n, begin + step);
+        if (begin >= end)
+            break;
+        pool.emplace_back(f, begin, end);
+    }
+    // the calling thread takes the first chunk
+    f(size_t(0), std::min(n, step));
+    for (auto& t : pool)
+        t.join();
+}
+
+/**
+ * @brief Parallel reduction over [0, n): each chunk returns a partial sum from
+ *      f(begin, end) and the partials are added in chunk order, so the result
+ *      only depends on the number of threads, not on their timing.
+ * @param n number of work items
+ * @param grain minimum number of items per chunk
+ * @param f callable taking (size_t begin, size_t end) and returning double
+ * @return sum of all partials
+ */
+template <typename F>
+double parallelSum(size_t n, size_t grain, F f) {
+    if (n == 0)
+        return 0.0;
+    size_t chunks = std::min<size_t>(hardwareThreads(), (n + grain - 1) / std::max<size_t>(grain, 1));
+    if (chunks <= 1)
+        return f(size_t(0), n);
+    size_t step = (n + chunks - 1) / chunks;
+    std::vector<double> partial(chunks, 0.0);
+    parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t b = c * step;
+            size_t e = std::min(n, b + step);
+            if (b < e)
+                partial[c] = f(b, e);
+        }
+    });
+    double sum = 0.0;
+    for (double p : partial)
+        sum += p;
+    return sum;
+}
+
+#endif
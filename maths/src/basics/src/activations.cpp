@@ -1,8 +1,11 @@
 
 #include "include/activations.hpp"
+#include "include/fastexp.hpp"
 #include <functional>
 #include <algorithm>
+#include <cmath>
 #include <numeric>
+#include <limits>
 
 //----------------SIGMOID----------------//
 
@@ -13,7 +16,7 @@
  */
 double sigmoid(double x) {
     // The sigmoid function is defined as 1 / (1 + exp(-x)).
-    return (1 / (1 + std::exp(-x)));
+    return (1 / (1 + expfn(-x)));
 }
 
 /**
@@ -54,19 +57,9 @@ std::vector<std::vector<double>> sigmoid(std::vector<std::vector<double>> x) {
  * @return Vector of softmax values
  */
 std::vector<double> softmax(std::vector<double> x, double temp = 1.0) {
-    // Create a copy of the input vector
-    std::vector<double> y(x);
-    // Calculate the sum of the exponentials of the vector elements
-    double sum = 0;
-    // Calculate the sum of the exponentials of the vector elements
-    std::transform(y.begin(), y.end(), y.begin(), [temp](double& val) { return exp(val / temp); });
-    sum = std::accumulate(y.begin(), y.end(), 0.0);
-    // Normalize the exponentials by dividing each by the sum
-    std::transform(y.begin(), y.end(), y.begin(), [sum](double val) {
-        return val / sum;
-    });
-    // Return the normalized vector
-    return y;
+    // max-shifted online softmax, computed in place on the copy
+    softmax(x.data(), x.data(), x.size(), temp);
+    return x;
 }
 
 /**
@@ -80,19 +73,21 @@ std::vector<double> softmax(std::vector<double> x, double temp = 1.0) {
  * @return Vector of softmax values
  */
 std::vector<std::vector<double>> softmax(std::vector<std::vector<double>> x, double temp = 1.0) {
-    // Create a copy of the input vector
-    std::vector<std::vector<double>> y(x);
-    // Calculate the sum of the exponentials of the vector elements
+    // Shift by the global maximum so no exponential overflows
+    double m = -std::numeric_limits<double>::infinity();
+    for (const auto& v : x) {
+        for (double i : v) { m = std::max(m, i / temp); }
+    }
     double sum = 0.0;
     for (auto& v : x) {
-        std::transform(v.begin(), v.end(), v.begin(), [&temp](double& i){ return exp(i/temp); });
+        std::transform(v.begin(), v.end(), v.begin(), [&temp, &m](double& i){ return expfn(i / temp - m); });
         sum += std::accumulate(v.begin(), v.end(), 0.0);
     }
     // Normalize each element by dividing it by the total sum
     for (auto& v: x) {
         std::transform(v.begin(), v.end(), v.begin(), [&sum](double& i){ return i / sum; });
     }
-    return y;
+    return x;
 }
 
 //----------------ReLU----------------//
@@ -153,100 +148,72 @@ std::vector<double> SeLUv(std::vector<double> x) {
 //----------------Least of them all----------------//
 
 /**
- * @brief Applies the LOTA (Least Of Them All) activation function to a 2D vector.
+ * @brief Applies the LOTA (Least Of Them All) activation function to a vector.
  *        The LOTA function is defined as:
- *        f(x) = x - min(x) for each element, and
+ *        f(x) = x + |min(x)| for each element, and
  *        f(x) = f(x) / sum(f(x)) for normalization
- * @param y Input 2D vector
- * @return A 2D vector where each vector is the result of the LOTA function applied to the corresponding vector in the input.
+ *        Computed in place on the argument copy with the two-pass span kernel.
+ * @param y Input vector
+ * @return A vector where each element is the result of the LOTA function applied to the corresponding element in the input.
  */
-std::vector<double> LOTA(std::vector<double>& y) {
-    // Create a copy of the input vector
-    std::vector<double> x(y);
-    // Find the minimum value in the input vector
-    double min_val = 0.0;
-    min_val = *std::min_element(x.begin(), x.end());
-    min_val = std::abs(min_val);
-    // Subtract the minimum value from each element in the vector
-    std::transform(x.begin(), x.end(), x.begin(), [&min_val](double& i){ return (i + min_val); });
-    // Calculate the sum of the elements in the vector
-    double sum = std::accumulate(x.begin(), x.end(), 0.0);
-    // Normalize the vector by dividing each element by the sum
-    std::transform(x.begin(), x.end(), x.begin(), [&sum](double& i){ return i / sum; });
-    return x;
+std::vector<double> LOTA(std::vector<double> y) {
+    LOTA(std::span<const double>(y), std::span<double>(y));
+    return y;
 }
 
 /**
  * @brief Applies the LOTA (Least Of Them All) activation function to a 2D vector.
  *        The LOTA function is defined as:
- *        f(x) = x - min(x) for each element, and
- *        f(x) = f(x) / sum(f(x)) for normalization
+ *        f(x) = x - min(0, min(x)) for each element, and
+ *        f(x) = f(x) / sum(f(x)) for normalization over the whole 2D vector
+ *        One pass finds the minimum and the sum, a second one normalizes in place.
  * @param y Input 2D vector
  * @return A 2D vector where each vector is the result of the LOTA function applied to the corresponding vector in the input.
  */
 std::vector<std::vector<double>> LOTA(std::vector<std::vector<double>> y) {
-    // Create a copy of the input 2D vector
-    std::vector<std::vector<double>> x(y);
-    // Find the minimum value in the entire 2D vector
-    double min_val = 0.0;
-    for (const auto& v: x) {
-        double val = *std::min_element(v.begin(), v.end());
-        if (val < min_val) { min_val = val; }
-    }
-    min_val = std::abs(min_val);
-    // Subtract the minimum value from each element in the 2D vector
-    for (auto& v : x) {
-        std::transform(v.begin(), v.end(), v.begin(), [&min_val](double& i){ return (i + min_val); });
-    }
-    double sum = 0.0; // Variable to store the sum of all elements
-    // Calculate the sum of all elements in the 2D vector
-    for (const auto& v: x) {
-        sum += std::accumulate(v.begin(), v.end(), 0.0);
+    double min_val = 0.0, sum = 0.0;
+    size_t count = 0;
+    for (const auto& v : y) {
+        for (double i : v) {
+            min_val = std::min(min_val, i);
+            sum += i;
+        }
+        count += v.size();
     }
-    // Normalize each element by dividing it by the total sum
-    for (auto& v: x) {
-        std::transform(v.begin(), v.end(), v.begin(), [&sum](double& i){ return i / sum; });
+    double shift = -min_val;
+    double r = 1.0 / (sum + (double)count * shift);
+    for (auto& v : y) {
+        for (double& i : v) { i = (i + shift) * r; }
     }
-    return x; // Return the normalized 2D vector
+    return y;
 }
 
 /**
- * @brief Applies the LOTA (Least Of Them All) activation function to a 2D vector.
+ * @brief Applies the LOTA (Least Of Them All) activation function to the top-left t x t block
+ *        of a 2D vector (the whole 2D vector if it has t rows). Elements outside the block are
+ *        returned unchanged.
  *        The LOTA function is defined as:
- *        f(x) = x - min(x) for each element, and
- *        f(x) = f(x) / sum(f(x)) for normalization
+ *        f(x) = x - min(0, min(x)) for each element, and
+ *        f(x) = f(x) / sum(f(x)) for normalization over the block
  * @param y Input 2D vector
+ * @param t Size of the block
  * @return A 2D vector where each vector is the result of the LOTA function applied to the corresponding vector in the input.
  */
 std::vector<std::vector<double>> LOTA(std::vector<std::vector<double>> y, int t) {
     if(y.size() == t) {
-        std::vector<std::vector<double>> x(y);
-        x = LOTA(x);
-        return x;
+        return LOTA(std::move(y));
     }
-    // Create a copy of the input 2D vector
-    std::vector<std::vector<double>> x(y);
-    // Find the minimum value in the entire 2D vector
-    double min_val = 0.0;
+    double min_val = 0.0, sum = 0.0;
     for (int i = 0; i < t; i++) {
-        for(int j = 0; j < t; j++) {
-            if (x[i][j] < min_val)
-                min_val = x[i][j];
+        for (int j = 0; j < t; j++) {
+            min_val = std::min(min_val, y[i][j]);
+            sum += y[i][j];
         }
     }
-    min_val = std::abs(min_val);
-    // Subtract the minimum value from each element in the 2D vector
-    for (int i = 0; i < t; i++) {
-        std::transform(x[i].begin(), x[i].begin() + t, x[i].begin(), [&min_val](double& i){ return (i + min_val); });
-    }
-    double sum = 0.0; // Variable to store the sum of all elements
-    // Calculate the sum of all elements in the 2D vector
+    double shift = -min_val;
+    double r = 1.0 / (sum + (double)t * (double)t * shift);
     for (int i = 0; i < t; i++) {
-        sum += std::accumulate(x[i].begin(), x[i].begin() + t, 0.0);
+        for (int j = 0; j < t; j++) { y[i][j] = (y[i][j] + shift) * r; }
     }
-    // Normalize each element by dividing it by the total sum
-    for (int i = 0; i < t; i++) {
-        std::transform(x[i].begin(), x[i].begin() + t, x[i].begin(), [&sum](double& i){ return i / sum; });
-    }
-    return x; // Return the normalized 2D vector
+    return y;
 }
@@ -1,7 +1,9 @@
 
 #include "include/activations.hpp"
+#include "include/fastexp.hpp"
 #include <functional>
 #include <algorithm>
+#include <cmath>
 #include <numeric>
 
 //----------------SIGMOID----------------//
@@ -68,9 +70,9 @@ std::vector<double> softmaxder(std::vector<double> x, double temp = 1.0) {
     std::vector<double> y(x);
     // Calculate the sum of exponential of each element of the input vector
     double sum = 0;
-    std::for_each(y.begin(), y.end(), [&sum, temp](double& val) { sum += exp(val/temp); });
+    std::for_each(y.begin(), y.end(), [&sum, temp](double& val) { sum += expfn(val/temp); });
     // Calculate the softmax of each element of the input vector
-    std::for_each(y.begin(), y.end(), [&sum](double& val) { val = exp(val) / sum; });
+    std::for_each(y.begin(), y.end(), [&sum](double& val) { val = expfn(val) / sum; });
     // Calculate the derivative of softmax(x) for each input value
     std::vector<double> result(y.size(), 0.0);
     for (size_t i = 0; i < y.size(); ++i) {
@@ -105,7 +107,7 @@ std::vector<std::vector<double>> softmaxder(std::vector<std::vector<double>> x,
     // Calculate the sum of the exponentials of the vector elements
     double sum = 0.0;
     for (auto& v : x) {
-        std::transform(v.begin(), v.end(), v.begin(), [&temp](double& i){ return exp(i/temp); });
+        std::transform(v.begin(), v.end(), v.begin(), [&temp](double& i){ return expfn(i/temp); });
         sum += std::accumulate(v.begin(), v.end(), 0.0);
     }
     // Normalize each element by dividing it by the total sum
@@ -199,62 +201,39 @@ std::vector<double> SeLUvder(std::vector<double> x) {
  * @brief Calculates the derivative of the LOTA (Least Of Them All) activation function for a vector.
  *        This function calculates the derivative of the LOTA function for each element in a vector.
  *        The LOTA derivative is defined as:
- *        f'(x) = (sum - x) / sum^2 for normalization
+ *        f'(x) = (sum - x) / sum^2 for normalization, x shifted by |min(x)|
  * @param y Input vector
  * @return A vector where each element is the derivative of the LOTA function applied to the corresponding element in the input vector.
  */
-std::vector<double> LOTAder(std::vector<double>& y) {
-    // Create a copy of the input vector
-    std::vector<double> v(y);
-    // Find the minimum value in the entire vector
-    double min_val =  *std::min_element(v.begin(), v.end());
-    min_val = std::abs(min_val);
-    // Subtract the minimum value from each element in the vector
-    std::transform(v.begin(), v.end(), v.begin(), [&min_val](double& i){ return (i + min_val); });
-    // Calculate the sum of the elements in the vector
-    double sum = std::accumulate(v.begin(), v.end(), 0.0);
-    // Normalize the vector by dividing each element by the sum
-    std::transform(v.begin(), v.end(), v.begin(), [&sum](double& i){ return ((sum - i) / std::pow(sum, 2)); });
-    return v;
+std::vector<double> LOTAder(std::vector<double> y) {
+    LOTAder(std::span<const double>(y), std::span<double>(y));
+    return y;
 }
 
 /**
  * @brief Derivative of the LOTA (Least Of Them All) activation function for a 2D vector.
  *        This function calculates the derivative of the LOTA function for each element
  *        in a 2D vector. The LOTA derivative is defined as:
- *        f'(x) = (sum - x) / sum^2 for normalization
+ *        f'(x) = (sum - x) / sum^2 for normalization, x shifted by -min(0, min(x))
  * @param y Input 2D vector
  * @return A 2D vector where each element is the derivative of the LOTA function applied 
  *         to the corresponding element in the input vector.
  */
 std::vector<std::vector<double>> LOTAder(std::vector<std::vector<double>> y) {
-    // Create a copy of the input 2D vector
-    std::vector<std::vector<double>> x(y);
-    // Find the minimum value in the entire 2D vector
-    double min_val = 0.0; 
-    for (const auto& v: x) {
-        double val = *std::min_element(v.begin(), v.end());
-        if (val < min_val) {
-            min_val = val;
+    double min_val = 0.0, sum = 0.0;
+    size_t count = 0;
+    for (const auto& v : y) {
+        for (double i : v) {
+            min_val = std::min(min_val, i);
+            sum += i;
         }
+        count += v.size();
     }
-    min_val = std::abs(min_val);
-    // Subtract the minimum value from each element in the 2D vector
-    for (auto& v : x) {
-        std::transform(v.begin(), v.end(), v.begin(), [&min_val](double& i) {
-            return (i + min_val);
-        });
-    }
-    double sum = 0.0; // Variable to store the sum of all elements
-    // Calculate the sum of all elements in the 2D vector
-    for (const auto& v: x) {
-        sum += std::accumulate(v.begin(), v.end(), 0.0);
-    }
-    // Calculate the derivative of the LOTA function for each element
-    for (auto& v : x) {
-        std::transform(v.begin(), v.end(), v.begin(), [&sum](double& i) {
-            return ((sum - i) / std::pow(sum, 2));
-        });
+    double shift = -min_val;
+    double S = sum + (double)count * shift;
+    double a = (S - shift) / (S * S), b = 1.0 / (S * S);
+    for (auto& v : y) {
+        for (double& i : v) { i = a - i * b; }
     }
-    return x; // Return the derived 2D vector
+    return y;
 }
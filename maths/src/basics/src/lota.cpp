@@ -0,0 +1,179 @@
+
+#include "include/activations.hpp"
+#include "include/parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+//----------------LOTA KERNELS----------------//
+
+/**
+ * @brief Minimum and sum of a contiguous range in one pass. Four independent
+ *      accumulators break the dependency chains so the loop pipelines.
+ * @param x values
+ * @param n number of values
+ * @param mn minimum (output)
+ * @param sum sum (output)
+ */
+static void minsum(const double* x, size_t n, double& mn, double& sum) {
+    double m0 = std::numeric_limits<double>::infinity(), m1 = m0, m2 = m0, m3 = m0;
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        m0 = std::min(m0, x[i]);
+        m1 = std::min(m1, x[i + 1]);
+        m2 = std::min(m2, x[i + 2]);
+        m3 = std::min(m3, x[i + 3]);
+        s0 += x[i];
+        s1 += x[i + 1];
+        s2 += x[i + 2];
+        s3 += x[i + 3];
+    }
+    for (; i < n; i++) {
+        m0 = std::min(m0, x[i]);
+        s0 += x[i];
+    }
+    mn = std::min(std::min(m0, m1), std::min(m2, m3));
+    sum = (s0 + s1) + (s2 + s3);
+}
+
+/**
+ * @brief y = (x + s) * r over a range (the LOTA normalisation)
+ */
+static void shiftscale(const double* x, double* y, size_t n, double s, double r) {
+    for (size_t i = 0; i < n; i++)
+        y[i] = (x[i] + s) * r;
+}
+
+/**
+ * @brief y = a - x * b over a range (the LOTA derivative (S - (x + s)) / S^2)
+ */
+static void affine(const double* x, double* y, size_t n, double a, double b) {
+    for (size_t i = 0; i < n; i++)
+        y[i] = a - x[i] * b;
+}
+
+/**
+ * @brief LOTA of a contiguous vector in two passes: the first finds the
+ *      minimum and the sum together, the second writes (x + |min|) / S with
+ *      S = sum + n |min|, so the shifted values are never stored.
+ * @param x input values
+ * @param y output values (same length, may alias x)
+ */
+void LOTA(std::span<const double> x, std::span<double> y) {
+    if (x.empty())
+        return;
+    double mn, sum;
+    minsum(x.data(), x.size(), mn, sum);
+    double s = std::abs(mn);
+    shiftscale(x.data(), y.data(), x.size(), s, 1.0 / (sum + (double)x.size() * s));
+}
+
+/**
+ * @brief LOTA derivative of a contiguous vector in two passes,
+ *      (S - (x + |min|)) / S^2 with S = sum + n |min|
+ * @param x input values
+ * @param y output values (same length, may alias x)
+ */
+void LOTAder(std::span<const double> x, std::span<double> y) {
+    if (x.empty())
+        return;
+    double mn, sum;
+    minsum(x.data(), x.size(), mn, sum);
+    double s = std::abs(mn);
+    double S = sum + (double)x.size() * s;
+    affine(x.data(), y.data(), x.size(), (S - s) / (S * S), 1.0 / (S * S));
+}
+
+/**
+ * @brief Shift and normaliser of a 2-D view treated as one distribution. The
+ *      shift is -min(0, min x), as in the nested-vector LOTA. Row statistics
+ *      are computed in parallel and reduced in row order.
+ */
+static void viewStats(const double* x, size_t ldx, size_t rows, size_t cols, double& s, double& S) {
+    std::vector<double> rmin(rows), rsum(rows);
+    parallelFor(rows, std::max<size_t>(1, 8192 / std::max<size_t>(cols, 1)), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++)
+            minsum(x + r * ldx, cols, rmin[r], rsum[r]);
+    });
+    double mn = 0.0, sum = 0.0;
+    for (size_t r = 0; r < rows; r++) {
+        mn = std::min(mn, rmin[r]);
+        sum += rsum[r];
+    }
+    s = -mn;
+    S = sum + (double)(rows * cols) * s;
+}
+
+/**
+ * @brief LOTA of a row-major 2-D view (leading dimensions ldx/ldy) as one
+ *      distribution over all its elements
+ * @param x input view
+ * @param ldx row stride of x in elements
+ * @param y output view (may alias x)
+ * @param ldy row stride of y in elements
+ * @param rows number of rows
+ * @param cols number of columns
+ */
+void LOTA(const double* x, size_t ldx, double* y, size_t ldy, size_t rows, size_t cols) {
+    if (rows == 0 || cols == 0)
+        return;
+    double s, S;
+    viewStats(x, ldx, rows, cols, s, S);
+    double r = 1.0 / S;
+    parallelFor(rows, std::max<size_t>(1, 8192 / cols), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            shiftscale(x + i * ldx, y + i * ldy, cols, s, r);
+    });
+}
+
+/**
+ * @brief LOTA derivative of a row-major 2-D view as one distribution
+ * @param x input view
+ * @param ldx row stride of x in elements
+ * @param y output view (may alias x)
+ * @param ldy row stride of y in elements
+ * @param rows number of rows
+ * @param cols number of columns
+ */
+void LOTAder(const double* x, size_t ldx, double* y, size_t ldy, size_t rows, size_t cols) {
+    if (rows == 0 || cols == 0)
+        return;
+    double s, S;
+    viewStats(x, ldx, rows, cols, s, S);
+    double a = (S - s) / (S * S), b = 1.0 / (S * S);
+    parallelFor(rows, std::max<size_t>(1, 8192 / cols), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            affine(x + i * ldx, y + i * ldy, cols, a, b);
+    });
+}
+
+/**
+ * @brief Batched LOTA: every row of a row-major batch is normalised on its
+ *      own (vector semantics), rows spread over threads
+ * @param x input (rows x cols)
+ * @param y output (rows x cols, may alias x)
+ * @param rows batch size
+ * @param cols values per row
+ */
+void LOTArows(const double* x, double* y, size_t rows, size_t cols) {
+    parallelFor(rows, std::max<size_t>(1, 8192 / std::max<size_t>(cols, 1)), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++)
+            LOTA(std::span<const double>(x + r * cols, cols), std::span<double>(y + r * cols, cols));
+    });
+}
+
+/**
+ * @brief Batched LOTA derivative, row by row
+ * @param x input (rows x cols)
+ * @param y output (rows x cols, may alias x)
+ * @param rows batch size
+ * @param cols values per row
+ */
+void LOTAderrows(const double* x, double* y, size_t rows, size_t cols) {
+    parallelFor(rows, std::max<size_t>(1, 8192 / std::max<size_t>(cols, 1)), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++)
+            LOTAder(std::span<const double>(x + r * cols, cols), std::span<double>(y + r * cols, cols));
+    });
+}
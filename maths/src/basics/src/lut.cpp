@@ -0,0 +1,212 @@
+
+#include "include/lut.hpp"
+#include "include/activations.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+//----------------LUT----------------//
+
+/**
+ * @brief build the table. Linear tables interpolate f between the interval
+ *      ends; quadratic tables take the parabola through the interval ends
+ *      and the midpoint.
+ * @param f function to tabulate
+ * @param lo lower end of the clamp range
+ * @param hi upper end of the clamp range
+ * @param size number of intervals
+ * @param interp interpolation order
+ * @throws std::invalid_argument for an empty range or zero size
+ */
+lut::lut(const std::function<double(double)>& f, double lo, double hi, size_t size, lutinterp interp)
+    : lo(lo), hi(hi), size(size), interp(interp)
+{
+    if (!(hi > lo) || size == 0)
+        throw std::invalid_argument("lookup table needs hi > lo and at least one interval");
+    invstep = (double)size / (hi - lo);
+    double step = (hi - lo) / (double)size;
+    // one extra entry so x == hi (index size, t == 0) needs no branch
+    c0.resize(size + 1);
+    c1.resize(size + 1);
+    if (interp == lutinterp::quadratic)
+        c2.resize(size + 1);
+    for (size_t i = 0; i <= size; i++) {
+        double a = lo + step * (double)i;
+        double fa = f(a), fb = f(a + step);
+        c0[i] = fa;
+        if (interp == lutinterp::linear)
+            c1[i] = fb - fa;
+        else {
+            double fm = f(a + 0.5 * step);
+            // p(t) = fa + c1 t + c2 t^2 through t = 0, 1/2, 1
+            c1[i] = 4.0 * fm - 3.0 * fa - fb;
+            c2[i] = 2.0 * (fa + fb - 2.0 * fm);
+        }
+    }
+}
+
+/**
+ * @brief table value at x (clamped to [lo, hi]; NaN maps to lo)
+ * @param x point
+ */
+double lut::operator()(double x) const {
+    double y;
+    apply(&x, &y, 1);
+    return y;
+}
+
+/**
+ * @brief batched lookup. The loop is branch-free (clamps are selects), so it
+ *      vectorises with gather loads where the target has them.
+ * @param x input values
+ * @param y output values (may alias x)
+ * @param n number of values
+ */
+void lut::apply(const double* x, double* y, size_t n) const {
+    const double* a = c0.data();
+    const double* b = c1.data();
+    const double top = (double)size;
+    if (interp == lutinterp::linear) {
+        for (size_t k = 0; k < n; k++) {
+            double u = (x[k] - lo) * invstep;
+            u = (u > 0.0) ? u : 0.0;
+            u = (u < top) ? u : top;
+            size_t i = (size_t)u;
+            double t = u - (double)i;
+            y[k] = a[i] + t * b[i];
+        }
+    }
+    else {
+        const double* c = c2.data();
+        for (size_t k = 0; k < n; k++) {
+            double u = (x[k] - lo) * invstep;
+            u = (u > 0.0) ? u : 0.0;
+            u = (u < top) ? u : top;
+            size_t i = (size_t)u;
+            double t = u - (double)i;
+            y[k] = a[i] + t * (b[i] + t * c[i]);
+        }
+    }
+}
+
+/**
+ * @brief largest absolute error against f on a uniform grid over [lo, hi]
+ * @param f exact function
+ * @param samples grid points
+ */
+double lut::maxerror(const std::function<double(double)>& f, size_t samples) const {
+    samples = std::max<size_t>(samples, 2);
+    std::vector<double> x(samples), y(samples);
+    for (size_t i = 0; i < samples; i++)
+        x[i] = lo + (hi - lo) * (double)i / (double)(samples - 1);
+    apply(x.data(), y.data(), samples);
+    double worst = 0.0;
+    for (size_t i = 0; i < samples; i++)
+        worst = std::max(worst, std::fabs(y[i] - f(x[i])));
+    return worst;
+}
+
+//----------------SHARED TABLES----------------//
+
+namespace {
+
+// settings used when the shared tables are first built
+struct lutsettings {
+    size_t size = 4096;
+    double range = 16.0;
+    lutinterp interp = lutinterp::linear;
+};
+
+lutsettings settings;
+std::atomic<bool> built{false};
+
+const lutsettings& frozenSettings() {
+    built.store(true);
+    return settings;
+}
+
+}
+
+/**
+ * @brief set the size, clamp range and interpolation of the shared activation
+ *      tables. Tables are built once on first use and are read-only after
+ *      that, so this must run during start-up, before any table lookup.
+ * @param size intervals per table
+ * @param range sigmoid is tabulated on [-range, range], exp on [-range, 0]
+ * @param interp interpolation order
+ * @throws std::runtime_error if a shared table was already built
+ */
+void configureLUT(size_t size, double range, lutinterp interp) {
+    if (built.load())
+        throw std::runtime_error("activation tables are already built");
+    if (size == 0 || !(range > 0.0))
+        throw std::invalid_argument("activation tables need size > 0 and range > 0");
+    settings.size = size;
+    settings.range = range;
+    settings.interp = interp;
+}
+
+/**
+ * @brief shared sigmoid table, built on first use (thread-safe static init)
+ */
+const lut& sigmoidLUT() {
+    static const lut table = [] {
+        const lutsettings& s = frozenSettings();
+        return lut([](double x) { return 1.0 / (1.0 + std::exp(-x)); }, -s.range, s.range, s.size, s.interp);
+    }();
+    return table;
+}
+
+/**
+ * @brief shared exp table on [-range, 0], built on first use. Softmax shifts
+ *      by the maximum first, so every argument is <= 0 and anything below
+ *      -range is at most e^-range relative to the largest term.
+ */
+const lut& expLUT() {
+    static const lut table = [] {
+        const lutsettings& s = frozenSettings();
+        return lut([](double x) { return std::exp(x); }, -s.range, 0.0, s.size, s.interp);
+    }();
+    return table;
+}
+
+//----------------TABLE ACTIVATIONS----------------//
+
+double sigmoidlut(double x) {
+    return sigmoidLUT()(x);
+}
+
+void sigmoidlut(const double* x, double* y, size_t n) {
+    sigmoidLUT().apply(x, y, n);
+}
+
+std::vector<double> sigmoidlut(const std::vector<double>& x) {
+    std::vector<double> y(x.size());
+    sigmoidLUT().apply(x.data(), y.data(), x.size());
+    return y;
+}
+
+/**
+ * @brief softmax through the shared exp table: shift by the maximum, look up
+ *      all exponentials in one batched call, then normalise
+ * @param x logits
+ * @param temp temperature
+ */
+std::vector<double> softmaxlut(const std::vector<double>& x, double temp) {
+    std::vector<double> y(x.size());
+    if (x.empty())
+        return y;
+    double m = *std::max_element(x.begin(), x.end());
+    double inv = 1.0 / temp;
+    for (size_t i = 0; i < x.size(); i++)
+        y[i] = (x[i] - m) * inv;
+    expLUT().apply(y.data(), y.data(), y.size());
+    double sum = 0.0;
+    for (double v : y)
+        sum += v;
+    double s = 1.0 / sum;
+    for (double& v : y)
+        v *= s;
+    return y;
+}
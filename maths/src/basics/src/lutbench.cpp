@@ -0,0 +1,54 @@
+
+// lutbench.cpp: speed and accuracy of the table activations against the exact functions
+#include "include/lut.hpp"
+#include "include/activations.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+template <typename F> static double nsPerElement(F f, size_t n, int reps) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++)
+        f();
+    std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start;
+    return d.count() / ((double)n * reps);
+}
+
+int main() {
+    const size_t n = 1 << 20;
+    const int reps = 20;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dis(-12.0, 12.0);
+    std::vector<double> x(n), y(n);
+    for (double& v : x)
+        v = dis(gen);
+    auto exactSigmoid = [](double v) { return 1.0 / (1.0 + std::exp(-v)); };
+    auto exactExp = [](double v) { return std::exp(v); };
+
+    double sink = 0.0;
+    double tExact = nsPerElement([&] {
+        for (size_t i = 0; i < n; i++)
+            y[i] = sigmoid(x[i]);
+        sink += y[n / 2];
+    }, n, reps);
+    std::printf("%-28s %8.3f ns/element\n", "sigmoid (exact)", tExact);
+
+    std::printf("\n%-10s %-10s %8s %14s %14s %10s\n", "interp", "size", "range", "sigmoid err", "exp err", "ns/elem");
+    for (lutinterp interp : {lutinterp::linear, lutinterp::quadratic}) {
+        for (size_t size : {256, 1024, 4096, 16384, 65536}) {
+            lut sig(exactSigmoid, -16.0, 16.0, size, interp);
+            lut ex(exactExp, -16.0, 0.0, size, interp);
+            double t = nsPerElement([&] {
+                sig.apply(x.data(), y.data(), n);
+                sink += y[n / 2];
+            }, n, reps);
+            std::printf("%-10s %-10zu %8.1f %14.3e %14.3e %10.3f\n",
+                        interp == lutinterp::linear ? "linear" : "quadratic", size, 16.0,
+                        sig.maxerror(exactSigmoid), ex.maxerror(exactExp), t);
+        }
+    }
+    std::printf("\n(checksum %g)\n", sink);
+    return 0;
+}
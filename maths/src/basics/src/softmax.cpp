@@ -0,0 +1,204 @@
+
+#include "include/activations.hpp"
+#include "include/fastexp.hpp"
+#include "include/parallel.hpp"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+//----------------ONLINE SOFTMAX----------------//
+
+/**
+ * @brief Running max and normaliser of exp(x / temp) in one pass. When a new
+ *      maximum appears the sum is rescaled by exp(old max - new max), so no
+ *      exponential ever overflows and the input is read only once.
+ * @param x input values
+ * @param n number of values
+ * @param inv 1 / temperature
+ * @param m running maximum of x * inv (output)
+ * @return sum of exp(x * inv - m)
+ */
+static double onlineNormaliser(const double* x, size_t n, double inv, double& m) {
+    m = -std::numeric_limits<double>::infinity();
+    double s = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double z = x[i] * inv;
+        if (z > m) {
+            s = s * expfn(m - z) + 1.0;
+            m = z;
+        }
+        else
+            s += expfn(z - m);
+    }
+    return s;
+}
+
+/**
+ * @brief Numerically stable softmax: one pass for the running max and sum,
+ *      one pass writing the probabilities.
+ * @param x input values
+ * @param y probabilities (length n, may alias x)
+ * @param n number of values
+ * @param temp temperature
+ * @return log-sum-exp of x / temp
+ */
+double softmax(const double* x, double* y, size_t n, double temp) {
+    if (n == 0)
+        return -std::numeric_limits<double>::infinity();
+    double inv = 1.0 / temp, m;
+    double s = onlineNormaliser(x, n, inv, m);
+    double r = 1.0 / s;
+    for (size_t i = 0; i < n; i++)
+        y[i] = expfn(x[i] * inv - m) * r;
+    return m + std::log(s);
+}
+
+/**
+ * @brief Row-wise softmax of a row-major batch, rows spread over threads
+ * @param x input (rows x n)
+ * @param y probabilities (rows x n, may alias x)
+ * @param rows number of rows
+ * @param n values per row
+ * @param temp temperature
+ */
+void softmax(const double* x, double* y, size_t rows, size_t n, double temp) {
+    parallelFor(rows, std::max<size_t>(1, 4096 / std::max<size_t>(n, 1)), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++)
+            softmax(x + r * n, y + r * n, n, temp);
+    });
+}
+
+/**
+ * @brief Vector-Jacobian product of softmax: given p = softmax(x) and the
+ *      upstream gradient g, dL/dx = p * (g - <g, p>). O(n), no Jacobian.
+ * @param p softmax output
+ * @param g upstream gradient
+ * @param out gradient with respect to the softmax input (may alias g)
+ * @param n number of values
+ * @param temp temperature used in the forward pass
+ */
+void softmaxvjp(const double* p, const double* g, double* out, size_t n, double temp) {
+    double dot = 0.0;
+    for (size_t i = 0; i < n; i++)
+        dot += g[i] * p[i];
+    double inv = 1.0 / temp;
+    for (size_t i = 0; i < n; i++)
+        out[i] = p[i] * (g[i] - dot) * inv;
+}
+
+//----------------SOFTMAX CROSS ENTROPY----------------//
+
+/**
+ * @brief Fused softmax and cross-entropy for one row. The forward pass
+ *      gathers the running max, the normaliser, sum(y) and sum(y * z) in one
+ *      read of the logits; the backward pass writes dL/dz = p sum(y) - y,
+ *      which is p - y for a probability target.
+ * @param z logits
+ * @param y target distribution
+ * @param grad gradient with respect to the logits (may be null)
+ * @param n number of classes
+ * @return -sum(y log softmax(z))
+ */
+double softmaxcrossentropy(const double* z, const double* y, double* grad, size_t n) {
+    if (n == 0)
+        return 0.0;
+    double m = -std::numeric_limits<double>::infinity(), s = 0.0, ysum = 0.0, yz = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        if (z[i] > m) {
+            s = s * expfn(m - z[i]) + 1.0;
+            m = z[i];
+        }
+        else
+            s += expfn(z[i] - m);
+        ysum += y[i];
+        yz += y[i] * z[i];
+    }
+    double lse = m + std::log(s);
+    if (grad) {
+        double r = 1.0 / s;
+        for (size_t i = 0; i < n; i++)
+            grad[i] = expfn(z[i] - m) * r * ysum - y[i];
+    }
+    return ysum * lse - yz;
+}
+
+/**
+ * @brief Fused softmax and cross-entropy for one row with a class label
+ * @param z logits
+ * @param label index of the true class
+ * @param grad gradient with respect to the logits, p - onehot(label) (may be null)
+ * @param n number of classes
+ * @return -log softmax(z)[label]
+ * @throws std::invalid_argument if label >= n
+ */
+double softmaxcrossentropy(const double* z, unsigned int label, double* grad, size_t n) {
+    if (label >= n)
+        throw std::invalid_argument("class label out of range");
+    double m;
+    double s = onlineNormaliser(z, n, 1.0, m);
+    if (grad) {
+        double r = 1.0 / s;
+        for (size_t i = 0; i < n; i++)
+            grad[i] = expfn(z[i] - m) * r;
+        grad[label] -= 1.0;
+    }
+    return m + std::log(s) - z[label];
+}
+
+/**
+ * @brief Batched fused softmax and cross-entropy over row-major logits and
+ *      targets. Rows are spread over threads; the loss and the gradient are
+ *      those of the batch mean, so grad rows carry a 1 / rows factor.
+ * @param z logits (rows x n)
+ * @param y targets (rows x n)
+ * @param grad gradient (rows x n, may be null)
+ * @param rows batch size
+ * @param n number of classes
+ * @return mean cross-entropy over the batch
+ */
+double softmaxcrossentropy(const double* z, const double* y, double* grad, size_t rows, size_t n) {
+    if (rows == 0)
+        return 0.0;
+    double inv = 1.0 / (double)rows;
+    double total = parallelSum(rows, std::max<size_t>(1, 4096 / std::max<size_t>(n, 1)), [&](size_t begin, size_t end) {
+        double part = 0.0;
+        for (size_t r = begin; r < end; r++) {
+            double* g = grad ? grad + r * n : nullptr;
+            part += softmaxcrossentropy(z + r * n, y + r * n, g, n);
+            if (g) {
+                for (size_t i = 0; i < n; i++)
+                    g[i] *= inv;
+            }
+        }
+        return part;
+    });
+    return total * inv;
+}
+
+/**
+ * @brief Batched fused softmax and cross-entropy with class labels
+ * @param z logits (rows x n)
+ * @param labels true class of each row
+ * @param grad gradient (rows x n, may be null)
+ * @param rows batch size
+ * @param n number of classes
+ * @return mean cross-entropy over the batch
+ */
+double softmaxcrossentropy(const double* z, const unsigned int* labels, double* grad, size_t rows, size_t n) {
+    if (rows == 0)
+        return 0.0;
+    double inv = 1.0 / (double)rows;
+    double total = parallelSum(rows, std::max<size_t>(1, 4096 / std::max<size_t>(n, 1)), [&](size_t begin, size_t end) {
+        double part = 0.0;
+        for (size_t r = begin; r < end; r++) {
+            double* g = grad ? grad + r * n : nullptr;
+            part += softmaxcrossentropy(z + r * n, labels[r], g, n);
+            if (g) {
+                for (size_t i = 0; i < n; i++)
+                    g[i] *= inv;
+            }
+        }
+        return part;
+    });
+    return total * inv;
+}
@@ -0,0 +1,66 @@
+
+#ifndef FFT_HPP
+#define FFT_HPP 1
+
+#include <vector>
+#include <complex>
+#include <memory>
+#include <cstddef>
+
+using cplx = std::complex<double>;
+
+/**
+ * @brief CLASS: Precomputed plan for a complex FFT of length n.
+ *      Lengths whose prime factors are 2, 3 and 5 use a mixed-radix
+ *      decimation-in-time transform; any other length is computed with
+ *      Bluestein's chirp-z algorithm on top of a smooth-length plan.
+ *      Plans are immutable after construction, so one plan can be used by
+ *      many threads at once.
+ * @param n transform length
+ * @param factors (radix, remaining length) pairs of the mixed-radix stages
+ * @param twiddles exp(-2 pi i k / n) for k in [0, n)
+ */
+class fftplan {
+public:
+    size_t n;                           // transform length
+    std::vector<size_t> factors;        // (radix, remaining length) pairs
+    std::vector<cplx> twiddles;         // forward twiddle factors
+    bool bluestein;                     // true if n has a prime factor > 5
+    size_t m;                           // padded length for bluestein
+    std::vector<cplx> chirp;            // exp(-pi i k^2 / n)
+    std::vector<cplx> chirpfft;         // FFT of the padded conjugate chirp
+    std::shared_ptr<const fftplan> sub; // smooth-length plan for bluestein
+
+    fftplan(size_t n);
+    void execute(const cplx* in, cplx* out, bool inverse) const;   // unnormalised transform
+
+    ~fftplan() {};
+};
+
+std::shared_ptr<const fftplan> getplan(size_t n);   // cached plan for length n
+size_t fftsize(size_t n);                           // smallest 2/3/5-smooth length >= n
+
+// complex transforms (inverse transforms are normalised by 1/n)
+
+std::vector<cplx> fft(const std::vector<cplx>&);
+std::vector<cplx> ifft(const std::vector<cplx>&);
+void fftinplace(std::vector<cplx>&);
+void ifftinplace(std::vector<cplx>&);
+
+// real transforms (n/2 + 1 non-negative frequency bins)
+
+std::vector<cplx> rfft(const std::vector<double>&);
+std::vector<double> irfft(const std::vector<cplx>&, size_t n);
+
+// multidimensional transforms on row-major data, in place
+
+void fftn(std::vector<cplx>&, const std::vector<size_t>& shape, bool inverse = false);
+void fft2(std::vector<cplx>&, size_t rows, size_t cols, bool inverse = false);
+void fft3(std::vector<cplx>&, size_t d0, size_t d1, size_t d2, bool inverse = false);
+
+// convolution and correlation (full length na + nb - 1)
+
+std::vector<double> convolve(const std::vector<double>&, const std::vector<double>&);
+std::vector<double> correlate(const std::vector<double>&, const std::vector<double>&);
+
+#endif
@@ -0,0 +1,471 @@
+
+#include "include/fft.hpp"
+#include "include/parallel.hpp"
+#include <stdexcept>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+
+static const double pi = 3.14159265358979323846;
+
+//----------------BUTTERFLIES----------------//
+
+/**
+ * @brief Complex product written out in real arithmetic so the butterfly
+ *      loops vectorise (std::complex multiplication carries NaN/inf checks).
+ */
+static inline cplx cmul(const cplx& a, const cplx& b) {
+    return cplx(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+/**
+ * @brief Radix-2 butterflies for outputs k in [k0, k1) of a stage of length 2m
+ */
+static void butterfly2(cplx* F, size_t fs, const cplx* tw, size_t m, size_t k0, size_t k1) {
+    cplx* F2 = F + m;
+    for (size_t k = k0; k < k1; k++) {
+        cplx t = cmul(F2[k], tw[k * fs]);
+        F2[k] = F[k] - t;
+        F[k] += t;
+    }
+}
+
+/**
+ * @brief Radix-3 butterflies for outputs k in [k0, k1) of a stage of length 3m
+ */
+static void butterfly3(cplx* F, size_t fs, const cplx* tw, size_t m, size_t k0, size_t k1) {
+    double epi3 = tw[fs * m].imag();     // imaginary part of exp(-2 pi i / 3)
+    for (size_t k = k0; k < k1; k++) {
+        cplx s1 = cmul(F[k + m], tw[k * fs]);
+        cplx s2 = cmul(F[k + 2 * m], tw[2 * k * fs]);
+        cplx s3 = s1 + s2;
+        cplx s0 = (s1 - s2) * epi3;
+        cplx a = F[k] - s3 * 0.5;
+        F[k] += s3;
+        F[k + 2 * m] = cplx(a.real() + s0.imag(), a.imag() - s0.real());
+        F[k + m] = cplx(a.real() - s0.imag(), a.imag() + s0.real());
+    }
+}
+
+/**
+ * @brief Radix-4 butterflies for outputs k in [k0, k1) of a stage of length 4m
+ */
+static void butterfly4(cplx* F, size_t fs, const cplx* tw, size_t m, size_t k0, size_t k1) {
+    for (size_t k = k0; k < k1; k++) {
+        cplx s0 = cmul(F[k + m], tw[k * fs]);
+        cplx s1 = cmul(F[k + 2 * m], tw[2 * k * fs]);
+        cplx s2 = cmul(F[k + 3 * m], tw[3 * k * fs]);
+        cplx s5 = F[k] - s1;
+        cplx f0 = F[k] + s1;
+        cplx s3 = s0 + s2, s4 = s0 - s2;
+        F[k + 2 * m] = f0 - s3;
+        F[k] = f0 + s3;
+        F[k + m] = cplx(s5.real() + s4.imag(), s5.imag() - s4.real());
+        F[k + 3 * m] = cplx(s5.real() - s4.imag(), s5.imag() + s4.real());
+    }
+}
+
+/**
+ * @brief Generic radix-p butterflies (used for radix 5) for outputs u in [k0, k1)
+ */
+static void butterflyp(cplx* F, size_t fs, const cplx* tw, size_t m, size_t p, size_t n, size_t k0, size_t k1) {
+    std::vector<cplx> scratch(p);
+    for (size_t u = k0; u < k1; u++) {
+        for (size_t q = 0, k = u; q < p; q++, k += m)
+            scratch[q] = F[k];
+        for (size_t q1 = 0, k = u; q1 < p; q1++, k += m) {
+            size_t idx = 0;
+            cplx sum = scratch[0];
+            for (size_t q = 1; q < p; q++) {
+                idx += fs * k;
+                if (idx >= n)
+                    idx %= n;
+                sum += cmul(scratch[q], tw[idx]);
+            }
+            F[k] = sum;
+        }
+    }
+}
+
+//----------------PLAN----------------//
+
+/**
+ * @brief Recursive mixed-radix decimation in time. Each stage gathers p
+ *      interleaved sub-transforms of length m and combines them with radix-p
+ *      butterflies. At the top level of a long transform the p sub-transforms
+ *      and the butterflies are split across threads.
+ */
+static void work(const fftplan& pl, cplx* out, const cplx* in, size_t fstride, size_t stage, bool top) {
+    size_t p = pl.factors[2 * stage];
+    size_t m = pl.factors[2 * stage + 1];
+    bool parallel = top && pl.n >= (1u << 15);
+    if (m == 1) {
+        for (size_t q = 0; q < p; q++)
+            out[q] = in[q * fstride];
+    }
+    else if (parallel) {
+        parallelFor(p, 1, [&](size_t begin, size_t end) {
+            for (size_t q = begin; q < end; q++)
+                work(pl, out + q * m, in + q * fstride, fstride * p, stage + 1, false);
+        });
+    }
+    else {
+        for (size_t q = 0; q < p; q++)
+            work(pl, out + q * m, in + q * fstride, fstride * p, stage + 1, false);
+    }
+    auto combine = [&](size_t k0, size_t k1) {
+        switch (p) {
+            case 2: butterfly2(out, fstride, pl.twiddles.data(), m, k0, k1); break;
+            case 3: butterfly3(out, fstride, pl.twiddles.data(), m, k0, k1); break;
+            case 4: butterfly4(out, fstride, pl.twiddles.data(), m, k0, k1); break;
+            default: butterflyp(out, fstride, pl.twiddles.data(), m, p, pl.n, k0, k1); break;
+        }
+    };
+    if (parallel)
+        parallelFor(m, 4096, combine);
+    else
+        combine(0, m);
+}
+
+/**
+ * @brief Smallest length >= n whose prime factors are only 2, 3 and 5
+ * @param n minimum length
+ * @return smooth length
+ */
+size_t fftsize(size_t n) {
+    if (n <= 1)
+        return 1;
+    size_t best = 1;
+    while (best < n)
+        best *= 2;
+    for (size_t p5 = 1; p5 < best; p5 *= 5)
+        for (size_t p3 = p5; p3 < best; p3 *= 3) {
+            size_t v = p3;
+            while (v < n)
+                v *= 2;
+            best = std::min(best, v);
+        }
+    return best;
+}
+
+/**
+ * @brief Build the plan for a transform of length n: factorisation into
+ *      radices 4, 2, 3, 5 and the twiddle table, or the Bluestein chirp and
+ *      its transform when n has a larger prime factor.
+ * @param n transform length
+ */
+fftplan::fftplan(size_t n):n(n), bluestein(false), m(0) {
+    size_t rest = n;
+    for (size_t p : {4, 2, 3, 5}) {
+        while (rest > 1 && rest % p == 0) {
+            rest /= p;
+            factors.push_back(p);
+            factors.push_back(rest);
+        }
+    }
+    if (rest > 1) {
+        // Bluestein: X_k = w_k * sum_j (x_j w_j) conj(w_{k-j}), w_k = exp(-pi i k^2 / n)
+        bluestein = true;
+        factors.clear();
+        m = fftsize(2 * n - 1);
+        sub = getplan(m);
+        chirp.resize(n);
+        for (size_t k = 0; k < n; k++) {
+            size_t k2 = (k * k) % (2 * n);
+            chirp[k] = std::polar(1.0, -pi * (double)k2 / (double)n);
+        }
+        std::vector<cplx> b(m, cplx(0.0, 0.0));
+        b[0] = std::conj(chirp[0]);
+        for (size_t k = 1; k < n; k++)
+            b[k] = b[m - k] = std::conj(chirp[k]);
+        chirpfft.resize(m);
+        sub->execute(b.data(), chirpfft.data(), false);
+        return;
+    }
+    twiddles.resize(n);
+    for (size_t k = 0; k < n; k++)
+        twiddles[k] = std::polar(1.0, -2.0 * pi * (double)k / (double)n);
+}
+
+/**
+ * @brief Run the transform (unnormalised in both directions). The inverse is
+ *      computed as conj(FFT(conj(x))). in and out may alias.
+ * @param in input of length n
+ * @param out output of length n
+ * @param inverse true for the inverse (positive exponent) transform
+ */
+void fftplan::execute(const cplx* in, cplx* out, bool inverse) const {
+    if (n <= 1) {
+        if (n == 1)
+            out[0] = in[0];
+        return;
+    }
+    std::vector<cplx> src(in, in + n);
+    if (inverse)
+        for (auto& v : src)
+            v = std::conj(v);
+    if (bluestein) {
+        std::vector<cplx> a(m, cplx(0.0, 0.0));
+        for (size_t k = 0; k < n; k++)
+            a[k] = cmul(src[k], chirp[k]);
+        sub->execute(a.data(), a.data(), false);
+        for (size_t k = 0; k < m; k++)
+            a[k] = cmul(a[k], chirpfft[k]);
+        sub->execute(a.data(), a.data(), true);
+        double scale = 1.0 / (double)m;
+        for (size_t k = 0; k < n; k++)
+            out[k] = cmul(a[k], chirp[k]) * scale;
+    }
+    else {
+        work(*this, out, src.data(), 1, 0, true);
+    }
+    if (inverse)
+        for (size_t k = 0; k < n; k++)
+            out[k] = std::conj(out[k]);
+}
+
+/**
+ * @brief Cached plan for length n. Plans are built once per length and
+ *      shared; construction happens outside the lock because Bluestein plans
+ *      request their own sub-plan.
+ * @param n transform length
+ * @return shared immutable plan
+ */
+std::shared_ptr<const fftplan> getplan(size_t n) {
+    static std::mutex lock;
+    static std::map<size_t, std::shared_ptr<const fftplan>> cache;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = cache.find(n);
+        if (it != cache.end())
+            return it->second;
+    }
+    auto plan = std::make_shared<const fftplan>(n);
+    std::lock_guard<std::mutex> guard(lock);
+    return cache.emplace(n, plan).first->second;
+}
+
+//----------------1-D TRANSFORMS----------------//
+
+/**
+ * @brief Forward complex FFT (out of place)
+ * @param x input sequence
+ * @return spectrum X_k = sum_j x_j exp(-2 pi i j k / n)
+ */
+std::vector<cplx> fft(const std::vector<cplx>& x) {
+    std::vector<cplx> y(x.size());
+    getplan(x.size())->execute(x.data(), y.data(), false);
+    return y;
+}
+
+/**
+ * @brief Inverse complex FFT (out of place), normalised by 1/n
+ * @param x spectrum
+ * @return sequence
+ */
+std::vector<cplx> ifft(const std::vector<cplx>& x) {
+    std::vector<cplx> y(x);
+    ifftinplace(y);
+    return y;
+}
+
+/**
+ * @brief Forward complex FFT in place
+ * @param x sequence, replaced by its spectrum
+ */
+void fftinplace(std::vector<cplx>& x) {
+    getplan(x.size())->execute(x.data(), x.data(), false);
+}
+
+/**
+ * @brief Inverse complex FFT in place, normalised by 1/n
+ * @param x spectrum, replaced by its sequence
+ */
+void ifftinplace(std::vector<cplx>& x) {
+    getplan(x.size())->execute(x.data(), x.data(), true);
+    double scale = x.empty() ? 1.0 : 1.0 / (double)x.size();
+    for (auto& v : x)
+        v *= scale;
+}
+
+/**
+ * @brief FFT of a real sequence. Even lengths pack the sequence into a
+ *      complex sequence of half the length and untangle the result, which
+ *      halves the work of a complex transform.
+ * @param x real sequence of length n
+ * @return bins 0 .. n/2 of the spectrum
+ */
+std::vector<cplx> rfft(const std::vector<double>& x) {
+    size_t n = x.size();
+    if (n == 0)
+        return {};
+    if (n % 2) {
+        std::vector<cplx> z(x.begin(), x.end());
+        fftinplace(z);
+        z.resize(n / 2 + 1);
+        return z;
+    }
+    size_t h = n / 2;
+    std::vector<cplx> z(h);
+    for (size_t k = 0; k < h; k++)
+        z[k] = cplx(x[2 * k], x[2 * k + 1]);
+    fftinplace(z);
+    std::vector<cplx> X(h + 1);
+    for (size_t k = 0; k <= h; k++) {
+        cplx zk = z[k % h];
+        cplx zc = std::conj(z[(h - k) % h]);
+        cplx even = (zk + zc) * 0.5;
+        cplx odd = (zk - zc) * cplx(0.0, -0.5);
+        X[k] = even + cmul(std::polar(1.0, -2.0 * pi * (double)k / (double)n), odd);
+    }
+    return X;
+}
+
+/**
+ * @brief Inverse of rfft, normalised by 1/n
+ * @param X bins 0 .. n/2 of a hermitian spectrum
+ * @param n length of the real sequence
+ * @return real sequence of length n
+ * @throws std::invalid_argument if the number of bins does not match n
+ */
+std::vector<double> irfft(const std::vector<cplx>& X, size_t n) {
+    if (X.size() != n / 2 + 1)
+        throw std::invalid_argument("irfft: expected n/2 + 1 bins");
+    if (n == 0)
+        return {};
+    std::vector<double> x(n);
+    if (n % 2) {
+        std::vector<cplx> z(n);
+        for (size_t k = 0; k <= n / 2; k++)
+            z[k] = X[k];
+        for (size_t k = n / 2 + 1; k < n; k++)
+            z[k] = std::conj(X[n - k]);
+        ifftinplace(z);
+        for (size_t k = 0; k < n; k++)
+            x[k] = z[k].real();
+        return x;
+    }
+    size_t h = n / 2;
+    std::vector<cplx> z(h);
+    for (size_t k = 0; k < h; k++) {
+        cplx xc = std::conj(X[h - k]);
+        cplx even = (X[k] + xc) * 0.5;
+        cplx odd = cmul((X[k] - xc) * 0.5, std::polar(1.0, 2.0 * pi * (double)k / (double)n));
+        z[k] = even + cplx(-odd.imag(), odd.real());
+    }
+    ifftinplace(z);
+    for (size_t k = 0; k < h; k++) {
+        x[2 * k] = z[k].real();
+        x[2 * k + 1] = z[k].imag();
+    }
+    return x;
+}
+
+//----------------N-D TRANSFORMS----------------//
+
+/**
+ * @brief Transform every line along one axis of row-major data. Lines are
+ *      independent and are split across threads; each thread gathers a line
+ *      into its own scratch buffer.
+ */
+static void transformAxis(std::vector<cplx>& data, const std::vector<size_t>& shape, size_t axis, bool inverse) {
+    size_t len = shape[axis];
+    size_t outer = 1, inner = 1;
+    for (size_t d = 0; d < axis; d++)
+        outer *= shape[d];
+    for (size_t d = axis + 1; d < shape.size(); d++)
+        inner *= shape[d];
+    auto plan = getplan(len);
+    parallelFor(outer * inner, std::max<size_t>(1, 8192 / std::max<size_t>(len, 1)), [&](size_t begin, size_t end) {
+        std::vector<cplx> line(len);
+        for (size_t l = begin; l < end; l++) {
+            size_t base = (l / inner) * len * inner + (l % inner);
+            for (size_t k = 0; k < len; k++)
+                line[k] = data[base + k * inner];
+            plan->execute(line.data(), line.data(), inverse);
+            for (size_t k = 0; k < len; k++)
+                data[base + k * inner] = line[k];
+        }
+    });
+}
+
+/**
+ * @brief N-dimensional FFT in place on row-major data
+ * @param data elements in row-major order
+ * @param shape extent of each axis
+ * @param inverse true for the inverse transform (normalised by 1/size)
+ * @throws std::invalid_argument if the data size does not match the shape
+ */
+void fftn(std::vector<cplx>& data, const std::vector<size_t>& shape, bool inverse) {
+    size_t total = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+    if (total != data.size())
+        throw std::invalid_argument("fftn: data size does not match shape");
+    for (size_t axis = shape.size(); axis-- > 0;)
+        transformAxis(data, shape, axis, inverse);
+    if (inverse && total > 0) {
+        double scale = 1.0 / (double)total;
+        parallelFor(total, 16384, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                data[i] *= scale;
+        });
+    }
+}
+
+/**
+ * @brief 2-D FFT in place on a row-major rows x cols array
+ */
+void fft2(std::vector<cplx>& data, size_t rows, size_t cols, bool inverse) {
+    fftn(data, {rows, cols}, inverse);
+}
+
+/**
+ * @brief 3-D FFT in place on a row-major d0 x d1 x d2 array
+ */
+void fft3(std::vector<cplx>& data, size_t d0, size_t d1, size_t d2, bool inverse) {
+    fftn(data, {d0, d1, d2}, inverse);
+}
+
+//----------------CONVOLUTION----------------//
+
+/**
+ * @brief Full linear convolution, c_k = sum_j a_j b_{k-j}. Short kernels use
+ *      the direct sum; long ones use real FFTs of a smooth padded length.
+ * @param a first sequence
+ * @param b second sequence
+ * @return convolution of length na + nb - 1
+ */
+std::vector<double> convolve(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.empty() || b.empty())
+        return {};
+    size_t len = a.size() + b.size() - 1;
+    if (std::min(a.size(), b.size()) <= 32) {
+        std::vector<double> c(len, 0.0);
+        for (size_t i = 0; i < a.size(); i++)
+            for (size_t j = 0; j < b.size(); j++)
+                c[i + j] += a[i] * b[j];
+        return c;
+    }
+    size_t n = fftsize(len);
+    std::vector<double> pa(a), pb(b);
+    pa.resize(n, 0.0);
+    pb.resize(n, 0.0);
+    std::vector<cplx> A = rfft(pa), B = rfft(pb);
+    for (size_t k = 0; k < A.size(); k++)
+        A[k] = cmul(A[k], B[k]);
+    std::vector<double> c = irfft(A, n);
+    c.resize(len);
+    return c;
+}
+
+/**
+ * @brief Full cross-correlation, c_k = sum_j a_{j+k} b_j for lags
+ *      k = -(nb - 1) .. na - 1; element 0 of the result is lag -(nb - 1).
+ * @param a signal
+ * @param b template
+ * @return correlation of length na + nb - 1
+ */
+std::vector<double> correlate(const std::vector<double>& a, const std::vector<double>& b) {
+    std::vector<double> rb(b.rbegin(), b.rend());
+    return convolve(a, rb);
+}
@@ -0,0 +1,50 @@
+
+#ifndef EIGEN_HPP
+#define EIGEN_HPP 1
+
+#include "mat.hpp"
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Result of a symmetric eigendecomposition A = V * diag(values) * V^T
+ * @param values eigenvalues in ascending order
+ * @param vectors eigenvectors stored as columns, in the order of values
+ */
+struct eigresult {
+    std::vector<double> values;
+    mat vectors;
+};
+
+/**
+ * @brief Result of a singular value decomposition A = U * diag(s) * V^T
+ * @param u left singular vectors as columns (m x k)
+ * @param s singular values in descending order (k)
+ * @param v right singular vectors as columns (n x k)
+ */
+struct svdresult {
+    mat u;
+    std::vector<double> s;
+    mat v;
+};
+
+/**
+ * @brief Principal component analysis of a data matrix (samples as rows)
+ * @param mean column means removed before the decomposition
+ * @param components principal axes as columns (features x k)
+ * @param variance explained variance of each component
+ */
+struct pcaresult {
+    std::vector<double> mean;
+    mat components;
+    std::vector<double> variance;
+};
+
+eigresult eigsym(const mat&);                   // symmetric eigensolver (tridiagonal QL)
+svdresult svd(const mat&);                      // full thin SVD (one-sided Jacobi)
+svdresult rsvd(const mat&, int k, int oversample = 10, int power = 2,
+               uint64_t seed = 0);              // randomized truncated SVD (top k)
+pcaresult pca(const mat&, int k);               // top k principal components
+mat pcatransform(const pcaresult&, const mat&); // project samples onto the components
+
+#endif
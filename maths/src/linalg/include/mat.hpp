@@ -8,6 +8,7 @@
 #include <numeric>
 #include <iostream>
 #include <cmath>
+#include <utility>
 
 /**
  * @brief CLASS: Matrix class
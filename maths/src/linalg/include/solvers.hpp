@@ -0,0 +1,93 @@
+
+#ifndef SOLVERS_HPP
+#define SOLVERS_HPP 1
+
+#include "mat.hpp"
+#include "sparse.hpp"
+#include <vector>
+#include <functional>
+
+/**
+ * @brief Matrix-free linear operator: writes y = A * x. Both arrays have the
+ *      length of the system; the solver never needs A itself.
+ */
+using linop = std::function<void(const double* x, double* y)>;
+
+linop makeOperator(const mat&);         // operator for a dense square matrix
+linop makeOperator(const csr&);         // operator for a sparse square matrix
+
+/**
+ * @brief CLASS: Preconditioner, applies z = M^-1 * r.
+ *      The base class is the identity (no preconditioning).
+ */
+class precond {
+public:
+    precond() = default;
+    virtual void apply(const double* r, double* z, int n) const;   // z = M^-1 * r
+    virtual ~precond() {};
+};
+
+/**
+ * @brief CLASS: Jacobi (diagonal) preconditioner, M = diag(A)
+ * @param inv reciprocal of the diagonal of A
+ */
+class jacobi : public precond {
+public:
+    std::vector<double> inv;    // 1 / a_ii
+
+    jacobi(const mat&);
+    jacobi(const csr&);
+    void apply(const double* r, double* z, int n) const override;
+};
+
+/**
+ * @brief CLASS: Incomplete LU factorisation with zero fill-in, M = L * U with
+ *      the sparsity pattern of A. L has a unit diagonal and is stored below the
+ *      diagonal of lu, U on and above it.
+ * @param lu factors sharing the pattern of A
+ * @param diag position of the diagonal entry of each row in lu
+ */
+class ilu0 : public precond {
+public:
+    csr lu;                     // combined L and U factors
+    std::vector<int> diag;      // index of a_ii in lu.val
+
+    ilu0(const csr&);
+    void apply(const double* r, double* z, int n) const override;
+};
+
+/**
+ * @brief Result of an iterative solve
+ * @param iterations number of iterations performed
+ * @param residual final relative residual ||b - A x|| / ||b||
+ * @param converged true if residual <= tolerance
+ */
+struct solverresult {
+    int iterations;
+    double residual;
+    bool converged;
+};
+
+// Krylov solvers, x holds the initial guess and receives the solution
+
+solverresult cg(const linop&, const std::vector<double>& b, std::vector<double>& x,
+                const precond& M = precond(), double tol = 1e-8, int maxit = 1000);
+solverresult gmres(const linop&, const std::vector<double>& b, std::vector<double>& x,
+                   const precond& M = precond(), int restart = 30, double tol = 1e-8, int maxit = 1000);
+solverresult bicgstab(const linop&, const std::vector<double>& b, std::vector<double>& x,
+                      const precond& M = precond(), double tol = 1e-8, int maxit = 1000);
+
+solverresult cg(const mat&, const std::vector<double>&, std::vector<double>&, const precond& M = precond(),
+                double tol = 1e-8, int maxit = 1000);
+solverresult cg(const csr&, const std::vector<double>&, std::vector<double>&, const precond& M = precond(),
+                double tol = 1e-8, int maxit = 1000);
+solverresult gmres(const mat&, const std::vector<double>&, std::vector<double>&, const precond& M = precond(),
+                   int restart = 30, double tol = 1e-8, int maxit = 1000);
+solverresult gmres(const csr&, const std::vector<double>&, std::vector<double>&, const precond& M = precond(),
+                   int restart = 30, double tol = 1e-8, int maxit = 1000);
+solverresult bicgstab(const mat&, const std::vector<double>&, std::vector<double>&, const precond& M = precond(),
+                      double tol = 1e-8, int maxit = 1000);
+solverresult bicgstab(const csr&, const std::vector<double>&, std::vector<double>&, const precond& M = precond(),
+                      double tol = 1e-8, int maxit = 1000);
+
+#endif
@@ -0,0 +1,86 @@
+
+#ifndef SPARSE_HPP
+#define SPARSE_HPP 1
+
+#include "mat.hpp"
+#include <vector>
+
+class csc;
+
+/**
+ * @brief CLASS: Compressed Sparse Row matrix
+ * @param row number of rows
+ * @param col number of columns
+ * @param ptr row pointers, nonzeros of row i are in [ptr[i], ptr[i+1])
+ * @param idx column index of each nonzero (sorted within a row)
+ * @param val value of each nonzero
+ */
+class csr {
+public:
+    int row;
+    int col;
+    std::vector<int> ptr;       // row pointers (row + 1 entries)
+    std::vector<int> idx;       // column indices
+    std::vector<double> val;    // nonzero values
+
+    // default constructor
+    csr():row(0), col(0), ptr(1, 0) {}
+    csr(int r, int c);                      // empty r*c matrix
+    csr(int r, int c, const std::vector<int>& ri, const std::vector<int>& ci,
+        const std::vector<double>& v);      // from COO triplets (duplicates are summed)
+    csr(const mat&);                        // from dense matrix (drops exact zeros)
+    csr(const csc&);                        // from compressed sparse column
+
+    int nnz() const { return ptr.back(); }
+    mat todense() const;                    // convert to dense mat
+    csc tocsc() const;                      // convert to compressed sparse column
+    csr transpose() const;                  // new matrix as transpose of matrix
+
+    void spmv(const double* x, double* y) const;                    // y = A * x
+    std::vector<double> operator*(const std::vector<double>&) const;    // SpMV
+    csr operator*(const csr&) const;        // SpMM (sparse * sparse)
+    mat operator*(const mat&) const;        // sparse * dense GEMM
+
+    ~csr() {};
+};
+
+/**
+ * @brief CLASS: Compressed Sparse Column matrix
+ * @param row number of rows
+ * @param col number of columns
+ * @param ptr column pointers, nonzeros of column j are in [ptr[j], ptr[j+1])
+ * @param idx row index of each nonzero (sorted within a column)
+ * @param val value of each nonzero
+ */
+class csc {
+public:
+    int row;
+    int col;
+    std::vector<int> ptr;       // column pointers (col + 1 entries)
+    std::vector<int> idx;       // row indices
+    std::vector<double> val;    // nonzero values
+
+    // default constructor
+    csc():row(0), col(0), ptr(1, 0) {}
+    csc(int r, int c);                      // empty r*c matrix
+    csc(int r, int c, const std::vector<int>& ri, const std::vector<int>& ci,
+        const std::vector<double>& v);      // from COO triplets (duplicates are summed)
+    csc(const mat&);                        // from dense matrix (drops exact zeros)
+    csc(const csr&);                        // from compressed sparse row
+
+    int nnz() const { return ptr.back(); }
+    mat todense() const;                    // convert to dense mat
+    csr tocsr() const;                      // convert to compressed sparse row
+    csc transpose() const;                  // new matrix as transpose of matrix
+
+    void spmv(const double* x, double* y) const;                    // y = A * x
+    std::vector<double> operator*(const std::vector<double>&) const;    // SpMV
+    csc operator*(const csc&) const;        // SpMM (sparse * sparse)
+    mat operator*(const mat&) const;        // sparse * dense GEMM
+
+    ~csc() {};
+};
+
+mat operator*(const mat&, const csr&);      // dense * sparse GEMM
+
+#endif
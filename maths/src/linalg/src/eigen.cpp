@@ -0,0 +1,509 @@
+
+#include "include/eigen.hpp"
+#include "include/parallel.hpp"
+#include <stdexcept>
+#include <random>
+#include <limits>
+
+//----------------HELPERS----------------//
+
+/**
+ * @brief Dot product of two contiguous arrays
+ */
+static double dotn(const double* x, const double* y, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++)
+        sum += x[i] * y[i];
+    return sum;
+}
+
+/**
+ * @brief Sort eigen/singular values with their vectors (stored as rows of vt)
+ * @param values values to sort
+ * @param vt one row per value, permuted together with values
+ * @param descending sort order
+ */
+static void sortPairs(std::vector<double>& values, std::vector<std::vector<double>>& vt, bool descending) {
+    std::vector<size_t> order(values.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return descending ? values[a] > values[b] : values[a] < values[b];
+    });
+    std::vector<double> sv(values.size());
+    std::vector<std::vector<double>> st(vt.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sv[i] = values[order[i]];
+        st[i] = std::move(vt[order[i]]);
+    }
+    values = std::move(sv);
+    vt = std::move(st);
+}
+
+/**
+ * @brief Orthonormalise the rows of qt (each row is one column of Q) with
+ *      modified Gram-Schmidt, applied twice for numerical orthogonality.
+ *      Rows that become numerically zero are left as zero.
+ */
+static void orthonormalRows(std::vector<std::vector<double>>& qt) {
+    size_t m = qt.empty() ? 0 : qt[0].size();
+    for (size_t c = 0; c < qt.size(); c++) {
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t p = 0; p < c; p++) {
+                double* q = qt[c].data();
+                const double* r = qt[p].data();
+                double d = parallelSum(m, 16384, [&](size_t b, size_t e) { return dotn(q + b, r + b, e - b); });
+                parallelFor(m, 16384, [&](size_t b, size_t e) {
+                    for (size_t i = b; i < e; i++)
+                        q[i] -= d * r[i];
+                });
+            }
+        }
+        double* q = qt[c].data();
+        double norm = std::sqrt(parallelSum(m, 16384, [&](size_t b, size_t e) { return dotn(q + b, q + b, e - b); }));
+        double inv = (norm > 0.0) ? 1.0 / norm : 0.0;
+        for (size_t i = 0; i < m; i++)
+            q[i] *= inv;
+    }
+}
+
+/**
+ * @brief Ct = (A_c * B)^T where B is given by its columns bt (l x n) and
+ *      A_c = A - 1 * mean^T when mean is given. Parallel over rows of A.
+ * @return l x m matrix stored by rows
+ */
+static std::vector<std::vector<double>> timesColumns(const mat& a, const std::vector<double>* mean,
+                                                     const std::vector<std::vector<double>>& bt) {
+    size_t l = bt.size();
+    std::vector<std::vector<double>> ct(l, std::vector<double>(a.row, 0.0));
+    std::vector<double> shift(l, 0.0);
+    if (mean)
+        for (size_t c = 0; c < l; c++)
+            shift[c] = dotn(mean->data(), bt[c].data(), a.col);
+    parallelFor(a.row, 32, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            for (size_t c = 0; c < l; c++)
+                ct[c][i] = dotn(a.a[i].data(), bt[c].data(), a.col) - shift[c];
+    });
+    return ct;
+}
+
+/**
+ * @brief Zt = (A_c^T * Q)^T where Q is given by its columns qt (l x m) and
+ *      A_c = A - 1 * mean^T when mean is given. Threads own disjoint blocks of
+ *      columns of A, so no reduction between threads is needed.
+ * @return l x n matrix stored by rows
+ */
+static std::vector<std::vector<double>> transposeTimesColumns(const mat& a, const std::vector<double>* mean,
+                                                              const std::vector<std::vector<double>>& qt) {
+    size_t l = qt.size();
+    std::vector<std::vector<double>> zt(l, std::vector<double>(a.col, 0.0));
+    parallelFor(a.col, 64, [&](size_t begin, size_t end) {
+        for (int i = 0; i < a.row; i++) {
+            const double* ai = a.a[i].data();
+            for (size_t c = 0; c < l; c++) {
+                double q = qt[c][i];
+                double* z = zt[c].data();
+                for (size_t j = begin; j < end; j++)
+                    z[j] += q * ai[j];
+            }
+        }
+    });
+    if (mean) {
+        for (size_t c = 0; c < l; c++) {
+            double qsum = std::accumulate(qt[c].begin(), qt[c].end(), 0.0);
+            for (int j = 0; j < a.col; j++)
+                zt[c][j] -= (*mean)[j] * qsum;
+        }
+    }
+    return zt;
+}
+
+/**
+ * @brief One-sided (Hestenes) Jacobi SVD on columns given as rows of w (n x m).
+ *      Column pairs are visited in round-robin tournament order so every
+ *      round is a set of disjoint pairs that are rotated in parallel.
+ * @param w columns of A, replaced by U * diag(s)
+ * @param vt rows of V^T (n x n), must start as identity
+ */
+static void jacobiColumns(std::vector<std::vector<double>>& w, std::vector<std::vector<double>>& vt) {
+    int n = w.size();
+    size_t m = n ? w[0].size() : 0;
+    int players = n + (n % 2);
+    std::vector<int> ring(players);
+    std::iota(ring.begin(), ring.end(), 0);
+    const double eps = std::numeric_limits<double>::epsilon() * 4;
+    size_t grain = std::max<size_t>(1, 16384 / std::max<size_t>(m, 1));
+    for (int sweep = 0; sweep < 60; sweep++) {
+        bool rotated = false;
+        for (int round = 0; round < players - 1; round++) {
+            std::vector<std::pair<int, int>> pairs;
+            for (int k = 0; k < players / 2; k++) {
+                int p = ring[k], q = ring[players - 1 - k];
+                if (p < n && q < n)
+                    pairs.emplace_back(std::min(p, q), std::max(p, q));
+            }
+            std::vector<char> flags(pairs.size(), 0);
+            parallelFor(pairs.size(), grain, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; k++) {
+                    double* wi = w[pairs[k].first].data();
+                    double* wj = w[pairs[k].second].data();
+                    double alpha = dotn(wi, wi, m), beta = dotn(wj, wj, m), gamma = dotn(wi, wj, m);
+                    if (std::abs(gamma) <= eps * std::sqrt(alpha * beta) || gamma == 0.0)
+                        continue;
+                    flags[k] = 1;
+                    double zeta = (beta - alpha) / (2.0 * gamma);
+                    double t = std::copysign(1.0, zeta) / (std::abs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                    double c = 1.0 / std::sqrt(1.0 + t * t), s = c * t;
+                    for (size_t i = 0; i < m; i++) {
+                        double x = wi[i], y = wj[i];
+                        wi[i] = c * x - s * y;
+                        wj[i] = s * x + c * y;
+                    }
+                    double* vi = vt[pairs[k].first].data();
+                    double* vj = vt[pairs[k].second].data();
+                    for (int i = 0; i < n; i++) {
+                        double x = vi[i], y = vj[i];
+                        vi[i] = c * x - s * y;
+                        vj[i] = s * x + c * y;
+                    }
+                }
+            });
+            for (char f : flags)
+                rotated = rotated || f;
+            // rotate every player except the first one
+            std::rotate(ring.begin() + 1, ring.end() - 1, ring.end());
+        }
+        if (!rotated)
+            break;
+    }
+}
+
+//----------------SYMMETRIC EIGENSOLVER----------------//
+
+/**
+ * @brief Eigendecomposition of a symmetric matrix. The matrix is reduced to
+ *      tridiagonal form with Householder reflections (rank-2 updates split
+ *      across rows), the tridiagonal problem is solved by implicit QL with
+ *      Wilkinson shifts, and each QL sweep's rotations are applied to the
+ *      eigenvector matrix in parallel blocks of rows. The reflectors are then
+ *      applied to the eigenvectors in parallel blocks of columns.
+ * @param a symmetric square matrix (only symmetry of the input is assumed, not checked)
+ * @return eigenvalues in ascending order and matching eigenvectors as columns
+ * @throws std::invalid_argument if the matrix is not square
+ * @throws std::runtime_error if QL does not converge
+ */
+eigresult eigsym(const mat& a) {
+    if (a.row != a.col)
+        throw std::invalid_argument("eigsym: matrix must be square");
+    int n = a.row;
+    std::vector<double> A(size_t(n) * n);
+    for (int i = 0; i < n; i++)
+        std::copy(a.a[i].begin(), a.a[i].end(), A.begin() + size_t(i) * n);
+    std::vector<double> d(n, 0.0), e(n, 0.0);
+    std::vector<std::vector<double>> reflectors;
+    std::vector<double> betas;
+
+    // Householder tridiagonalisation
+    for (int k = 0; k + 2 < n; k++) {
+        int s = n - k - 1;
+        std::vector<double> v(s);
+        for (int i = 0; i < s; i++)
+            v[i] = A[size_t(k + 1 + i) * n + k];
+        double norm = std::sqrt(dotn(v.data(), v.data(), s));
+        double alpha = (v[0] > 0) ? -norm : norm;
+        d[k] = A[size_t(k) * n + k];
+        e[k] = alpha;
+        v[0] -= alpha;
+        double vv = dotn(v.data(), v.data(), s);
+        double beta = (norm == 0.0 || vv == 0.0) ? 0.0 : 2.0 / vv;
+        reflectors.push_back(v);
+        betas.push_back(beta);
+        if (beta == 0.0) {
+            e[k] = A[size_t(k + 1) * n + k];
+            continue;
+        }
+        // p = beta * A_sub * v, w = p - (beta / 2) (p^T v) v
+        std::vector<double> p(s);
+        parallelFor(s, 64, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                p[i] = beta * dotn(&A[size_t(k + 1 + i) * n + k + 1], v.data(), s);
+        });
+        double K = 0.5 * beta * dotn(p.data(), v.data(), s);
+        for (int i = 0; i < s; i++)
+            p[i] -= K * v[i];
+        // A_sub = A_sub - v w^T - w v^T
+        parallelFor(s, 64, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                double* row = &A[size_t(k + 1 + i) * n + k + 1];
+                double vi = v[i], wi = p[i];
+                for (int j = 0; j < s; j++)
+                    row[j] -= vi * p[j] + wi * v[j];
+            }
+        });
+    }
+    if (n >= 2) {
+        d[n - 2] = A[size_t(n - 2) * n + n - 2];
+        e[n - 2] = A[size_t(n - 1) * n + n - 2];
+    }
+    if (n >= 1)
+        d[n - 1] = A[size_t(n - 1) * n + n - 1];
+    e[n - 1] = 0.0;
+
+    // implicit QL on the tridiagonal matrix, z starts as identity
+    std::vector<double> z(size_t(n) * n, 0.0);
+    for (int i = 0; i < n; i++)
+        z[size_t(i) * n + i] = 1.0;
+    struct rotation { int i; double c, s; };
+    std::vector<rotation> rots;
+    for (int l = 0; l < n; l++) {
+        int iter = 0, m;
+        do {
+            for (m = l; m < n - 1; m++) {
+                double dd = std::abs(d[m]) + std::abs(d[m + 1]);
+                if (std::abs(e[m]) <= std::numeric_limits<double>::epsilon() * dd)
+                    break;
+            }
+            if (m == l)
+                break;
+            if (++iter > 60)
+                throw std::runtime_error("eigsym: QL iteration did not converge");
+            double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+            double r = std::hypot(g, 1.0);
+            g = d[m] - d[l] + e[l] / (g + std::copysign(r, g));
+            double s = 1.0, c = 1.0, p = 0.0;
+            int i;
+            rots.clear();
+            for (i = m - 1; i >= l; i--) {
+                double f = s * e[i], b = c * e[i];
+                e[i + 1] = (r = std::hypot(f, g));
+                if (r == 0.0) {
+                    d[i + 1] -= p;
+                    e[m] = 0.0;
+                    break;
+                }
+                s = f / r;
+                c = g / r;
+                g = d[i + 1] - p;
+                r = (d[i] - g) * s + 2.0 * c * b;
+                d[i + 1] = g + (p = s * r);
+                g = c * r - b;
+                rots.push_back({i, c, s});
+            }
+            // apply this sweep's rotations to all rows of z
+            parallelFor(n, 64, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; k++) {
+                    double* zk = &z[k * n];
+                    for (const auto& rt : rots) {
+                        double f = zk[rt.i + 1];
+                        zk[rt.i + 1] = rt.s * zk[rt.i] + rt.c * f;
+                        zk[rt.i] = rt.c * zk[rt.i] - rt.s * f;
+                    }
+                }
+            });
+            if (r == 0.0 && i >= l)
+                continue;
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0.0;
+        } while (m != l);
+    }
+
+    // back-transform: z = H_0 H_1 ... H_{n-3} z, parallel over columns
+    parallelFor(n, 16, [&](size_t begin, size_t end) {
+        for (int k = (int)reflectors.size() - 1; k >= 0; k--) {
+            if (betas[k] == 0.0)
+                continue;
+            const std::vector<double>& v = reflectors[k];
+            for (size_t j = begin; j < end; j++) {
+                double t = 0.0;
+                for (size_t i = 0; i < v.size(); i++)
+                    t += v[i] * z[(k + 1 + i) * n + j];
+                t *= betas[k];
+                for (size_t i = 0; i < v.size(); i++)
+                    z[(k + 1 + i) * n + j] -= t * v[i];
+            }
+        }
+    });
+
+    // eigenvectors as rows for sorting, then as columns of the result
+    std::vector<std::vector<double>> vt(n, std::vector<double>(n));
+    for (int r = 0; r < n; r++)
+        for (int c = 0; c < n; c++)
+            vt[c][r] = z[size_t(r) * n + c];
+    sortPairs(d, vt, false);
+    mat vectors(n, n);
+    for (int c = 0; c < n; c++)
+        for (int r = 0; r < n; r++)
+            vectors.a[r][c] = vt[c][r];
+    return {d, vectors};
+}
+
+//----------------SVD----------------//
+
+/**
+ * @brief Thin singular value decomposition by one-sided Jacobi rotations.
+ *      Accurate for small singular values; for wide matrices the transpose is
+ *      decomposed and the factors are swapped.
+ * @param a m x n matrix
+ * @return u (m x k), s (k, descending), v (n x k) with k = min(m, n)
+ */
+svdresult svd(const mat& a) {
+    int m = a.row, n = a.col;
+    bool wide = m < n;
+    int rows = wide ? n : m, cols = wide ? m : n;
+    // w holds the columns of the (possibly transposed) matrix
+    std::vector<std::vector<double>> w(cols, std::vector<double>(rows));
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++) {
+            if (wide)
+                w[i][j] = a.a[i][j];
+            else
+                w[j][i] = a.a[i][j];
+        }
+    std::vector<std::vector<double>> vt(cols, std::vector<double>(cols, 0.0));
+    for (int i = 0; i < cols; i++)
+        vt[i][i] = 1.0;
+    jacobiColumns(w, vt);
+
+    std::vector<double> s(cols);
+    for (int j = 0; j < cols; j++) {
+        s[j] = std::sqrt(dotn(w[j].data(), w[j].data(), rows));
+        double inv = (s[j] > 0.0) ? 1.0 / s[j] : 0.0;
+        for (double& x : w[j])
+            x *= inv;
+    }
+    // sort columns of U and V together
+    std::vector<std::vector<double>> both(cols);
+    for (int j = 0; j < cols; j++) {
+        both[j] = w[j];
+        both[j].insert(both[j].end(), vt[j].begin(), vt[j].end());
+    }
+    sortPairs(s, both, true);
+    mat u(rows, cols), v(cols, cols);
+    for (int j = 0; j < cols; j++) {
+        for (int i = 0; i < rows; i++)
+            u.a[i][j] = both[j][i];
+        for (int i = 0; i < cols; i++)
+            v.a[i][j] = both[j][rows + i];
+    }
+    if (wide)
+        return {v, s, u};
+    return {u, s, v};
+}
+
+/**
+ * @brief Randomized truncated SVD (Halko, Martinsson, Tropp) of A_c, where
+ *      A_c = A - 1 * mean^T when a mean is given. The centred matrix is never
+ *      formed, so PCA needs no copy of the data.
+ */
+static svdresult rsvdimpl(const mat& a, const std::vector<double>* mean, int k, int oversample, int power,
+                          uint64_t seed)
+{
+    int m = a.row, n = a.col;
+    if (k <= 0 || k > std::min(m, n))
+        throw std::invalid_argument("rsvd: rank must be in [1, min(rows, cols)]");
+    int l = std::min(k + std::max(oversample, 0), std::min(m, n));
+    // gaussian test matrix, stored by columns
+    std::mt19937_64 gen(seed);
+    std::normal_distribution<double> dis(0.0, 1.0);
+    std::vector<std::vector<double>> omega(l, std::vector<double>(n));
+    for (auto& col : omega)
+        for (double& x : col)
+            x = dis(gen);
+    // range finder with power iterations: Q = orth((A A^T)^q A Omega)
+    std::vector<std::vector<double>> qt = timesColumns(a, mean, omega);
+    orthonormalRows(qt);
+    for (int it = 0; it < power; it++) {
+        std::vector<std::vector<double>> zt = transposeTimesColumns(a, mean, qt);
+        orthonormalRows(zt);
+        qt = timesColumns(a, mean, zt);
+        orthonormalRows(qt);
+    }
+    // B = Q^T A_c is small (l x n); decompose it exactly
+    mat b(transposeTimesColumns(a, mean, qt));
+    svdresult small = svd(b);
+    // U = Q * U_b, truncated to k
+    svdresult res{mat(m, k), std::vector<double>(small.s.begin(), small.s.begin() + k), mat(n, k)};
+    parallelFor(m, 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            for (int c = 0; c < k; c++) {
+                double sum = 0.0;
+                for (int r = 0; r < l; r++)
+                    sum += qt[r][i] * small.u.a[r][c];
+                res.u.a[i][c] = sum;
+            }
+    });
+    for (int i = 0; i < n; i++)
+        for (int c = 0; c < k; c++)
+            res.v.a[i][c] = small.v.a[i][c];
+    return res;
+}
+
+/**
+ * @brief Randomized truncated SVD for the top k singular triplets. Cost is
+ *      dominated by 2 * (power + 1) passes of matrix products over A, which
+ *      are split across threads.
+ * @param a m x n matrix
+ * @param k number of singular triplets
+ * @param oversample extra sampled directions for accuracy
+ * @param power number of power iterations (more for slowly decaying spectra)
+ * @param seed seed of the gaussian test matrix
+ * @return u (m x k), s (k, descending), v (n x k)
+ * @throws std::invalid_argument if k is out of range
+ */
+svdresult rsvd(const mat& a, int k, int oversample, int power, uint64_t seed) {
+    return rsvdimpl(a, nullptr, k, oversample, power, seed);
+}
+
+//----------------PCA----------------//
+
+/**
+ * @brief Principal component analysis of a data matrix with samples as rows.
+ *      Column means are removed implicitly inside the randomized SVD.
+ * @param x data matrix (samples x features)
+ * @param k number of components
+ * @return column means, components (features x k) and explained variances
+ * @throws std::invalid_argument if k is out of range
+ */
+pcaresult pca(const mat& x, int k) {
+    int m = x.row, n = x.col;
+    std::vector<double> mean(n, 0.0);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            mean[j] += x.a[i][j];
+    for (double& v : mean)
+        v /= std::max(m, 1);
+    svdresult s = rsvdimpl(x, &mean, k, 10, 2, 0);
+    std::vector<double> variance(k);
+    for (int c = 0; c < k; c++)
+        variance[c] = s.s[c] * s.s[c] / std::max(m - 1, 1);
+    return {mean, s.v, variance};
+}
+
+/**
+ * @brief Project samples onto principal components, (x - mean) * components
+ * @param p fitted principal components
+ * @param x data matrix (samples x features)
+ * @return projected samples (samples x k)
+ * @throws std::invalid_argument if the feature count does not match
+ */
+mat pcatransform(const pcaresult& p, const mat& x) {
+    if (x.col != (int)p.mean.size())
+        throw std::invalid_argument("pcatransform: feature count mismatch");
+    int k = p.components.col;
+    mat y(x.row, k);
+    parallelFor(x.row, 64, [&](size_t begin, size_t end) {
+        std::vector<double> centred(x.col);
+        for (size_t i = begin; i < end; i++) {
+            for (int j = 0; j < x.col; j++)
+                centred[j] = x.a[i][j] - p.mean[j];
+            for (int c = 0; c < k; c++) {
+                double sum = 0.0;
+                for (int j = 0; j < x.col; j++)
+                    sum += centred[j] * p.components.a[j][c];
+                y.a[i][c] = sum;
+            }
+        }
+    });
+    return y;
+}
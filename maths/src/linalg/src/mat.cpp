@@ -8,7 +8,7 @@
  */
 mat mat::operator=(mat a) {
     this->row = a.row;
-    this->row = a.col;
+    this->col = a.col;
     this->a = a.a;
     return mat();
 }
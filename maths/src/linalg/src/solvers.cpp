@@ -0,0 +1,426 @@
+
+#include "include/solvers.hpp"
+#include "include/parallel.hpp"
+#include <stdexcept>
+
+//----------------VECTOR KERNELS----------------//
+
+static const size_t grain = 8192;     // minimum vector chunk per thread
+
+/**
+ * @brief Parallel dot product of two arrays of length n
+ */
+static double pdot(const double* x, const double* y, size_t n) {
+    return parallelSum(n, grain, [&](size_t begin, size_t end) {
+        double sum = 0.0;
+        for (size_t i = begin; i < end; i++)
+            sum += x[i] * y[i];
+        return sum;
+    });
+}
+
+/**
+ * @brief Parallel euclidean norm of an array of length n
+ */
+static double pnorm(const double* x, size_t n) {
+    return std::sqrt(pdot(x, x, n));
+}
+
+/**
+ * @brief Parallel y = y + a * x
+ */
+static void paxpy(double a, const double* x, double* y, size_t n) {
+    parallelFor(n, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            y[i] += a * x[i];
+    });
+}
+
+/**
+ * @brief Parallel r = b - A * x, using r as the scratch for A * x
+ */
+static void presidual(const linop& A, const double* b, const double* x, double* r, size_t n) {
+    A(x, r);
+    parallelFor(n, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            r[i] = b[i] - r[i];
+    });
+}
+
+//----------------OPERATORS----------------//
+
+/**
+ * @brief Linear operator for a dense square matrix, rows are split across threads
+ * @param a dense square matrix (referenced, must outlive the operator)
+ * @return operator computing y = a * x
+ * @throws std::invalid_argument if the matrix is not square
+ */
+linop makeOperator(const mat& a) {
+    if (a.row != a.col)
+        throw std::invalid_argument("operator matrix must be square");
+    return [&a](const double* x, double* y) {
+        parallelFor(a.row, 64, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const double* ai = a.a[i].data();
+                double sum = 0.0;
+                for (int j = 0; j < a.col; j++)
+                    sum += ai[j] * x[j];
+                y[i] = sum;
+            }
+        });
+    };
+}
+
+/**
+ * @brief Linear operator for a sparse square matrix (parallel SpMV)
+ * @param a csr square matrix (referenced, must outlive the operator)
+ * @return operator computing y = a * x
+ * @throws std::invalid_argument if the matrix is not square
+ */
+linop makeOperator(const csr& a) {
+    if (a.row != a.col)
+        throw std::invalid_argument("operator matrix must be square");
+    return [&a](const double* x, double* y) { a.spmv(x, y); };
+}
+
+//----------------PRECONDITIONERS----------------//
+
+/**
+ * @brief Identity preconditioner, z = r
+ */
+void precond::apply(const double* r, double* z, int n) const {
+    std::copy(r, r + n, z);
+}
+
+/**
+ * @brief Jacobi preconditioner from a dense matrix
+ * @param a square matrix with nonzero diagonal
+ * @throws std::invalid_argument if a diagonal entry is zero
+ */
+jacobi::jacobi(const mat& a) {
+    inv.resize(a.row);
+    for (int i = 0; i < a.row; i++) {
+        if (a.a[i][i] == 0.0)
+            throw std::invalid_argument("jacobi: zero on the diagonal");
+        inv[i] = 1.0 / a.a[i][i];
+    }
+}
+
+/**
+ * @brief Jacobi preconditioner from a sparse matrix
+ * @param a square csr matrix with nonzero diagonal
+ * @throws std::invalid_argument if a diagonal entry is missing or zero
+ */
+jacobi::jacobi(const csr& a) {
+    inv.assign(a.row, 0.0);
+    for (int i = 0; i < a.row; i++) {
+        for (int k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+            if (a.idx[k] == i)
+                inv[i] = a.val[k];
+        if (inv[i] == 0.0)
+            throw std::invalid_argument("jacobi: zero on the diagonal");
+        inv[i] = 1.0 / inv[i];
+    }
+}
+
+/**
+ * @brief z = D^-1 * r, parallel over elements
+ */
+void jacobi::apply(const double* r, double* z, int n) const {
+    parallelFor(n, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            z[i] = inv[i] * r[i];
+    });
+}
+
+/**
+ * @brief ILU(0) factorisation (IKJ variant) restricted to the pattern of a
+ * @param a square csr matrix with sorted column indices and a nonzero diagonal
+ * @throws std::invalid_argument if a diagonal entry is missing or a pivot is zero
+ */
+ilu0::ilu0(const csr& a):lu(a) {
+    int n = a.row;
+    diag.assign(n, -1);
+    std::vector<int> pos(n, -1);    // position of column j in the current row
+    for (int i = 0; i < n; i++) {
+        for (int k = lu.ptr[i]; k < lu.ptr[i + 1]; k++) {
+            pos[lu.idx[k]] = k;
+            if (lu.idx[k] == i)
+                diag[i] = k;
+        }
+        if (diag[i] < 0)
+            throw std::invalid_argument("ilu0: missing diagonal entry");
+        // eliminate the strictly lower part of row i
+        for (int k = lu.ptr[i]; k < lu.ptr[i + 1] && lu.idx[k] < i; k++) {
+            int c = lu.idx[k];
+            double pivot = lu.val[diag[c]];
+            if (pivot == 0.0)
+                throw std::invalid_argument("ilu0: zero pivot");
+            lu.val[k] /= pivot;
+            for (int p = diag[c] + 1; p < lu.ptr[c + 1]; p++) {
+                int j = lu.idx[p];
+                if (pos[j] >= 0)
+                    lu.val[pos[j]] -= lu.val[k] * lu.val[p];
+            }
+        }
+        for (int k = lu.ptr[i]; k < lu.ptr[i + 1]; k++)
+            pos[lu.idx[k]] = -1;
+    }
+}
+
+/**
+ * @brief z = U^-1 * L^-1 * r by forward and backward substitution.
+ *      Triangular solves are inherently sequential.
+ */
+void ilu0::apply(const double* r, double* z, int n) const {
+    for (int i = 0; i < n; i++) {
+        double sum = r[i];
+        for (int k = lu.ptr[i]; k < diag[i]; k++)
+            sum -= lu.val[k] * z[lu.idx[k]];
+        z[i] = sum;
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double sum = z[i];
+        for (int k = diag[i] + 1; k < lu.ptr[i + 1]; k++)
+            sum -= lu.val[k] * z[lu.idx[k]];
+        z[i] = sum / lu.val[diag[i]];
+    }
+}
+
+//----------------SOLVERS----------------//
+
+/**
+ * @brief Preconditioned conjugate gradient for symmetric positive definite systems
+ * @param A linear operator
+ * @param b right hand side
+ * @param x initial guess, receives the solution
+ * @param M symmetric positive definite preconditioner
+ * @param tol relative residual tolerance
+ * @param maxit maximum number of iterations
+ * @return iterations, final relative residual and convergence flag
+ */
+solverresult cg(const linop& A, const std::vector<double>& b, std::vector<double>& x,
+                const precond& M, double tol, int maxit)
+{
+    size_t n = b.size();
+    x.resize(n, 0.0);
+    std::vector<double> r(n), z(n), p(n), q(n);
+    double bnorm = pnorm(b.data(), n);
+    if (bnorm == 0.0)
+        bnorm = 1.0;
+    presidual(A, b.data(), x.data(), r.data(), n);
+    double res = pnorm(r.data(), n) / bnorm;
+    if (res <= tol)
+        return {0, res, true};
+    M.apply(r.data(), z.data(), n);
+    p = z;
+    double rz = pdot(r.data(), z.data(), n);
+    for (int it = 1; it <= maxit; it++) {
+        A(p.data(), q.data());
+        double alpha = rz / pdot(p.data(), q.data(), n);
+        paxpy(alpha, p.data(), x.data(), n);
+        paxpy(-alpha, q.data(), r.data(), n);
+        res = pnorm(r.data(), n) / bnorm;
+        if (res <= tol)
+            return {it, res, true};
+        M.apply(r.data(), z.data(), n);
+        double rznew = pdot(r.data(), z.data(), n);
+        double beta = rznew / rz;
+        rz = rznew;
+        parallelFor(n, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                p[i] = z[i] + beta * p[i];
+        });
+    }
+    return {maxit, res, false};
+}
+
+/**
+ * @brief Restarted GMRES(m) with right preconditioning, A * M^-1 * u = b and
+ *      x = M^-1 * u, so the monitored residual is the true residual.
+ * @param A linear operator
+ * @param b right hand side
+ * @param x initial guess, receives the solution
+ * @param M preconditioner
+ * @param restart Krylov subspace dimension m before restarting
+ * @param tol relative residual tolerance
+ * @param maxit maximum number of iterations (inner steps in total)
+ * @return iterations, final relative residual and convergence flag
+ */
+solverresult gmres(const linop& A, const std::vector<double>& b, std::vector<double>& x,
+                   const precond& M, int restart, double tol, int maxit)
+{
+    size_t n = b.size();
+    int m = std::max(1, restart);
+    x.resize(n, 0.0);
+    std::vector<double> r(n), w(n), z(n);
+    std::vector<std::vector<double>> v(m + 1, std::vector<double>(n));     // Krylov basis
+    std::vector<std::vector<double>> h(m + 1, std::vector<double>(m, 0.0)); // Hessenberg matrix
+    std::vector<double> cs(m), sn(m), g(m + 1);
+    double bnorm = pnorm(b.data(), n);
+    if (bnorm == 0.0)
+        bnorm = 1.0;
+    presidual(A, b.data(), x.data(), r.data(), n);
+    double beta = pnorm(r.data(), n);
+    double res = beta / bnorm;
+    int it = 0;
+    while (res > tol && it < maxit) {
+        // start a cycle from the current residual
+        for (size_t i = 0; i < n; i++)
+            v[0][i] = r[i] / beta;
+        std::fill(g.begin(), g.end(), 0.0);
+        g[0] = beta;
+        int k = 0;
+        for (; k < m && it < maxit; k++, it++) {
+            M.apply(v[k].data(), z.data(), n);
+            A(z.data(), w.data());
+            // modified Gram-Schmidt orthogonalisation
+            for (int j = 0; j <= k; j++) {
+                h[j][k] = pdot(w.data(), v[j].data(), n);
+                paxpy(-h[j][k], v[j].data(), w.data(), n);
+            }
+            h[k + 1][k] = pnorm(w.data(), n);
+            if (h[k + 1][k] != 0.0)
+                for (size_t i = 0; i < n; i++)
+                    v[k + 1][i] = w[i] / h[k + 1][k];
+            // apply previous Givens rotations to the new column
+            for (int j = 0; j < k; j++) {
+                double t = cs[j] * h[j][k] + sn[j] * h[j + 1][k];
+                h[j + 1][k] = -sn[j] * h[j][k] + cs[j] * h[j + 1][k];
+                h[j][k] = t;
+            }
+            // new rotation eliminating h[k+1][k]
+            double d = std::hypot(h[k][k], h[k + 1][k]);
+            cs[k] = (d == 0.0) ? 1.0 : h[k][k] / d;
+            sn[k] = (d == 0.0) ? 0.0 : h[k + 1][k] / d;
+            h[k][k] = d;
+            h[k + 1][k] = 0.0;
+            g[k + 1] = -sn[k] * g[k];
+            g[k] = cs[k] * g[k];
+            res = std::abs(g[k + 1]) / bnorm;
+            if (res <= tol) {
+                k++;
+                it++;
+                break;
+            }
+        }
+        // solve the upper triangular system H y = g and update x = x + M^-1 V y
+        std::vector<double> y(k, 0.0);
+        for (int i = k - 1; i >= 0; i--) {
+            double sum = g[i];
+            for (int j = i + 1; j < k; j++)
+                sum -= h[i][j] * y[j];
+            y[i] = (h[i][i] == 0.0) ? 0.0 : sum / h[i][i];
+        }
+        std::fill(w.begin(), w.end(), 0.0);
+        for (int j = 0; j < k; j++)
+            paxpy(y[j], v[j].data(), w.data(), n);
+        M.apply(w.data(), z.data(), n);
+        paxpy(1.0, z.data(), x.data(), n);
+        // true residual for the next cycle
+        presidual(A, b.data(), x.data(), r.data(), n);
+        beta = pnorm(r.data(), n);
+        res = beta / bnorm;
+        if (beta == 0.0)
+            break;
+    }
+    return {it, res, res <= tol};
+}
+
+/**
+ * @brief Preconditioned BiCGSTAB for general nonsymmetric systems
+ * @param A linear operator
+ * @param b right hand side
+ * @param x initial guess, receives the solution
+ * @param M preconditioner
+ * @param tol relative residual tolerance
+ * @param maxit maximum number of iterations
+ * @return iterations, final relative residual and convergence flag
+ */
+solverresult bicgstab(const linop& A, const std::vector<double>& b, std::vector<double>& x,
+                      const precond& M, double tol, int maxit)
+{
+    size_t n = b.size();
+    x.resize(n, 0.0);
+    std::vector<double> r(n), r0(n), p(n, 0.0), v(n, 0.0), s(n), t(n), ph(n), sh(n);
+    double bnorm = pnorm(b.data(), n);
+    if (bnorm == 0.0)
+        bnorm = 1.0;
+    presidual(A, b.data(), x.data(), r.data(), n);
+    r0 = r;
+    double res = pnorm(r.data(), n) / bnorm;
+    if (res <= tol)
+        return {0, res, true};
+    double rho = 1.0, alpha = 1.0, omega = 1.0;
+    for (int it = 1; it <= maxit; it++) {
+        double rhonew = pdot(r0.data(), r.data(), n);
+        if (rhonew == 0.0)
+            return {it, res, false};       // breakdown
+        double beta = (rhonew / rho) * (alpha / omega);
+        rho = rhonew;
+        parallelFor(n, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                p[i] = r[i] + beta * (p[i] - omega * v[i]);
+        });
+        M.apply(p.data(), ph.data(), n);
+        A(ph.data(), v.data());
+        alpha = rho / pdot(r0.data(), v.data(), n);
+        parallelFor(n, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                s[i] = r[i] - alpha * v[i];
+        });
+        double snorm = pnorm(s.data(), n) / bnorm;
+        if (snorm <= tol) {
+            paxpy(alpha, ph.data(), x.data(), n);
+            return {it, snorm, true};
+        }
+        M.apply(s.data(), sh.data(), n);
+        A(sh.data(), t.data());
+        double tt = pdot(t.data(), t.data(), n);
+        omega = (tt == 0.0) ? 0.0 : pdot(t.data(), s.data(), n) / tt;
+        parallelFor(n, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                x[i] += alpha * ph[i] + omega * sh[i];
+                r[i] = s[i] - omega * t[i];
+            }
+        });
+        res = pnorm(r.data(), n) / bnorm;
+        if (res <= tol)
+            return {it, res, true};
+        if (omega == 0.0)
+            return {it, res, false};       // breakdown
+    }
+    return {maxit, res, false};
+}
+
+//----------------MATRIX OVERLOADS----------------//
+
+solverresult cg(const mat& a, const std::vector<double>& b, std::vector<double>& x, const precond& M,
+                double tol, int maxit) {
+    return cg(makeOperator(a), b, x, M, tol, maxit);
+}
+
+solverresult cg(const csr& a, const std::vector<double>& b, std::vector<double>& x, const precond& M,
+                double tol, int maxit) {
+    return cg(makeOperator(a), b, x, M, tol, maxit);
+}
+
+solverresult gmres(const mat& a, const std::vector<double>& b, std::vector<double>& x, const precond& M,
+                   int restart, double tol, int maxit) {
+    return gmres(makeOperator(a), b, x, M, restart, tol, maxit);
+}
+
+solverresult gmres(const csr& a, const std::vector<double>& b, std::vector<double>& x, const precond& M,
+                   int restart, double tol, int maxit) {
+    return gmres(makeOperator(a), b, x, M, restart, tol, maxit);
+}
+
+solverresult bicgstab(const mat& a, const std::vector<double>& b, std::vector<double>& x, const precond& M,
+                      double tol, int maxit) {
+    return bicgstab(makeOperator(a), b, x, M, tol, maxit);
+}
+
+solverresult bicgstab(const csr& a, const std::vector<double>& b, std::vector<double>& x, const precond& M,
+                      double tol, int maxit) {
+    return bicgstab(makeOperator(a), b, x, M, tol, maxit);
+}
@@ -0,0 +1,494 @@
+
+#include "include/sparse.hpp"
+#include "include/parallel.hpp"
+#include <stdexcept>
+
+//----------------HELPERS----------------//
+
+/**
+ * @brief Build compressed storage (row pointers / column pointers) from COO triplets.
+ *      Entries are bucketed by their major index with a counting sort, then sorted
+ *      by minor index inside each bucket and duplicates are summed.
+ * @param nmajor number of rows (CSR) or columns (CSC)
+ * @param nminor number of columns (CSR) or rows (CSC)
+ * @param major major index of each triplet
+ * @param minor minor index of each triplet
+ * @param v value of each triplet
+ * @param ptr output pointers (nmajor + 1 entries)
+ * @param idx output minor indices
+ * @param val output values
+ * @throws std::invalid_argument if the triplet arrays differ in size or an index is out of range
+ */
+static void compress(int nmajor, int nminor, const std::vector<int>& major, const std::vector<int>& minor,
+                     const std::vector<double>& v, std::vector<int>& ptr, std::vector<int>& idx, std::vector<double>& val)
+{
+    if (major.size() != minor.size() || major.size() != v.size())
+        throw std::invalid_argument("COO triplet arrays must have the same length");
+    std::vector<int> count(nmajor + 1, 0);
+    for (size_t k = 0; k < major.size(); k++) {
+        if (major[k] < 0 || major[k] >= nmajor || minor[k] < 0 || minor[k] >= nminor)
+            throw std::invalid_argument("COO index out of range");
+        count[major[k] + 1]++;
+    }
+    for (int i = 0; i < nmajor; i++)
+        count[i + 1] += count[i];
+    // scatter triplets into their buckets
+    std::vector<int> tidx(major.size());
+    std::vector<double> tval(major.size());
+    std::vector<int> next(count.begin(), count.end() - 1);
+    for (size_t k = 0; k < major.size(); k++) {
+        int p = next[major[k]]++;
+        tidx[p] = minor[k];
+        tval[p] = v[k];
+    }
+    // sort each bucket by minor index and merge duplicates
+    ptr.assign(nmajor + 1, 0);
+    idx.clear();
+    val.clear();
+    idx.reserve(major.size());
+    val.reserve(major.size());
+    std::vector<int> order;
+    for (int i = 0; i < nmajor; i++) {
+        order.resize(count[i + 1] - count[i]);
+        std::iota(order.begin(), order.end(), count[i]);
+        std::sort(order.begin(), order.end(), [&tidx](int a, int b) { return tidx[a] < tidx[b]; });
+        for (size_t k = 0; k < order.size(); k++) {
+            if (k > 0 && tidx[order[k]] == idx.back())
+                val.back() += tval[order[k]];
+            else {
+                idx.push_back(tidx[order[k]]);
+                val.push_back(tval[order[k]]);
+            }
+        }
+        ptr[i + 1] = idx.size();
+    }
+}
+
+/**
+ * @brief Transpose compressed storage: CSR arrays of A become CSR arrays of A^T
+ *      (equivalently, the CSC arrays of A). Minor indices stay sorted.
+ * @param nmajor number of major entries of the input
+ * @param nminor number of minor entries of the input
+ */
+static void transposeCompressed(int nmajor, int nminor, const std::vector<int>& ptr, const std::vector<int>& idx,
+                                const std::vector<double>& val, std::vector<int>& tptr, std::vector<int>& tidx,
+                                std::vector<double>& tval)
+{
+    tptr.assign(nminor + 1, 0);
+    tidx.resize(idx.size());
+    tval.resize(val.size());
+    for (size_t k = 0; k < idx.size(); k++)
+        tptr[idx[k] + 1]++;
+    for (int j = 0; j < nminor; j++)
+        tptr[j + 1] += tptr[j];
+    std::vector<int> next(tptr.begin(), tptr.end() - 1);
+    for (int i = 0; i < nmajor; i++) {
+        for (int k = ptr[i]; k < ptr[i + 1]; k++) {
+            int p = next[idx[k]]++;
+            tidx[p] = i;
+            tval[p] = val[k];
+        }
+    }
+}
+
+/**
+ * @brief Gustavson sparse * sparse product on compressed row arrays. Rows of the
+ *      result are computed independently, so the symbolic and numeric passes are
+ *      both split across threads.
+ * @param ar rows of A
+ * @param bc columns of B
+ */
+static void gustavson(int ar, int bc, const std::vector<int>& aptr, const std::vector<int>& aidx,
+                      const std::vector<double>& aval, const std::vector<int>& bptr, const std::vector<int>& bidx,
+                      const std::vector<double>& bval, std::vector<int>& cptr, std::vector<int>& cidx,
+                      std::vector<double>& cval)
+{
+    cptr.assign(ar + 1, 0);
+    // symbolic pass: count nonzeros of each output row
+    parallelFor(ar, 256, [&](size_t begin, size_t end) {
+        std::vector<int> mark(bc, -1);
+        for (size_t i = begin; i < end; i++) {
+            int count = 0;
+            for (int k = aptr[i]; k < aptr[i + 1]; k++) {
+                int j = aidx[k];
+                for (int p = bptr[j]; p < bptr[j + 1]; p++) {
+                    if (mark[bidx[p]] != (int)i) {
+                        mark[bidx[p]] = i;
+                        count++;
+                    }
+                }
+            }
+            cptr[i + 1] = count;
+        }
+    });
+    for (int i = 0; i < ar; i++)
+        cptr[i + 1] += cptr[i];
+    cidx.resize(cptr[ar]);
+    cval.resize(cptr[ar]);
+    // numeric pass: accumulate each row in a dense scratch row
+    parallelFor(ar, 256, [&](size_t begin, size_t end) {
+        std::vector<int> mark(bc, -1);
+        std::vector<double> acc(bc, 0.0);
+        for (size_t i = begin; i < end; i++) {
+            int pos = cptr[i];
+            for (int k = aptr[i]; k < aptr[i + 1]; k++) {
+                int j = aidx[k];
+                double a = aval[k];
+                for (int p = bptr[j]; p < bptr[j + 1]; p++) {
+                    int c = bidx[p];
+                    if (mark[c] != (int)i) {
+                        mark[c] = i;
+                        cidx[pos++] = c;
+                        acc[c] = a * bval[p];
+                    }
+                    else {
+                        acc[c] += a * bval[p];
+                    }
+                }
+            }
+            std::sort(cidx.begin() + cptr[i], cidx.begin() + pos);
+            for (int k = cptr[i]; k < pos; k++)
+                cval[k] = acc[cidx[k]];
+        }
+    });
+}
+
+/**
+ * @brief Compressed row arrays times dense matrix, parallel over rows of the result.
+ * @param r rows of the sparse operand
+ * @param b dense right hand side
+ * @return dense product
+ */
+static mat sparseDense(int r, const std::vector<int>& ptr, const std::vector<int>& idx,
+                       const std::vector<double>& val, const mat& b)
+{
+    mat c(r, b.col);
+    parallelFor(r, 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double* ci = c.a[i].data();
+            for (int k = ptr[i]; k < ptr[i + 1]; k++) {
+                const double* bj = b.a[idx[k]].data();
+                double v = val[k];
+                for (int j = 0; j < b.col; j++)
+                    ci[j] += v * bj[j];
+            }
+        }
+    });
+    return c;
+}
+
+//----------------CSR----------------//
+
+/**
+ * @brief Constructor for an empty r*c sparse matrix
+ * @param r number of rows
+ * @param c number of columns
+ */
+csr::csr(int r, int c):row(r), col(c), ptr(r + 1, 0) {}
+
+/**
+ * @brief Constructor from COO triplets (row index, column index, value).
+ *      Triplets may come in any order; duplicates are summed.
+ * @param r number of rows
+ * @param c number of columns
+ * @param ri row index of each triplet
+ * @param ci column index of each triplet
+ * @param v value of each triplet
+ * @throws std::invalid_argument if an index is out of range
+ */
+csr::csr(int r, int c, const std::vector<int>& ri, const std::vector<int>& ci, const std::vector<double>& v)
+    :row(r), col(c)
+{
+    compress(r, c, ri, ci, v, ptr, idx, val);
+}
+
+/**
+ * @brief Constructor from dense matrix, exact zeros are not stored
+ * @param m dense matrix
+ */
+csr::csr(const mat& m):row(m.row), col(m.col), ptr(m.row + 1, 0) {
+    for (int i = 0; i < row; i++) {
+        for (int j = 0; j < col; j++) {
+            if (m.a[i][j] != 0.0) {
+                idx.push_back(j);
+                val.push_back(m.a[i][j]);
+            }
+        }
+        ptr[i + 1] = idx.size();
+    }
+}
+
+/**
+ * @brief Constructor from compressed sparse column matrix
+ * @param m csc matrix
+ */
+csr::csr(const csc& m):row(m.row), col(m.col) {
+    transposeCompressed(m.col, m.row, m.ptr, m.idx, m.val, ptr, idx, val);
+}
+
+/**
+ * @brief Convert to dense matrix
+ * @return dense mat of size row*col
+ */
+mat csr::todense() const {
+    mat m(row, col);
+    for (int i = 0; i < row; i++)
+        for (int k = ptr[i]; k < ptr[i + 1]; k++)
+            m.a[i][idx[k]] = val[k];
+    return m;
+}
+
+/**
+ * @brief Convert to compressed sparse column
+ */
+csc csr::tocsc() const {
+    return csc(*this);
+}
+
+/**
+ * @brief Transpose of the matrix
+ * @return new csr matrix of size col*row
+ */
+csr csr::transpose() const {
+    csr t(col, row);
+    transposeCompressed(row, col, ptr, idx, val, t.ptr, t.idx, t.val);
+    return t;
+}
+
+/**
+ * @brief Sparse matrix-vector product y = A * x, parallel over rows
+ * @param x input vector of length col
+ * @param y output vector of length row
+ */
+void csr::spmv(const double* x, double* y) const {
+    parallelFor(row, 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double sum = 0.0;
+            for (int k = ptr[i]; k < ptr[i + 1]; k++)
+                sum += val[k] * x[idx[k]];
+            y[i] = sum;
+        }
+    });
+}
+
+/**
+ * @brief Sparse matrix-vector product
+ * @param x input vector of length col
+ * @return A * x
+ * @throws std::invalid_argument if the vector length does not match the columns
+ */
+std::vector<double> csr::operator*(const std::vector<double>& x) const {
+    if ((int)x.size() != col)
+        throw std::invalid_argument("vector length must match matrix columns");
+    std::vector<double> y(row, 0.0);
+    spmv(x.data(), y.data());
+    return y;
+}
+
+/**
+ * @brief Sparse * sparse product (Gustavson row-by-row algorithm)
+ * @param b right operand
+ * @return sparse product
+ * @throws std::invalid_argument if the inner dimensions do not match
+ */
+csr csr::operator*(const csr& b) const {
+    if (col != b.row)
+        throw std::invalid_argument("inner dimensions must match");
+    csr c(row, b.col);
+    gustavson(row, b.col, ptr, idx, val, b.ptr, b.idx, b.val, c.ptr, c.idx, c.val);
+    return c;
+}
+
+/**
+ * @brief Sparse * dense product
+ * @param b dense right operand
+ * @return dense product
+ * @throws std::invalid_argument if the inner dimensions do not match
+ */
+mat csr::operator*(const mat& b) const {
+    if (col != b.row)
+        throw std::invalid_argument("inner dimensions must match");
+    return sparseDense(row, ptr, idx, val, b);
+}
+
+/**
+ * @brief Dense * sparse product, parallel over rows of the dense operand
+ * @param a dense left operand
+ * @param b sparse right operand
+ * @return dense product
+ * @throws std::invalid_argument if the inner dimensions do not match
+ */
+mat operator*(const mat& a, const csr& b) {
+    if (a.col != b.row)
+        throw std::invalid_argument("inner dimensions must match");
+    mat c(a.row, b.col);
+    parallelFor(a.row, 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double* ci = c.a[i].data();
+            for (int p = 0; p < a.col; p++) {
+                double v = a.a[i][p];
+                if (v == 0.0)
+                    continue;
+                for (int k = b.ptr[p]; k < b.ptr[p + 1]; k++)
+                    ci[b.idx[k]] += v * b.val[k];
+            }
+        }
+    });
+    return c;
+}
+
+//----------------CSC----------------//
+
+/**
+ * @brief Constructor for an empty r*c sparse matrix
+ * @param r number of rows
+ * @param c number of columns
+ */
+csc::csc(int r, int c):row(r), col(c), ptr(c + 1, 0) {}
+
+/**
+ * @brief Constructor from COO triplets (row index, column index, value).
+ *      Triplets may come in any order; duplicates are summed.
+ * @param r number of rows
+ * @param c number of columns
+ * @param ri row index of each triplet
+ * @param ci column index of each triplet
+ * @param v value of each triplet
+ * @throws std::invalid_argument if an index is out of range
+ */
+csc::csc(int r, int c, const std::vector<int>& ri, const std::vector<int>& ci, const std::vector<double>& v)
+    :row(r), col(c)
+{
+    compress(c, r, ci, ri, v, ptr, idx, val);
+}
+
+/**
+ * @brief Constructor from dense matrix, exact zeros are not stored
+ * @param m dense matrix
+ */
+csc::csc(const mat& m):row(m.row), col(m.col), ptr(m.col + 1, 0) {
+    for (int j = 0; j < col; j++) {
+        for (int i = 0; i < row; i++) {
+            if (m.a[i][j] != 0.0) {
+                idx.push_back(i);
+                val.push_back(m.a[i][j]);
+            }
+        }
+        ptr[j + 1] = idx.size();
+    }
+}
+
+/**
+ * @brief Constructor from compressed sparse row matrix
+ * @param m csr matrix
+ */
+csc::csc(const csr& m):row(m.row), col(m.col) {
+    transposeCompressed(m.row, m.col, m.ptr, m.idx, m.val, ptr, idx, val);
+}
+
+/**
+ * @brief Convert to dense matrix
+ * @return dense mat of size row*col
+ */
+mat csc::todense() const {
+    mat m(row, col);
+    for (int j = 0; j < col; j++)
+        for (int k = ptr[j]; k < ptr[j + 1]; k++)
+            m.a[idx[k]][j] = val[k];
+    return m;
+}
+
+/**
+ * @brief Convert to compressed sparse row
+ */
+csr csc::tocsr() const {
+    return csr(*this);
+}
+
+/**
+ * @brief Transpose of the matrix
+ * @return new csc matrix of size col*row
+ */
+csc csc::transpose() const {
+    csc t(col, row);
+    transposeCompressed(col, row, ptr, idx, val, t.ptr, t.idx, t.val);
+    return t;
+}
+
+/**
+ * @brief Sparse matrix-vector product y = A * x. Columns scatter into y, so
+ *      each thread accumulates a private copy of y over its block of columns
+ *      and the copies are summed afterwards.
+ * @param x input vector of length col
+ * @param y output vector of length row
+ */
+void csc::spmv(const double* x, double* y) const {
+    size_t parts = std::min<size_t>(hardwareThreads(), std::max(1, nnz() / 65536));
+    if (parts <= 1) {
+        std::fill(y, y + row, 0.0);
+        for (int j = 0; j < col; j++)
+            for (int k = ptr[j]; k < ptr[j + 1]; k++)
+                y[idx[k]] += val[k] * x[j];
+        return;
+    }
+    std::vector<std::vector<double>> partial(parts, std::vector<double>(row, 0.0));
+    size_t step = (col + parts - 1) / parts;
+    parallelFor(parts, 1, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) {
+            int jend = std::min<size_t>(col, (p + 1) * step);
+            for (int j = p * step; j < jend; j++)
+                for (int k = ptr[j]; k < ptr[j + 1]; k++)
+                    partial[p][idx[k]] += val[k] * x[j];
+        }
+    });
+    parallelFor(row, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double sum = 0.0;
+            for (size_t p = 0; p < parts; p++)
+                sum += partial[p][i];
+            y[i] = sum;
+        }
+    });
+}
+
+/**
+ * @brief Sparse matrix-vector product
+ * @param x input vector of length col
+ * @return A * x
+ * @throws std::invalid_argument if the vector length does not match the columns
+ */
+std::vector<double> csc::operator*(const std::vector<double>& x) const {
+    if ((int)x.size() != col)
+        throw std::invalid_argument("vector length must match matrix columns");
+    std::vector<double> y(row, 0.0);
+    spmv(x.data(), y.data());
+    return y;
+}
+
+/**
+ * @brief Sparse * sparse product. The CSC arrays of A*B are the CSR arrays of
+ *      B^T * A^T, so the product reuses the row-wise Gustavson kernel.
+ * @param b right operand
+ * @return sparse product
+ * @throws std::invalid_argument if the inner dimensions do not match
+ */
+csc csc::operator*(const csc& b) const {
+    if (col != b.row)
+        throw std::invalid_argument("inner dimensions must match");
+    csc c(row, b.col);
+    gustavson(b.col, row, b.ptr, b.idx, b.val, ptr, idx, val, c.ptr, c.idx, c.val);
+    return c;
+}
+
+/**
+ * @brief Sparse * dense product
+ * @param b dense right operand
+ * @return dense product
+ * @throws std::invalid_argument if the inner dimensions do not match
+ */
+mat csc::operator*(const mat& b) const {
+    if (col != b.row)
+        throw std::invalid_argument("inner dimensions must match");
+    csr r(*this);
+    return sparseDense(row, r.ptr, r.idx, r.val, b);
+}
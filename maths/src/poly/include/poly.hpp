@@ -4,18 +4,64 @@
 
 #include <iostream>
 #include <vector>
+#include <complex>
+#include <utility>
 
+/**
+ * @brief CLASS: Dense univariate polynomial with coefficients in ascending
+ *      order, p(x) = coeffs[0] + coeffs[1] x + ... + coeffs[n] x^n.
+ *      Instantiated for float and double.
+ * @param coeffs coefficients, coeffs[i] multiplies x^i
+ */
 template <typename t> class poly {
-private:
-    std::vector<t> coeffs;
-    std::vector<int> exponents;
-    int degree;
 public:
+    std::vector<t> coeffs;      // ascending coefficients
+
+    // default constructor (zero polynomial)
     poly();
     poly(std::vector<t> coeffs);
-    poly(std::vector<t> coeffs, t x);
-    poly(std::vector<t> coeffs, t x, t y);
-    poly(std::vector<t> coeffs, t x, t y, t z);
-}
+
+    int degree() const;         // degree, -1 for the zero polynomial
+    void trim();                // drop zero leading coefficients
+
+    t operator()(t x) const;    // Horner evaluation
+    t horner(t x) const;        // Horner evaluation (serial dependency chain)
+    t estrin(t x) const;        // Estrin evaluation (log-depth tree, more ILP)
+    std::vector<t> eval(const std::vector<t>& x, bool useEstrin = false) const;    // batched evaluation
+    void eval(const t* x, t* y, size_t n, bool useEstrin = false) const;           // batched evaluation
+
+    poly derivative() const;    // first derivative
+    poly integral() const;      // antiderivative with zero constant
+
+    std::vector<std::complex<double>> roots(double tol = 1e-12, int maxit = 500) const;    // Aberth-Ehrlich
+
+    poly operator+=(const poly&);
+    poly operator-=(const poly&);
+    poly operator*=(const poly&);
+    poly operator*=(t);
+
+    ~poly() {};
+};
+
+template <typename t> poly<t> operator+(const poly<t>&, const poly<t>&);
+template <typename t> poly<t> operator-(const poly<t>&, const poly<t>&);
+template <typename t> poly<t> operator*(const poly<t>&, const poly<t>&);   // picks naive, Karatsuba or FFT
+template <typename t> poly<t> operator*(const poly<t>&, t);
+template <typename t> std::ostream& operator<<(std::ostream&, const poly<t>&);
+
+// multiplication kernels
+
+template <typename t> poly<t> mulnaive(const poly<t>&, const poly<t>&);
+template <typename t> poly<t> mulkaratsuba(const poly<t>&, const poly<t>&);
+template <typename t> poly<t> mulfft(const poly<t>&, const poly<t>&);
+
+// division (Newton series inversion for large quotients)
+
+template <typename t> std::pair<poly<t>, poly<t>> divmod(const poly<t>&, const poly<t>&);
+template <typename t> poly<t> seriesinverse(const poly<t>&, size_t n);     // 1/p mod x^n
+
+// construction
+
+template <typename t> poly<t> fromroots(const std::vector<t>&);     // prod (x - r_i) by a product tree
 
 #endif
@@ -0,0 +1,42 @@
+
+#ifndef REMEZ_HPP
+#define REMEZ_HPP 1
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <iostream>
+
+/**
+ * @brief Minimax approximation p(t) / q(t) of a function on [lo, hi]
+ *      produced by remez(). The coefficients are in the scaled variable
+ *      t = (x - mid) * scale, which lies in [-1, 1], because converting them
+ *      to powers of x is badly conditioned. For a polynomial q = {1}.
+ * @param p numerator coefficients in t, ascending
+ * @param q denominator coefficients in t, ascending, q[0] = 1
+ * @param lo lower end of the interval
+ * @param hi upper end of the interval
+ * @param relative true if the error is relative (|p/q - f| / |f|)
+ * @param error largest error measured on a dense grid of the interval
+ * @param iterations number of exchange steps used
+ */
+struct minimax {
+    std::vector<double> p;      // numerator coefficients
+    std::vector<double> q;      // denominator coefficients
+    double lo;                  // interval start
+    double hi;                  // interval end
+    double mid;                 // interval centre
+    double scale;               // 2 / (hi - lo)
+    bool relative;              // relative or absolute error
+    double error;               // measured maximum error
+    int iterations;             // exchange steps
+
+    double operator()(double x) const;     // evaluate p(x) / q(x)
+};
+
+minimax remez(const std::function<double(double)>& f, double lo, double hi, unsigned int pdeg,
+              unsigned int qdeg = 0, bool relative = false, double tol = 1e-6, int maxit = 60);
+double maxerror(const minimax&, const std::function<double(double)>& f, size_t samples = 100000);
+void writeheader(std::ostream&, const minimax&, const std::string& name, const std::string& description);
+
+#endif
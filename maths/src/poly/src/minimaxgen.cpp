@@ -0,0 +1,63 @@
+
+// minimaxgen.cpp: build-time generator of minimax approximation headers
+//
+// usage: minimaxgen --func exp2|exp|tanh|sigmoid --lo a --hi b --degree n
+//                   [--qdegree m] [--relative 0|1] [--name id] --out file.hpp
+
+#include "include/remez.hpp"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> opt = {
+        {"func", "exp2"}, {"lo", "-0.5"}, {"hi", "0.5"}, {"degree", "11"},
+        {"qdegree", "0"}, {"relative", "1"}, {"name", ""}, {"out", ""}
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        if (key.rfind("--", 0) != 0 || opt.find(key.substr(2)) == opt.end()) {
+            std::cerr << "minimaxgen: unknown option " << key << std::endl;
+            return 1;
+        }
+        opt[key.substr(2)] = argv[i + 1];
+    }
+    if (opt["out"].empty()) {
+        std::cerr << "minimaxgen: --out is required" << std::endl;
+        return 1;
+    }
+
+    const std::map<std::string, std::pair<double (*)(double), std::string>> funcs = {
+        {"exp2", {[](double x) { return std::exp2(x); }, "2^x"}},
+        {"exp", {[](double x) { return std::exp(x); }, "e^x"}},
+        {"tanh", {[](double x) { return std::tanh(x); }, "tanh(x)"}},
+        {"sigmoid", {[](double x) { return 1.0 / (1.0 + std::exp(-x)); }, "1 / (1 + e^-x)"}},
+    };
+    auto fn = funcs.find(opt["func"]);
+    if (fn == funcs.end()) {
+        std::cerr << "minimaxgen: unknown function " << opt["func"] << std::endl;
+        return 1;
+    }
+    std::string name = opt["name"].empty() ? opt["func"] + "approx" : opt["name"];
+
+    try {
+        minimax m = remez(fn->second.first, std::stod(opt["lo"]), std::stod(opt["hi"]),
+                          (unsigned int)std::stoul(opt["degree"]), (unsigned int)std::stoul(opt["qdegree"]),
+                          opt["relative"] != "0");
+        std::ofstream os(opt["out"]);
+        if (!os) {
+            std::cerr << "minimaxgen: cannot write " << opt["out"] << std::endl;
+            return 1;
+        }
+        writeheader(os, m, name, "minimax approximation of " + fn->second.second);
+        std::cout << "minimaxgen: " << name << " error " << m.error << " after "
+                  << m.iterations << " exchanges" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "minimaxgen: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
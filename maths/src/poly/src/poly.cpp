@@ -1,2 +1,540 @@
 
 #include "include/poly.hpp"
+#include "include/fft.hpp"
+#include "include/parallel.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+static const double pi = 3.14159265358979323846;
+
+// points per block of the batched evaluators
+static const size_t evalBlock = 256;
+// below this length the quadratic kernels win
+static const size_t karatsubaCutoff = 32;
+// above this combined length multiplication goes through the FFT
+static const size_t fftCutoff = 1024;
+// quotient length from which division uses Newton inversion
+static const size_t newtonCutoff = 64;
+
+//----------------CONSTRUCTORS----------------//
+
+template <typename t> poly<t>::poly() {}
+
+template <typename t> poly<t>::poly(std::vector<t> coeffs) : coeffs(std::move(coeffs)) {
+    trim();
+}
+
+template <typename t> int poly<t>::degree() const {
+    return (int)coeffs.size() - 1;
+}
+
+template <typename t> void poly<t>::trim() {
+    while (!coeffs.empty() && coeffs.back() == t(0))
+        coeffs.pop_back();
+}
+
+//----------------EVALUATION----------------//
+
+template <typename t> t poly<t>::operator()(t x) const {
+    return horner(x);
+}
+
+/**
+ * @brief Horner's rule, n multiply-adds in one dependent chain
+ * @param x point
+ */
+template <typename t> t poly<t>::horner(t x) const {
+    t y = t(0);
+    for (size_t k = coeffs.size(); k-- > 0;)
+        y = y * x + coeffs[k];
+    return y;
+}
+
+/**
+ * @brief Estrin's scheme: pairs of coefficients are combined with x, then
+ *      pairs of those with x^2, x^4, ... The depth is log2(n) instead of n,
+ *      so independent multiply-adds can overlap in the pipeline.
+ * @param x point
+ */
+template <typename t> t poly<t>::estrin(t x) const {
+    size_t m = coeffs.size();
+    if (m < 4)
+        return horner(x);
+    std::vector<t> w((m + 1) / 2);
+    for (size_t i = 0; 2 * i < m; i++)
+        w[i] = (2 * i + 1 < m) ? coeffs[2 * i] + coeffs[2 * i + 1] * x : coeffs[2 * i];
+    m = w.size();
+    t xp = x * x;
+    while (m > 1) {
+        for (size_t i = 0; i < m / 2; i++)
+            w[i] = w[2 * i] + w[2 * i + 1] * xp;
+        if (m % 2)
+            w[m / 2] = w[m - 1];
+        m = (m + 1) / 2;
+        xp *= xp;
+    }
+    return w[0];
+}
+
+/**
+ * @brief Horner over a block of points. The loop over points is innermost,
+ *      so each coefficient step is a vectorisable multiply-add over the block.
+ */
+template <typename t> static void hornerBlock(const std::vector<t>& c, const t* x, t* y, size_t n) {
+    if (c.empty()) {
+        std::fill(y, y + n, t(0));
+        return;
+    }
+    std::fill(y, y + n, c.back());
+    for (size_t k = c.size() - 1; k-- > 0;) {
+        t ck = c[k];
+        for (size_t j = 0; j < n; j++)
+            y[j] = y[j] * x[j] + ck;
+    }
+}
+
+/**
+ * @brief Estrin over a block of points, one workspace row per tree node
+ */
+template <typename t> static void estrinBlock(const std::vector<t>& c, const t* x, t* y, size_t n) {
+    size_t m = c.size();
+    if (m < 4) {
+        hornerBlock(c, x, y, n);
+        return;
+    }
+    size_t half = (m + 1) / 2;
+    std::vector<t> w(half * n), xp(n);
+    for (size_t i = 0; i < half; i++) {
+        t* wi = &w[i * n];
+        if (2 * i + 1 < m) {
+            t c0 = c[2 * i], c1 = c[2 * i + 1];
+            for (size_t j = 0; j < n; j++)
+                wi[j] = c0 + c1 * x[j];
+        }
+        else
+            std::fill(wi, wi + n, c[2 * i]);
+    }
+    for (size_t j = 0; j < n; j++)
+        xp[j] = x[j] * x[j];
+    m = half;
+    while (m > 1) {
+        for (size_t i = 0; i < m / 2; i++) {
+            t* wi = &w[i * n];
+            const t* wa = &w[2 * i * n];
+            const t* wb = &w[(2 * i + 1) * n];
+            for (size_t j = 0; j < n; j++)
+                wi[j] = wa[j] + wb[j] * xp[j];
+        }
+        if (m % 2)
+            std::copy(&w[(m - 1) * n], &w[m * n], &w[(m / 2) * n]);
+        m = (m + 1) / 2;
+        for (size_t j = 0; j < n; j++)
+            xp[j] *= xp[j];
+    }
+    std::copy(w.begin(), w.begin() + n, y);
+}
+
+/**
+ * @brief evaluate at many points; blocks of points are spread over threads
+ * @param x points
+ * @param y values (length n)
+ * @param n number of points
+ * @param useEstrin use Estrin instead of Horner within a block
+ */
+template <typename t> void poly<t>::eval(const t* x, t* y, size_t n, bool useEstrin) const {
+    size_t blocks = (n + evalBlock - 1) / evalBlock;
+    // spread blocks over threads only when the total work is worth it
+    size_t grain = std::max<size_t>(1, 16384 / (evalBlock * (coeffs.size() + 1)));
+    parallelFor(blocks, grain, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            size_t s = b * evalBlock;
+            size_t len = std::min(evalBlock, n - s);
+            if (useEstrin)
+                estrinBlock(coeffs, x + s, y + s, len);
+            else
+                hornerBlock(coeffs, x + s, y + s, len);
+        }
+    });
+}
+
+template <typename t> std::vector<t> poly<t>::eval(const std::vector<t>& x, bool useEstrin) const {
+    std::vector<t> y(x.size());
+    eval(x.data(), y.data(), x.size(), useEstrin);
+    return y;
+}
+
+//----------------CALCULUS----------------//
+
+template <typename t> poly<t> poly<t>::derivative() const {
+    poly<t> d;
+    if (coeffs.size() > 1) {
+        d.coeffs.resize(coeffs.size() - 1);
+        for (size_t k = 1; k < coeffs.size(); k++)
+            d.coeffs[k - 1] = coeffs[k] * t(k);
+    }
+    return d;
+}
+
+template <typename t> poly<t> poly<t>::integral() const {
+    poly<t> p;
+    if (!coeffs.empty()) {
+        p.coeffs.resize(coeffs.size() + 1, t(0));
+        for (size_t k = 0; k < coeffs.size(); k++)
+            p.coeffs[k + 1] = coeffs[k] / t(k + 1);
+    }
+    return p;
+}
+
+//----------------ROOTS----------------//
+
+/**
+ * @brief all complex roots by the Aberth-Ehrlich iteration. Every root is
+ *      refined simultaneously with a Newton step corrected for the other
+ *      approximations, which converges cubically for simple roots.
+ *      Zero roots are split off exactly before iterating.
+ * @param tol relative step size at which a root is considered converged
+ * @param maxit maximum number of sweeps
+ * @return deg roots (unsorted)
+ * @throws std::runtime_error if the iteration does not converge
+ */
+template <typename t> std::vector<std::complex<double>> poly<t>::roots(double tol, int maxit) const {
+    using cd = std::complex<double>;
+    std::vector<cd> r;
+    size_t lead = 0;
+    while (lead < coeffs.size() && coeffs[lead] == t(0))
+        lead++;
+    if (coeffs.size() <= lead + 1) {
+        r.assign(coeffs.empty() ? 0 : lead, cd(0.0, 0.0));
+        return r;
+    }
+    r.assign(lead, cd(0.0, 0.0));
+
+    // monic polynomial without the zero roots
+    std::vector<double> a(coeffs.begin() + lead, coeffs.end());
+    size_t n = a.size() - 1;
+    double an = a[n];
+    for (double& c : a)
+        c /= an;
+
+    // start on a circle of radius |a0|^(1/n), the geometric mean of root moduli
+    double radius = std::pow(std::abs(a[0]), 1.0 / (double)n);
+    std::vector<cd> z(n);
+    for (size_t k = 0; k < n; k++)
+        z[k] = std::polar(radius, 2.0 * pi * (double)k / (double)n + 0.4);
+
+    std::vector<char> done(n, 0);
+    size_t remaining = n;
+    for (int it = 0; it < maxit && remaining > 0; it++) {
+        for (size_t k = 0; k < n; k++) {
+            if (done[k])
+                continue;
+            // p and p' by Horner
+            cd p(a[n], 0.0), dp(0.0, 0.0);
+            for (size_t i = n; i-- > 0;) {
+                dp = dp * z[k] + p;
+                p = p * z[k] + a[i];
+            }
+            if (p == cd(0.0, 0.0)) {
+                done[k] = 1;
+                remaining--;
+                continue;
+            }
+            cd ratio = p / dp;
+            cd s(0.0, 0.0);
+            for (size_t j = 0; j < n; j++) {
+                if (j != k)
+                    s += 1.0 / (z[k] - z[j]);
+            }
+            cd w = ratio / (1.0 - ratio * s);
+            z[k] -= w;
+            if (std::abs(w) <= tol * std::max(1.0, std::abs(z[k]))) {
+                done[k] = 1;
+                remaining--;
+            }
+        }
+    }
+    if (remaining > 0)
+        throw std::runtime_error("Aberth iteration did not converge");
+    r.insert(r.end(), z.begin(), z.end());
+    return r;
+}
+
+//----------------ARITHMETIC----------------//
+
+template <typename t> poly<t> poly<t>::operator+=(const poly<t>& b) {
+    if (b.coeffs.size() > coeffs.size())
+        coeffs.resize(b.coeffs.size(), t(0));
+    for (size_t i = 0; i < b.coeffs.size(); i++)
+        coeffs[i] += b.coeffs[i];
+    trim();
+    return *this;
+}
+
+template <typename t> poly<t> poly<t>::operator-=(const poly<t>& b) {
+    if (b.coeffs.size() > coeffs.size())
+        coeffs.resize(b.coeffs.size(), t(0));
+    for (size_t i = 0; i < b.coeffs.size(); i++)
+        coeffs[i] -= b.coeffs[i];
+    trim();
+    return *this;
+}
+
+template <typename t> poly<t> poly<t>::operator*=(const poly<t>& b) {
+    *this = *this * b;
+    return *this;
+}
+
+template <typename t> poly<t> poly<t>::operator*=(t s) {
+    for (t& c : coeffs)
+        c *= s;
+    trim();
+    return *this;
+}
+
+template <typename t> poly<t> operator+(const poly<t>& a, const poly<t>& b) {
+    poly<t> r = a;
+    r += b;
+    return r;
+}
+
+template <typename t> poly<t> operator-(const poly<t>& a, const poly<t>& b) {
+    poly<t> r = a;
+    r -= b;
+    return r;
+}
+
+template <typename t> poly<t> operator*(const poly<t>& a, t s) {
+    poly<t> r = a;
+    r *= s;
+    return r;
+}
+
+/**
+ * @brief product, choosing the kernel by size: schoolbook for short factors,
+ *      Karatsuba for medium ones and FFT convolution for long ones
+ */
+template <typename t> poly<t> operator*(const poly<t>& a, const poly<t>& b) {
+    size_t na = a.coeffs.size(), nb = b.coeffs.size();
+    if (std::min(na, nb) < karatsubaCutoff)
+        return mulnaive(a, b);
+    if (na + nb < fftCutoff)
+        return mulkaratsuba(a, b);
+    return mulfft(a, b);
+}
+
+template <typename t> std::ostream& operator<<(std::ostream& os, const poly<t>& p) {
+    if (p.coeffs.empty())
+        return os << t(0);
+    for (size_t k = 0; k < p.coeffs.size(); k++) {
+        if (k > 0)
+            os << " + ";
+        os << p.coeffs[k];
+        if (k == 1)
+            os << "*x";
+        else if (k > 1)
+            os << "*x^" << k;
+    }
+    return os;
+}
+
+//----------------MULTIPLICATION----------------//
+
+/**
+ * @brief schoolbook product into r (length na + nb - 1, accumulated)
+ */
+template <typename t> static void naiveAdd(const t* a, size_t na, const t* b, size_t nb, t* r) {
+    for (size_t i = 0; i < na; i++) {
+        t ai = a[i];
+        for (size_t j = 0; j < nb; j++)
+            r[i + j] += ai * b[j];
+    }
+}
+
+template <typename t> poly<t> mulnaive(const poly<t>& a, const poly<t>& b) {
+    if (a.coeffs.empty() || b.coeffs.empty())
+        return poly<t>();
+    std::vector<t> r(a.coeffs.size() + b.coeffs.size() - 1, t(0));
+    naiveAdd(a.coeffs.data(), a.coeffs.size(), b.coeffs.data(), b.coeffs.size(), r.data());
+    return poly<t>(std::move(r));
+}
+
+/**
+ * @brief Karatsuba product of two length-n operands into r (length 2n - 1,
+ *      overwritten): three half-size products instead of four
+ */
+template <typename t> static void karatsuba(const t* a, const t* b, size_t n, t* r) {
+    if (n < karatsubaCutoff) {
+        std::fill(r, r + 2 * n - 1, t(0));
+        naiveAdd(a, n, b, n, r);
+        return;
+    }
+    size_t h = n / 2, g = n - h;        // low half h, high half g >= h
+    std::vector<t> z0(2 * h - 1), z2(2 * g - 1), z1(2 * g - 1), sa(g), sb(g);
+    karatsuba(a, b, h, z0.data());
+    karatsuba(a + h, b + h, g, z2.data());
+    for (size_t i = 0; i < g; i++) {
+        sa[i] = a[h + i] + (i < h ? a[i] : t(0));
+        sb[i] = b[h + i] + (i < h ? b[i] : t(0));
+    }
+    karatsuba(sa.data(), sb.data(), g, z1.data());
+    for (size_t i = 0; i < z0.size(); i++)
+        z1[i] -= z0[i];
+    for (size_t i = 0; i < z2.size(); i++)
+        z1[i] -= z2[i];
+
+    std::fill(r, r + 2 * n - 1, t(0));
+    for (size_t i = 0; i < z0.size(); i++)
+        r[i] += z0[i];
+    for (size_t i = 0; i < z1.size(); i++)
+        r[i + h] += z1[i];
+    for (size_t i = 0; i < z2.size(); i++)
+        r[i + 2 * h] += z2[i];
+}
+
+/**
+ * @brief Karatsuba product; unbalanced operands are cut into pieces of the
+ *      shorter length so the padding never exceeds one piece
+ */
+template <typename t> poly<t> mulkaratsuba(const poly<t>& a, const poly<t>& b) {
+    if (a.coeffs.empty() || b.coeffs.empty())
+        return poly<t>();
+    const std::vector<t>& lng = (a.coeffs.size() >= b.coeffs.size()) ? a.coeffs : b.coeffs;
+    const std::vector<t>& sht = (a.coeffs.size() >= b.coeffs.size()) ? b.coeffs : a.coeffs;
+    size_t m = sht.size();
+    std::vector<t> r(lng.size() + m - 1, t(0)), piece(m), prod(2 * m - 1);
+    for (size_t s = 0; s < lng.size(); s += m) {
+        size_t len = std::min(m, lng.size() - s);
+        std::copy(lng.begin() + s, lng.begin() + s + len, piece.begin());
+        std::fill(piece.begin() + len, piece.end(), t(0));
+        karatsuba(piece.data(), sht.data(), m, prod.data());
+        size_t top = std::min(prod.size(), r.size() - s);
+        for (size_t i = 0; i < top; i++)
+            r[s + i] += prod[i];
+    }
+    return poly<t>(std::move(r));
+}
+
+/**
+ * @brief product by FFT convolution in double precision. The rounding error
+ *      is relative to the largest coefficient, so tiny coefficients next to
+ *      huge ones are not reproduced exactly.
+ */
+template <typename t> poly<t> mulfft(const poly<t>& a, const poly<t>& b) {
+    if (a.coeffs.empty() || b.coeffs.empty())
+        return poly<t>();
+    std::vector<double> da(a.coeffs.begin(), a.coeffs.end()), db(b.coeffs.begin(), b.coeffs.end());
+    std::vector<double> dr = convolve(da, db);
+    return poly<t>(std::vector<t>(dr.begin(), dr.end()));
+}
+
+//----------------DIVISION----------------//
+
+/**
+ * @brief power series inverse 1/p mod x^n by Newton iteration
+ *      g <- g (2 - p g), doubling the number of correct terms each step
+ * @throws std::invalid_argument if p(0) is zero
+ */
+template <typename t> poly<t> seriesinverse(const poly<t>& p, size_t n) {
+    if (p.coeffs.empty() || p.coeffs[0] == t(0))
+        throw std::invalid_argument("series inverse needs a nonzero constant term");
+    std::vector<t> g(1, t(1) / p.coeffs[0]);
+    size_t len = 1;
+    while (len < n) {
+        len = std::min(2 * len, n);
+        poly<t> f(std::vector<t>(p.coeffs.begin(), p.coeffs.begin() + std::min(len, p.coeffs.size())));
+        poly<t> gp(g);
+        std::vector<t> e = (f * gp).coeffs;
+        e.resize(len, t(0));
+        for (t& c : e)
+            c = -c;
+        e[0] += t(2);
+        g = (gp * poly<t>(e)).coeffs;
+        g.resize(len, t(0));
+    }
+    g.resize(n, t(0));
+    poly<t> r;
+    r.coeffs = std::move(g);
+    return r;
+}
+
+/**
+ * @brief quotient and remainder, a = q b + r with deg r < deg b. Long
+ *      quotients use reversed polynomials and a series inverse, so division
+ *      costs a few multiplications instead of O(deg a * deg b).
+ * @throws std::invalid_argument on division by the zero polynomial
+ */
+template <typename t> std::pair<poly<t>, poly<t>> divmod(const poly<t>& a, const poly<t>& b) {
+    poly<t> bb = b;
+    bb.trim();
+    if (bb.coeffs.empty())
+        throw std::invalid_argument("polynomial division by zero");
+    poly<t> aa = a;
+    aa.trim();
+    if (aa.degree() < bb.degree())
+        return {poly<t>(), aa};
+    size_t na = aa.coeffs.size(), nb = bb.coeffs.size(), nq = na - nb + 1;
+
+    std::vector<t> q(nq, t(0));
+    if (nq < newtonCutoff || nb < newtonCutoff) {
+        std::vector<t> r = aa.coeffs;
+        t lead = bb.coeffs.back();
+        for (size_t k = nq; k-- > 0;) {
+            t c = r[k + nb - 1] / lead;
+            q[k] = c;
+            for (size_t j = 0; j < nb; j++)
+                r[k + j] -= c * bb.coeffs[j];
+        }
+        r.resize(nb - 1);
+        return {poly<t>(q), poly<t>(r)};
+    }
+
+    std::vector<t> ra(aa.coeffs.rbegin(), aa.coeffs.rbegin() + nq);
+    std::vector<t> rb(bb.coeffs.rbegin(), bb.coeffs.rend());
+    std::vector<t> rq = (poly<t>(ra) * seriesinverse(poly<t>(rb), nq)).coeffs;
+    rq.resize(nq, t(0));
+    std::reverse_copy(rq.begin(), rq.end(), q.begin());
+    poly<t> pq(q);
+    std::vector<t> r = (aa - bb * pq).coeffs;
+    if (r.size() > nb - 1)
+        r.resize(nb - 1);
+    return {pq, poly<t>(r)};
+}
+
+/**
+ * @brief monic polynomial with the given roots, multiplied as a balanced
+ *      product tree so the fast multiplication kernels are used
+ */
+template <typename t> poly<t> fromroots(const std::vector<t>& r) {
+    if (r.empty())
+        return poly<t>(std::vector<t>{t(1)});
+    std::vector<poly<t>> level(r.size());
+    for (size_t i = 0; i < r.size(); i++)
+        level[i].coeffs = {-r[i], t(1)};
+    while (level.size() > 1) {
+        std::vector<poly<t>> next((level.size() + 1) / 2);
+        for (size_t i = 0; i < next.size(); i++)
+            next[i] = (2 * i + 1 < level.size()) ? level[2 * i] * level[2 * i + 1] : level[2 * i];
+        level = std::move(next);
+    }
+    return level[0];
+}
+
+//----------------INSTANTIATIONS----------------//
+
+#define POLY_INSTANTIATE(T) \
+    template class poly<T>; \
+    template poly<T> operator+(const poly<T>&, const poly<T>&); \
+    template poly<T> operator-(const poly<T>&, const poly<T>&); \
+    template poly<T> operator*(const poly<T>&, const poly<T>&); \
+    template poly<T> operator*(const poly<T>&, T); \
+    template std::ostream& operator<<(std::ostream&, const poly<T>&); \
+    template poly<T> mulnaive(const poly<T>&, const poly<T>&); \
+    template poly<T> mulkaratsuba(const poly<T>&, const poly<T>&); \
+    template poly<T> mulfft(const poly<T>&, const poly<T>&); \
+    template std::pair<poly<T>, poly<T>> divmod(const poly<T>&, const poly<T>&); \
+    template poly<T> seriesinverse(const poly<T>&, size_t); \
+    template poly<T> fromroots(const std::vector<T>&);
+
+POLY_INSTANTIATE(float)
+POLY_INSTANTIATE(double)
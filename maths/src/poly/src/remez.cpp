@@ -0,0 +1,349 @@
+
+#include "include/remez.hpp"
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+
+using real = long double;
+
+static const real pi = 3.141592653589793238462643383279502884L;
+
+//----------------HELPERS----------------//
+
+/**
+ * @brief solve A x = b in place by Gaussian elimination with partial pivoting
+ * @throws std::runtime_error if A is singular
+ */
+static std::vector<real> gaussSolve(std::vector<std::vector<real>> A, std::vector<real> b) {
+    size_t n = b.size();
+    for (size_t c = 0; c < n; c++) {
+        size_t piv = c;
+        for (size_t r = c + 1; r < n; r++) {
+            if (std::fabs(A[r][c]) > std::fabs(A[piv][c]))
+                piv = r;
+        }
+        if (A[piv][c] == 0.0L)
+            throw std::runtime_error("singular Remez system");
+        std::swap(A[piv], A[c]);
+        std::swap(b[piv], b[c]);
+        for (size_t r = c + 1; r < n; r++) {
+            real f = A[r][c] / A[c][c];
+            for (size_t k = c; k < n; k++)
+                A[r][k] -= f * A[c][k];
+            b[r] -= f * b[c];
+        }
+    }
+    std::vector<real> x(n);
+    for (size_t r = n; r-- > 0;) {
+        real s = b[r];
+        for (size_t k = r + 1; k < n; k++)
+            s -= A[r][k] * x[k];
+        x[r] = s / A[r][r];
+    }
+    return x;
+}
+
+static real horner(const std::vector<real>& c, real t) {
+    real y = 0.0L;
+    for (size_t k = c.size(); k-- > 0;)
+        y = y * t + c[k];
+    return y;
+}
+
+//----------------MINIMAX----------------//
+
+/**
+ * @brief evaluate the approximation at x
+ * @param x point, expected in [lo, hi]
+ */
+double minimax::operator()(double x) const {
+    double t = (x - mid) * scale;
+    double num = 0.0, den = 0.0;
+    for (size_t k = p.size(); k-- > 0;)
+        num = num * t + p[k];
+    for (size_t k = q.size(); k-- > 0;)
+        den = den * t + q[k];
+    return num / den;
+}
+
+/**
+ * @brief Remez exchange algorithm for the best polynomial (qdeg = 0) or
+ *      rational approximation in the max norm. Each step solves for
+ *      coefficients whose error equioscillates on the current reference
+ *      points, then moves the reference to the extrema of the new error.
+ *      The rational case is linearised by holding the levelled error fixed
+ *      in the denominator term and iterating that solve to a fixed point.
+ *      Odd or even functions make most (pdeg, qdeg) pairs degenerate; fit
+ *      those with matching parity or as a function of x^2.
+ * @param f function to approximate
+ * @param lo lower end of the interval
+ * @param hi upper end of the interval
+ * @param pdeg numerator degree
+ * @param qdeg denominator degree
+ * @param relative minimise the relative instead of the absolute error
+ * @param tol stop when the extrema agree to this relative spread
+ * @param maxit maximum number of exchange steps
+ * @return approximation with its measured maximum error
+ * @throws std::invalid_argument for an empty interval or a relative fit of a
+ *      function with a zero in the interval
+ * @throws std::runtime_error if the denominator has a zero in the interval
+ */
+minimax remez(const std::function<double(double)>& f, double lo, double hi, unsigned int pdeg,
+              unsigned int qdeg, bool relative, double tol, int maxit) {
+    if (!(hi > lo))
+        throw std::invalid_argument("Remez interval needs hi > lo");
+    const real mid = 0.5L * ((real)lo + (real)hi), half = 0.5L * ((real)hi - (real)lo);
+    auto F = [&](real t) { return (real)f((double)(mid + half * t)); };
+    auto W = [&](real fv) -> real {
+        if (!relative)
+            return 1.0L;
+        if (fv == 0.0L)
+            throw std::invalid_argument("relative Remez fit of a function with a zero in the interval");
+        return 1.0L / std::fabs(fv);
+    };
+
+    const size_t N = pdeg + qdeg + 2;
+    std::vector<real> ref(N);
+    for (size_t i = 0; i < N; i++)
+        ref[i] = -std::cos(pi * (real)i / (real)(N - 1));
+
+    // dense Chebyshev-spaced grid for locating the error extrema
+    const size_t G = std::max<size_t>(4000, 200 * N);
+    std::vector<real> grid(G), fgrid(G), wgrid(G);
+    for (size_t g = 0; g < G; g++) {
+        grid[g] = -std::cos(pi * (real)g / (real)(G - 1));
+        fgrid[g] = F(grid[g]);
+        wgrid[g] = W(fgrid[g]);
+    }
+
+    std::vector<real> a(pdeg + 1, 0.0L), b(qdeg + 1, 0.0L);
+    b[0] = 1.0L;
+    real E = 0.0L;
+    int it = 0, stalled = 0;
+    std::vector<real> err(G), bestA, bestB;
+    real bestErr = INFINITY;
+    for (; it < maxit; it++) {
+        // levelled solve on the reference, iterated for the rational case
+        std::vector<real> fr(N), sr(N);
+        for (size_t i = 0; i < N; i++) {
+            fr[i] = F(ref[i]);
+            sr[i] = ((i % 2) ? -1.0L : 1.0L) / W(fr[i]);
+        }
+        for (int inner = 0; inner < (qdeg ? 50 : 1); inner++) {
+            std::vector<std::vector<real>> A(N, std::vector<real>(N, 0.0L));
+            std::vector<real> rhs(N);
+            for (size_t i = 0; i < N; i++) {
+                real tp = 1.0L;
+                for (unsigned int j = 0; j <= pdeg; j++, tp *= ref[i])
+                    A[i][j] = tp;
+                tp = ref[i];
+                for (unsigned int j = 1; j <= qdeg; j++, tp *= ref[i])
+                    A[i][pdeg + j] = -(fr[i] - sr[i] * E) * tp;
+                A[i][N - 1] = sr[i];
+                rhs[i] = fr[i];
+            }
+            std::vector<real> sol = gaussSolve(A, rhs);
+            for (unsigned int j = 0; j <= pdeg; j++)
+                a[j] = sol[j];
+            for (unsigned int j = 1; j <= qdeg; j++)
+                b[j] = sol[pdeg + j];
+            real En = sol[N - 1];
+            bool settled = std::fabs(En - E) <= 1e-15L * std::fabs(En);
+            E = En;
+            if (settled)
+                break;
+        }
+
+        // weighted error on the grid
+        for (size_t g = 0; g < G; g++) {
+            real den = horner(b, grid[g]);
+            if (den <= 0.0L)
+                throw std::runtime_error("Remez denominator has a zero in the interval");
+            err[g] = wgrid[g] * (horner(a, grid[g]) / den - fgrid[g]);
+        }
+
+        // local extrema of the error, merged into an alternating sequence
+        std::vector<size_t> ext;
+        for (size_t g = 0; g < G; g++) {
+            bool peak = (g == 0 || std::fabs(err[g]) >= std::fabs(err[g - 1])) &&
+                        (g == G - 1 || std::fabs(err[g]) >= std::fabs(err[g + 1]));
+            if (!peak || err[g] == 0.0L)
+                continue;
+            if (!ext.empty() && ((err[ext.back()] > 0.0L) == (err[g] > 0.0L))) {
+                if (std::fabs(err[g]) > std::fabs(err[ext.back()]))
+                    ext.back() = g;
+            }
+            else
+                ext.push_back(g);
+        }
+        real emax = 0.0L;
+        for (size_t g = 0; g < G; g++)
+            emax = std::max(emax, std::fabs(err[g]));
+        if (emax < bestErr) {
+            bestErr = emax;
+            bestA = a;
+            bestB = b;
+            stalled = 0;
+        }
+        else if (++stalled >= 5)
+            break;      // error is at the rounding floor of f, more exchanges only add noise
+
+        if (ext.size() >= N) {
+            // multiple exchange: the reference becomes the N largest alternating extrema
+            while (ext.size() > N) {
+                if (std::fabs(err[ext.front()]) < std::fabs(err[ext.back()]))
+                    ext.erase(ext.begin());
+                else
+                    ext.pop_back();
+            }
+            real emin = INFINITY;
+            for (size_t i = 0; i < N; i++) {
+                ref[i] = grid[ext[i]];
+                emin = std::min(emin, std::fabs(err[ext[i]]));
+            }
+            if (emax - emin <= (real)tol * emax) {
+                it++;
+                break;
+            }
+        }
+        else {
+            // too few alternations (degenerate start): single-point exchange of
+            // the worst extremum with the nearest reference point of equal sign
+            size_t g = ext.empty() ? 0 : ext[0];
+            for (size_t e : ext) {
+                if (std::fabs(err[e]) > std::fabs(err[g]))
+                    g = e;
+            }
+            size_t best = N;
+            for (size_t i = 0; i < N; i++) {
+                real ri = horner(a, ref[i]) / horner(b, ref[i]) - F(ref[i]);
+                if ((ri > 0.0L) == (err[g] > 0.0L) &&
+                    (best == N || std::fabs(ref[i] - grid[g]) < std::fabs(ref[best] - grid[g])))
+                    best = i;
+            }
+            if (best == N || ref[best] == grid[g])
+                break;
+            ref[best] = grid[g];
+            std::sort(ref.begin(), ref.end());
+        }
+    }
+    a = bestA;
+    b = bestB;
+
+    minimax r;
+    r.p.assign(a.begin(), a.end());
+    r.q.assign(b.begin(), b.end());
+    r.lo = lo;
+    r.hi = hi;
+    r.mid = (double)mid;
+    r.scale = (double)(1.0L / half);
+    r.relative = relative;
+    r.iterations = it;
+    r.error = maxerror(r, f);
+    return r;
+}
+
+/**
+ * @brief largest error of an approximation, evaluated in double precision
+ *      exactly as the emitted code does, on a uniform grid plus a
+ *      Chebyshev-spaced grid that resolves the interval ends
+ * @param m approximation
+ * @param f reference function
+ * @param samples points per grid
+ */
+double maxerror(const minimax& m, const std::function<double(double)>& f, size_t samples) {
+    double worst = 0.0;
+    samples = std::max<size_t>(samples, 2);
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < samples; i++) {
+            double u = (double)i / (double)(samples - 1);
+            double t = (pass == 0) ? 2.0 * u - 1.0 : -std::cos((double)pi * u);
+            double x = std::clamp(m.mid + t / m.scale, m.lo, m.hi);
+            double fx = f(x);
+            double e = std::fabs(m(x) - fx);
+            if (m.relative && fx != 0.0)
+                e /= std::fabs(fx);
+            worst = std::max(worst, e);
+        }
+    }
+    return worst;
+}
+
+//----------------CODE EMISSION----------------//
+
+static std::string num(double v) {
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "%.17g", v);
+    return buf;
+}
+
+/**
+ * @brief Estrin expression for coefficients c[lo, lo + len): the upper half
+ *      is scaled by t^h where h is the largest power of two below len
+ */
+static std::string estrinExpr(const std::string& c, size_t lo, size_t len) {
+    if (len == 1)
+        return c + "[" + std::to_string(lo) + "]";
+    if (len == 2)
+        return "(" + c + "[" + std::to_string(lo) + "] + " + c + "[" + std::to_string(lo + 1) + "] * t)";
+    size_t h = 1;
+    while (2 * h < len)
+        h *= 2;
+    std::string power = (h == 1) ? "t" : "t" + std::to_string(h);
+    return "(" + estrinExpr(c, lo, h) + " + " + estrinExpr(c, lo + h, len - h) + " * " + power + ")";
+}
+
+/**
+ * @brief write a self-contained header with constexpr coefficient tables and
+ *      scalar/batched Estrin evaluators for an approximation
+ * @param os output stream
+ * @param m approximation
+ * @param name name of the evaluator function and prefix of the tables
+ * @param description one line describing the approximated function
+ */
+void writeheader(std::ostream& os, const minimax& m, const std::string& name, const std::string& description) {
+    std::string guard = name;
+    std::transform(guard.begin(), guard.end(), guard.begin(), [](unsigned char c) { return (char)std::toupper(c); });
+    guard += "_HPP";
+    size_t powers = std::max(m.p.size(), m.q.size());
+
+    os << "\n// " << name << ".hpp: generated by minimaxgen, do not edit\n";
+    os << "// " << description << "\n";
+    os << "// interval [" << num(m.lo) << ", " << num(m.hi) << "], degree (" << m.p.size() - 1 << ", "
+       << m.q.size() - 1 << "), max " << (m.relative ? "relative" : "absolute") << " error " << num(m.error) << "\n";
+    os << "#ifndef " << guard << "\n#define " << guard << " 1\n\n#include <cstddef>\n\n";
+    os << "constexpr double " << name << "_mid = " << num(m.mid) << ";\n";
+    os << "constexpr double " << name << "_scale = " << num(m.scale) << ";\n";
+    os << "constexpr double " << name << "_error = " << num(m.error) << ";\n";
+    os << "constexpr double " << name << "_p[] = {\n";
+    for (double c : m.p)
+        os << "    " << num(c) << ",\n";
+    os << "};\n";
+    if (m.q.size() > 1) {
+        os << "constexpr double " << name << "_q[] = {\n";
+        for (double c : m.q)
+            os << "    " << num(c) << ",\n";
+        os << "};\n";
+    }
+
+    os << "\n/**\n * @brief " << description << " (Estrin evaluation)\n * @param x point in ["
+       << num(m.lo) << ", " << num(m.hi) << "]\n */\n";
+    os << "inline double " << name << "(double x) {\n";
+    os << "    const double t = (x - " << name << "_mid) * " << name << "_scale;\n";
+    for (size_t h = 2; h < powers; h *= 2)
+        os << "    const double t" << h << " = " << (h == 2 ? std::string("t * t") : "t" + std::to_string(h / 2) + " * t" + std::to_string(h / 2)) << ";\n";
+    os << "    const double p = " << estrinExpr(name + "_p", 0, m.p.size()) << ";\n";
+    if (m.q.size() > 1) {
+        os << "    const double q = " << estrinExpr(name + "_q", 0, m.q.size()) << ";\n";
+        os << "    return p / q;\n";
+    }
+    else
+        os << "    return p;\n";
+    os << "}\n\n";
+    os << "/**\n * @brief batched " << name << ", a straight loop the compiler can vectorise\n */\n";
+    os << "inline void " << name << "(const double* x, double* y, size_t n) {\n";
+    os << "    for (size_t i = 0; i < n; i++)\n        y[i] = " << name << "(x[i]);\n}\n\n";
+    os << "#endif\n";
+}
@@ -0,0 +1,151 @@
+
+#ifndef STATS_HPP
+#define STATS_HPP 1
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief CLASS: Single-pass running moments (Welford / Pebay updates).
+ *      Numerically stable for long streams and mergeable: two estimators
+ *      over disjoint shards merge into the estimator of the union.
+ * @param n number of samples
+ * @param mean running mean
+ * @param m2 sum of squared deviations from the mean
+ * @param m3 sum of cubed deviations from the mean
+ * @param m4 sum of fourth powers of deviations from the mean
+ */
+class runningstats {
+public:
+    uint64_t n;         // number of samples
+    double mean;        // running mean
+    double m2;          // second central moment sum
+    double m3;          // third central moment sum
+    double m4;          // fourth central moment sum
+    double minv;        // smallest sample
+    double maxv;        // largest sample
+
+    runningstats();
+    void push(double);                      // add one sample
+    void push(const std::vector<double>&);  // add a batch of samples
+    void merge(const runningstats&);        // combine with another shard
+
+    double variance(bool sample = true) const;     // (n - 1) or n normalised variance
+    double stddev(bool sample = true) const;       // standard deviation
+    double skewness() const;                       // sample skewness
+    double kurtosis() const;                       // excess kurtosis
+
+    ~runningstats() {};
+};
+
+/**
+ * @brief CLASS: Single-pass running mean vector and covariance matrix.
+ *      Mergeable across shards like runningstats.
+ * @param dim dimension of the samples
+ * @param n number of samples
+ * @param mean running mean vector
+ * @param comoment sum of outer products of deviations (dim x dim)
+ */
+class runningcov {
+public:
+    unsigned int dim;
+    uint64_t n;
+    std::vector<double> mean;
+    std::vector<std::vector<double>> comoment;
+
+    runningcov(unsigned int dim);
+    void push(const std::vector<double>&);      // add one sample
+    void merge(const runningcov&);              // combine with another shard
+    std::vector<std::vector<double>> covariance(bool sample = true) const;
+    std::vector<std::vector<double>> correlation() const;
+
+    ~runningcov() {};
+};
+
+/**
+ * @brief CLASS: Merging t-digest for approximate quantiles with bounded
+ *      memory. Accuracy is highest in the tails; the number of centroids is
+ *      O(compression) regardless of the stream length. Digests built on
+ *      separate shards merge into a digest of the union.
+ * @param compression size/accuracy trade-off (about 100 to 1000)
+ */
+class tdigest {
+public:
+    struct centroid {
+        double mean;
+        double weight;
+    };
+    double compression;                 // delta of the scale function
+    std::vector<centroid> centroids;    // merged centroids sorted by mean
+    std::vector<centroid> buffer;       // unmerged samples
+    double total;                       // total weight
+    double minv;                        // smallest sample
+    double maxv;                        // largest sample
+
+    tdigest(double compression = 200.0);
+    void push(double x, double w = 1.0);    // add a weighted sample
+    void merge(const tdigest&);             // combine with another shard
+    void compress();                        // merge the buffer into the centroids
+    double quantile(double q);              // approximate q-quantile, q in [0, 1]
+    double cdf(double x);                   // approximate fraction of samples <= x
+    uint64_t count() const { return (uint64_t)(total + 0.5); }
+
+    ~tdigest() {};
+};
+
+/**
+ * @brief CLASS: Fixed-width histogram over [lo, hi) with underflow and
+ *      overflow counters. Memory is fixed by the number of bins.
+ */
+class histogram {
+public:
+    double lo;                      // lower edge of the first bin
+    double hi;                      // upper edge of the last bin
+    std::vector<uint64_t> counts;   // one counter per bin
+    uint64_t underflow;             // samples below lo
+    uint64_t overflow;              // samples at or above hi (and NaN)
+
+    histogram(double lo, double hi, unsigned int bins);
+    void push(double);                  // add one sample
+    void push(const std::vector<double>&);  // add a batch of samples
+    void merge(const histogram&);       // combine with another shard (same bins)
+    double quantile(double q) const;    // approximate quantile by linear interpolation in a bin
+    uint64_t total() const;             // number of samples
+
+    ~histogram() {};
+};
+
+/**
+ * @brief CLASS: Log-bucket histogram for positive values spanning many
+ *      orders of magnitude. Buckets grow geometrically so every bucket has
+ *      the same relative width; values below lo go to the underflow bucket
+ *      and values above hi to the overflow bucket.
+ */
+class loghistogram {
+public:
+    double lo;                      // lower edge of the first bucket (> 0)
+    double hi;                      // upper edge of the last bucket
+    double growth;                  // ratio of consecutive bucket edges
+    std::vector<uint64_t> counts;   // one counter per bucket
+    uint64_t underflow;             // samples below lo (including zero and negatives)
+    uint64_t overflow;              // samples at or above hi
+
+    loghistogram(double lo, double hi, double precision = 0.01);
+    void push(double);                  // add one sample
+    void merge(const loghistogram&);    // combine with another shard (same buckets)
+    double quantile(double q) const;    // approximate quantile (geometric bucket midpoint)
+    uint64_t total() const;             // number of samples
+
+    ~loghistogram() {};
+};
+
+// batch helpers (basic.cpp)
+
+double mean(const std::vector<double>&);
+double median(std::vector<double>);
+double mode(const std::vector<double>&);
+double variance(const std::vector<double>&, bool sample = true);
+double stddev(const std::vector<double>&, bool sample = true);
+runningstats parallelstats(const std::vector<double>&);     // sharded moments merged in order
+
+#endif
@@ -0,0 +1,92 @@
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+#include "include/stats.hpp"
+#include "include/parallel.hpp"
+
+/**
+ * @brief arithmetic mean (single Welford pass)
+ * @param x samples
+ */
+double mean(const std::vector<double>& x) {
+    runningstats s;
+    s.push(x);
+    return s.mean;
+}
+
+/**
+ * @brief median by selection, the input is taken by value and reordered
+ * @param x samples
+ */
+double median(std::vector<double> x) {
+    if (x.empty())
+        throw std::invalid_argument("median of an empty sample");
+    size_t h = x.size() / 2;
+    std::nth_element(x.begin(), x.begin() + h, x.end());
+    double m = x[h];
+    if (x.size() % 2 == 0)
+        m = 0.5 * (m + *std::max_element(x.begin(), x.begin() + h));
+    return m;
+}
+
+/**
+ * @brief most frequent value (smallest one on ties)
+ * @param x samples
+ */
+double mode(const std::vector<double>& x) {
+    if (x.empty())
+        throw std::invalid_argument("mode of an empty sample");
+    std::unordered_map<double, size_t> freq;
+    double best = x[0];
+    size_t bestcount = 0;
+    for (double v : x) {
+        size_t c = ++freq[v];
+        if (c > bestcount || (c == bestcount && v < best)) {
+            best = v;
+            bestcount = c;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief variance (single Welford pass)
+ * @param x samples
+ * @param sample use (n - 1) normalisation
+ */
+double variance(const std::vector<double>& x, bool sample) {
+    runningstats s;
+    s.push(x);
+    return s.variance(sample);
+}
+
+/**
+ * @brief standard deviation, the square root of variance()
+ * @param x samples
+ * @param sample use (n - 1) normalisation
+ */
+double stddev(const std::vector<double>& x, bool sample) {
+    return std::sqrt(variance(x, sample));
+}
+
+/**
+ * @brief moments of a large sample computed in parallel. The data is cut into
+ *      a fixed number of shards independent of the thread count and the shard
+ *      moments are merged in shard order, so the result is reproducible.
+ * @param x samples
+ */
+runningstats parallelstats(const std::vector<double>& x) {
+    const size_t shard = 1 << 16;
+    size_t nshards = (x.size() + shard - 1) / shard;
+    std::vector<runningstats> part(nshards);
+    parallelFor(nshards, 1, [&](size_t b, size_t e) {
+        for (size_t s = b; s < e; s++) {
+            size_t end = std::min(x.size(), (s + 1) * shard);
+            for (size_t i = s * shard; i < end; i++) part[s].push(x[i]);
+        }
+    });
+    runningstats total;
+    for (const runningstats& p : part) total.merge(p);
+    return total;
+}
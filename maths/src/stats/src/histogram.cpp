@@ -0,0 +1,167 @@
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "include/stats.hpp"
+
+//----------------HISTOGRAM----------------//
+
+/**
+ * @brief bins equal-width bins over [lo, hi), with separate underflow and
+ *      overflow counters
+ * @param lo lower edge of the first bin
+ * @param hi upper edge of the last bin
+ * @param bins number of bins
+ */
+histogram::histogram(double lo, double hi, unsigned int bins) : lo(lo), hi(hi),
+    counts(bins, 0), underflow(0), overflow(0) {
+    if (!(hi > lo) || bins == 0)
+        throw std::invalid_argument("histogram needs hi > lo and at least one bin");
+}
+
+/**
+ * @brief add one sample
+ * @param x sample
+ */
+void histogram::push(double x) {
+    if (x < lo) {
+        underflow++;
+        return;
+    }
+    if (!(x < hi)) {
+        overflow++;
+        return;
+    }
+    size_t b = (size_t)((x - lo) / (hi - lo) * (double)counts.size());
+    if (b >= counts.size()) b = counts.size() - 1;
+    counts[b]++;
+}
+
+/**
+ * @brief add a batch of samples
+ * @param x samples
+ */
+void histogram::push(const std::vector<double>& x) {
+    for (double v : x) push(v);
+}
+
+/**
+ * @brief add the counts of another histogram with identical bins
+ * @param b histogram over a disjoint set of samples
+ */
+void histogram::merge(const histogram& b) {
+    if (b.lo != lo || b.hi != hi || b.counts.size() != counts.size())
+        throw std::invalid_argument("cannot merge histograms with different bins");
+    for (size_t i = 0; i < counts.size(); i++) counts[i] += b.counts[i];
+    underflow += b.underflow;
+    overflow += b.overflow;
+}
+
+/**
+ * @brief number of samples, including underflow and overflow
+ */
+uint64_t histogram::total() const {
+    uint64_t t = underflow + overflow;
+    for (uint64_t c : counts) t += c;
+    return t;
+}
+
+/**
+ * @brief approximate quantile assuming samples are uniform within a bin.
+ *      Quantiles falling in the underflow/overflow counters clamp to lo/hi.
+ * @param q quantile in [0, 1]
+ */
+double histogram::quantile(double q) const {
+    if (q < 0.0 || q > 1.0)
+        throw std::invalid_argument("quantile must lie in [0, 1]");
+    uint64_t t = total();
+    if (t == 0) return std::numeric_limits<double>::quiet_NaN();
+    double target = q * (double)t;
+    double cum = (double)underflow;
+    if (target <= cum) return lo;
+    double width = (hi - lo) / (double)counts.size();
+    for (size_t i = 0; i < counts.size(); i++) {
+        double c = (double)counts[i];
+        if (target <= cum + c && c > 0.0)
+            return lo + width * ((double)i + (target - cum) / c);
+        cum += c;
+    }
+    return hi;
+}
+
+//----------------LOGHISTOGRAM----------------//
+
+/**
+ * @brief log-bucket histogram; bucket i covers [lo g^i, lo g^(i+1)) with
+ *      g = 1 + 2 precision, so the bucket midpoint is within precision of any
+ *      value in the bucket
+ * @param lo smallest tracked value (> 0)
+ * @param hi largest tracked value
+ * @param precision relative error of quantiles
+ */
+loghistogram::loghistogram(double lo, double hi, double precision) : lo(lo), hi(hi),
+    growth(1.0 + 2.0 * precision), underflow(0), overflow(0) {
+    if (!(lo > 0.0) || !(hi > lo) || !(precision > 0.0))
+        throw std::invalid_argument("log histogram needs 0 < lo < hi and precision > 0");
+    size_t buckets = (size_t)std::ceil(std::log(hi / lo) / std::log(growth));
+    counts.assign(buckets, 0);
+}
+
+/**
+ * @brief add one sample
+ * @param x sample
+ */
+void loghistogram::push(double x) {
+    if (!(x >= lo)) {
+        underflow++;
+        return;
+    }
+    if (x >= hi) {
+        overflow++;
+        return;
+    }
+    size_t b = (size_t)(std::log(x / lo) / std::log(growth));
+    if (b >= counts.size()) b = counts.size() - 1;
+    counts[b]++;
+}
+
+/**
+ * @brief add the counts of another log histogram with identical buckets
+ * @param b log histogram over a disjoint set of samples
+ */
+void loghistogram::merge(const loghistogram& b) {
+    if (b.lo != lo || b.hi != hi || b.growth != growth)
+        throw std::invalid_argument("cannot merge log histograms with different buckets");
+    for (size_t i = 0; i < counts.size(); i++) counts[i] += b.counts[i];
+    underflow += b.underflow;
+    overflow += b.overflow;
+}
+
+/**
+ * @brief number of samples, including underflow and overflow
+ */
+uint64_t loghistogram::total() const {
+    uint64_t t = underflow + overflow;
+    for (uint64_t c : counts) t += c;
+    return t;
+}
+
+/**
+ * @brief approximate quantile, reported as the geometric midpoint of the
+ *      bucket that contains it (clamped to lo/hi outside the range)
+ * @param q quantile in [0, 1]
+ */
+double loghistogram::quantile(double q) const {
+    if (q < 0.0 || q > 1.0)
+        throw std::invalid_argument("quantile must lie in [0, 1]");
+    uint64_t t = total();
+    if (t == 0) return std::numeric_limits<double>::quiet_NaN();
+    double target = q * (double)t;
+    double cum = (double)underflow;
+    if (target <= cum) return lo;
+    for (size_t i = 0; i < counts.size(); i++) {
+        cum += (double)counts[i];
+        if (target <= cum && counts[i] > 0)
+            return lo * std::pow(growth, (double)i + 0.5);
+    }
+    return hi;
+}
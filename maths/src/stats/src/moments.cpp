@@ -0,0 +1,188 @@
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "include/stats.hpp"
+
+//----------------RUNNINGSTATS----------------//
+
+/**
+ * @brief empty accumulator: no samples, min +inf and max -inf
+ */
+runningstats::runningstats() : n(0), mean(0.0), m2(0.0), m3(0.0), m4(0.0),
+    minv(std::numeric_limits<double>::infinity()),
+    maxv(-std::numeric_limits<double>::infinity()) {}
+
+/**
+ * @brief add one sample, updating the central moment sums in place
+ * @param x sample
+ */
+void runningstats::push(double x) {
+    double n1 = (double)n;
+    n++;
+    double nn = (double)n;
+    double delta = x - mean;
+    double deltan = delta / nn;
+    double deltan2 = deltan * deltan;
+    double term1 = delta * deltan * n1;
+    mean += deltan;
+    m4 += term1 * deltan2 * (nn * nn - 3.0 * nn + 3.0) + 6.0 * deltan2 * m2 - 4.0 * deltan * m3;
+    m3 += term1 * deltan * (nn - 2.0) - 3.0 * deltan * m2;
+    m2 += term1;
+    if (x < minv) minv = x;
+    if (x > maxv) maxv = x;
+}
+
+/**
+ * @brief add a batch of samples
+ * @param x samples
+ */
+void runningstats::push(const std::vector<double>& x) {
+    for (double v : x) push(v);
+}
+
+/**
+ * @brief merge the moments of another shard into this one
+ * @param b moments over a disjoint set of samples
+ */
+void runningstats::merge(const runningstats& b) {
+    if (b.n == 0)
+        return;
+    if (n == 0) {
+        *this = b;
+        return;
+    }
+    double na = (double)n, nb = (double)b.n, nn = na + nb;
+    double delta = b.mean - mean;
+    double d2 = delta * delta, d3 = d2 * delta, d4 = d2 * d2;
+    double nm4 = m4 + b.m4 + d4 * na * nb * (na * na - na * nb + nb * nb) / (nn * nn * nn)
+               + 6.0 * d2 * (na * na * b.m2 + nb * nb * m2) / (nn * nn)
+               + 4.0 * delta * (na * b.m3 - nb * m3) / nn;
+    double nm3 = m3 + b.m3 + d3 * na * nb * (na - nb) / (nn * nn)
+               + 3.0 * delta * (na * b.m2 - nb * m2) / nn;
+    double nm2 = m2 + b.m2 + d2 * na * nb / nn;
+    mean += delta * nb / nn;
+    m2 = nm2;
+    m3 = nm3;
+    m4 = nm4;
+    n += b.n;
+    if (b.minv < minv) minv = b.minv;
+    if (b.maxv > maxv) maxv = b.maxv;
+}
+
+/**
+ * @brief variance of the samples so far (0 with fewer than two)
+ * @param sample use (n - 1) normalisation
+ */
+double runningstats::variance(bool sample) const {
+    if (n < 2) return 0.0;
+    return m2 / (sample ? (double)(n - 1) : (double)n);
+}
+
+/**
+ * @brief standard deviation, the square root of variance()
+ * @param sample use (n - 1) normalisation
+ */
+double runningstats::stddev(bool sample) const {
+    return std::sqrt(variance(sample));
+}
+
+/**
+ * @brief sample skewness g1 = sqrt(n) m3 / m2^(3/2) (0 for constant data)
+ */
+double runningstats::skewness() const {
+    if (n < 2 || m2 == 0.0) return 0.0;
+    return std::sqrt((double)n) * m3 / std::pow(m2, 1.5);
+}
+
+/**
+ * @brief excess kurtosis g2 = n m4 / m2^2 - 3 (0 for constant data)
+ */
+double runningstats::kurtosis() const {
+    if (n < 2 || m2 == 0.0) return 0.0;
+    return (double)n * m4 / (m2 * m2) - 3.0;
+}
+
+//----------------RUNNINGCOV----------------//
+
+/**
+ * @brief empty accumulator of dim-dimensional samples
+ * @param dim sample dimension
+ */
+runningcov::runningcov(unsigned int dim) : dim(dim), n(0), mean(dim, 0.0),
+    comoment(dim, std::vector<double>(dim, 0.0)) {}
+
+/**
+ * @brief add one sample: C += (x - mean_old)(x - mean_new)^T
+ * @param x sample of length dim
+ */
+void runningcov::push(const std::vector<double>& x) {
+    if (x.size() != dim)
+        throw std::invalid_argument("sample dimension does not match covariance dimension");
+    n++;
+    double inv = 1.0 / (double)n;
+    std::vector<double> delta(dim);
+    for (unsigned int i = 0; i < dim; i++) {
+        delta[i] = x[i] - mean[i];
+        mean[i] += delta[i] * inv;
+    }
+    for (unsigned int i = 0; i < dim; i++) {
+        double di = delta[i];
+        for (unsigned int j = i; j < dim; j++)
+            comoment[i][j] += di * (x[j] - mean[j]);
+    }
+}
+
+/**
+ * @brief merge another shard: C = Ca + Cb + (na nb / n) d d^T
+ * @param b covariance over a disjoint set of samples
+ */
+void runningcov::merge(const runningcov& b) {
+    if (b.dim != dim)
+        throw std::invalid_argument("cannot merge covariances of different dimension");
+    if (b.n == 0)
+        return;
+    if (n == 0) {
+        *this = b;
+        return;
+    }
+    double na = (double)n, nb = (double)b.n, nn = na + nb;
+    double f = na * nb / nn;
+    std::vector<double> delta(dim);
+    for (unsigned int i = 0; i < dim; i++) delta[i] = b.mean[i] - mean[i];
+    for (unsigned int i = 0; i < dim; i++) {
+        for (unsigned int j = i; j < dim; j++)
+            comoment[i][j] += b.comoment[i][j] + f * delta[i] * delta[j];
+        mean[i] += delta[i] * nb / nn;
+    }
+    n += b.n;
+}
+
+/**
+ * @brief covariance matrix
+ * @param sample use (n - 1) normalisation
+ * @return dim x dim symmetric matrix
+ */
+std::vector<std::vector<double>> runningcov::covariance(bool sample) const {
+    std::vector<std::vector<double>> c(dim, std::vector<double>(dim, 0.0));
+    double d = sample ? (double)n - 1.0 : (double)n;
+    if (d <= 0.0) return c;
+    for (unsigned int i = 0; i < dim; i++)
+        for (unsigned int j = i; j < dim; j++)
+            c[i][j] = c[j][i] = comoment[i][j] / d;
+    return c;
+}
+
+/**
+ * @brief Pearson correlation matrix (zero where a variable is constant)
+ * @return dim x dim symmetric matrix
+ */
+std::vector<std::vector<double>> runningcov::correlation() const {
+    std::vector<std::vector<double>> c(dim, std::vector<double>(dim, 0.0));
+    for (unsigned int i = 0; i < dim; i++) {
+        for (unsigned int j = i; j < dim; j++) {
+            double s = std::sqrt(comoment[i][i] * comoment[j][j]);
+            c[i][j] = c[j][i] = (s > 0.0) ? comoment[i][j] / s : 0.0;
+        }
+    }
+    return c;
+}
@@ -0,0 +1,162 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include "include/stats.hpp"
+
+//----------------TDIGEST----------------//
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// k1 scale function: centroids are small near q = 0 and q = 1
+inline double kscale(double q, double delta) {
+    return delta / (2.0 * pi) * std::asin(2.0 * q - 1.0);
+}
+
+}
+
+/**
+ * @brief empty digest
+ * @param compression centroid budget delta (at least 10); larger is more accurate
+ */
+tdigest::tdigest(double compression) : compression(compression), total(0.0),
+    minv(std::numeric_limits<double>::infinity()),
+    maxv(-std::numeric_limits<double>::infinity()) {
+    if (compression < 10.0)
+        throw std::invalid_argument("t-digest compression must be at least 10");
+}
+
+/**
+ * @brief add a weighted sample; the buffer is folded into the centroids once
+ *      it holds several times the compression
+ * @param x sample
+ * @param w weight
+ */
+void tdigest::push(double x, double w) {
+    if (std::isnan(x) || w <= 0.0)
+        return;
+    buffer.push_back({x, w});
+    total += w;
+    if (x < minv) minv = x;
+    if (x > maxv) maxv = x;
+    if (buffer.size() >= (size_t)(5.0 * compression)) compress();
+}
+
+/**
+ * @brief merge another digest; its centroids are re-clustered with ours
+ * @param b digest over a disjoint set of samples
+ */
+void tdigest::merge(const tdigest& b) {
+    if (b.total <= 0.0)
+        return;
+    buffer.insert(buffer.end(), b.centroids.begin(), b.centroids.end());
+    buffer.insert(buffer.end(), b.buffer.begin(), b.buffer.end());
+    total += b.total;
+    minv = std::min(minv, b.minv);
+    maxv = std::max(maxv, b.maxv);
+    compress();
+}
+
+/**
+ * @brief merge the buffer into the centroids. All centroids are sorted by mean
+ *      and swept once; a centroid absorbs its right neighbour while the pair
+ *      spans at most one unit of the scale function.
+ */
+void tdigest::compress() {
+    if (buffer.empty())
+        return;
+    buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+    std::sort(buffer.begin(), buffer.end(),
+        [](const centroid& a, const centroid& b) { return a.mean < b.mean; });
+    centroids.clear();
+    centroids.reserve((size_t)compression);
+
+    double sofar = 0.0;
+    centroid cur = buffer[0];
+    double klo = kscale(0.0, compression);
+    for (size_t i = 1; i < buffer.size(); i++) {
+        const centroid& c = buffer[i];
+        double q = (sofar + cur.weight + c.weight) / total;
+        if (kscale(std::min(q, 1.0), compression) - klo <= 1.0) {
+            cur.weight += c.weight;
+            cur.mean += (c.mean - cur.mean) * c.weight / cur.weight;
+        }
+        else {
+            sofar += cur.weight;
+            centroids.push_back(cur);
+            klo = kscale(std::min(sofar / total, 1.0), compression);
+            cur = c;
+        }
+    }
+    centroids.push_back(cur);
+    buffer.clear();
+}
+
+/**
+ * @brief approximate quantile; interpolates linearly between centroid
+ *      centres, treating the extreme centroids as anchored at min and max
+ * @param q quantile in [0, 1]
+ */
+double tdigest::quantile(double q) {
+    if (q < 0.0 || q > 1.0)
+        throw std::invalid_argument("quantile must lie in [0, 1]");
+    compress();
+    if (centroids.empty()) return std::numeric_limits<double>::quiet_NaN();
+    if (centroids.size() == 1) return minv + q * (maxv - minv);
+    double target = q * total;
+    if (target <= 0.0) return minv;
+    if (target >= total) return maxv;
+
+    // left edge: first half-centroid runs from minv to the first centre
+    const centroid& first = centroids.front();
+    if (target < first.weight / 2.0)
+        return minv + (first.mean - minv) * target / (first.weight / 2.0);
+
+    double cum = first.weight / 2.0;    // weight up to the centre of centroid i
+    for (size_t i = 0; i + 1 < centroids.size(); i++) {
+        double gap = (centroids[i].weight + centroids[i + 1].weight) / 2.0;
+        if (target < cum + gap) {
+            double t = (target - cum) / gap;
+            return centroids[i].mean + t * (centroids[i + 1].mean - centroids[i].mean);
+        }
+        cum += gap;
+    }
+    const centroid& last = centroids.back();
+    double t = (target - cum) / (last.weight / 2.0);
+    return last.mean + std::min(t, 1.0) * (maxv - last.mean);
+}
+
+/**
+ * @brief approximate cumulative distribution, inverse of quantile()
+ * @param x value
+ */
+double tdigest::cdf(double x) {
+    compress();
+    if (centroids.empty()) return std::numeric_limits<double>::quiet_NaN();
+    if (x < minv) return 0.0;
+    if (x >= maxv) return 1.0;
+    if (centroids.size() == 1)
+        return (maxv > minv) ? (x - minv) / (maxv - minv) : 1.0;
+
+    const centroid& first = centroids.front();
+    if (x < first.mean) {
+        double span = first.mean - minv;
+        return (span > 0.0 ? (x - minv) / span : 1.0) * first.weight / 2.0 / total;
+    }
+    double cum = first.weight / 2.0;
+    for (size_t i = 0; i + 1 < centroids.size(); i++) {
+        double gap = (centroids[i].weight + centroids[i + 1].weight) / 2.0;
+        if (x < centroids[i + 1].mean) {
+            double span = centroids[i + 1].mean - centroids[i].mean;
+            double t = span > 0.0 ? (x - centroids[i].mean) / span : 0.0;
+            return (cum + t * gap) / total;
+        }
+        cum += gap;
+    }
+    const centroid& last = centroids.back();
+    double span = maxv - last.mean;
+    double t = span > 0.0 ? (x - last.mean) / span : 1.0;
+    return (cum + t * last.weight / 2.0) / total;
+}
@@ -0,0 +1,74 @@
+
+#ifndef TENSOR_HPP
+#define TENSOR_HPP 1
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+/**
+ * @brief CLASS: N-dimensional tensor over a shared contiguous buffer.
+ *      Views (reshape, transpose, slice, broadcast) share the buffer and only
+ *      change offset/shape/strides, so they never copy data. Elementwise
+ *      operators broadcast NumPy-style: shapes are aligned from the last axis
+ *      and axes of size 1 are stretched.
+ * @param data shared element buffer
+ * @param offset index of the first element of this view in data
+ * @param shape extent of each axis
+ * @param strides step in elements along each axis (0 for broadcast axes)
+ */
+template <typename T> class tensor {
+public:
+    std::shared_ptr<std::vector<T>> data;   // shared buffer
+    size_t offset;                          // first element of the view
+    std::vector<size_t> shape;              // extent of each axis
+    std::vector<ptrdiff_t> strides;         // stride of each axis in elements
+
+    // default constructor (0-d tensor holding one zero)
+    tensor();
+    tensor(std::vector<size_t> shape, T value = T());           // filled tensor
+    tensor(std::vector<size_t> shape, std::vector<T> values);   // tensor from row-major values
+
+    size_t ndim() const { return shape.size(); }
+    size_t size() const;                    // number of elements
+    bool contiguous() const;                // row-major and dense
+    T* ptr() { return data->data() + offset; }
+    const T* ptr() const { return data->data() + offset; }
+    T& at(const std::vector<size_t>&);      // element access by index
+    T at(const std::vector<size_t>&) const; // element access by index
+    std::vector<T> tovector() const;        // elements in row-major order
+
+    tensor copy() const;                    // contiguous deep copy
+    tensor reshape(std::vector<size_t>) const;              // view if contiguous, else copy
+    tensor transpose() const;                               // view with reversed axes
+    tensor transpose(const std::vector<size_t>& perm) const;   // view with permuted axes
+    tensor slice(size_t axis, size_t start, size_t stop, size_t step = 1) const;    // view of a range
+    tensor broadcast(const std::vector<size_t>&) const;     // view stretched to a shape
+
+    T sum() const;                          // sum of all elements
+    tensor sum(size_t axis, bool keepdims = false) const;   // sum along an axis
+    tensor mean(size_t axis, bool keepdims = false) const;  // mean along an axis
+    tensor max(size_t axis, bool keepdims = false) const;   // maximum along an axis
+    tensor min(size_t axis, bool keepdims = false) const;   // minimum along an axis
+
+    tensor operator+=(const tensor&);       // in-place addition (rhs broadcast to this shape)
+    tensor operator-=(const tensor&);       // in-place subtraction
+    tensor operator*=(const tensor&);       // in-place multiplication
+    tensor operator/=(const tensor&);       // in-place division
+
+    ~tensor() {};
+};
+
+std::vector<size_t> broadcastShape(const std::vector<size_t>&, const std::vector<size_t>&);
+
+template <typename T> tensor<T> operator+(const tensor<T>&, const tensor<T>&);
+template <typename T> tensor<T> operator-(const tensor<T>&, const tensor<T>&);
+template <typename T> tensor<T> operator*(const tensor<T>&, const tensor<T>&);
+template <typename T> tensor<T> operator/(const tensor<T>&, const tensor<T>&);
+template <typename T> tensor<T> operator+(const tensor<T>&, T);
+template <typename T> tensor<T> operator-(const tensor<T>&, T);
+template <typename T> tensor<T> operator*(const tensor<T>&, T);
+template <typename T> tensor<T> operator/(const tensor<T>&, T);
+template <typename T> tensor<T> matmul(const tensor<T>&, const tensor<T>&);    // batched matrix product
+
+#endif
@@ -0,0 +1,567 @@
+
+#include "include/tensor.hpp"
+#include "include/parallel.hpp"
+#include <stdexcept>
+#include <numeric>
+#include <algorithm>
+#include <array>
+#include <limits>
+
+//----------------HELPERS----------------//
+
+/**
+ * @brief Row-major strides of a dense tensor with the given shape
+ */
+static std::vector<ptrdiff_t> denseStrides(const std::vector<size_t>& shape) {
+    std::vector<ptrdiff_t> s(shape.size(), 1);
+    for (int i = (int)shape.size() - 2; i >= 0; i--)
+        s[i] = s[i + 1] * (ptrdiff_t)shape[i + 1];
+    return s;
+}
+
+/**
+ * @brief Number of elements of a shape
+ */
+static size_t elements(const std::vector<size_t>& shape) {
+    return std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+}
+
+/**
+ * @brief Walk K strided operands of a common shape one innermost row at a
+ *      time. Rows are split across threads; f receives the offset of the row
+ *      in each operand, the row length and the innermost stride of each
+ *      operand, so the inner loop is a plain strided (usually unit) loop the
+ *      compiler can vectorise.
+ * @param shape common shape of all operands
+ * @param strides strides of each operand
+ * @param base offset of each operand
+ * @param f callable (offsets, length, inner strides)
+ */
+template <size_t K, typename F>
+static void stridedRows(const std::vector<size_t>& shape, const std::array<const std::vector<ptrdiff_t>*, K>& strides,
+                        const std::array<size_t, K>& base, F f)
+{
+    size_t nd = shape.size();
+    if (nd == 0) {
+        std::array<ptrdiff_t, K> inner{};
+        f(base, size_t(1), inner);
+        return;
+    }
+    size_t len = shape[nd - 1];
+    size_t rows = elements(shape) / std::max<size_t>(len, 1);
+    if (len == 0 || rows == 0)
+        return;
+    std::array<ptrdiff_t, K> inner;
+    for (size_t k = 0; k < K; k++)
+        inner[k] = (*strides[k])[nd - 1];
+    parallelFor(rows, std::max<size_t>(1, 16384 / len), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+            std::array<size_t, K> off = base;
+            size_t rem = r;
+            for (int d = (int)nd - 2; d >= 0; d--) {
+                size_t i = rem % shape[d];
+                rem /= shape[d];
+                for (size_t k = 0; k < K; k++)
+                    off[k] += i * (*strides[k])[d];
+            }
+            f(off, len, inner);
+        }
+    });
+}
+
+//----------------CONSTRUCTION----------------//
+
+/**
+ * @brief Default constructor, a 0-d tensor (no axes) holding one zero.
+ *      A shape with no axes has one element, so the buffer must hold it
+ *      for size(), sum(), copy() and tovector() to stay in bounds.
+ */
+template <typename T>
+tensor<T>::tensor():data(std::make_shared<std::vector<T>>(1, T())), offset(0) {}
+
+/**
+ * @brief Constructor for a dense tensor filled with a value
+ * @param shape extent of each axis
+ * @param value fill value
+ */
+template <typename T>
+tensor<T>::tensor(std::vector<size_t> shape, T value)
+    :data(std::make_shared<std::vector<T>>(elements(shape), value)), offset(0), shape(shape),
+     strides(denseStrides(shape)) {}
+
+/**
+ * @brief Constructor for a dense tensor from row-major values
+ * @param shape extent of each axis
+ * @param values elements in row-major order
+ * @throws std::invalid_argument if the number of values does not match the shape
+ */
+template <typename T>
+tensor<T>::tensor(std::vector<size_t> shape, std::vector<T> values)
+    :offset(0), shape(shape), strides(denseStrides(shape))
+{
+    if (values.size() != elements(shape))
+        throw std::invalid_argument("tensor: value count does not match shape");
+    data = std::make_shared<std::vector<T>>(std::move(values));
+}
+
+/**
+ * @brief Number of elements in the view
+ */
+template <typename T>
+size_t tensor<T>::size() const {
+    return elements(shape);
+}
+
+/**
+ * @brief True if the view is dense and row-major (can be read as a flat array)
+ */
+template <typename T>
+bool tensor<T>::contiguous() const {
+    ptrdiff_t expect = 1;
+    for (int d = (int)shape.size() - 1; d >= 0; d--) {
+        if (shape[d] != 1 && strides[d] != expect)
+            return false;
+        expect *= (ptrdiff_t)shape[d];
+    }
+    return true;
+}
+
+/**
+ * @brief Element access by multi-index
+ * @throws std::out_of_range if the index has the wrong rank or is out of bounds
+ */
+template <typename T>
+T& tensor<T>::at(const std::vector<size_t>& index) {
+    if (index.size() != shape.size())
+        throw std::out_of_range("tensor: index rank mismatch");
+    ptrdiff_t off = offset;
+    for (size_t d = 0; d < index.size(); d++) {
+        if (index[d] >= shape[d])
+            throw std::out_of_range("tensor: index out of bounds");
+        off += index[d] * strides[d];
+    }
+    return (*data)[off];
+}
+
+/**
+ * @brief Element access by multi-index
+ * @throws std::out_of_range if the index has the wrong rank or is out of bounds
+ */
+template <typename T>
+T tensor<T>::at(const std::vector<size_t>& index) const {
+    return const_cast<tensor<T>*>(this)->at(index);
+}
+
+/**
+ * @brief Elements of the view in row-major order
+ */
+template <typename T>
+std::vector<T> tensor<T>::tovector() const {
+    return *copy().data;
+}
+
+//----------------VIEWS----------------//
+
+/**
+ * @brief Contiguous deep copy of the view
+ */
+template <typename T>
+tensor<T> tensor<T>::copy() const {
+    tensor<T> out(shape);
+    const T* src = data->data();
+    T* dst = out.data->data();
+    stridedRows<2>(shape, {&out.strides, &strides}, {size_t(0), offset},
+        [&](const std::array<size_t, 2>& off, size_t len, const std::array<ptrdiff_t, 2>& in) {
+            T* y = dst + off[0];
+            const T* x = src + off[1];
+            for (size_t i = 0; i < len; i++)
+                y[i] = x[i * in[1]];
+        });
+    return out;
+}
+
+/**
+ * @brief Reshape to a new shape with the same number of elements. A
+ *      contiguous view is reshaped without copying; otherwise it is copied first.
+ * @throws std::invalid_argument if the element count differs
+ */
+template <typename T>
+tensor<T> tensor<T>::reshape(std::vector<size_t> newshape) const {
+    if (elements(newshape) != size())
+        throw std::invalid_argument("tensor: reshape must keep the number of elements");
+    tensor<T> out = contiguous() ? *this : copy();
+    out.shape = newshape;
+    out.strides = denseStrides(newshape);
+    return out;
+}
+
+/**
+ * @brief View with the order of the axes reversed (matrix transpose for 2-D)
+ */
+template <typename T>
+tensor<T> tensor<T>::transpose() const {
+    std::vector<size_t> perm(shape.size());
+    std::iota(perm.rbegin(), perm.rend(), 0);
+    return transpose(perm);
+}
+
+/**
+ * @brief View with permuted axes, axis d of the result is axis perm[d] of this
+ * @throws std::invalid_argument if perm is not a permutation of the axes
+ */
+template <typename T>
+tensor<T> tensor<T>::transpose(const std::vector<size_t>& perm) const {
+    if (perm.size() != shape.size())
+        throw std::invalid_argument("tensor: permutation rank mismatch");
+    std::vector<bool> seen(perm.size(), false);
+    tensor<T> out = *this;
+    for (size_t d = 0; d < perm.size(); d++) {
+        if (perm[d] >= perm.size() || seen[perm[d]])
+            throw std::invalid_argument("tensor: invalid permutation");
+        seen[perm[d]] = true;
+        out.shape[d] = shape[perm[d]];
+        out.strides[d] = strides[perm[d]];
+    }
+    return out;
+}
+
+/**
+ * @brief View of the range [start, stop) with a step along one axis
+ * @throws std::invalid_argument if the axis or range is invalid
+ */
+template <typename T>
+tensor<T> tensor<T>::slice(size_t axis, size_t start, size_t stop, size_t step) const {
+    if (axis >= shape.size() || step == 0 || start > stop || stop > shape[axis])
+        throw std::invalid_argument("tensor: invalid slice");
+    tensor<T> out = *this;
+    out.offset = offset + start * strides[axis];
+    out.shape[axis] = (stop - start + step - 1) / step;
+    out.strides[axis] = strides[axis] * (ptrdiff_t)step;
+    return out;
+}
+
+/**
+ * @brief View stretched to a broadcast-compatible shape (size-1 and missing
+ *      leading axes get stride 0)
+ * @throws std::invalid_argument if the shapes are not broadcast compatible
+ */
+template <typename T>
+tensor<T> tensor<T>::broadcast(const std::vector<size_t>& target) const {
+    if (target.size() < shape.size())
+        throw std::invalid_argument("tensor: cannot broadcast to fewer axes");
+    tensor<T> out = *this;
+    size_t lead = target.size() - shape.size();
+    out.shape = target;
+    out.strides.assign(target.size(), 0);
+    for (size_t d = 0; d < shape.size(); d++) {
+        if (shape[d] == target[lead + d])
+            out.strides[lead + d] = strides[d];
+        else if (shape[d] != 1)
+            throw std::invalid_argument("tensor: shapes are not broadcast compatible");
+    }
+    return out;
+}
+
+//----------------REDUCTIONS----------------//
+
+/**
+ * @brief Reduce along one axis: the axis is moved last with a transpose
+ *      view so that each output element reduces one strided row.
+ */
+template <typename T, typename R>
+static tensor<T> reduceAxis(const tensor<T>& a, size_t axis, bool keepdims, T init, R reduce) {
+    if (axis >= a.ndim())
+        throw std::invalid_argument("tensor: reduction axis out of range");
+    std::vector<size_t> perm;
+    std::vector<size_t> outshape;
+    for (size_t d = 0; d < a.ndim(); d++) {
+        if (d != axis) {
+            perm.push_back(d);
+            outshape.push_back(a.shape[d]);
+        }
+    }
+    perm.push_back(axis);
+    tensor<T> v = a.transpose(perm);
+    tensor<T> out(outshape, init);
+    // one output per row of the moved view
+    std::vector<ptrdiff_t> ostride(v.ndim(), 0);
+    std::vector<ptrdiff_t> odense = (outshape.empty()) ? std::vector<ptrdiff_t>() : out.strides;
+    for (size_t d = 0; d + 1 < v.ndim(); d++)
+        ostride[d] = odense[d];
+    const T* src = v.data->data();
+    T* dst = out.data->data();
+    stridedRows<2>(v.shape, {&ostride, &v.strides}, {size_t(0), v.offset},
+        [&](const std::array<size_t, 2>& off, size_t len, const std::array<ptrdiff_t, 2>& in) {
+            T acc = init;
+            const T* x = src + off[1];
+            for (size_t i = 0; i < len; i++)
+                acc = reduce(acc, x[i * in[1]]);
+            dst[off[0]] = acc;
+        });
+    if (keepdims) {
+        std::vector<size_t> kept = a.shape;
+        kept[axis] = 1;
+        out = out.reshape(kept);
+    }
+    return out;
+}
+
+/**
+ * @brief Sum of all elements
+ */
+template <typename T>
+T tensor<T>::sum() const {
+    tensor<T> flat = reshape({size()});
+    const T* x = flat.ptr();
+    return (T)parallelSum(flat.size(), 16384, [&](size_t begin, size_t end) {
+        double acc = 0.0;
+        for (size_t i = begin; i < end; i++)
+            acc += x[i];
+        return acc;
+    });
+}
+
+/**
+ * @brief Sum along an axis
+ * @param axis axis to reduce
+ * @param keepdims keep the reduced axis with extent 1
+ */
+template <typename T>
+tensor<T> tensor<T>::sum(size_t axis, bool keepdims) const {
+    return reduceAxis(*this, axis, keepdims, T(0), [](T a, T b) { return a + b; });
+}
+
+/**
+ * @brief Mean along an axis
+ * @param axis axis to reduce
+ * @param keepdims keep the reduced axis with extent 1
+ */
+template <typename T>
+tensor<T> tensor<T>::mean(size_t axis, bool keepdims) const {
+    tensor<T> s = sum(axis, keepdims);
+    return s / (T)std::max<size_t>(shape[axis], 1);
+}
+
+/**
+ * @brief Maximum along an axis
+ * @param axis axis to reduce
+ * @param keepdims keep the reduced axis with extent 1
+ */
+template <typename T>
+tensor<T> tensor<T>::max(size_t axis, bool keepdims) const {
+    return reduceAxis(*this, axis, keepdims, std::numeric_limits<T>::lowest(), [](T a, T b) { return std::max(a, b); });
+}
+
+/**
+ * @brief Minimum along an axis
+ * @param axis axis to reduce
+ * @param keepdims keep the reduced axis with extent 1
+ */
+template <typename T>
+tensor<T> tensor<T>::min(size_t axis, bool keepdims) const {
+    return reduceAxis(*this, axis, keepdims, std::numeric_limits<T>::max(), [](T a, T b) { return std::min(a, b); });
+}
+
+//----------------ELEMENTWISE----------------//
+
+/**
+ * @brief Broadcast shape of two shapes (NumPy rules)
+ * @throws std::invalid_argument if the shapes are not compatible
+ */
+std::vector<size_t> broadcastShape(const std::vector<size_t>& a, const std::vector<size_t>& b) {
+    size_t nd = std::max(a.size(), b.size());
+    std::vector<size_t> out(nd);
+    for (size_t d = 0; d < nd; d++) {
+        size_t x = (d < nd - a.size()) ? 1 : a[d - (nd - a.size())];
+        size_t y = (d < nd - b.size()) ? 1 : b[d - (nd - b.size())];
+        if (x != y && x != 1 && y != 1)
+            throw std::invalid_argument("tensor: shapes are not broadcast compatible");
+        out[d] = (x == 1) ? y : x;
+    }
+    return out;
+}
+
+/**
+ * @brief Elementwise out = op(a, b) with broadcasting. Same-shape contiguous
+ *      operands take a flat loop; everything else walks strided rows.
+ */
+template <typename T, typename Op>
+static tensor<T> binary(const tensor<T>& a, const tensor<T>& b, Op op) {
+    std::vector<size_t> shape = broadcastShape(a.shape, b.shape);
+    tensor<T> out(shape);
+    T* y = out.data->data();
+    if (a.shape == shape && b.shape == shape && a.contiguous() && b.contiguous()) {
+        const T* x1 = a.ptr();
+        const T* x2 = b.ptr();
+        parallelFor(out.size(), 16384, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                y[i] = op(x1[i], x2[i]);
+        });
+        return out;
+    }
+    tensor<T> va = a.broadcast(shape), vb = b.broadcast(shape);
+    const T* pa = va.data->data();
+    const T* pb = vb.data->data();
+    stridedRows<3>(shape, {&out.strides, &va.strides, &vb.strides}, {size_t(0), va.offset, vb.offset},
+        [&](const std::array<size_t, 3>& off, size_t len, const std::array<ptrdiff_t, 3>& in) {
+            T* o = y + off[0];
+            const T* x1 = pa + off[1];
+            const T* x2 = pb + off[2];
+            for (size_t i = 0; i < len; i++)
+                o[i] = op(x1[i * in[1]], x2[i * in[2]]);
+        });
+    return out;
+}
+
+/**
+ * @brief In-place this = op(this, b) with b broadcast to the shape of this.
+ *      Writes go through the view, so they are visible in the shared buffer.
+ */
+template <typename T, typename Op>
+static void inplace(tensor<T>& a, const tensor<T>& b, Op op) {
+    tensor<T> vb = b.broadcast(a.shape);
+    T* pa = a.data->data();
+    const T* pb = vb.data->data();
+    stridedRows<2>(a.shape, {&a.strides, &vb.strides}, {a.offset, vb.offset},
+        [&](const std::array<size_t, 2>& off, size_t len, const std::array<ptrdiff_t, 2>& in) {
+            T* x1 = pa + off[0];
+            const T* x2 = pb + off[1];
+            for (size_t i = 0; i < len; i++)
+                x1[i * in[0]] = op(x1[i * in[0]], x2[i * in[1]]);
+        });
+}
+
+/**
+ * @brief Elementwise out = op(a, s) for a scalar s
+ */
+template <typename T, typename Op>
+static tensor<T> scalar(const tensor<T>& a, T s, Op op) {
+    tensor<T> out = a.copy();
+    T* y = out.data->data();
+    parallelFor(out.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            y[i] = op(y[i], s);
+    });
+    return out;
+}
+
+template <typename T> tensor<T> tensor<T>::operator+=(const tensor<T>& b) {
+    inplace(*this, b, [](T x, T y) { return x + y; });
+    return *this;
+}
+
+template <typename T> tensor<T> tensor<T>::operator-=(const tensor<T>& b) {
+    inplace(*this, b, [](T x, T y) { return x - y; });
+    return *this;
+}
+
+template <typename T> tensor<T> tensor<T>::operator*=(const tensor<T>& b) {
+    inplace(*this, b, [](T x, T y) { return x * y; });
+    return *this;
+}
+
+template <typename T> tensor<T> tensor<T>::operator/=(const tensor<T>& b) {
+    inplace(*this, b, [](T x, T y) { return x / y; });
+    return *this;
+}
+
+template <typename T> tensor<T> operator+(const tensor<T>& a, const tensor<T>& b) {
+    return binary(a, b, [](T x, T y) { return x + y; });
+}
+
+template <typename T> tensor<T> operator-(const tensor<T>& a, const tensor<T>& b) {
+    return binary(a, b, [](T x, T y) { return x - y; });
+}
+
+template <typename T> tensor<T> operator*(const tensor<T>& a, const tensor<T>& b) {
+    return binary(a, b, [](T x, T y) { return x * y; });
+}
+
+template <typename T> tensor<T> operator/(const tensor<T>& a, const tensor<T>& b) {
+    return binary(a, b, [](T x, T y) { return x / y; });
+}
+
+template <typename T> tensor<T> operator+(const tensor<T>& a, T s) {
+    return scalar(a, s, [](T x, T y) { return x + y; });
+}
+
+template <typename T> tensor<T> operator-(const tensor<T>& a, T s) {
+    return scalar(a, s, [](T x, T y) { return x - y; });
+}
+
+template <typename T> tensor<T> operator*(const tensor<T>& a, T s) {
+    return scalar(a, s, [](T x, T y) { return x * y; });
+}
+
+template <typename T> tensor<T> operator/(const tensor<T>& a, T s) {
+    return scalar(a, s, [](T x, T y) { return x / y; });
+}
+
+/**
+ * @brief Batched matrix product over the last two axes, leading (batch) axes
+ *      broadcast: (..., m, k) x (..., k, n) -> (..., m, n). Every output row
+ *      is independent and rows of all batches are split across threads.
+ * @throws std::invalid_argument if an operand has fewer than 2 axes or inner sizes differ
+ */
+template <typename T> tensor<T> matmul(const tensor<T>& a, const tensor<T>& b) {
+    if (a.ndim() < 2 || b.ndim() < 2)
+        throw std::invalid_argument("matmul: operands need at least 2 axes");
+    size_t m = a.shape[a.ndim() - 2], k = a.shape[a.ndim() - 1];
+    size_t n = b.shape[b.ndim() - 1];
+    if (b.shape[b.ndim() - 2] != k)
+        throw std::invalid_argument("matmul: inner dimensions must match");
+    std::vector<size_t> abatch(a.shape.begin(), a.shape.end() - 2);
+    std::vector<size_t> bbatch(b.shape.begin(), b.shape.end() - 2);
+    std::vector<size_t> batch = broadcastShape(abatch, bbatch);
+    std::vector<size_t> ashape = batch, bshape = batch, oshape = batch;
+    ashape.insert(ashape.end(), {m, k});
+    bshape.insert(bshape.end(), {k, n});
+    oshape.insert(oshape.end(), {m, n});
+    tensor<T> va = a.broadcast(ashape), vb = b.broadcast(bshape);
+    tensor<T> out(oshape);
+    size_t nb = elements(batch), nd = batch.size();
+    const T* pa = va.data->data();
+    const T* pb = vb.data->data();
+    T* po = out.data->data();
+    parallelFor(nb * m, std::max<size_t>(1, 4096 / std::max<size_t>(k * n, 1)), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+            size_t bi = r / m, i = r % m;
+            size_t oa = va.offset, ob = vb.offset, rem = bi;
+            for (int d = (int)nd - 1; d >= 0; d--) {
+                size_t idx = rem % batch[d];
+                rem /= batch[d];
+                oa += idx * va.strides[d];
+                ob += idx * vb.strides[d];
+            }
+            const T* arow = pa + oa + i * va.strides[nd];
+            T* orow = po + r * n;
+            for (size_t p = 0; p < k; p++) {
+                T av = arow[p * va.strides[nd + 1]];
+                const T* brow = pb + ob + p * vb.strides[nd];
+                ptrdiff_t bs = vb.strides[nd + 1];
+                for (size_t j = 0; j < n; j++)
+                    orow[j] += av * brow[j * bs];
+            }
+        }
+    });
+    return out;
+}
+
+//----------------INSTANTIATIONS----------------//
+
+template class tensor<float>;
+template class tensor<double>;
+
+#define TENSOR_OPERATORS(T) \
+    template tensor<T> operator+(const tensor<T>&, const tensor<T>&); \
+    template tensor<T> operator-(const tensor<T>&, const tensor<T>&); \
+    template tensor<T> operator*(const tensor<T>&, const tensor<T>&); \
+    template tensor<T> operator/(const tensor<T>&, const tensor<T>&); \
+    template tensor<T> operator+(const tensor<T>&, T); \
+    template tensor<T> operator-(const tensor<T>&, T); \
+    template tensor<T> operator*(const tensor<T>&, T); \
+    template tensor<T> operator/(const tensor<T>&, T); \
+    template tensor<T> matmul(const tensor<T>&, const tensor<T>&);
+
+TENSOR_OPERATORS(float)
+TENSOR_OPERATORS(double)
@@ -0,0 +1,438 @@
+// autodiff.cpp: arena and reverse-mode autodiff tape
+#include "include/autodiff.hpp"
+#include "include/activations.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+//----------------ARENA----------------//
+
+/**
+ * @brief n doubles from the current block, moving on to the next block (or
+ * a new one) when it is full
+ * @param n number of doubles
+ * @return uninitialised storage, valid until reset()
+ */
+double* arena::allocate(size_t n) {
+    while (current < blocks.size()) {
+        if (offset + n <= sizes[current]) {
+            double* p = blocks[current].get() + offset;
+            offset += n;
+            return p;
+        }
+        current++;
+        offset = 0;
+    }
+    const size_t size = std::max(block, n);
+    blocks.emplace_back(new double[size]);
+    sizes.push_back(size);
+    offset = n;
+    return blocks.back().get();
+}
+
+/**
+ * @brief Forget every allocation. Blocks are kept; if the last step spread
+ * over several of them they are replaced by one block as large as all of
+ * them together, so the next step of the same size is one bump per request.
+ */
+void arena::reset() {
+    if (blocks.size() > 1) {
+        const size_t total = capacity();
+        blocks.clear();
+        sizes.clear();
+        blocks.emplace_back(new double[total]);
+        sizes.push_back(total);
+    }
+    current = 0;
+    offset = 0;
+}
+
+/**
+ * @brief doubles owned by the arena
+ */
+size_t arena::capacity() const {
+    size_t total = 0;
+    for (size_t s : sizes) total += s;
+    return total;
+}
+
+//----------------RECORDING----------------//
+
+/**
+ * @brief append a node with room for its value
+ */
+node tape::push(op kind, size_t rows, size_t cols, uint32_t a, uint32_t b, double s) {
+    nodes.push_back(entry{kind, a, b, rows, cols, s, mem.allocate(rows * cols), nullptr, nullptr});
+    return node{(uint32_t)(nodes.size() - 1)};
+}
+
+/**
+ * @brief elementwise node of one operand (same shape)
+ */
+node tape::unary(op kind, node a, double s) {
+    return push(kind, nodes[a.id].rows, nodes[a.id].cols, a.id, 0, s);
+}
+
+/**
+ * @brief elementwise node of two operands of the same shape
+ * @throws std::invalid_argument if the shapes differ
+ */
+node tape::same(op kind, node a, node b) {
+    if (nodes[a.id].rows != nodes[b.id].rows || nodes[a.id].cols != nodes[b.id].cols)
+        throw std::invalid_argument("-_-TAPE OPERANDS HAVE DIFFERENT SHAPES-_-");
+    return push(kind, nodes[a.id].rows, nodes[a.id].cols, a.id, b.id);
+}
+
+/**
+ * @brief Leaf holding a copy of x; no gradient flows into it
+ * @param x values, row-major
+ * @param rows number of rows
+ * @param cols number of columns
+ */
+node tape::constant(const double* x, size_t rows, size_t cols) {
+    node v = push(op::constant, rows, cols);
+    std::copy(x, x + rows * cols, nodes[v.id].value);
+    return v;
+}
+
+/**
+ * @brief column vector leaf holding a copy of x
+ */
+node tape::constant(const std::vector<double>& x) {
+    return constant(x.data(), x.size(), 1);
+}
+
+/**
+ * @brief Leaf holding a copy of a weight matrix; backward() adds its
+ * gradient into g (same shape)
+ * @param w weights, one row per vector
+ * @param g gradient accumulator
+ * @throws std::invalid_argument if w is empty or ragged
+ */
+node tape::parameter(const std::vector<std::vector<double>>& w, std::vector<std::vector<double>>& g) {
+    const size_t rows = w.size(), cols = rows ? w[0].size() : 0;
+    if (rows == 0 || g.size() != rows)
+        throw std::invalid_argument("-_-TAPE OPERANDS HAVE DIFFERENT SHAPES-_-");
+    for (size_t i = 0; i < rows; i++) {
+        if (w[i].size() != cols || g[i].size() != cols)
+            throw std::invalid_argument("-_-TAPE OPERANDS HAVE DIFFERENT SHAPES-_-");
+    }
+    node v = push(op::parameter, rows, cols);
+    entry& n = nodes[v.id];
+    n.sink = &g;
+    for (size_t i = 0; i < rows; i++) std::copy(w[i].begin(), w[i].end(), n.value + i * cols);
+    return v;
+}
+
+/**
+ * @brief elementwise a + b
+ */
+node tape::add(node a, node b) {
+    node v = same(op::add, a, b);
+    const double *x = value(a), *y = value(b);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = x[i] + y[i];
+    return v;
+}
+
+/**
+ * @brief elementwise a - b
+ */
+node tape::sub(node a, node b) {
+    node v = same(op::sub, a, b);
+    const double *x = value(a), *y = value(b);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = x[i] - y[i];
+    return v;
+}
+
+/**
+ * @brief elementwise (Hadamard) product a * b
+ */
+node tape::mul(node a, node b) {
+    node v = same(op::mul, a, b);
+    const double *x = value(a), *y = value(b);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = x[i] * y[i];
+    return v;
+}
+
+/**
+ * @brief s times every element of a
+ */
+node tape::scale(node a, double s) {
+    node v = unary(op::scale, a, s);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = s * x[i];
+    return v;
+}
+
+/**
+ * @brief sum of every element of a (1 x 1)
+ */
+node tape::sum(node a) {
+    node v = push(op::sum, 1, 1, a.id);
+    const double* x = value(a);
+    double s = 0.0;
+    for (size_t i = 0, n = rows(a) * cols(a); i < n; i++) s += x[i];
+    nodes[v.id].value[0] = s;
+    return v;
+}
+
+/**
+ * @brief elementwise |a|
+ */
+node tape::abs(node a) {
+    node v = unary(op::abs, a);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = std::fabs(x[i]);
+    return v;
+}
+
+/**
+ * @brief elementwise square root of a
+ */
+node tape::sqrt(node a) {
+    node v = unary(op::sqrt, a);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = std::sqrt(x[i]);
+    return v;
+}
+
+/**
+ * @brief elementwise natural logarithm of a
+ */
+node tape::log(node a) {
+    node v = unary(op::log, a);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = std::log(x[i]);
+    return v;
+}
+
+/**
+ * @brief elementwise a to the power p
+ */
+node tape::power(node a, double p) {
+    node v = unary(op::power, a, p);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = std::pow(x[i], p);
+    return v;
+}
+
+/**
+ * @brief matrix product a b, rows of b streamed in the inner loop
+ * @throws std::invalid_argument if the inner dimensions differ
+ */
+node tape::matmul(node a, node b) {
+    const size_t m = rows(a), k = cols(a), n = cols(b);
+    if (rows(b) != k)
+        throw std::invalid_argument("-_-TAPE OPERANDS HAVE DIFFERENT SHAPES-_-");
+    node v = push(op::matmul, m, n, a.id, b.id);
+    const double *x = value(a), *y = value(b);
+    double* z = nodes[v.id].value;
+    std::fill(z, z + m * n, 0.0);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t p = 0; p < k; p++) {
+            const double s = x[i * k + p];
+            const double* yr = y + p * n;
+            for (size_t j = 0; j < n; j++) z[i * n + j] += s * yr[j];
+        }
+    }
+    return v;
+}
+
+/**
+ * @brief transpose of a
+ */
+node tape::transpose(node a) {
+    const size_t m = rows(a), n = cols(a);
+    node v = push(op::transpose, n, m, a.id);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) z[j * m + i] = x[i * n + j];
+    }
+    return v;
+}
+
+/**
+ * @brief elementwise sigmoid of a
+ */
+node tape::sigmoid(node a) {
+    node v = unary(op::sigmoid, a);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = ::sigmoid(x[i]);
+    return v;
+}
+
+/**
+ * @brief elementwise ReLU of a
+ */
+node tape::relu(node a) {
+    node v = unary(op::relu, a);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = ReLU(x[i]);
+    return v;
+}
+
+/**
+ * @brief elementwise SeLU of a (activations.hpp)
+ */
+node tape::selu(node a) {
+    node v = unary(op::selu, a);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t i = 0, n = rows(v) * cols(v); i < n; i++) z[i] = SeLU(x[i]);
+    return v;
+}
+
+/**
+ * @brief softmax of every column with temperature temp (each column is
+ * one sample's vector), shifted by the column maximum for stability
+ */
+node tape::softmax(node a, double temp) {
+    node v = unary(op::softmax, a, temp);
+    const size_t m = rows(a), n = cols(a);
+    const double* x = value(a);
+    double* z = nodes[v.id].value;
+    for (size_t j = 0; j < n; j++) {
+        double top = x[j];
+        for (size_t i = 1; i < m; i++) top = std::max(top, x[i * n + j]);
+        double s = 0.0;
+        for (size_t i = 0; i < m; i++) s += z[i * n + j] = std::exp((x[i * n + j] - top) / temp);
+        for (size_t i = 0; i < m; i++) z[i * n + j] /= s;
+    }
+    return v;
+}
+
+//----------------BACKWARD----------------//
+
+/**
+ * @brief Gradient of a 1 x 1 node with respect to every node recorded
+ * before it; parameter gradients are added into their accumulators
+ * @param loss scalar node
+ * @throws std::invalid_argument if loss is not 1 x 1
+ */
+void tape::backward(node loss) {
+    if (rows(loss) != 1 || cols(loss) != 1)
+        throw std::invalid_argument("-_-TAPE BACKWARD NEEDS A SCALAR-_-");
+    for (uint32_t i = 0; i <= loss.id; i++) {
+        entry& n = nodes[i];
+        n.grad = mem.allocate(n.rows * n.cols);
+        std::fill(n.grad, n.grad + n.rows * n.cols, 0.0);
+    }
+    nodes[loss.id].grad[0] = 1.0;
+
+    for (uint32_t id = loss.id + 1; id-- > 0;) {
+        const entry& n = nodes[id];
+        const size_t count = n.rows * n.cols;
+        const double* g = n.grad;
+        const double* z = n.value;
+        double* ga = n.kind == op::constant || n.kind == op::parameter ? nullptr : nodes[n.a].grad;
+        const double* x = ga ? nodes[n.a].value : nullptr;
+        switch (n.kind) {
+            case op::constant:
+                break;
+            case op::parameter:
+                for (size_t i = 0; i < n.rows; i++) {
+                    double* row = (*n.sink)[i].data();
+                    for (size_t j = 0; j < n.cols; j++) row[j] += g[i * n.cols + j];
+                }
+                break;
+            case op::add:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i];
+                for (size_t i = 0; i < count; i++) nodes[n.b].grad[i] += g[i];
+                break;
+            case op::sub:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i];
+                for (size_t i = 0; i < count; i++) nodes[n.b].grad[i] -= g[i];
+                break;
+            case op::mul: {
+                const double* y = nodes[n.b].value;
+                double* gb = nodes[n.b].grad;
+                for (size_t i = 0; i < count; i++) {
+                    ga[i] += g[i] * y[i];
+                    gb[i] += g[i] * x[i];
+                }
+                break;
+            }
+            case op::scale:
+                for (size_t i = 0; i < count; i++) ga[i] += n.s * g[i];
+                break;
+            case op::sum:
+                for (size_t i = 0, m = nodes[n.a].rows * nodes[n.a].cols; i < m; i++) ga[i] += g[0];
+                break;
+            case op::abs:
+                for (size_t i = 0; i < count; i++) ga[i] += x[i] > 0.0 ? g[i] : x[i] < 0.0 ? -g[i] : 0.0;
+                break;
+            case op::sqrt:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i] * 0.5 / z[i];
+                break;
+            case op::log:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i] / x[i];
+                break;
+            case op::power:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i] * n.s * std::pow(x[i], n.s - 1.0);
+                break;
+            case op::matmul: {
+                // C = A B: dA += dC B^T, dB += A^T dC
+                const size_t m = nodes[n.a].rows, k = nodes[n.a].cols, c = n.cols;
+                const double* y = nodes[n.b].value;
+                double* gb = nodes[n.b].grad;
+                for (size_t i = 0; i < m; i++) {
+                    const double* gr = g + i * c;
+                    for (size_t p = 0; p < k; p++) {
+                        const double* yr = y + p * c;
+                        double* gbr = gb + p * c;
+                        double d = 0.0;
+                        const double s = x[i * k + p];
+                        for (size_t j = 0; j < c; j++) {
+                            d += gr[j] * yr[j];
+                            gbr[j] += s * gr[j];
+                        }
+                        ga[i * k + p] += d;
+                    }
+                }
+                break;
+            }
+            case op::transpose:
+                for (size_t i = 0; i < n.rows; i++) {
+                    for (size_t j = 0; j < n.cols; j++) ga[j * n.rows + i] += g[i * n.cols + j];
+                }
+                break;
+            case op::sigmoid:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i] * z[i] * (1.0 - z[i]);
+                break;
+            case op::relu:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i] * ReLUder(x[i]);
+                break;
+            case op::selu:
+                for (size_t i = 0; i < count; i++) ga[i] += g[i] * SeLUder(x[i]);
+                break;
+            case op::softmax:
+                // per column: dx = y * (dy - sum(dy * y)) / temp
+                for (size_t j = 0; j < n.cols; j++) {
+                    double d = 0.0;
+                    for (size_t i = 0; i < n.rows; i++) d += g[i * n.cols + j] * z[i * n.cols + j];
+                    for (size_t i = 0; i < n.rows; i++)
+                        ga[i * n.cols + j] += z[i * n.cols + j] * (g[i * n.cols + j] - d) / n.s;
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * @brief forget every node; the arena and the node vector keep their memory
+ */
+void tape::reset() {
+    nodes.clear();
+    mem.reset();
+}
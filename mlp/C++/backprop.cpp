@@ -1,346 +1,367 @@
-
 // backprop.cpp: backward propagation functions for mlp
 #include "include/mlp.hpp"
+#include "include/autodiff.hpp"
+#include <cmath>
 #include <numeric>
+#include <algorithm>
 #include <iostream>
+#include <functional>
+#include <stdexcept>
+
+typedef std::vector<std::vector<double>> matrix;
+
+//----------------GRADIENT----------------//
 
 /**
- * @brief The backward propagation function. This function performs the
- * backward propagation and calculates the error.
+ * @brief Gradient of 1/2 ||output - expected||^2 with respect to every weight,
+ * added to gi, gw and go. Reads only the weights and the forward state passed
+ * in, so it serves both the model's own buffers and a worker's.
+ * @param net model
+ * @param x dense input (used when sx is empty)
+ * @param sx sparse input
+ * @param expected target output
+ * @param output network output
+ * @param activations activations of each hidden layer
+ * @param gi gradient of iweights (accumulated)
+ * @param gw gradient of weights (accumulated)
+ * @param go gradient of oweights (accumulated)
+ * @param delta scratch of length neurons
+ * @param next scratch of length neurons
+ * @param mask dropout bitmask of each hidden layer (activations are the
+ * dropped and rescaled ones), or null without dropout
+ * @param ready called with k as soon as the gradient of weight matrix k is
+ * complete (k = layers - 1 for oweights, l for weights[l - 1], 0 for
+ * iweights), in that order; may be null
+ * @return mean squared error of the sample
+ * @throws std::runtime_error if the model is normalised
  */
-void mlp::backward() {
-    // Initialize vectors
-    std::vector<double> error(out);
-    std::vector<std::vector<double>> ow(out, std::vector<double>(neurons, 0.0));
-    std::vector<double> dh1(neurons, 0.0);  // Initialize to 0
-    
-    // Calculate output layer error
-    for(int i = 0; i < out; i++) {
-        error[i] = expected[i] - output[i];
-    }
+static double gradient(const mlp& net, const double* x, const sparsevec& sx, const double* expected,
+                       const double* output, const matrix& activations, matrix& gi,
+                       std::vector<matrix>& gw, matrix& go, std::vector<double>& delta,
+                       std::vector<double>& next, const std::vector<std::vector<uint64_t>>* mask = nullptr,
+                       const std::function<void(unsigned int)>* ready = nullptr) {
+    if (net.normalize != normalization::none)
+        throw std::runtime_error("-_-NORMALISED MLP TRAINS WITH train(x, t, batch)-_-");
+    const unsigned int hidden = net.layers - 1, neurons = net.neurons;
+    double loss = 0.0;
+    std::fill(delta.begin(), delta.end(), 0.0);
 
-    // Calculate gradients for output weights
-    for(int i = 0; i < out; i++) {
-        for(int j = 0; j < neurons; j++) {
-            ow[i][j] = error[i] * activations[layers-2][j];
+    // output layer: dL/dy = y - t, and the error reaching the top hidden layer
+    const std::vector<double>& top = activations[hidden - 1];
+    for (unsigned int i = 0; i < net.out; i++) {
+        double e = output[i] - expected[i];
+        loss += e * e;
+        const std::vector<double>& w = net.oweights[i];
+        for (unsigned int j = 0; j < neurons; j++) {
+            go[i][j] += e * top[j];
+            delta[j] += e * w[j];
         }
     }
+    if (ready) (*ready)(hidden);
 
-    // Calculate hidden layer deltas
-    for(int i = 0; i < neurons; i++) {
-        double sum = 0.0;
-        for(int j = 0; j < out; j++) {
-            sum += error[j] * oweights[j][i];
+    // hidden layers, top down: through the sigmoid, then into the layer below
+    for (unsigned int l = hidden; l-- > 0;) {
+        const std::vector<double>& a = activations[l];
+        if (mask) {
+            // dropped units pass nothing back; a kept unit's sigmoid output is a * keep
+            const uint64_t* m = (*mask)[l].data();
+            const double keep = 1.0 - net.dropout, inv = 1.0 / keep;
+            for (unsigned int j = 0; j < neurons; j++) {
+                const double s = a[j] * keep;
+                delta[j] = (m[j >> 6] >> (j & 63) & 1) ? delta[j] * inv * s * (1.0 - s) : 0.0;
+            }
         }
-        dh1[i] = sum * sigmoidder(hlayers[layers-2][i]);  // Corrected index
-    }
-
-    // Update output weights
-    for(int i = 0; i < out; i++) {
-        for(int j = 0; j < neurons; j++) {
-            oweights[i][j] += learning * ow[i][j];
+        else {
+            for (unsigned int j = 0; j < neurons; j++) delta[j] *= a[j] * (1.0 - a[j]);
         }
-    }
-
-    // Handle hidden layers
-    std::vector<std::vector<std::vector<double>>> dweights(layers - 1,
-        std::vector<std::vector<double>>(neurons, std::vector<double>(neurons, 0.0)));
-    std::vector<double> layer_error = dh1;
-
-    for(int i = layers-2; i >= 0; i--) {  // Corrected loop condition
-        std::vector<double> next_error(neurons, 0.0);
-        
-        // Calculate weight updates
-        for(int j = 0; j < neurons; j++) {
-            for(int k = 0; k < neurons; k++) {
-                dweights[i][j][k] = layer_error[k] * activations[i][j];
+        if (l == 0) break;
+        const std::vector<double>& below = activations[l - 1];
+        const matrix& w = net.weights[l - 1];
+        std::fill(next.begin(), next.end(), 0.0);
+        for (unsigned int j = 0; j < neurons; j++) {
+            double d = delta[j];
+            if (d == 0.0) continue;
+            std::vector<double>& g = gw[l - 1][j];
+            for (unsigned int k = 0; k < neurons; k++) {
+                g[k] += d * below[k];
+                next[k] += d * w[j][k];
             }
         }
+        std::swap(delta, next);
+        if (ready) (*ready)(l);
+    }
 
-        // Calculate error for next layer back
-        for(int j = 0; j < neurons; j++) {
-            double sum = 0.0;
-            for(int k = 0; k < neurons; k++) {
-                sum += layer_error[k] * weights[i][k][j];
+    // input layer (only the columns of nonzero features for a sparse input)
+    if (!sx.index.empty()) {
+        for (unsigned int j = 0; j < neurons; j++) {
+            for (size_t k = 0; k < sx.index.size(); k++) {
+                gi[j][sx.index[k]] += delta[j] * sx.value[k];
             }
-            next_error[j] = sum * sigmoidder(hlayers[i][j]);
         }
-        
-        layer_error = next_error;
     }
-
-    // Update hidden layer weights
-    for(int i = layers-2; i >= 0; i--) {  // Corrected loop condition
-        for(int j = 0; j < neurons; j++) {
-            for(int k = 0; k < neurons; k++) {
-                weights[i][j][k] += learning * dweights[i][j][k];
+    else {
+        for (unsigned int j = 0; j < neurons; j++) {
+            for (unsigned int k = 0; k < net.in; k++) {
+                gi[j][k] += delta[j] * x[k];
             }
         }
     }
+    if (ready) (*ready)(0);
+    return loss / net.out;
+}
 
-    // Update input weights
-    for(int i = 0; i < neurons; i++) {
-        for(int j = 0; j < in; j++) {
-            iweights[i][j] += learning * layer_error[i];
+/**
+ * @brief gradient descent step W -= rate * g on every matrix
+ */
+static void descend(mlp& net, const matrix& gi, const std::vector<matrix>& gw, const matrix& go, double rate) {
+    auto step = [rate](matrix& w, const matrix& g) {
+        for (size_t i = 0; i < w.size(); i++) {
+            for (size_t j = 0; j < w[i].size(); j++) w[i][j] -= rate * g[i][j];
         }
-    }
-
-    // Reset activations and hlayers
-    for(int i = 0; i < layers; i++) {
-        std::fill(activations[i].begin(), activations[i].end(), 0.0);
-        std::fill(hlayers[i].begin(), hlayers[i].end(), 0.0);
-    }
-    std::fill(output.begin(), output.end(), 0.0);
+    };
+    step(net.iweights, gi);
+    for (size_t l = 0; l < net.weights.size(); l++) step(net.weights[l], gw[l]);
+    step(net.oweights, go);
 }
 
+//----------------MODEL STATE----------------//
 
 /**
- * @brief Backpropagation with gradients
+ * @brief The backward propagation function. Computes the gradient of the
+ * current sample into giweights, gweights and goweights and takes one
+ * gradient descent step. The forward state is left untouched.
  */
-void mlp::backprop() {
-    // Compute output layer error
-    std::vector<double> output_error(out, 0.0);
-    for (unsigned int i = 0; i < out; ++i) {
-        output_error[i] = output[i] - expected[i];
-    }
-    // Compute output layer gradients
-    for (unsigned int i = 0; i < out; ++i) {
-        for (unsigned int j = 0; j < neurons; ++j) {
-            goweights[i][j] = output_error[i] * activations[layers - 1][j];
-        }
-    }
-
-    // Compute hidden layer gradients
-    std::vector<double> hidden_error(neurons, 0.0);
-    for (unsigned int i = 0; i < neurons; ++i) {
-        double error_sum = 0.0;
-        for (unsigned int j = 0; j < out; ++j) {
-            error_sum += oweights[j][i] * output_error[j];
-        }
-        hidden_error[i] = error_sum * activations[layers - 1][i] * (1 - activations[layers - 1][i]);
-    }
-    
-    // Compute gradients for the hidden layer
-    for (unsigned int i = 0; i < neurons; ++i) {
-        for (unsigned int j = 0; j < in; ++j) {
-            giweights[i][j] = hidden_error[i] * input[j];
-        }
-    }
-    
-    // Propagate error backward through the network
-    for (int l = layers - 2; l >= 0; --l) {
-        std::vector<double> layer_error(neurons, 0.0);
-        for (unsigned int i = 0; i < neurons; ++i) {
-            double error_sum = 0.0;
-            for (unsigned int j = 0; j < (neurons); ++j) {
-                error_sum += weights[l][j][i] * gweights[l][j][i];
-            }
-            layer_error[i] = error_sum * activations[l][i] * (1 - activations[l][i]);
-        }
-        
-        // Compute gradients for the current layer
-        for (unsigned int i = 0; i < neurons; ++i) {
-            for (unsigned int j = 0; j < neurons; ++j) {
-                gweights[l][i][j] = layer_error[i] * activations[l][j];
-            }
-        }
+void mlp::backward() {
+    for (auto& row : giweights) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& row : goweights) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& m : gweights) {
+        for (auto& row : m) std::fill(row.begin(), row.end(), 0.0);
     }
+    std::vector<double> delta(neurons), next(neurons);
+    gradient(*this, input.data(), sinput, expected.data(), output.data(), activations,
+             giweights, gweights, goweights, delta, next);
+    descend(*this, giweights, gweights, goweights, learning);
 }
 
+//----------------WORKER STATE----------------//
 
 /**
- * @brief Perform backpropagation with L1 regularization
+ * @brief Backward propagation of a worker's sample. The gradient is added to
+ * the worker's accumulators; the weights are only read, so workers can run
+ * concurrently. Call forward(w) first.
+ * @param w worker
+ * @return mean squared error of the sample
  */
-void mlp::backwithL1() {
-    double lambda = 0.01; // Regularization parameter
+double mlp::backward(worker& w) const {
+    double loss = gradient(*this, w.input.data(), w.sinput, w.expected.data(), w.output.data(),
+                           w.activations, w.giweights, w.gweights, w.goweights, w.delta, w.next,
+                           w.mask.empty() ? nullptr : &w.mask);
+    w.samples++;
+    return loss;
+}
 
-    // Perform standard backpropagation to compute gradients
-    backprop();
+/**
+ * @brief Backward propagation of a worker's sample that reports progress:
+ * ready(k) is called as soon as the gradient of weight matrix k is final
+ * (k = layers - 1 for oweights, l for weights[l - 1], 0 for iweights; top
+ * down), so communication of the finished layers can overlap with the rest
+ * of the pass
+ * @param w worker
+ * @param ready progress callback
+ * @return mean squared error of the sample
+ */
+double mlp::backward(worker& w, const std::function<void(unsigned int)>& ready) const {
+    double loss = gradient(*this, w.input.data(), w.sinput, w.expected.data(), w.output.data(),
+                           w.activations, w.giweights, w.gweights, w.goweights, w.delta, w.next,
+                           w.mask.empty() ? nullptr : &w.mask, &ready);
+    w.samples++;
+    return loss;
+}
 
-    // Compute L1 penalty
-    double l1_penalty = 0.0;
-    // Compute L1 penalty for the weights of the hidden layers
-    for (unsigned int l = 0; l < layers-1; ++l) {
-        for (unsigned int i = 0; i < neurons; ++i) {
-            for (unsigned int j = 0; j < neurons; ++j) {
-                l1_penalty += std::abs(weights[l][i][j]);
-            }
-        }
-    }
-    // Compute L1 penalty for the weights of the input layer
-    for (unsigned int i = 0; i < neurons; ++i) {
-        for (unsigned int j = 0; j < in; ++j) {
-            l1_penalty += std::abs(iweights[i][j]);
-        }
-    }
-    // Compute L1 penalty for the weights of the output layer
-    for (unsigned int i = 0; i < out; ++i) {
-        for (unsigned int j = 0; j < neurons; ++j) {
-            l1_penalty += std::abs(oweights[i][j]);
-        }
-    }
+/**
+ * @brief Apply a worker's accumulated gradient (averaged over its samples)
+ * and clear it. Not thread-safe: one thread updates while no worker runs.
+ * @param w worker
+ */
+void mlp::update(worker& w) {
+    if (w.samples > 0)
+        descend(*this, w.giweights, w.gweights, w.goweights, learning / w.samples);
+    w.zero();
+}
 
-    // Update weights with L1 regularization
-    // Update the weights of the hidden layers
-    for (unsigned int l = 0; l < layers-1; ++l) {
-        for (unsigned int i = 0; i < neurons; ++i) {
-            for (unsigned int j = 0; j < neurons; ++j) {
-                double gradient = gweights[l][i][j];
-                if (weights[l][i][j] > 0) {
-                    weights[l][i][j] -= learning * (lambda + gradient);
-                } else {
-                    weights[l][i][j] -= learning * (-lambda + gradient);
-                }
-            }
-        }
-    }
-    // Update the weights of the input layer
-    for (unsigned int i = 0; i < neurons; ++i) {
-        for (unsigned int j = 0; j < in; ++j) {
-            double gradient = giweights[i][j];
-            if (iweights[i][j] > 0) {
-                iweights[i][j] -= learning * (lambda + gradient);
-            } else {
-                iweights[i][j] -= learning * (-lambda + gradient);
-            }
-        }
-    }
-    // Update the weights of the output layer
-    for (unsigned int i = 0; i < out; ++i) {
-        for (unsigned int j = 0; j < neurons; ++j) {
-            double gradient = goweights[i][j];
-            if (oweights[i][j] > 0) {
-                oweights[i][j] -= learning * (lambda + gradient);
-            } else {
-                oweights[i][j] -= learning * (-lambda + gradient);
-            }
-        }
+/**
+ * @brief Apply the gradients of several workers as one step averaged over
+ * all of their samples (synchronous data-parallel training), then clear them
+ * @param workers workers that ran on disjoint parts of a batch
+ */
+void mlp::update(std::vector<worker>& workers) {
+    unsigned int total = 0;
+    for (const worker& w : workers) total += w.samples;
+    for (worker& w : workers) {
+        if (total > 0 && w.samples > 0)
+            descend(*this, w.giweights, w.gweights, w.goweights, learning / total);
+        w.zero();
     }
-    std::cout << "Into Backprop" << std::endl;
-    // Compute loss with L1 penalty
-    double loss = computeLossWithL1(output, expected, *this, lambda);
-    std::cout << "Loss with L1 penalty: " << loss << std::endl;
 }
 
-void mlp::backwithL2() {
-    double lambda = 0.01; // Regularization parameter
-
-    // Perform standard backpropagation to compute gradients
-    backprop();
+//----------------TAPE----------------//
 
-    // Compute L2 penalty
-    double l2_penalty = 0.0;
-    for (unsigned int l = 0; l < layers-1; ++l) {
-        for (unsigned int i = 0; i < neurons; ++i) {
-            for (unsigned int j = 0; j < neurons; ++j) {
-                l2_penalty += weights[l][i][j] * weights[l][i][j];
-            }
-        }
-    }
-    for (unsigned int i = 0; i < neurons; ++i) {
-        for (unsigned int j = 0; j < in; ++j) {
-            l2_penalty += iweights[i][j] * iweights[i][j];
-        }
-    }
-    for (unsigned int i = 0; i < out; ++i) {
-        for (unsigned int j = 0; j < neurons; ++j) {
-            l2_penalty += oweights[i][j] * oweights[i][j];
-        }
+/**
+ * @brief Record the forward pass of the loaded sample (input, expected) and
+ * the loss 1/2 ||output - expected||^2 on a tape. The weights enter as
+ * parameters whose gradients go to giweights, gweights and goweights.
+ * @param t tape (reset here)
+ * @param net model
+ * @param params the weight parameters, input layer first
+ * @return loss node
+ * @throws std::runtime_error if the model is normalised
+ */
+static node record(tape& t, mlp& net, std::vector<node>& params) {
+    if (net.normalize != normalization::none)
+        throw std::runtime_error("-_-NORMALISED MLP TRAINS WITH train(x, t, batch)-_-");
+    t.reset();
+    params.clear();
+    node a = t.constant(net.input);
+    for (unsigned int l = 0; l + 1 < net.layers; l++) {
+        params.push_back(l == 0 ? t.parameter(net.iweights, net.giweights)
+                                : t.parameter(net.weights[l - 1], net.gweights[l - 1]));
+        a = t.sigmoid(t.matmul(params.back(), a));
     }
+    params.push_back(t.parameter(net.oweights, net.goweights));
+    node y = t.matmul(params.back(), a);
+    std::copy(t.value(y), t.value(y) + net.out, net.output.begin());
+    node e = t.sub(y, t.constant(net.expected));
+    return t.scale(t.sum(t.mul(e, e)), 0.5);
+}
 
-    // Update weights with L2 regularization
-    for (unsigned int l = 0; l < layers-1; ++l) {
-        for (unsigned int i = 0; i < neurons; ++i) {
-            for (unsigned int j = 0; j < neurons; ++j) {
-                double gradient = gweights[l][i][j];
-                weights[l][i][j] -= learning * (lambda * weights[l][i][j] + gradient);
-            }
-        }
-    }
-    for (unsigned int i = 0; i < neurons; ++i) {
-        for (unsigned int j = 0; j < in; ++j) {
-            double gradient = giweights[i][j];
-            iweights[i][j] -= learning * (lambda * iweights[i][j] + gradient);
-        }
-    }
-    for (unsigned int i = 0; i < out; ++i) {
-        for (unsigned int j = 0; j < neurons; ++j) {
-            double gradient = goweights[i][j];
-            oweights[i][j] -= learning * (lambda * oweights[i][j] + gradient);
-        }
+/**
+ * @brief clear giweights, gweights and goweights
+ */
+static void zero(mlp& net) {
+    for (auto& row : net.giweights) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& row : net.goweights) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& m : net.gweights) {
+        for (auto& row : m) std::fill(row.begin(), row.end(), 0.0);
     }
+}
 
-    // Compute loss with L2 penalty
-    double loss = computeLossWithL2(output, expected, *this, lambda);
-    std::cout << "Loss with L2 penalty: " << loss << std::endl;
+/**
+ * @brief the tape of this thread; reset per step, so its memory is reused
+ */
+static tape& scratch() {
+    static thread_local tape t;
+    return t;
 }
 
+/**
+ * @brief Gradient of 1/2 ||output - expected||^2 for the loaded sample,
+ * computed by the tape into giweights, gweights and goweights (replacing
+ * them); output is refreshed. The weights are not changed.
+ * @throws std::runtime_error if the model is normalised
+ */
+void mlp::backprop() {
+    static thread_local std::vector<node> params;
+    tape& t = scratch();
+    node loss = record(t, *this, params);
+    zero(*this);
+    t.backward(loss);
+}
 
 /**
- * @brief Rprop algorithm for MLP
- * @param dataset Input dataset
+ * @brief Gradient step on 1/2 ||output - expected||^2 + lambda sum |w| over
+ * every weight matrix (lambda = 0.01), differentiated by the tape; prints the
+ * penalised loss
+ * @throws std::runtime_error if the model is normalised
+ */
+void mlp::backwithL1() {
+    const double lambda = 0.01; // Regularization parameter
+    static thread_local std::vector<node> params;
+    tape& t = scratch();
+    node loss = record(t, *this, params);
+    for (node w : params) loss = t.add(loss, t.scale(t.sum(t.abs(w)), lambda));
+    zero(*this);
+    t.backward(loss);
+    descend(*this, giweights, gweights, goweights, learning);
+    std::cout << "Loss with L1 penalty: " << t.scalar(loss) << std::endl;
+}
+
+/**
+ * @brief Gradient step on 1/2 ||output - expected||^2 + lambda / 2 sum w^2
+ * over every weight matrix (lambda = 0.01, i.e. weight decay lambda w),
+ * differentiated by the tape; prints the penalised loss
+ * @throws std::runtime_error if the model is normalised
+ */
+void mlp::backwithL2() {
+    const double lambda = 0.01; // Regularization parameter
+    static thread_local std::vector<node> params;
+    tape& t = scratch();
+    node loss = record(t, *this, params);
+    for (node w : params) loss = t.add(loss, t.scale(t.sum(t.power(w, 2.0)), 0.5 * lambda));
+    zero(*this);
+    t.backward(loss);
+    descend(*this, giweights, gweights, goweights, learning);
+    std::cout << "Loss with L2 penalty: " << t.scalar(loss) << std::endl;
+}
+
+/**
+ * @brief Rprop (iRprop-, Igel and Huesken 2000) for MLP: full-batch
+ * gradients from the tape, then every weight moves against the sign of its
+ * gradient by its own step size, which grows by 1.2 while the sign holds
+ * and shrinks by 0.5 when it flips (that weight then skips one update).
+ * Stops after epochs passes or once the mean squared error is below 0.01.
+ * @param dataset input samples (raw, normalised with the model's scaler),
+ * all trained towards expected
  * @note This version only updates the weights and doesn't update the bias
+ * @throws std::runtime_error if the model is normalised
  */
 void mlp::rprop(std::vector<std::vector<double>> dataset) {
     const double etaPlus = 1.2;     // Increase factor
     const double etaMinus = 0.5;    // Decrease factor
     const double deltaMax = 50.0;   // Maximum update value
     const double deltaMin = 1e-6;   // Minimum update value
+    const double delta0 = 0.1;      // Initial update value
 
-    std::vector<double> outputError(out, 0.0);
-    std::vector<double> hiddenError(neurons, 0.0);
-    std::vector<std::vector<double>> gradients(out, std::vector<double>(neurons, 0.0));
-    std::vector<std::vector<double>> deltaWeights(out, std::vector<double>(neurons, deltaMin));
+    // step size and previous gradient of every weight, shaped like the weights
+    std::vector<matrix*> w = {&iweights}, g = {&giweights};
+    for (size_t l = 0; l + 2 < layers; l++) {
+        w.push_back(&weights[l]);
+        g.push_back(&gweights[l]);
+    }
+    w.push_back(&oweights);
+    g.push_back(&goweights);
+    std::vector<matrix> step, last;
+    for (matrix* m : w) {
+        step.emplace_back(m->size(), std::vector<double>((*m)[0].size(), delta0));
+        last.emplace_back(m->size(), std::vector<double>((*m)[0].size(), 0.0));
+    }
 
+    std::vector<node> params;
+    tape& t = scratch();
     for (unsigned int epoch = 0; epoch < epochs; ++epoch) {
         double totalError = 0.0;
+        zero(*this);
         for (const auto& data : dataset) {
-            input = data;
-            forward();
-            backward();
-
-            // Compute mean square error
-            double error = 0.0;
-            for (unsigned int i = 0; i < out; ++i) {
-                outputError[i] = (expected[i] - output[i]);
-                error += std::pow(expected[i] - output[i], 2);
-            }
-            error /= out;
-            totalError += error;
+            loadInput(data);
+            node loss = record(t, *this, params);
+            t.backward(loss);
+            totalError += 2.0 * t.scalar(loss) / out;
+        }
 
-            // Update weights using Rprop
-            for (unsigned int i = 0; i < out; ++i) {
-                for (unsigned int j = 0; j < neurons; ++j) {
-                    double grad = outputError[i] * hlayers[0][j];
-                    if (grad * gradients[i][j] > 0) {
-                        deltaWeights[i][j] = std::min(deltaWeights[i][j] * etaPlus, deltaMax);
-                        oweights[i][j] += (grad > 0 ? -deltaWeights[i][j] : deltaWeights[i][j]);
-                        gradients[i][j] = grad;
-                    } else if (grad * gradients[i][j] < 0) {
-                        deltaWeights[i][j] = std::max(deltaWeights[i][j] * etaMinus, deltaMin);
-                        oweights[i][j] += (grad > 0 ? -deltaWeights[i][j] : deltaWeights[i][j]);
-                        gradients[i][j] = 0;
-                    } else {
-                        oweights[i][j] += (grad > 0 ? -deltaWeights[i][j] : deltaWeights[i][j]);
-                        gradients[i][j] = grad;
-                    }
-                }
-            }
-            for (unsigned int i = 0; i < neurons; ++i) {
-                for (unsigned int j = 0; j < in; ++j) {
-                    double grad = hiddenError[i] * input[j];
-                    if (grad * gradients[i][j] > 0) {
-                        deltaWeights[i][j] = std::min(deltaWeights[i][j] * etaPlus, deltaMax);
-                        iweights[i][j] += (grad > 0 ? -deltaWeights[i][j] : deltaWeights[i][j]);
-                        gradients[i][j] = grad;
-                    } else if (grad * gradients[i][j] < 0) {
-                        deltaWeights[i][j] = std::max(deltaWeights[i][j] * etaMinus, deltaMin);
-                        iweights[i][j] += (grad > 0 ? -deltaWeights[i][j] : deltaWeights[i][j]);
-                        gradients[i][j] = 0;
-                    } else {
-                        iweights[i][j] += (grad > 0 ? -deltaWeights[i][j] : deltaWeights[i][j]);
-                        gradients[i][j] = grad;
+        // Update weights using Rprop
+        for (size_t k = 0; k < w.size(); k++) {
+            for (size_t i = 0; i < w[k]->size(); i++) {
+                for (size_t j = 0; j < (*w[k])[i].size(); j++) {
+                    double grad = (*g[k])[i][j];
+                    double& delta = step[k][i][j];
+                    if (grad * last[k][i][j] > 0) {
+                        delta = std::min(delta * etaPlus, deltaMax);
+                    } else if (grad * last[k][i][j] < 0) {
+                        delta = std::max(delta * etaMinus, deltaMin);
+                        grad = 0.0;
                     }
+                    if (grad > 0) (*w[k])[i][j] -= delta;
+                    else if (grad < 0) (*w[k])[i][j] += delta;
+                    last[k][i][j] = grad;
                 }
             }
         }
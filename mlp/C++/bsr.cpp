@@ -0,0 +1,183 @@
+// bsr.cpp: block-sparse weight storage and inference for pruned mlp models
+#include "include/bsr.hpp"
+#include "include/mlp.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+//----------------BSR----------------//
+
+/**
+ * @brief Convert a dense matrix to block-sparse form, storing only the
+ * br x bc tiles that hold a nonzero
+ * @param m dense matrix (rows of equal length)
+ * @param br block rows
+ * @param bc block columns
+ * @return block-sparse matrix
+ * @throws std::invalid_argument if a block dimension is zero
+ */
+bsr tobsr(const std::vector<std::vector<double>>& m, unsigned int br, unsigned int bc) {
+    if (br == 0 || bc == 0)
+        throw std::invalid_argument("-_-BLOCK SIZE MUST BE POSITIVE-_-");
+    bsr a;
+    a.rows = m.size();
+    a.cols = a.rows ? m[0].size() : 0;
+    a.br = br;
+    a.bc = bc;
+    size_t nbr = a.prows() / br, nbc = a.pcols() / bc;
+    a.rowptr.assign(1, 0);
+    for (size_t rb = 0; rb < nbr; rb++) {
+        size_t r1 = std::min<size_t>(a.rows, (rb + 1) * br);
+        for (size_t cb = 0; cb < nbc; cb++) {
+            size_t c1 = std::min<size_t>(a.cols, (cb + 1) * bc);
+            bool nonzero = false;
+            for (size_t r = rb * br; r < r1 && !nonzero; r++) {
+                for (size_t c = cb * bc; c < c1; c++) {
+                    if (m[r][c] != 0.0) { nonzero = true; break; }
+                }
+            }
+            if (!nonzero) continue;
+            a.colidx.push_back(cb);
+            size_t base = a.values.size();
+            a.values.resize(base + (size_t)br * bc, 0.0);
+            for (size_t r = rb * br; r < r1; r++) {
+                for (size_t c = cb * bc; c < c1; c++) {
+                    a.values[base + (r - rb * br) * bc + (c - cb * bc)] = m[r][c];
+                }
+            }
+        }
+        a.rowptr.push_back(a.colidx.size());
+    }
+    return a;
+}
+
+/**
+ * @brief fixed-size tile kernel; the block shape is a compile-time constant
+ * so the inner products unroll and vectorise
+ */
+template <unsigned int BR, unsigned int BC>
+static void bsrkernel(const bsr& a, const double* x, double* y) {
+    const size_t nbr = a.rowptr.size() - 1;
+    for (size_t rb = 0; rb < nbr; rb++) {
+        double acc[BR] = {};
+        for (unsigned int k = a.rowptr[rb]; k < a.rowptr[rb + 1]; k++) {
+            const double* v = a.values.data() + (size_t)k * BR * BC;
+            const double* xs = x + (size_t)a.colidx[k] * BC;
+            for (unsigned int r = 0; r < BR; r++) {
+                for (unsigned int c = 0; c < BC; c++) acc[r] += v[r * BC + c] * xs[c];
+            }
+        }
+        for (unsigned int r = 0; r < BR; r++) y[rb * BR + r] = acc[r];
+    }
+}
+
+/**
+ * @brief Block-sparse matrix-vector product y = A x. Common block shapes
+ * (1x1, 2x2, 4x4, 8x8, 1x8, 8x1) use unrolled kernels, others a generic loop.
+ * @param a block-sparse matrix
+ * @param x input, zero padded to a.pcols()
+ * @param y output of length a.prows()
+ */
+void bsrmv(const bsr& a, const double* x, double* y) {
+    if (a.br == 1 && a.bc == 1) return bsrkernel<1, 1>(a, x, y);
+    if (a.br == 2 && a.bc == 2) return bsrkernel<2, 2>(a, x, y);
+    if (a.br == 4 && a.bc == 4) return bsrkernel<4, 4>(a, x, y);
+    if (a.br == 8 && a.bc == 8) return bsrkernel<8, 8>(a, x, y);
+    if (a.br == 1 && a.bc == 8) return bsrkernel<1, 8>(a, x, y);
+    if (a.br == 8 && a.bc == 1) return bsrkernel<8, 1>(a, x, y);
+    const size_t nbr = a.rowptr.size() - 1, tile = (size_t)a.br * a.bc;
+    for (size_t rb = 0; rb < nbr; rb++) {
+        double* yr = y + rb * a.br;
+        std::fill(yr, yr + a.br, 0.0);
+        for (unsigned int k = a.rowptr[rb]; k < a.rowptr[rb + 1]; k++) {
+            const double* v = a.values.data() + k * tile;
+            const double* xs = x + (size_t)a.colidx[k] * a.bc;
+            for (unsigned int r = 0; r < a.br; r++) {
+                double sum = 0.0;
+                for (unsigned int c = 0; c < a.bc; c++) sum += v[r * a.bc + c] * xs[c];
+                yr[r] += sum;
+            }
+        }
+    }
+}
+
+//----------------SPMLP----------------//
+
+/**
+ * @brief Export the matrices used by mlp::forward() in block-sparse form.
+ * Prune with block groups of the same shape (prune(net, s, br, bc)) so that
+ * whole tiles are empty.
+ * @param net (pruned) model
+ * @param br block rows
+ * @param bc block columns
+ * @throws std::runtime_error if the model is normalised
+ */
+spmlp::spmlp(const mlp& net, unsigned int br, unsigned int bc)
+    : in(net.in), out(net.out), norm(net.norm)
+{
+    if (net.normalize != normalization::none)
+        throw std::runtime_error("-_-NORMALISED MLP CANNOT BE EXPORTED BLOCK-SPARSE-_-");
+    layer.push_back(tobsr(net.iweights, br, bc));
+    for (unsigned int l = 1; l + 1 < net.layers; l++) layer.push_back(tobsr(net.weights[l - 1], br, bc));
+    layer.push_back(tobsr(net.oweights, br, bc));
+}
+
+/**
+ * @brief length of one of the two ping-pong buffers used by infer()
+ */
+size_t spmlp::width() const {
+    size_t w = in;
+    for (const bsr& a : layer) w = std::max({w, a.prows(), a.pcols()});
+    return w;
+}
+
+/**
+ * @brief Inference of one sample through the block-sparse layers
+ * @param x raw input of length in
+ * @param y output of length out
+ * @param scratch buffer, resized to 2 * width() if smaller
+ */
+void spmlp::infer(const double* x, double* y, std::vector<double>& scratch) const {
+    const size_t w = width();
+    if (scratch.size() < 2 * w) scratch.resize(2 * w);
+    double* a = scratch.data();
+    double* b = a + w;
+    std::copy(x, x + in, a);
+    norm.transform(a);
+    std::fill(a + in, a + layer[0].pcols(), 0.0);
+    for (size_t l = 0; l + 1 < layer.size(); l++) {
+        bsrmv(layer[l], a, b);
+        const unsigned int rows = layer[l].rows;
+        for (unsigned int r = 0; r < rows; r++) b[r] = sigmoid(b[r]);
+        // padding rows must read as zero in the next product
+        std::fill(b + rows, b + std::max<size_t>(rows, layer[l + 1].pcols()), 0.0);
+        std::swap(a, b);
+    }
+    bsrmv(layer.back(), a, b);
+    std::copy(b, b + out, y);
+}
+
+/**
+ * @brief Inference of one sample with its own scratch
+ * @param x raw input of length in
+ * @return output of length out
+ * @throws std::runtime_error if the input has the wrong size
+ */
+std::vector<double> spmlp::infer(const std::vector<double>& x) const {
+    if (x.size() != in)
+        throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    std::vector<double> scratch, y(out);
+    infer(x.data(), y.data(), scratch);
+    return y;
+}
+
+/**
+ * @brief fraction of tiles stored over all layers
+ */
+double spmlp::density() const {
+    size_t stored = 0, total = 0;
+    for (const bsr& a : layer) {
+        stored += a.blocks();
+        total += (a.prows() / a.br) * (a.pcols() / a.bc);
+    }
+    return total ? (double)stored / (double)total : 0.0;
+}
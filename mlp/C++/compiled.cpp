@@ -0,0 +1,107 @@
+// compiled.cpp: training mlp through a compiled computation graph
+#include "include/mlp.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+//----------------GRAPH----------------//
+
+/**
+ * @brief Build the training step of a batch as a graph: inputs x (in x
+ * batch, one sample per column, node 0) and t (out x batch, node 1), every
+ * hidden layer sigmoid(W a), the linear output layer and the loss
+ * ½ Σ (y - t)² (an output), with its reverse pass adding into giweights,
+ * gweights and goweights. The loss gradient, the sigmoid derivatives and
+ * their products with the back-propagated errors fuse into single passes.
+ * @param batch samples per run
+ * @param threads workers for run()
+ * @return the compiled graph; it refers to the model's weights and gradients
+ * @throws std::invalid_argument if batch is zero
+ * @throws std::runtime_error if the model is normalised
+ */
+graph mlp::compile(size_t batch, unsigned int threads) {
+    if (batch == 0)
+        throw std::invalid_argument("-_-BATCH SIZE MUST BE POSITIVE-_-");
+    if (normalize != normalization::none)
+        throw std::runtime_error("-_-GRAPH TRAINING DOES NOT SUPPORT NORMALISATION-_-");
+    graph g;
+    const unsigned int x = g.input(in, batch), t = g.input(out, batch);
+    unsigned int a = g.sigmoid(g.matmul(g.parameter(iweights, &giweights), x));
+    for (unsigned int l = 1; l + 1 < layers; l++)
+        a = g.sigmoid(g.matmul(g.parameter(weights[l - 1], &gweights[l - 1]), a));
+    const unsigned int e = g.sub(g.matmul(g.parameter(oweights, &goweights), a), t);
+    const unsigned int loss = g.scale(g.sum(g.mul(e, e)), 0.5);
+    g.output(loss);
+    g.gradient(loss);
+    g.compile(threads);
+    return g;
+}
+
+//----------------TRAINING----------------//
+
+/**
+ * @brief Mini-batch gradient descent with the step compiled once (see
+ * compile(size_t, unsigned int)); a shorter last batch gets its own graph.
+ * Same steps as train(x, t, batch) without normalisation.
+ * @param x samples (raw, normalised with the model's scaler)
+ * @param t targets of length out
+ * @param batch samples per step
+ * @param threads workers for each step
+ * @return mean squared error of the last epoch
+ * @throws std::invalid_argument if batch is zero
+ * @throws std::runtime_error if x and t differ in length, a sample has the wrong size or the model is normalised
+ */
+double mlp::fit(const std::vector<std::vector<double>>& x, const std::vector<std::vector<double>>& t,
+                unsigned int batch, unsigned int threads) {
+    if (x.size() != t.size())
+        throw std::runtime_error("-_-NUMBER OF SAMPLES AND TARGETS SHOULD MATCH-_-");
+    for (size_t i = 0; i < x.size(); i++) {
+        if (x[i].size() != in || t[i].size() != out)
+            throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    }
+    graph step = compile(batch, threads), tail;
+    const size_t B = batch;
+    std::vector<double> input(in * B), target(out * B), sample(in);
+
+    auto descend = [](std::vector<std::vector<double>>& w, std::vector<std::vector<double>>& g, double rate) {
+        for (size_t i = 0; i < w.size(); i++) {
+            for (size_t j = 0; j < w[i].size(); j++) {
+                w[i][j] -= rate * g[i][j];
+                g[i][j] = 0.0;
+            }
+        }
+    };
+    for (auto* m : {&giweights, &goweights}) {
+        for (auto& row : *m) std::fill(row.begin(), row.end(), 0.0);
+    }
+    for (auto& m : gweights) {
+        for (auto& row : m) std::fill(row.begin(), row.end(), 0.0);
+    }
+    for (unsigned int e = 0; e < epochs; e++) {
+        double total = 0.0;
+        for (size_t s = 0; s < x.size(); s += B) {
+            const size_t R = std::min(B, x.size() - s);
+            if (R < B && tail.outputs().empty()) tail = compile(R, threads);
+            graph& g = R < B ? tail : step;
+            // one sample per column
+            for (size_t r = 0; r < R; r++) {
+                std::copy(x[s + r].begin(), x[s + r].end(), sample.begin());
+                norm.transform(sample.data());
+                for (unsigned int i = 0; i < in; i++) input[i * R + r] = sample[i];
+                for (unsigned int i = 0; i < out; i++) target[i * R + r] = t[s + r][i];
+            }
+            g.bind(0, input.data());
+            g.bind(1, target.data());
+            g.run();
+            total += 2.0 * g.value(g.outputs()[0])[0] / out;
+
+            const double rate = learning / R;
+            descend(iweights, giweights, rate);
+            for (unsigned int l = 1; l + 1 < layers; l++) descend(weights[l - 1], gweights[l - 1], rate);
+            descend(oweights, goweights, rate);
+        }
+        mse = x.empty() ? 0.0 : total / x.size();
+        std::cout << "Epoch " << e + 1 << " Average MSE: " << mse << std::endl;
+    }
+    return mse;
+}
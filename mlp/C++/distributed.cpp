@@ -0,0 +1,81 @@
+// distributed.cpp: data-parallel training of mlp over a ring of processes
+#include "include/mlp.hpp"
+#include "include/ring.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief Synchronous data-parallel training; every process of the ring
+ * calls it with the same data. Each step takes batch samples per rank (rank
+ * r reads samples r * batch .. of the step's slice), accumulates their
+ * gradient in a worker and all-reduces it in buckets. The buckets of the
+ * last sample's backward pass are sent as soon as their layers are done,
+ * so the reduction of the upper layers overlaps with the backward pass of
+ * the lower ones. Every rank then takes the same step with the gradient
+ * averaged over all samples of the step, so the replicas stay identical;
+ * rank 0's weights and normalisation are copied to the others first.
+ * Runs epochs passes over the data.
+ * @param comm ring of processes (its compress flag selects fp16 gradients)
+ * @param x samples (raw, normalised with the model's scaler)
+ * @param t targets of length out
+ * @param batch samples per rank per step
+ * @param bucket gradient bucket size in bytes
+ * @return mean squared error of the last epoch over all ranks
+ * @throws std::invalid_argument if batch is zero
+ * @throws std::runtime_error if x and t differ in length or the ring fails
+ */
+double mlp::train(ring& comm, const std::vector<std::vector<double>>& x, const std::vector<std::vector<double>>& t,
+                  unsigned int batch, size_t bucket) {
+    if (x.size() != t.size())
+        throw std::runtime_error("-_-NUMBER OF SAMPLES AND TARGETS SHOULD MATCH-_-");
+    if (batch == 0)
+        throw std::invalid_argument("-_-BATCH SIZE MUST BE POSITIVE-_-");
+
+    // identical replicas
+    for (auto& row : iweights) comm.broadcast(row.data(), row.size());
+    for (auto& m : weights) {
+        for (auto& row : m) comm.broadcast(row.data(), row.size());
+    }
+    for (auto& row : oweights) comm.broadcast(row.data(), row.size());
+    if (norm.fitted) {
+        comm.broadcast(norm.shift.data(), norm.shift.size());
+        comm.broadcast(norm.scale.data(), norm.scale.size());
+    }
+
+    // gradient tensors in the order backward() finishes them: oweights,
+    // weights top down, iweights (weights[layers - 2] feeds nothing and is skipped)
+    const unsigned int hidden = layers - 1;
+    worker w(*this, comm.rank);         // every rank drops its own units
+    reducer sync(comm, bucket);
+    sync.add(w.goweights);
+    for (unsigned int k = hidden - 1; k >= 1; k--) sync.add(w.gweights[k - 1]);
+    sync.add(w.giweights);
+    const std::function<void(unsigned int)> ready = [&sync, hidden](unsigned int k) { sync.finished(hidden - k); };
+
+    const size_t n = x.size(), stride = (size_t)comm.size * batch;
+    const size_t steps = (n + stride - 1) / stride;
+    for (unsigned int e = 0; e < epochs; e++) {
+        double sums[2] = {0.0, 0.0};        // loss, samples
+        for (size_t s = 0; s < steps; s++) {
+            const size_t begin = std::min(n, s * stride + (size_t)comm.rank * batch);
+            const size_t end = std::min(n, begin + batch);
+            for (size_t i = begin; i < end; i++) {
+                loadInput(w, x[i]);
+                w.expected = t[i];
+                forward(w);
+                sums[0] += i + 1 == end ? backward(w, ready) : backward(w);
+            }
+            sync.wait();
+            sums[1] += end - begin;
+            // every rank knows how many samples the step had in total
+            w.samples = std::min(n, (s + 1) * stride) - s * stride;
+            update(w);
+        }
+        comm.allreduce(sums, 2, true);
+        mse = sums[1] > 0 ? sums[0] / sums[1] : 0.0;
+        if (comm.rank == 0)
+            std::cout << "Epoch " << e + 1 << " Average MSE: " << mse << std::endl;
+    }
+    return mse;
+}
@@ -1,36 +1,308 @@
 // forprop.cpp: forward propagation functions for mlp
 #include "include/mlp.hpp"
+#include "include/dense.hpp"
+#include "include/philox.hpp"
 #include <numeric>
+#include <stdexcept>
+#include <algorithm>
+
+//----------------KERNELS----------------//
+
+/**
+ * @brief activations of hidden layer l from its pre-activations (in place
+ * allowed): the layer's normalisation, if any, then the sigmoid
+ */
+static void activate(const mlp& net, unsigned int l, const double* h, double* a) {
+    const unsigned int n = net.neurons;
+    if (net.normalize != normalization::none)
+        normalized(net.normalize, h, a, n, net.gamma[l].data(), net.beta[l].data(), net.mean[l].data(), net.var[l].data());
+    else if (a != h)
+        std::copy(h, h + n, a);
+    for (unsigned int j = 0; j < n; j++) a[j] = sigmoid(a[j]);
+}
+
+/**
+ * @brief first hidden layer from a dense input
+ */
+static void firstLayer(const mlp& net, const double* x, double* h, double* a) {
+    for (unsigned int i = 0; i < net.neurons; i++) {
+        h[i] = std::inner_product(x, x + net.in, net.iweights[i].begin(), 0.0);
+    }
+    activate(net, 0, h, a); // Apply activation function
+}
+
+/**
+ * @brief first hidden layer from the nonzeros of a sparse input only
+ */
+static void firstLayer(const mlp& net, const sparsevec& x, double* h, double* a) {
+    for (unsigned int i = 0; i < net.neurons; i++) {
+        const double* w = net.iweights[i].data();
+        double sum = 0.0;
+        for (size_t k = 0; k < x.index.size(); k++) {
+            sum += x.value[k] * w[x.index[k]];
+        }
+        h[i] = sum;
+    }
+    activate(net, 0, h, a); // Apply activation function
+}
+
+/**
+ * @brief Inverted dropout of hidden layer l of a training worker: draw the
+ * layer's bitmask and scale the kept activations by 1 / (1 - dropout), so
+ * nothing changes at inference
+ */
+static void drop(const mlp& net, worker& w, unsigned int l) {
+    std::vector<uint64_t>& m = w.mask[l];
+    const double keep = 1.0 - net.dropout, inv = 1.0 / keep;
+    philox(w.seed).bernoulli(m.data(), m.size(), l, w.draws * m.size(), keep);
+    double* a = w.activations[l].data();
+    for (unsigned int j = 0; j < net.neurons; j++) a[j] = (m[j >> 6] >> (j & 63) & 1) ? a[j] * inv : 0.0;
+}
+
+/**
+ * @brief remaining hidden layers and the linear output layer; with a
+ * dropping worker, every hidden layer is masked before the next reads it
+ */
+static void laterLayers(const mlp& net, std::vector<std::vector<double>>& hlayers,
+                        std::vector<std::vector<double>>& activations, double* output, worker* w = nullptr) {
+    const unsigned int layers = net.layers, neurons = net.neurons;
+    if (w) drop(net, *w, 0);
+    // Calculate activations of the remaining hidden layers
+    for (unsigned int i = 1; i < layers - 1; i++) {
+        for (unsigned int j = 0; j < neurons; j++) {
+            hlayers[i][j] = std::inner_product(activations[i - 1].begin(), activations[i - 1].end(), net.weights[i - 1][j].begin(), 0.0);
+        }
+        activate(net, i, hlayers[i].data(), activations[i].data()); // Apply activation function
+        if (w) drop(net, *w, i);
+    }
+    // Calculate output layer activations
+    for (unsigned int i = 0; i < net.out; i++) {
+        output[i] = std::inner_product(activations[layers - 2].begin(), activations[layers - 2].end(), net.oweights[i].begin(), 0.0);
+    }
+}
+
+/**
+ * @brief check a sparse input against the model and copy it, scaled
+ */
+static void loadSparse(const mlp& net, const sparsevec& x, sparsevec& dst) {
+    if (x.index.size() != x.value.size())
+        throw std::runtime_error("sparse input index and value sizes must match");
+    for (unsigned int k : x.index) {
+        if (k >= net.in)
+            throw std::runtime_error("sparse input index out of range");
+    }
+    dst = x;
+    net.norm.transform(dst.index.data(), dst.value.data(), dst.value.size());
+}
+
+//----------------MODEL STATE----------------//
 
 /**
  * @brief The forward propagation function. This function performs the
  * forward propagation and calculates the activations of each layer.
  */
 void mlp::forward() {
-    // Ensure vectors are properly initialized
-    // assert(hlayers.size() == layers);
-    // assert(activations.size() == layers);
-
+    sinput.index.clear();
+    sinput.value.clear();
     // Calculate activation of the first hidden layer
-    for (int i = 0; i < neurons; i++) {
-        double sum = std::inner_product(input.begin(), input.end(), iweights[i].begin(), 0.0);
-        hlayers[0][i] = sum;
-        activations[0][i] = sigmoid(sum); // Apply activation function
+    firstLayer(*this, input.data(), hlayers[0].data(), activations[0].data());
+    propagate();
+}
+
+/**
+ * @brief The forward propagation function for a sparse input. Only the
+ * columns of iweights that belong to nonzero features are read, so the
+ * cost of the first layer is neurons * nnz instead of neurons * in.
+ * The nonzeros are scaled by the fitted normalisation as they are copied.
+ * @param x sparse input vector
+ * @throws std::runtime_error if a feature index is out of range
+ */
+void mlp::forward(const sparsevec& x) {
+    loadSparse(*this, x, sinput);
+    // Calculate activation of the first hidden layer from the nonzeros only
+    firstLayer(*this, sinput, hlayers[0].data(), activations[0].data());
+    propagate();
+}
+
+/**
+ * @brief Forward propagation from the first hidden layer onward. Expects
+ * hlayers[0] and activations[0] to be filled by forward().
+ */
+void mlp::propagate() {
+    laterLayers(*this, hlayers, activations, output.data());
+}
+
+//----------------WORKER STATE----------------//
+
+/**
+ * @brief Shape a worker like the model and clear its gradients
+ * @param net model the worker will train or evaluate
+ */
+worker::worker(const mlp& net, uint64_t seed) : seed(seed), draws(0), training(true), samples(0) {
+    input.assign(net.in, 0.0);
+    expected.assign(net.out, 0.0);
+    output.assign(net.out, 0.0);
+    hlayers.assign(net.layers, std::vector<double>(net.neurons, 0.0));
+    activations.assign(net.layers, std::vector<double>(net.neurons, 0.0));
+    giweights.assign(net.neurons, std::vector<double>(net.in, 0.0));
+    goweights.assign(net.out, std::vector<double>(net.neurons, 0.0));
+    gweights.assign(net.layers - 1, std::vector<std::vector<double>>(net.neurons, std::vector<double>(net.neurons, 0.0)));
+    delta.assign(net.neurons, 0.0);
+    next.assign(net.neurons, 0.0);
+}
+
+/**
+ * @brief the worker to mask with, if this forward pass drops units
+ */
+static worker* dropping(const mlp& net, worker& w) {
+    if (!w.training || net.dropout <= 0.0) {
+        w.mask.clear();
+        return nullptr;
     }
+    if (net.dropout >= 1.0)
+        throw std::invalid_argument("-_-DROPOUT MUST BE BELOW 1-_-");
+    if (w.mask.size() != net.layers - 1)
+        w.mask.assign(net.layers - 1, std::vector<uint64_t>((net.neurons + 63) / 64, 0));
+    w.draws++;
+    return &w;
+}
 
-    // Calculate activations of the remaining hidden layers
-    for (int i = 1; i < layers - 1; i++) {
-        for (int j = 0; j < neurons; j++) {
-            double sum = std::inner_product(activations[i - 1].begin(), activations[i - 1].end(), weights[i - 1][j].begin(), 0.0);
-            hlayers[i][j] = sum;
-            activations[i][j] = sigmoid(sum); // Apply activation function
+/**
+ * @brief clear the accumulated gradients
+ */
+void worker::zero() {
+    for (auto& row : giweights) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& row : goweights) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& m : gweights) {
+        for (auto& row : m) std::fill(row.begin(), row.end(), 0.0);
+    }
+    samples = 0;
+}
+
+/**
+ * @brief Copy a sample into a worker's input and normalise it
+ * @param w worker
+ * @param x sample of length in
+ * @throws std::runtime_error if the sample has the wrong size
+ */
+void mlp::loadInput(worker& w, const std::vector<double>& x) const {
+    if (x.size() != in)
+        throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    w.input.assign(x.begin(), x.end());
+    norm.transform(w.input.data());
+}
+
+/**
+ * @brief Forward propagation of the worker's (loaded) input. Only the
+ * weights are read; everything written belongs to the worker. A training
+ * worker drops hidden units with probability dropout.
+ * @param w worker
+ * @throws std::invalid_argument if dropout >= 1
+ */
+void mlp::forward(worker& w) const {
+    w.sinput.index.clear();
+    w.sinput.value.clear();
+    firstLayer(*this, w.input.data(), w.hlayers[0].data(), w.activations[0].data());
+    laterLayers(*this, w.hlayers, w.activations, w.output.data(), dropping(*this, w));
+}
+
+/**
+ * @brief Forward propagation of a sparse input into a worker
+ * @param w worker
+ * @param x sparse input vector (raw, scaled while copied)
+ * @throws std::runtime_error if a feature index is out of range
+ * @throws std::invalid_argument if dropout >= 1
+ */
+void mlp::forward(worker& w, const sparsevec& x) const {
+    loadSparse(*this, x, w.sinput);
+    firstLayer(*this, w.sinput, w.hlayers[0].data(), w.activations[0].data());
+    laterLayers(*this, w.hlayers, w.activations, w.output.data(), dropping(*this, w));
+}
+
+//----------------INFERENCE----------------//
+
+/**
+ * @brief Size the ping-pong buffers for a model (widest of in, neurons, out)
+ * @param net model the workspace will be used with
+ */
+workspace::workspace(const mlp& net) {
+    size_t width = std::max({net.in, net.neurons, net.out});
+    a.assign(width, 0.0);
+    b.assign(width, 0.0);
+}
+
+/**
+ * @brief Reentrant single-sample inference. Same computation as forward()
+ * on a raw sample (normalisation, sigmoid hidden layers, linear output), but
+ * it only reads the weights: activations live in the caller's workspace and
+ * nothing of the model is written, so one model can serve many threads
+ * without locking. No allocation happens once the workspace is sized.
+ * @param x raw input of length in
+ * @param y output of length out
+ * @param ws scratch for this thread (grown if too small)
+ * @throws std::runtime_error if x or y has the wrong length
+ */
+void mlp::infer(std::span<const double> x, std::span<double> y, workspace& ws) const {
+    if (x.size() != in || y.size() != out)
+        throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    size_t width = std::max({in, neurons, out});
+    if (ws.a.size() < width) ws.a.resize(width);
+    if (ws.b.size() < width) ws.b.resize(width);
+    double* a = ws.a.data();
+    double* b = ws.b.data();
+    std::copy(x.begin(), x.end(), a);
+    norm.transform(a);
+
+    // first hidden layer
+    for (unsigned int i = 0; i < neurons; i++) {
+        b[i] = dot(iweights[i].data(), a, in);
+    }
+    activate(*this, 0, b, b);
+    std::swap(a, b);
+    // remaining hidden layers
+    for (unsigned int l = 1; l + 1 < layers; l++) {
+        for (unsigned int j = 0; j < neurons; j++) {
+            b[j] = dot(weights[l - 1][j].data(), a, neurons);
         }
+        activate(*this, l, b, b);
+        std::swap(a, b);
+    }
+    // linear output layer
+    for (unsigned int i = 0; i < out; i++) {
+        y[i] = dot(oweights[i].data(), a, neurons);
     }
+}
 
-    // Calculate output layer activations
-    for (int i = 0; i < out; i++) {
-        double sum = std::inner_product(activations[layers - 2].begin(), activations[layers - 2].end(), oweights[i].begin(), 0.0);
-        output[i] = sum;
-        // output[i] = sigmoid(sum); // Apply activation function to output layer
+/**
+ * @brief Reentrant batched inference: rows samples go through every layer
+ * as one matrix-matrix product instead of rows matrix-vector products, so
+ * the weights are streamed once per batch rather than once per sample.
+ * @param x raw inputs, rows x in, row-major
+ * @param y outputs, rows x out, row-major
+ * @param rows number of samples
+ * @param ws scratch for this thread (grown to rows x widest layer)
+ * @throws std::runtime_error if x or y has the wrong length
+ */
+void mlp::infer(std::span<const double> x, std::span<double> y, size_t rows, workspace& ws) const {
+    if (x.size() != rows * in || y.size() != rows * out)
+        throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    size_t width = std::max({in, neurons, out});
+    if (ws.a.size() < rows * width) ws.a.resize(rows * width);
+    if (ws.b.size() < rows * width) ws.b.resize(rows * width);
+    double* a = ws.a.data();
+    double* b = ws.b.data();
+    std::copy(x.begin(), x.end(), a);
+    for (size_t r = 0; r < rows; r++) norm.transform(a + r * in);
+
+    // normalised layers take the sigmoid after their normalisation
+    const bool plain = normalize == normalization::none;
+    layerBatch(rowsOf(iweights), neurons, a, in, rows, in, b, neurons, plain);
+    if (!plain) for (size_t r = 0; r < rows; r++) activate(*this, 0, b + r * neurons, b + r * neurons);
+    std::swap(a, b);
+    for (unsigned int l = 1; l + 1 < layers; l++) {
+        layerBatch(rowsOf(weights[l - 1]), neurons, a, neurons, rows, neurons, b, neurons, plain);
+        if (!plain) for (size_t r = 0; r < rows; r++) activate(*this, l, b + r * neurons, b + r * neurons);
+        std::swap(a, b);
     }
+    layerBatch(rowsOf(oweights), out, a, neurons, rows, neurons, y.data(), out, false);
 }
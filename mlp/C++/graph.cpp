@@ -0,0 +1,791 @@
+// graph.cpp: building, differentiating, compiling and running static computation graphs
+#include "include/graph.hpp"
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <stdexcept>
+
+constexpr unsigned int NONE = ~0u;          // no node
+constexpr size_t TILE = 256;                // elements per fused-loop tile
+constexpr size_t MAXREADS = 4;              // operands from memory per fused kernel
+constexpr size_t MAXNODES = 32;             // nodes per fused kernel
+constexpr size_t SPLIT = 1 << 15;           // least work (multiply-adds or elements) per piece
+
+//----------------NODES----------------//
+
+enum class graph::op : uint8_t {
+    input, parameter,
+    // elementwise
+    constant, add, sub, mul, scale, sigmoid, tanh, relu, selu, expand,
+    dsigmoid, dtanh, drelu, dselu,
+    // the rest
+    matmul, sum, rowsum
+};
+
+/**
+ * @brief graph node; after compile() a node either roots a kernel (and owns
+ * a buffer), is fused into one, or is an input or parameter
+ */
+struct graph::node {
+    op kind;
+    unsigned int a, b;                                  // operands
+    size_t rows, cols;
+    double s;                                           // constant, scale
+    bool ta, tb;                                        // matmul transposes
+    bool keep;                                          // output
+    const std::vector<std::vector<double>>* w;          // matrix parameter
+    std::vector<std::vector<double>>* gw;
+    const std::vector<double>* v;                       // column parameter
+    std::vector<double>* gv;
+    const double* bound;                                // input
+    unsigned int grad;                                  // gradient of a parameter
+    size_t offset;                                      // buffer in memory, or SIZE_MAX
+};
+
+/**
+ * @brief one pass over memory: a matmul, a reduction or a fused elementwise
+ * program. Registers of a program are its reads, then its members.
+ */
+struct graph::kernel {
+    op kind;                                            // of the root; elementwise kernels are programs
+    unsigned int out;                                   // root node
+    std::vector<unsigned int> reads;                    // nodes read from memory
+    std::vector<unsigned int> members;                  // fused nodes, root last
+    struct step {
+        op kind;
+        double s;
+        unsigned int a, b;                              // registers
+    };
+    std::vector<step> program;                          // one per member
+    unsigned int level;
+    size_t work;                                        // rows (matmul, rowsum) or elements
+};
+
+/**
+ * @brief a kernel over rows or elements [begin, end)
+ */
+struct graph::task {
+    unsigned int kernel;
+    size_t begin, end;
+};
+
+/**
+ * @brief whether a graph::op kind (as int) is computed by fused programs
+ */
+static bool elementwiseop(int kind) {
+    return kind >= 2 && kind <= 15;     // constant .. dselu of graph::op
+}
+
+//----------------POOL----------------//
+
+/**
+ * @brief Persistent workers for the levels of a run: run() hands out the
+ * pieces of one level through an atomic counter, works on them itself and
+ * returns when every piece is done, so a level costs one wake-up, not a
+ * thread start per kernel.
+ */
+struct graph::pool {
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake, done;
+    graph* owner = nullptr;
+    const std::vector<task>* tasks = nullptr;
+    std::atomic<size_t> next{0};
+    size_t busy = 0;
+    uint64_t generation = 0;
+    bool stop = false;
+
+    explicit pool(unsigned int n) {
+        for (unsigned int i = 1; i < n; i++) threads.emplace_back([this, i] { loop(i); });
+    }
+
+    ~pool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    void drain(unsigned int id) {
+        for (size_t k; (k = next.fetch_add(1)) < tasks->size();) {
+            const task& t = (*tasks)[k];
+            owner->execute(owner->kernels[t.kernel], t.begin, t.end, id);
+        }
+    }
+
+    void loop(unsigned int id) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+            drain(id);
+            std::lock_guard<std::mutex> guard(lock);
+            if (--busy == 0) done.notify_one();
+        }
+    }
+
+    void run(graph& g, const std::vector<task>& level) {
+        if (threads.empty() || level.size() == 1) {
+            owner = &g;
+            tasks = &level;
+            next = 0;
+            drain(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            owner = &g;
+            tasks = &level;
+            next = 0;
+            busy = threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        drain(0);
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&] { return busy == 0; });
+    }
+};
+
+graph::graph() = default;
+graph::graph(graph&&) noexcept = default;
+graph& graph::operator=(graph&&) noexcept = default;
+graph::~graph() = default;
+
+//----------------BUILDING----------------//
+
+/**
+ * @brief append a node
+ * @throws std::runtime_error once the graph is compiled
+ */
+unsigned int graph::push(op kind, size_t rows, size_t cols, unsigned int a, unsigned int b, double s) {
+    if (compiled)
+        throw std::runtime_error("-_-GRAPH IS ALREADY COMPILED-_-");
+    nodes.push_back(node{kind, a, b, rows, cols, s, false, false, false, nullptr, nullptr, nullptr, nullptr,
+                         nullptr, NONE, SIZE_MAX});
+    return (unsigned int)(nodes.size() - 1);
+}
+
+/**
+ * @brief elementwise node; its shape is the larger of its operands', each
+ * of which must be that shape, a column of it or a scalar
+ * @throws std::invalid_argument for other shapes
+ */
+unsigned int graph::elementwise(op kind, unsigned int a, unsigned int b) {
+    const size_t r = std::max(nodes[a].rows, nodes[b].rows), c = std::max(nodes[a].cols, nodes[b].cols);
+    for (unsigned int x : {a, b}) {
+        const node& n = nodes[x];
+        if (!((n.rows == r && n.cols == c) || (n.rows == r && n.cols == 1) || (n.rows == 1 && n.cols == 1)))
+            throw std::invalid_argument("-_-GRAPH OPERANDS HAVE DIFFERENT SHAPES-_-");
+    }
+    return push(kind, r, c, a, b);
+}
+
+/**
+ * @brief input of rows x cols, read from the pointer given to bind()
+ */
+unsigned int graph::input(size_t rows, size_t cols) {
+    return push(op::input, rows, cols);
+}
+
+/**
+ * @brief 1 x 1 constant
+ */
+unsigned int graph::constant(double value) {
+    return push(op::constant, 1, 1, 0, 0, value);
+}
+
+/**
+ * @brief Weight matrix, packed into the graph's memory at every run; with
+ * g, gradient() makes run() add its gradient into g
+ * @param w weights, one row per vector
+ * @param g gradient accumulator shaped like w, or null
+ */
+unsigned int graph::parameter(const std::vector<std::vector<double>>& w, std::vector<std::vector<double>>* g) {
+    unsigned int id = push(op::parameter, w.size(), w.empty() ? 0 : w[0].size());
+    nodes[id].w = &w;
+    nodes[id].gw = g;
+    return id;
+}
+
+/**
+ * @brief Column parameter (a bias); see the matrix overload
+ */
+unsigned int graph::parameter(const std::vector<double>& b, std::vector<double>* g) {
+    unsigned int id = push(op::parameter, b.size(), 1);
+    nodes[id].v = &b;
+    nodes[id].gv = g;
+    return id;
+}
+
+/**
+ * @brief elementwise a + b
+ */
+unsigned int graph::add(unsigned int a, unsigned int b) {
+    return elementwise(op::add, a, b);
+}
+
+/**
+ * @brief elementwise a - b
+ */
+unsigned int graph::sub(unsigned int a, unsigned int b) {
+    return elementwise(op::sub, a, b);
+}
+
+/**
+ * @brief elementwise (Hadamard) product a * b
+ */
+unsigned int graph::mul(unsigned int a, unsigned int b) {
+    return elementwise(op::mul, a, b);
+}
+
+/**
+ * @brief s times every element of a
+ */
+unsigned int graph::scale(unsigned int a, double s) {
+    return push(op::scale, nodes[a].rows, nodes[a].cols, a, a, s);
+}
+
+/**
+ * @brief elementwise sigmoid of a
+ */
+unsigned int graph::sigmoid(unsigned int a) {
+    return push(op::sigmoid, nodes[a].rows, nodes[a].cols, a, a);
+}
+
+/**
+ * @brief elementwise tanh of a
+ */
+unsigned int graph::tanh(unsigned int a) {
+    return push(op::tanh, nodes[a].rows, nodes[a].cols, a, a);
+}
+
+/**
+ * @brief elementwise ReLU of a
+ */
+unsigned int graph::relu(unsigned int a) {
+    return push(op::relu, nodes[a].rows, nodes[a].cols, a, a);
+}
+
+/**
+ * @brief elementwise SeLU of a (activations.hpp)
+ */
+unsigned int graph::selu(unsigned int a) {
+    return push(op::selu, nodes[a].rows, nodes[a].cols, a, a);
+}
+
+/**
+ * @brief sum of every element of a (1 x 1)
+ */
+unsigned int graph::sum(unsigned int a) {
+    return push(op::sum, 1, 1, a, a);
+}
+
+/**
+ * @brief sum of every row of a (rows x 1)
+ */
+unsigned int graph::rowsum(unsigned int a) {
+    return push(op::rowsum, nodes[a].rows, 1, a, a);
+}
+
+/**
+ * @brief op(a) op(b), where op transposes when the flag is set
+ * @throws std::invalid_argument if the inner dimensions differ
+ */
+unsigned int graph::matmul(unsigned int a, unsigned int b, bool ta, bool tb) {
+    const node &x = nodes[a], &y = nodes[b];
+    const size_t m = ta ? x.cols : x.rows, k = ta ? x.rows : x.cols;
+    const size_t kb = tb ? y.cols : y.rows, n = tb ? y.rows : y.cols;
+    if (k != kb)
+        throw std::invalid_argument("-_-GRAPH OPERANDS HAVE DIFFERENT SHAPES-_-");
+    unsigned int id = push(op::matmul, m, n, a, b);
+    nodes[id].ta = ta;
+    nodes[id].tb = tb;
+    return id;
+}
+
+/**
+ * @brief keep the value of a after run(); compile() only keeps what outputs need
+ */
+void graph::output(unsigned int a) {
+    if (!nodes[a].keep) kept.push_back(a);
+    nodes[a].keep = true;
+}
+
+//----------------GRADIENT----------------//
+
+/**
+ * @brief g summed down to rows x cols (the shape of a broadcast operand)
+ */
+unsigned int graph::reduce(unsigned int g, size_t rows, size_t cols) {
+    const node& n = nodes[g];
+    if (n.rows == rows && n.cols == cols) return g;
+    if (rows == 1 && cols == 1) return sum(g);
+    if (cols == 1 && n.rows == rows) return rowsum(g);
+    throw std::invalid_argument("-_-GRAPH OPERANDS HAVE DIFFERENT SHAPES-_-");
+}
+
+/**
+ * @brief Append the reverse pass of a scalar: gradient nodes for every node
+ * between the parameters that have a gradient accumulator and loss, built
+ * from the same operations (so they fuse and plan like the forward pass);
+ * contributions of a node used several times are added. Each parameter's
+ * gradient becomes an output that run() adds into its accumulator.
+ * @param loss 1 x 1 node
+ * @throws std::invalid_argument if loss is not 1 x 1
+ * @throws std::runtime_error if the path to loss goes through a derivative node
+ */
+void graph::gradient(unsigned int loss) {
+    if (nodes[loss].rows != 1 || nodes[loss].cols != 1)
+        throw std::invalid_argument("-_-GRAPH GRADIENT NEEDS A SCALAR-_-");
+    const size_t count = loss + 1;
+    std::vector<char> needs(count, 0);
+    for (size_t i = 0; i < count; i++) {
+        const node& n = nodes[i];
+        if (n.kind == op::parameter) needs[i] = n.gw || n.gv;
+        else if (n.kind != op::input && n.kind != op::constant) needs[i] = needs[n.a] || needs[n.b];
+    }
+    std::vector<unsigned int> g(count, NONE);
+    auto acc = [&](unsigned int x, unsigned int c) { g[x] = g[x] == NONE ? c : add(g[x], c); };
+    g[loss] = constant(1.0);
+
+    for (unsigned int i = count; i-- > 0;) {
+        if (g[i] == NONE || !needs[i]) continue;
+        const node n = nodes[i];        // copied: push() may reallocate
+        const unsigned int d = g[i];
+        const node &x = nodes[n.a], &y = nodes[n.b];
+        const size_t xr = x.rows, xc = x.cols, yr = y.rows, yc = y.cols;
+        switch (n.kind) {
+            case op::input:
+            case op::constant:
+                break;
+            case op::parameter:
+                nodes[i].grad = d;
+                output(d);
+                break;
+            case op::add:
+                if (needs[n.a]) acc(n.a, reduce(d, xr, xc));
+                if (needs[n.b]) acc(n.b, reduce(d, yr, yc));
+                break;
+            case op::sub:
+                if (needs[n.a]) acc(n.a, reduce(d, xr, xc));
+                if (needs[n.b]) acc(n.b, reduce(scale(d, -1.0), yr, yc));
+                break;
+            case op::mul:
+                if (needs[n.a]) acc(n.a, reduce(mul(d, n.b), xr, xc));
+                if (needs[n.b]) acc(n.b, reduce(mul(d, n.a), yr, yc));
+                break;
+            case op::scale:
+                acc(n.a, scale(d, n.s));
+                break;
+            case op::sigmoid:
+                acc(n.a, push(op::dsigmoid, n.rows, n.cols, d, i));
+                break;
+            case op::tanh:
+                acc(n.a, push(op::dtanh, n.rows, n.cols, d, i));
+                break;
+            case op::relu:
+                acc(n.a, push(op::drelu, n.rows, n.cols, d, n.a));
+                break;
+            case op::selu:
+                acc(n.a, push(op::dselu, n.rows, n.cols, d, n.a));
+                break;
+            case op::expand:
+                acc(n.a, reduce(d, xr, xc));
+                break;
+            case op::sum:
+            case op::rowsum:
+                acc(n.a, push(op::expand, xr, xc, d, d));
+                break;
+            case op::matmul:
+                // C = op(A) op(B): d op(A) = dC op(B)^T, d op(B) = op(A)^T dC
+                if (needs[n.a]) acc(n.a, n.ta ? matmul(n.b, d, n.tb, true) : matmul(d, n.b, false, !n.tb));
+                if (needs[n.b]) acc(n.b, n.tb ? matmul(d, n.a, true, n.ta) : matmul(n.a, d, !n.ta, false));
+                break;
+            default:
+                throw std::runtime_error("-_-GRAPH CANNOT DIFFERENTIATE A DERIVATIVE-_-");
+        }
+    }
+}
+
+//----------------COMPILING----------------//
+
+/**
+ * @brief Turn the nodes into kernels, levels and a memory plan (see the
+ * class). Only nodes that outputs depend on are kept.
+ * @param threads workers for run(), including the caller
+ * @throws std::runtime_error if the graph has no outputs or is already compiled
+ */
+void graph::compile(unsigned int threads) {
+    if (compiled || kept.empty())
+        throw std::runtime_error("-_-GRAPH NEEDS OUTPUTS AND ONE COMPILE-_-");
+    const size_t count = nodes.size();
+    auto leaf = [&](unsigned int i) { return nodes[i].kind == op::input || nodes[i].kind == op::parameter; };
+    auto operands = [&](unsigned int i, auto f) {
+        const node& n = nodes[i];
+        if (leaf(i) || n.kind == op::constant) return;
+        f(n.a);
+        if (n.b != n.a) f(n.b);
+    };
+
+    // live nodes and their distinct live consumers
+    std::vector<char> live(count, 0);
+    for (unsigned int k : kept) live[k] = 1;
+    for (unsigned int i = count; i-- > 0;) {
+        if (live[i]) operands(i, [&](unsigned int x) { live[x] = 1; });
+    }
+    std::vector<unsigned int> consumer(count, NONE), consumers(count, 0);
+    for (unsigned int i = 0; i < count; i++) {
+        if (!live[i]) continue;
+        operands(i, [&](unsigned int x) { consumers[x]++; consumer[x] = i; });
+    }
+
+    // fusion, consumers first: a node joins its only consumer's group if
+    // both are elementwise of one shape and the group stays within MAXREADS
+    std::vector<unsigned int> group(count, NONE);
+    std::vector<size_t> reads(count, 0), size(count, 0);
+    for (unsigned int i = count; i-- > 0;) {
+        if (!live[i] || leaf(i)) continue;
+        const node& n = nodes[i];
+        size_t own = 0;
+        operands(i, [&](unsigned int) { own++; });
+        const unsigned int c = consumer[i];
+        if (elementwiseop((int)n.kind) && !n.keep && consumers[i] == 1 && elementwiseop((int)nodes[c].kind)
+            && nodes[c].rows == n.rows && nodes[c].cols == n.cols && reads[group[c]] - 1 + own <= MAXREADS
+            && size[group[c]] < MAXNODES) {
+            group[i] = group[c];
+            reads[group[c]] += own - 1;
+            size[group[c]]++;
+        }
+        else {
+            group[i] = i;
+            reads[i] = own;
+            size[i] = 1;
+        }
+    }
+
+    // kernels in topological order of their roots (a root follows its members)
+    std::vector<std::vector<unsigned int>> members(count);
+    for (unsigned int i = 0; i < count; i++) {
+        if (live[i] && !leaf(i)) members[group[i]].push_back(i);
+    }
+    std::vector<unsigned int> producer(count, NONE);        // kernel whose output a node is
+    kernels.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        if (!live[i] || leaf(i) || group[i] != i) continue;
+        kernel k;
+        k.kind = nodes[i].kind;
+        k.out = i;
+        k.members = std::move(members[i]);
+        auto find = [](const std::vector<unsigned int>& v, unsigned int x) {
+            return (unsigned int)(std::find(v.begin(), v.end(), x) - v.begin());
+        };
+        for (unsigned int m : k.members) {
+            operands(m, [&](unsigned int x) {
+                if ((leaf(x) || group[x] != i) && find(k.reads, x) == k.reads.size()) k.reads.push_back(x);
+            });
+        }
+        if (elementwiseop((int)k.kind)) {
+            const unsigned int base = (unsigned int)k.reads.size();
+            auto reg = [&](unsigned int x) {
+                const unsigned int r = find(k.reads, x);
+                return r < base ? r : base + find(k.members, x);
+            };
+            for (unsigned int m : k.members) {
+                const node& n = nodes[m];
+                const bool none = n.kind == op::constant;
+                k.program.push_back({n.kind, n.s, none ? 0 : reg(n.a), none ? 0 : reg(n.b)});
+            }
+        }
+        const node& o = nodes[i];
+        k.work = k.kind == op::matmul || k.kind == op::rowsum ? o.rows : k.kind == op::sum ? 1 : o.rows * o.cols;
+        k.level = 1;
+        for (unsigned int x : k.reads) {
+            if (producer[x] != NONE) k.level = std::max(k.level, kernels[producer[x]].level + 1);
+        }
+        producer[i] = (unsigned int)kernels.size();
+        kernels.push_back(std::move(k));
+    }
+
+    // lifetimes in levels: parameters from the start, outputs to the end
+    const unsigned int end = kernels.empty() ? 1 : 1 + std::max_element(kernels.begin(), kernels.end(),
+        [](const kernel& a, const kernel& b) { return a.level < b.level; })->level;
+    struct span { unsigned int node; size_t size; unsigned int first, last; };
+    std::vector<span> spans;
+    std::vector<unsigned int> at(count, NONE);
+    stats = statistics();
+    for (unsigned int i = 0; i < count; i++) {
+        if (!live[i] || nodes[i].kind == op::input) continue;
+        stats.naive += nodes[i].rows * nodes[i].cols;
+        if (nodes[i].kind != op::parameter && producer[i] == NONE) continue;
+        at[i] = (unsigned int)spans.size();
+        const size_t size = (nodes[i].rows * nodes[i].cols + 7) & ~(size_t)7;      // 64-byte granules
+        const unsigned int first = producer[i] == NONE ? 0 : kernels[producer[i]].level;
+        spans.push_back({i, size, first, nodes[i].keep ? end : first});
+    }
+    for (const kernel& k : kernels) {
+        for (unsigned int x : k.reads) {
+            if (at[x] != NONE) spans[at[x]].last = std::max(spans[at[x]].last, k.level);
+        }
+    }
+
+    // first fit, largest first, among the buffers live at the same time
+    std::vector<unsigned int> order(spans.size());
+    for (unsigned int i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return spans[a].size > spans[b].size; });
+    std::vector<unsigned int> placed;
+    std::vector<std::pair<size_t, size_t>> busy;
+    size_t top = 0;
+    for (unsigned int s : order) {
+        const span& p = spans[s];
+        busy.clear();
+        for (unsigned int q : placed) {
+            const span& o = spans[q];
+            if (o.first <= p.last && p.first <= o.last)
+                busy.emplace_back(nodes[o.node].offset, nodes[o.node].offset + o.size);
+        }
+        std::sort(busy.begin(), busy.end());
+        size_t offset = 0;
+        for (const auto& b : busy) {
+            if (offset + p.size <= b.first) break;
+            offset = std::max(offset, b.second);
+        }
+        nodes[p.node].offset = offset;
+        top = std::max(top, offset + p.size);
+        placed.push_back(s);
+    }
+    memory.assign(top, 0.0);
+
+    // levels, the larger kernels split into pieces for the threads
+    threads = std::max(1u, threads);
+    schedule.assign(end - 1, {});
+    for (unsigned int k = 0; k < kernels.size(); k++) schedule[kernels[k].level - 1].push_back({k, 0, 0});
+    for (auto& level : schedule) {
+        std::vector<task> pieces;
+        const size_t share = std::max<size_t>(1, threads / level.size());
+        for (const task& t : level) {
+            const kernel& k = kernels[t.kernel];
+            const node& o = nodes[k.out];
+            size_t cost = k.work;
+            if (k.kind == op::matmul) {
+                const node& a = nodes[o.a];
+                cost = o.rows * o.cols * (o.ta ? a.rows : a.cols);
+            }
+            else if (k.kind == op::rowsum) cost = o.rows * nodes[o.a].cols;
+            size_t parts = k.kind == op::sum ? 1 : std::min({share, k.work, std::max<size_t>(1, cost / SPLIT)});
+            if (elementwiseop((int)k.kind)) parts = std::min(parts, (k.work + TILE - 1) / TILE);
+            parts = std::max<size_t>(1, parts);
+            size_t step = (k.work + parts - 1) / parts;
+            if (elementwiseop((int)k.kind)) step = (step + TILE - 1) / TILE * TILE;
+            for (size_t b = 0; b < k.work; b += step) pieces.push_back({t.kernel, b, std::min(k.work, b + step)});
+        }
+        level = std::move(pieces);
+    }
+
+    size_t regs = 0;
+    for (const kernel& k : kernels) regs = std::max(regs, k.reads.size() + k.members.size());
+    scratch.assign(threads, std::vector<double>(regs * TILE));
+    workers = std::make_unique<pool>(threads);
+    stats.nodes = count;
+    stats.kernels = kernels.size();
+    stats.levels = schedule.size();
+    stats.planned = top;
+    compiled = true;
+}
+
+//----------------RUNNING----------------//
+
+/**
+ * @brief Read an input from x (rows x cols, row-major) in every run() until
+ * bound again
+ * @throws std::invalid_argument if the node is not an input
+ */
+void graph::bind(unsigned int input, const double* x) {
+    if (input >= nodes.size() || nodes[input].kind != op::input)
+        throw std::invalid_argument("-_-GRAPH NODE IS NOT AN INPUT-_-");
+    nodes[input].bound = x;
+}
+
+/**
+ * @brief where the value of a lives during run(), or null if it is fused away
+ */
+double* graph::address(unsigned int a) const {
+    const node& n = nodes[a];
+    if (n.kind == op::input) return const_cast<double*>(n.bound);
+    return n.offset == SIZE_MAX ? nullptr : const_cast<double*>(memory.data()) + n.offset;
+}
+
+/**
+ * @brief a value after run(): an input, an output or a kernel's result
+ * (null for nodes fused away)
+ */
+const double* graph::value(unsigned int a) const {
+    return address(a);
+}
+
+/**
+ * @brief number of rows of a
+ */
+size_t graph::rows(unsigned int a) const {
+    return nodes[a].rows;
+}
+
+/**
+ * @brief number of columns of a
+ */
+size_t graph::cols(unsigned int a) const {
+    return nodes[a].cols;
+}
+
+/**
+ * @brief Run a piece of a kernel: rows [begin, end) of a matmul or rowsum,
+ * elements [begin, end) of a fused program (tile by tile; every step of
+ * the program is a tight loop over the tile), or a whole sum
+ */
+void graph::execute(const kernel& k, size_t begin, size_t end, unsigned int thread) {
+    const node& o = nodes[k.out];
+    double* out = address(k.out);
+    switch (k.kind) {
+        case op::matmul: {
+            const node &x = nodes[o.a], &y = nodes[o.b];
+            const double* A = address(o.a);
+            const double* B = address(o.b);
+            const size_t n = o.cols, kk = o.ta ? x.rows : x.cols, ac = x.cols, bc = y.cols;
+            for (size_t i = begin; i < end; i++) {
+                double* c = out + i * n;
+                if (!o.tb) {
+                    // C[i, :] += op(A)[i, p] B[p, :], B streamed by rows
+                    std::fill(c, c + n, 0.0);
+                    for (size_t p = 0; p < kk; p++) {
+                        const double s = o.ta ? A[p * ac + i] : A[i * ac + p];
+                        if (s == 0.0) continue;
+                        const double* b = B + p * bc;
+                        for (size_t j = 0; j < n; j++) c[j] += s * b[j];
+                    }
+                }
+                else {
+                    // C[i, j] = op(A)[i, :] . B[j, :]
+                    for (size_t j = 0; j < n; j++) {
+                        const double* b = B + j * bc;
+                        double d = 0.0;
+                        if (!o.ta) {
+                            const double* a = A + i * ac;
+                            for (size_t p = 0; p < kk; p++) d += a[p] * b[p];
+                        }
+                        else {
+                            for (size_t p = 0; p < kk; p++) d += A[p * ac + i] * b[p];
+                        }
+                        c[j] = d;
+                    }
+                }
+            }
+            return;
+        }
+        case op::sum: {
+            const double* a = address(o.a);
+            double s = 0.0;
+            for (size_t i = 0, n = nodes[o.a].rows * nodes[o.a].cols; i < n; i++) s += a[i];
+            out[0] = s;
+            return;
+        }
+        case op::rowsum: {
+            const double* a = address(o.a);
+            const size_t n = nodes[o.a].cols;
+            for (size_t i = begin; i < end; i++) {
+                double s = 0.0;
+                for (size_t j = 0; j < n; j++) s += a[i * n + j];
+                out[i] = s;
+            }
+            return;
+        }
+        default:
+            break;
+    }
+
+    // fused elementwise program
+    const size_t total = o.rows * o.cols, cols = o.cols, base = k.reads.size();
+    double* tiles = scratch[thread].data();
+    double* reg[MAXREADS + MAXNODES];
+    const double* in[MAXREADS];
+    for (size_t r = 0; r < base; r++) in[r] = address(k.reads[r]);
+    for (size_t t0 = begin; t0 < end; t0 += TILE) {
+        const size_t m = std::min(TILE, end - t0);
+        for (size_t r = 0; r < base; r++) {
+            const node& x = nodes[k.reads[r]];
+            if (x.rows * x.cols == total) {
+                reg[r] = const_cast<double*>(in[r]) + t0;
+                continue;
+            }
+            reg[r] = tiles + r * TILE;
+            if (x.rows * x.cols == 1) std::fill(reg[r], reg[r] + m, in[r][0]);
+            else for (size_t e = 0; e < m; e++) reg[r][e] = in[r][(t0 + e) / cols];     // column
+        }
+        for (size_t s = 0; s < k.program.size(); s++) {
+            const auto& p = k.program[s];
+            double* z = s + 1 == k.program.size() ? out + t0 : tiles + (base + s) * TILE;
+            reg[base + s] = z;
+            const double* a = reg[p.a];
+            const double* b = reg[p.b];
+            switch (p.kind) {
+                case op::constant: for (size_t e = 0; e < m; e++) z[e] = p.s; break;
+                case op::add: for (size_t e = 0; e < m; e++) z[e] = a[e] + b[e]; break;
+                case op::sub: for (size_t e = 0; e < m; e++) z[e] = a[e] - b[e]; break;
+                case op::mul: for (size_t e = 0; e < m; e++) z[e] = a[e] * b[e]; break;
+                case op::scale: for (size_t e = 0; e < m; e++) z[e] = p.s * a[e]; break;
+                case op::sigmoid: for (size_t e = 0; e < m; e++) z[e] = 1.0 / (1.0 + std::exp(-a[e])); break;
+                case op::tanh: for (size_t e = 0; e < m; e++) z[e] = std::tanh(a[e]); break;
+                case op::relu: for (size_t e = 0; e < m; e++) z[e] = a[e] > 0.0 ? a[e] : 0.0; break;
+                case op::selu: for (size_t e = 0; e < m; e++) z[e] = a[e] > 0.0 ? a[e] : 0.1 * a[e]; break;
+                case op::expand: for (size_t e = 0; e < m; e++) z[e] = a[e]; break;
+                case op::dsigmoid: for (size_t e = 0; e < m; e++) z[e] = a[e] * b[e] * (1.0 - b[e]); break;
+                case op::dtanh: for (size_t e = 0; e < m; e++) z[e] = a[e] * (1.0 - b[e] * b[e]); break;
+                case op::drelu: for (size_t e = 0; e < m; e++) z[e] = b[e] > 0.0 ? a[e] : 0.0; break;
+                case op::dselu: for (size_t e = 0; e < m; e++) z[e] = b[e] > 0.0 ? a[e] : 0.1 * a[e]; break;
+                default: break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief One execution: pack the parameters, run the levels in order (the
+ * pieces of a level in parallel), then add every parameter gradient into
+ * its accumulator
+ * @throws std::runtime_error if the graph is not compiled or an input is unbound
+ */
+void graph::run() {
+    if (!compiled)
+        throw std::runtime_error("-_-GRAPH IS NOT COMPILED-_-");
+    for (const node& n : nodes) {
+        if (n.kind == op::input && !n.bound)
+            throw std::runtime_error("-_-GRAPH INPUT IS NOT BOUND-_-");
+        if (n.kind != op::parameter || n.offset == SIZE_MAX) continue;
+        double* p = memory.data() + n.offset;
+        if (n.w) {
+            for (const auto& row : *n.w) p = std::copy(row.begin(), row.end(), p);
+        }
+        else std::copy(n.v->begin(), n.v->end(), p);
+    }
+    for (const auto& level : schedule) workers->run(*this, level);
+    for (const node& n : nodes) {
+        if (n.kind != op::parameter || n.grad == NONE) continue;
+        const double* g = address(n.grad);
+        if (n.gw) {
+            for (auto& row : *n.gw) {
+                for (double& v : row) v += *g++;
+            }
+        }
+        else {
+            for (double& v : *n.gv) v += *g++;
+        }
+    }
+}
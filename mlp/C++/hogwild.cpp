@@ -0,0 +1,175 @@
+// hogwild.cpp: lock-free asynchronous SGD (Hogwild) for sparse-input mlp training
+#include "include/mlp.hpp"
+#include <atomic>
+#include <thread>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+//----------------SHARED WEIGHTS----------------//
+
+// While hogwild() runs every access to the weights goes through atomic_ref
+// with relaxed ordering: each read and write of a weight is indivisible, but
+// nothing is ordered or locked, and an update racing with another may be
+// lost. On x86 and ARM these are plain loads and stores.
+
+static inline double peek(double& w) {
+    return std::atomic_ref<double>(w).load(std::memory_order_relaxed);
+}
+
+static inline void poke(double& w, double v) {
+    std::atomic_ref<double>(w).store(v, std::memory_order_relaxed);
+}
+
+/**
+ * @brief per-thread state of hogwild(): activations of each hidden layer,
+ * the backpropagated error and the scaled nonzeros of the current sample
+ */
+struct lane {
+    std::vector<std::vector<double>> a;     // activations of each hidden layer
+    std::vector<double> delta;              // error of the current layer
+    std::vector<double> next;               // error of the layer below
+    std::vector<double> value;              // scaled nonzeros
+    std::vector<double> y;                  // output
+};
+
+/**
+ * @brief One SGD step on one sparse sample against the shared weights.
+ * The backward pass reads each weight once, uses the value it read to pass
+ * the error down and stores the updated weight in the same sweep, so no
+ * gradient is ever materialised; the input layer touches only the columns
+ * of the sample's nonzeros, which is what keeps threads from colliding on
+ * sparse data.
+ * @return squared error of the sample / out
+ */
+static double step(mlp& net, const sparsevec& x, const std::vector<double>& t, lane& s) {
+    const unsigned int hidden = net.layers - 1, neurons = net.neurons;
+    const double rate = net.learning;
+    const size_t nnz = x.index.size();
+    const unsigned int* idx = x.index.data();
+    s.value.assign(x.value.begin(), x.value.end());
+    net.norm.transform(idx, s.value.data(), nnz);
+    const double* v = s.value.data();
+
+    // forward
+    for (unsigned int j = 0; j < neurons; j++) {
+        double* w = net.iweights[j].data();
+        double sum = 0.0;
+        for (size_t k = 0; k < nnz; k++) sum += peek(w[idx[k]]) * v[k];
+        s.a[0][j] = sigmoid(sum);
+    }
+    for (unsigned int l = 1; l < hidden; l++) {
+        const double* below = s.a[l - 1].data();
+        for (unsigned int j = 0; j < neurons; j++) {
+            double* w = net.weights[l - 1][j].data();
+            double sum = 0.0;
+            for (unsigned int k = 0; k < neurons; k++) sum += peek(w[k]) * below[k];
+            s.a[l][j] = sigmoid(sum);
+        }
+    }
+    const double* top = s.a[hidden - 1].data();
+    for (unsigned int i = 0; i < net.out; i++) {
+        double* w = net.oweights[i].data();
+        double sum = 0.0;
+        for (unsigned int j = 0; j < neurons; j++) sum += peek(w[j]) * top[j];
+        s.y[i] = sum;
+    }
+
+    // output layer
+    double loss = 0.0;
+    std::fill(s.delta.begin(), s.delta.end(), 0.0);
+    for (unsigned int i = 0; i < net.out; i++) {
+        const double e = s.y[i] - t[i];
+        loss += e * e;
+        double* w = net.oweights[i].data();
+        for (unsigned int j = 0; j < neurons; j++) {
+            const double wj = peek(w[j]);
+            s.delta[j] += e * wj;
+            poke(w[j], wj - rate * e * top[j]);
+        }
+    }
+    // hidden layers, top down
+    for (unsigned int l = hidden; l-- > 0;) {
+        const double* a = s.a[l].data();
+        for (unsigned int j = 0; j < neurons; j++) s.delta[j] *= a[j] * (1.0 - a[j]);
+        if (l == 0) break;
+        const double* below = s.a[l - 1].data();
+        std::fill(s.next.begin(), s.next.end(), 0.0);
+        for (unsigned int j = 0; j < neurons; j++) {
+            const double d = s.delta[j];
+            if (d == 0.0) continue;
+            double* w = net.weights[l - 1][j].data();
+            for (unsigned int k = 0; k < neurons; k++) {
+                const double wk = peek(w[k]);
+                s.next[k] += d * wk;
+                poke(w[k], wk - rate * d * below[k]);
+            }
+        }
+        std::swap(s.delta, s.next);
+    }
+    // input layer: the nonzero columns only
+    for (unsigned int j = 0; j < neurons; j++) {
+        const double d = rate * s.delta[j];
+        if (d == 0.0) continue;
+        double* w = net.iweights[j].data();
+        for (size_t k = 0; k < nnz; k++) poke(w[idx[k]], peek(w[idx[k]]) - d * v[k]);
+    }
+    return loss / net.out;
+}
+
+//----------------HOGWILD----------------//
+
+/**
+ * @brief Asynchronous lock-free SGD (Hogwild, Niu et al. 2011) on sparse
+ * samples. threads threads each take every threads-th sample of a shuffled
+ * order and update the shared weights after every sample, with no locks and
+ * no barrier inside an epoch. With sparse inputs two samples rarely share
+ * input columns, so lost updates are rare and cost little; with one thread
+ * this is exactly per-sample SGD as backward() does it. Runs epochs passes;
+ * the order is reshuffled (deterministically) every epoch.
+ * @param x sparse samples (raw, scaled with the model's scaler)
+ * @param t targets of length out
+ * @param threads number of threads
+ * @return mean squared error over the last epoch, measured while training
+ * @throws std::runtime_error if a sample does not fit the model, x and t differ in length or the model is normalised
+ */
+double mlp::hogwild(const std::vector<sparsevec>& x, const std::vector<std::vector<double>>& t, unsigned int threads) {
+    if (x.size() != t.size())
+        throw std::runtime_error("-_-NUMBER OF SAMPLES AND TARGETS SHOULD MATCH-_-");
+    if (normalize != normalization::none)
+        throw std::runtime_error("-_-NORMALISED MLP TRAINS WITH train(x, t, batch)-_-");
+    for (size_t i = 0; i < x.size(); i++) {
+        if (x[i].index.size() != x[i].value.size() || t[i].size() != out)
+            throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+        for (unsigned int k : x[i].index) {
+            if (k >= in)
+                throw std::runtime_error("-_-SPARSE INPUT INDEX OUT OF RANGE-_-");
+        }
+    }
+    threads = std::max(1u, threads);
+
+    std::vector<size_t> order(x.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 gen(1);
+    std::vector<double> losses(threads);
+    for (unsigned int e = 0; e < epochs; e++) {
+        std::shuffle(order.begin(), order.end(), gen);
+        auto run = [&](unsigned int id) {
+            lane s;
+            s.a.assign(layers - 1, std::vector<double>(neurons, 0.0));
+            s.delta.assign(neurons, 0.0);
+            s.next.assign(neurons, 0.0);
+            s.y.assign(out, 0.0);
+            double loss = 0.0;
+            for (size_t i = id; i < order.size(); i += threads) loss += step(*this, x[order[i]], t[order[i]], s);
+            losses[id] = loss;
+        };
+        std::vector<std::thread> pool;
+        for (unsigned int id = 1; id < threads; id++) pool.emplace_back(run, id);
+        run(0);
+        for (std::thread& th : pool) th.join();
+        mse = x.empty() ? 0.0 : std::accumulate(losses.begin(), losses.end(), 0.0) / x.size();
+    }
+    return mse;
+}
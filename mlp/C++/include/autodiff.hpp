@@ -0,0 +1,112 @@
+// autodiff.hpp: reverse-mode automatic differentiation on a tape
+#ifndef AUTODIFF_HPP
+#define AUTODIFF_HPP 1
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Bump allocator for the values and gradients of a tape. allocate()
+ * moves a pointer through large blocks; nothing is freed one by one.
+ * reset() forgets every allocation but keeps the memory, and merges the
+ * blocks into one when a step needed more than one, so after the first
+ * step a tape of the same shape never touches the heap again.
+ * @param block doubles per block (grown for larger requests)
+ */
+class arena {
+public:
+    explicit arena(size_t block = 1 << 16) : block(block) {}
+
+    double* allocate(size_t n);     // n doubles, uninitialised
+    void reset();                               // drop all allocations, keep the memory
+    size_t capacity() const;        // doubles owned
+
+private:
+    std::vector<std::unique_ptr<double[]>> blocks;
+    std::vector<size_t> sizes;
+    size_t current = 0;             // block being filled
+    size_t offset = 0;              // doubles used in it
+    size_t block;
+};
+
+/**
+ * @brief handle of a node (a rows x cols row-major value) on a tape
+ */
+struct node {
+    uint32_t id;
+};
+
+/**
+ * @brief Reverse-mode autodiff tape. Every operation appends a node holding
+ * its value (computed eagerly) and its operands; backward() seeds the
+ * gradient of a scalar with 1 and sweeps the nodes in reverse, each adding
+ * its operands' share (the chain rule), so any composition of the
+ * operations gets exact gradients. Values and gradients live in an arena
+ * and nodes in a reused vector, so recording costs no heap allocation
+ * once warm; call reset() between steps.
+ *
+ * Operations cover the vector ops (vecops.hpp), matrix ops (mat) and
+ * activations (activations.hpp) used by the networks: elementwise +, -,
+ * Hadamard product, scaling, sum, abs, sqrt, log, power; matrix product
+ * and transpose; sigmoid, ReLU, SeLU and column-wise softmax.
+ * Parameters are read from nested-vector matrices and backward() adds
+ * their gradients into the matrices given with them.
+ */
+class tape {
+public:
+    node constant(const double* x, size_t rows, size_t cols = 1);   // copied; no gradient
+    node constant(const std::vector<double>& x);                    // column vector
+    node parameter(const std::vector<std::vector<double>>& w, std::vector<std::vector<double>>& g);
+
+    node add(node a, node b);
+    node sub(node a, node b);
+    node mul(node a, node b);                   // Hadamard product
+    node scale(node a, double s);
+    node sum(node a);                           // 1 x 1
+    node abs(node a);
+    node sqrt(node a);
+    node log(node a);
+    node power(node a, double p);
+    node matmul(node a, node b);
+    node transpose(node a);
+    node sigmoid(node a);
+    node relu(node a);
+    node selu(node a);
+    node softmax(node a, double temp = 1.0);    // per column
+
+    void backward(node loss);                   // gradients of a 1 x 1 node
+    void reset();                               // forget every node, keep the memory
+
+    const double* value(node a) const { return nodes[a.id].value; }
+    const double* gradient(node a) const { return nodes[a.id].grad; }   // after backward()
+    double scalar(node a) const { return nodes[a.id].value[0]; }
+    size_t rows(node a) const { return nodes[a.id].rows; }
+    size_t cols(node a) const { return nodes[a.id].cols; }
+    size_t size() const { return nodes.size(); }
+
+private:
+    enum class op : uint8_t {
+        constant, parameter, add, sub, mul, scale, sum, abs, sqrt, log, power,
+        matmul, transpose, sigmoid, relu, selu, softmax
+    };
+    struct entry {
+        op kind;
+        uint32_t a, b;                          // operands
+        size_t rows, cols;
+        double s;                               // scale, exponent or temperature
+        double* value;
+        double* grad;
+        std::vector<std::vector<double>>* sink; // parameter gradient
+    };
+
+    arena mem;
+    std::vector<entry> nodes;
+
+    node push(op kind, size_t rows, size_t cols, uint32_t a = 0, uint32_t b = 0, double s = 0.0);
+    node unary(op kind, node a, double s = 0.0);
+    node same(op kind, node a, node b);
+};
+
+#endif
@@ -0,0 +1,66 @@
+// bsr.hpp: block-sparse weight storage and inference for pruned mlp models
+#ifndef BSR_HPP
+#define BSR_HPP 1
+
+#include <vector>
+#include <cstddef>
+#include "scaler.hpp"
+
+class mlp;
+
+/**
+ * @brief Block compressed sparse row matrix. The matrix is tiled into
+ * br x bc blocks and only blocks with a nonzero are stored, each as a dense
+ * row-major tile, so the kernel runs small fixed-size dense products with no
+ * per-element index. Edge tiles are zero padded; bsrmv() therefore reads x
+ * up to pcols() and writes y up to prows().
+ * @param rows logical number of rows
+ * @param cols logical number of columns
+ * @param br block rows
+ * @param bc block columns
+ */
+struct bsr {
+    unsigned int rows;                  // logical rows
+    unsigned int cols;                  // logical columns
+    unsigned int br;                    // block rows
+    unsigned int bc;                    // block columns
+    std::vector<unsigned int> rowptr;   // first block of each block row (block rows + 1)
+    std::vector<unsigned int> colidx;   // block column of each stored block
+    std::vector<double> values;         // br * bc values per stored block
+
+    size_t prows() const { return (size_t)(rows + br - 1) / br * br; }     // padded rows
+    size_t pcols() const { return (size_t)(cols + bc - 1) / bc * bc; }     // padded columns
+    size_t blocks() const { return colidx.size(); }                         // stored blocks
+};
+
+bsr tobsr(const std::vector<std::vector<double>>&, unsigned int br, unsigned int bc);
+void bsrmv(const bsr&, const double* x, double* y);        // y = A x (padded lengths)
+
+/**
+ * @brief Inference copy of a pruned mlp with every matrix in block-sparse
+ * form. Forward pass is the same as mlp::forward() (sigmoid hidden layers,
+ * linear output, the model's input normalisation).
+ * @param in number of inputs
+ * @param out number of outputs
+ * @param norm input normalisation copied from the model
+ * @param layer matrices, input layer first, output layer last
+ */
+class spmlp {
+public:
+    unsigned int in;                // number of inputs
+    unsigned int out;               // number of outputs
+    scaler norm;                    // input normalisation
+    std::vector<bsr> layer;         // block-sparse matrices
+
+    spmlp() = default;
+    spmlp(const mlp&, unsigned int br = 4, unsigned int bc = 4);
+
+    size_t width() const;                                               // scratch needed by infer
+    void infer(const double* x, double* y, std::vector<double>& scratch) const;
+    std::vector<double> infer(const std::vector<double>&) const;
+    double density() const;                                             // stored / total blocks
+
+    ~spmlp() = default;
+};
+
+#endif
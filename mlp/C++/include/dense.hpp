@@ -0,0 +1,104 @@
+// dense.hpp: dense layer kernels shared by mlp::infer and read-only model snapshots
+#ifndef DENSE_HPP
+#define DENSE_HPP 1
+
+#include <vector>
+#include <cstddef>
+#include "activations.hpp"
+
+/**
+ * @brief dot product with four independent accumulators (shorter dependency
+ * chain than std::inner_product)
+ */
+inline double dot(const double* w, const double* x, size_t n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        s0 += w[k] * x[k];
+        s1 += w[k + 1] * x[k + 1];
+        s2 += w[k + 2] * x[k + 2];
+        s3 += w[k + 3] * x[k + 3];
+    }
+    for (; k < n; k++) s0 += w[k] * x[k];
+    return (s0 + s1) + (s2 + s3);
+}
+
+/**
+ * @brief 2 x 2 register tile of a layer product: two neurons against two
+ * samples, so each loaded weight and activation feeds two multiply-adds
+ * @param w0 weight row of the first neuron
+ * @param w1 weight row of the second neuron
+ * @param a0 activations of the first sample
+ * @param a1 activations of the second sample
+ * @param n row length
+ * @param o results {w0.a0, w0.a1, w1.a0, w1.a1}
+ */
+inline void dot22(const double* w0, const double* w1, const double* a0, const double* a1,
+                         size_t n, double* o) {
+    double s00 = 0.0, s01 = 0.0, s10 = 0.0, s11 = 0.0;
+    double t00 = 0.0, t01 = 0.0, t10 = 0.0, t11 = 0.0;
+    size_t k = 0;
+    for (; k + 2 <= n; k += 2) {
+        s00 += w0[k] * a0[k];  s01 += w0[k] * a1[k];
+        s10 += w1[k] * a0[k];  s11 += w1[k] * a1[k];
+        t00 += w0[k + 1] * a0[k + 1];  t01 += w0[k + 1] * a1[k + 1];
+        t10 += w1[k + 1] * a0[k + 1];  t11 += w1[k + 1] * a1[k + 1];
+    }
+    for (; k < n; k++) {
+        s00 += w0[k] * a0[k];  s01 += w0[k] * a1[k];
+        s10 += w1[k] * a0[k];  s11 += w1[k] * a1[k];
+    }
+    o[0] = s00 + t00;  o[1] = s01 + t01;  o[2] = s10 + t10;  o[3] = s11 + t11;
+}
+
+/**
+ * @brief One layer of the batched forward pass, B = f(A W^T) with A rows x k
+ * and W m x k, in 2 x 2 tiles with neurons outermost, so each pair of weight
+ * rows is loaded once and reused from L1 for every sample of the batch.
+ * W(j) returns a pointer to row j, so nested vectors and flat (mapped)
+ * storage share the kernel.
+ */
+template <class Rows>
+void layerBatch(Rows W, size_t m, const double* A, size_t lda,
+                size_t rows, size_t k, double* B, size_t ldb, bool sig) {
+    auto f = [sig](double v) { return sig ? sigmoid(v) : v; };
+    size_t j = 0;
+    for (; j + 2 <= m; j += 2) {
+        const double* w0 = W(j);
+        const double* w1 = W(j + 1);
+        size_t r = 0;
+        for (; r + 2 <= rows; r += 2) {
+            double o[4];
+            dot22(w0, w1, A + r * lda, A + (r + 1) * lda, k, o);
+            B[r * ldb + j] = f(o[0]);
+            B[(r + 1) * ldb + j] = f(o[1]);
+            B[r * ldb + j + 1] = f(o[2]);
+            B[(r + 1) * ldb + j + 1] = f(o[3]);
+        }
+        for (; r < rows; r++) {
+            B[r * ldb + j] = f(dot(w0, A + r * lda, k));
+            B[r * ldb + j + 1] = f(dot(w1, A + r * lda, k));
+        }
+    }
+    for (; j < m; j++) {
+        for (size_t r = 0; r < rows; r++) B[r * ldb + j] = f(dot(W(j), A + r * lda, k));
+    }
+}
+
+/**
+ * @brief row accessor of a nested-vector matrix for layerBatch
+ */
+inline auto rowsOf(const std::vector<std::vector<double>>& W) {
+    return [&W](size_t j) { return W[j].data(); };
+}
+
+/**
+ * @brief row accessor of a flat row-major matrix for layerBatch
+ * @param W first element
+ * @param ld row length
+ */
+inline auto rowsOf(const double* W, size_t ld) {
+    return [W, ld](size_t j) { return W + j * ld; };
+}
+
+#endif
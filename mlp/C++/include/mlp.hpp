@@ -16,7 +16,88 @@
 #define MLP_HPP 1
 
 #include <vector>
+#include <span>
+#include <string>
+#include <functional>
+#include <cstdint>
 #include "activations.hpp"
+#include "scaler.hpp"
+#include "normalize.hpp"
+#include "graph.hpp"
+
+/**
+ * @brief Sparse input vector (one row of a CSR matrix). Only the nonzero
+ * features are stored, so bag-of-words or one-hot inputs are never densified.
+ * @param index feature index of each nonzero (less than mlp::in)
+ * @param value value of each nonzero
+ */
+struct sparsevec {
+    std::vector<unsigned int> index;    // feature indices
+    std::vector<double> value;          // feature values
+};
+
+/**
+ * @brief Weight initialization schemes (see mlp::initializeWeights)
+ * - he: N(0, 2 / fan_in)
+ * - xavier: N(0, 2 / (fan_in + fan_out))
+ * - orthogonal: orthonormal rows or columns
+ */
+enum class initialization { he, xavier, orthogonal };
+
+class mlp;
+class ring;
+
+/**
+ * @brief Caller-owned scratch for mlp::infer: two buffers as wide as the
+ * widest layer, used in ping-pong fashion from layer to layer. One per
+ * thread; the model is only read, so any number of threads can share it.
+ * The batched infer grows the buffers to rows x widest layer.
+ * @param a buffer holding the current layer's input
+ * @param b buffer receiving the current layer's output
+ */
+struct workspace {
+    std::vector<double> a;      // layer input
+    std::vector<double> b;      // layer output
+
+    workspace() = default;
+    workspace(const mlp&);      // sized for the model
+};
+
+/**
+ * @brief Per-thread training state for a shared mlp: the sample, every
+ * layer's pre-activations and activations, and gradient accumulators with
+ * the same shapes as the weights. forward(worker&) and backward(worker&) only
+ * read the model, so N workers can run concurrently on one set of weights;
+ * update() is the single writer that applies their gradients. With
+ * mlp::dropout > 0 a training worker drops hidden units: the mask of each
+ * layer is drawn from Philox (seed, layer, draws) as one bit per unit, and
+ * backward() reads the bits back instead of a mask of doubles. Workers
+ * that run together need different seeds.
+ * @param samples number of samples accumulated since the last update
+ * @param training false for evaluation (no dropout)
+ */
+struct worker {
+    std::vector<double> input;      // normalised input
+    std::vector<double> expected;   // target output
+    std::vector<double> output;     // network output
+    sparsevec sinput;               // sparse input (empty when the dense input is used)
+    std::vector<std::vector<double>> hlayers;       // pre-activations of each layer
+    std::vector<std::vector<double>> activations;   // activations of each layer
+    std::vector<std::vector<std::vector<double>>> gweights;     // gradient of hidden weights
+    std::vector<std::vector<double>> giweights;     // gradient of input weights
+    std::vector<std::vector<double>> goweights;     // gradient of output weights
+    std::vector<double> delta;      // backprop scratch (current layer)
+    std::vector<double> next;       // backprop scratch (layer below)
+    std::vector<std::vector<uint64_t>> mask;        // dropout bitmask of each hidden layer (bit set = kept)
+    uint64_t seed;                  // dropout generator key
+    uint64_t draws;                 // forward passes masked so far
+    bool training;                  // apply mlp::dropout in forward passes
+    unsigned int samples;           // samples accumulated in the gradients
+
+    worker() = default;
+    worker(const mlp&, uint64_t seed = 0);          // shaped like the model
+    void zero();                    // clear the gradients
+};
 
 /**
  * @brief Multi-layer Perceptron class (with No BIASES)
@@ -31,11 +112,14 @@ public:
     unsigned int epochs;        // number of epochs
     double mse;                 // mean square error
     double learning;            // learning rate
+    double dropout = 0.0;       // probability of dropping a hidden unit in training workers
     bool status;                // 1 if completely trained
 // member containers
     std::vector<double> input;      // input vector
     std::vector<double> output;     // output vector
     std::vector<double> expected;   // expected output vectors
+    sparsevec sinput;               // sparse input (empty when the dense input is used)
+    scaler norm;                    // input normalisation, applied when samples are loaded
     std::vector<std::vector<std::vector<double>>> weights;      // weights for matrix layer
     std::vector<std::vector<double>> iweights;      // input to hidden weights
     std::vector<std::vector<double>> oweights;      // input to hidden weights
@@ -44,18 +128,39 @@ public:
     std::vector<std::vector<std::vector<double>>> gweights;     // gradient of weights for matrix layer
     std::vector<std::vector<double>> giweights;     // gradient of input to hidden weights
     std::vector<std::vector<double>> goweights;     // gradient of input to hidden weights
+    normalization normalize = normalization::none;  // normalisation of the hidden pre-activations
+    double momentum = 0.1;                          // batchnorm running statistics update rate
+    std::vector<std::vector<double>> gamma;         // normalisation scale of each hidden layer
+    std::vector<std::vector<double>> beta;          // normalisation shift of each hidden layer (bias once folded)
+    std::vector<std::vector<double>> mean;          // batchnorm running mean of each hidden layer
+    std::vector<std::vector<double>> var;           // batchnorm running variance of each hidden layer
 
 // member functions
     // default constructor
     mlp() = default;
     mlp(unsigned int in, unsigned int out, unsigned int epochs, double learning);
+    mlp(unsigned int in, unsigned int out, unsigned int layers, unsigned int neurons,
+        unsigned int epochs, double learning);
     mlp(std::vector<double> input, std::vector<double> expected, std::vector<double> output,
         unsigned int epochs, double learning);
 
     double getL1Penalty();
     double getL2Penalty();
 
+    void fitScaler(const std::vector<std::vector<double>>&, scaling);
+    void loadInput(const std::vector<double>&);
     void forward();
+    void forward(const sparsevec&);
+    void infer(std::span<const double> x, std::span<double> y, workspace&) const;
+    void infer(std::span<const double> x, std::span<double> y, size_t rows, workspace&) const;   // batch
+    void loadInput(worker&, const std::vector<double>&) const;
+    void forward(worker&) const;
+    void forward(worker&, const sparsevec&) const;
+    double backward(worker&) const;
+    double backward(worker&, const std::function<void(unsigned int)>& ready) const;  // with per-layer progress
+    void update(worker&);
+    void update(std::vector<worker>&);
+    void propagate();
     void backward();
     void backprop();
     void backwithL1();
@@ -63,9 +168,24 @@ public:
     void rprop(std::vector<std::vector<double>>);
     void train();
     void train(std::vector<std::vector<double>>);
+    void train(std::vector<sparsevec>);
+    double train(ring&, const std::vector<std::vector<double>>& x, const std::vector<std::vector<double>>& t,
+                 unsigned int batch, size_t bucket = 1 << 20);                   // data-parallel
+    double hogwild(const std::vector<sparsevec>& x, const std::vector<std::vector<double>>& t,
+                   unsigned int threads);                                        // lock-free async SGD
+    double train(const std::vector<std::vector<double>>& x, const std::vector<std::vector<double>>& t,
+                 unsigned int batch);                                            // mini-batch, normalisation aware
+    graph compile(size_t batch, unsigned int threads = 1);                       // training step as a graph
+    double fit(const std::vector<std::vector<double>>& x, const std::vector<std::vector<double>>& t,
+               unsigned int batch, unsigned int threads = 1);                    // mini-batch, compiled
+    void addNormalization(normalization);
+    void fold();                                    // batchnorm into the weights, for inference
     void validate();
     void test();
     void initializeWeights();
+    void initializeWeights(initialization, uint64_t seed, unsigned int threads = 1);   // reproducible
+    void save(const std::string&) const;
+    void load(const std::string&);
 
     // default destructor
     ~mlp() = default;
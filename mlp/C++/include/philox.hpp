@@ -0,0 +1,35 @@
+// philox.hpp: counter-based random numbers (Philox4x32-10) for weight initialisation
+#ifndef PHILOX_HPP
+#define PHILOX_HPP 1
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3", SC 2011). There is no state to advance: the 128-bit output of
+ * a block is a bijection of its 128-bit counter keyed by the 64-bit seed,
+ * so element index of stream is computed directly from (seed, stream,
+ * index). A tensor can be filled in any order, by any number of threads,
+ * in any chunks, and always gets the same bits. Element index uses block
+ * index / 2, whose four words give two 53-bit uniforms (and, by Box-Muller,
+ * two normals); index % 2 picks one of them. Bernoulli bitmasks use one
+ * word per bit instead: bit b of mask word w comes from word b % 4 of block
+ * 16 w + b / 4.
+ * @param seed key of the generator
+ */
+struct philox {
+    uint64_t seed;
+
+    explicit philox(uint64_t seed = 0) : seed(seed) {}
+
+    void block(uint32_t counter[4]) const;                      // one Philox4x32-10 block in place
+    double uniform(uint32_t stream, uint64_t index) const;     // in [0, 1)
+    double normal(uint32_t stream, uint64_t index) const;      // standard normal
+    void uniform(double* out, size_t n, uint32_t stream, uint64_t first = 0) const;    // elements first .. first + n - 1
+    void normal(double* out, size_t n, uint32_t stream, uint64_t first = 0,
+                double mean = 0.0, double stddev = 1.0) const;
+    void bernoulli(uint64_t* mask, size_t words, uint32_t stream, uint64_t first, double p) const;   // bitmask
+};
+
+#endif
@@ -0,0 +1,55 @@
+// prune.hpp: magnitude pruning (unstructured, block and neuron level) for mlp
+#ifndef PRUNE_HPP
+#define PRUNE_HPP 1
+
+#include <vector>
+#include <cstdint>
+
+class mlp;
+
+/**
+ * @brief Gradual magnitude pruning. Every weight matrix of the model
+ * (iweights, each weights[l], oweights) gets its own 0/1 mask. At each
+ * update the smallest groups of every matrix are masked until the matrix
+ * reaches the scheduled sparsity; a group is a single weight or, for
+ * br x bc > 1, a br x bc block scored by its L2 norm so that the result
+ * exports cleanly to block-sparse storage. The sparsity follows the cubic
+ * schedule of Zhu and Gupta,
+ *      s(t) = target + (initial - target) * (1 - (t - begin) / (end - begin))^3
+ * so most weights are removed early, while the network can still recover
+ * during fine-tuning. With begin == end the target is applied at once.
+ * @param initial sparsity at step begin
+ * @param target final sparsity, in [0, 1)
+ * @param begin first pruning step
+ * @param end last pruning step
+ * @param frequency steps between mask updates
+ * @param br block rows
+ * @param bc block columns
+ */
+class pruner {
+public:
+    double initial;             // sparsity at the first pruning step
+    double target;              // final sparsity
+    unsigned int begin;         // first pruning step
+    unsigned int end;           // last pruning step
+    unsigned int frequency;     // steps between mask updates
+    unsigned int br;            // block rows of a pruning group
+    unsigned int bc;            // block columns of a pruning group
+    std::vector<std::vector<std::vector<uint8_t>>> mask;   // 1 = kept, per matrix
+
+    pruner(double target, unsigned int begin = 0, unsigned int end = 0, unsigned int frequency = 1,
+           double initial = 0.0, unsigned int br = 1, unsigned int bc = 1);
+
+    double sparsity(unsigned int step) const;       // scheduled sparsity at a step
+    bool update(mlp&, unsigned int step);           // recompute masks if a step is due
+    void apply(mlp&) const;                         // zero the masked weights
+
+    ~pruner() = default;
+};
+
+void prune(mlp&, double sparsity, unsigned int br = 1, unsigned int bc = 1);     // one-shot magnitude pruning
+void finetune(mlp&, pruner&, const std::vector<std::vector<double>>& inputs, unsigned int epochs);
+unsigned int shrink(mlp&, unsigned int keep);      // structured: keep the strongest neurons of each layer
+double sparsity(const mlp&);                        // measured fraction of zero weights
+
+#endif
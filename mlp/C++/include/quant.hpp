@@ -0,0 +1,81 @@
+// quant.hpp: post-training int8 quantization and integer inference for mlp
+#ifndef QUANT_HPP
+#define QUANT_HPP 1
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "scaler.hpp"
+
+class mlp;
+
+/**
+ * @brief One quantized weight matrix. Activations entering the layer are
+ * uint8 with a per-channel affine code x = s[c] * (q[c] - z[c]); the input
+ * scales s[c] are folded into the weights before they are rounded, so each
+ * output row needs only one float scale and one int32 zero-point correction:
+ *      pre[r] = scale[r] * (sum_c w[r][c] * q[c] - zero[r])
+ * Rows are padded with zeros to ld (a multiple of 32) for the SIMD kernels.
+ * @param rows output channels
+ * @param cols input channels
+ * @param ld padded row length
+ */
+struct qlayer {
+    unsigned int rows;              // output channels
+    unsigned int cols;              // input channels
+    unsigned int ld;                // padded row length (multiple of 32)
+    std::vector<int8_t> w;          // rows x ld int8 weights
+    std::vector<float> scale;       // per-row dequantization scale
+    std::vector<int64_t> zero;      // per-row sum_c w[r][c] * z[c]
+    // requantization of the (sigmoid) output, empty for the linear output layer
+    std::vector<float> oinv;        // 1 / output scale per row
+    std::vector<int32_t> ozero;     // output zero point per row
+};
+
+/**
+ * @brief Scratch buffers for qmlp::infer, two uint8 activation buffers used
+ * in ping-pong fashion. One per thread; the model itself is read-only.
+ */
+struct qworkspace {
+    std::vector<double> x;          // normalised input
+    std::vector<uint8_t> a;         // activations entering the current layer
+    std::vector<uint8_t> b;         // activations leaving the current layer
+};
+
+/**
+ * @brief Int8 copy of a trained mlp for inference. Built once from the model
+ * and a calibration set: the double network is run over the samples to find
+ * the range of every input feature and every hidden neuron, which sets the
+ * per-channel uint8 activation codes; weights get symmetric per-row int8
+ * scales. Inference then uses uint8 x int8 -> int32 dot products, and the
+ * sigmoid of each hidden layer writes the next layer's uint8 codes directly.
+ * Weight storage is one byte per weight instead of eight.
+ * @param in number of inputs
+ * @param out number of outputs
+ * @param norm input normalisation copied from the model
+ * @param layer quantized matrices, input layer first, output layer last
+ */
+class qmlp {
+public:
+    unsigned int in;                // number of inputs
+    unsigned int out;               // number of outputs
+    scaler norm;                    // input normalisation
+    std::vector<float> iinv;        // 1 / input scale per feature
+    std::vector<int32_t> izero;     // input zero point per feature
+    std::vector<qlayer> layer;      // quantized layers
+
+    qmlp() = default;
+    qmlp(const mlp&, const std::vector<std::vector<double>>& calibration);
+
+    qworkspace workspace() const;                                       // correctly sized scratch
+    void infer(const double* x, double* y, qworkspace&) const;          // one sample
+    std::vector<double> infer(const std::vector<double>&) const;        // one sample, own scratch
+    size_t bytes() const;                                               // weight and scale storage
+
+    ~qmlp() = default;
+};
+
+int32_t qdot(const uint8_t* a, const int8_t* w, size_t n);     // n a multiple of 32
+const char* qkernel();                                          // name of the compiled dot kernel
+
+#endif
@@ -0,0 +1,122 @@
+// registry.hpp: versioned mlp models with lock-free hot swapping
+#ifndef REGISTRY_HPP
+#define REGISTRY_HPP 1
+
+#include <span>
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include "mlp.hpp"
+#include "serialize.hpp"
+
+/**
+ * @brief Read-only model version: the arrays of a model file (see
+ * modelheader) used in place. Built from a file it maps the file, so loading
+ * costs one mmap and the pages are shared with every process serving the
+ * same model; built from an mlp it copies the weights into the same flat
+ * layout. Inference only reads, so one snapshot serves any number of threads.
+ * @param header dimensions of the model
+ * @param version registry version (set when published)
+ */
+class snapshot {
+public:
+    modelheader header;             // dimensions
+    uint64_t version;               // registry version, 0 until published
+    const double* shift;            // input normalisation
+    const double* scale;
+    const double* iweights;         // neurons x in
+    const double* weights;          // (layers - 1) x neurons x neurons
+    const double* oweights;         // out x neurons
+    const double* beta;             // (layers - 1) x neurons hidden normalisation, null if not stored
+    const double* gamma;
+    const double* mean;
+    const double* var;
+    std::vector<double> storage;    // owned arrays (copied models)
+    void* map;                      // mapped file (mapped models)
+    size_t length;                  // mapped bytes
+
+    snapshot(const mlp&);
+    snapshot(const std::string& path);
+    snapshot(const snapshot&) = delete;
+    snapshot& operator=(const snapshot&) = delete;
+    ~snapshot();
+
+    void infer(std::span<const double> x, std::span<double> y, size_t rows, workspace&) const;   // batch
+    std::vector<double> infer(const std::vector<double>& x) const;                              // one sample
+
+private:
+    void bind(const double*);       // point the arrays into a flat buffer
+};
+
+/**
+ * @brief Versioned model registry with hazard-pointer reclamation.
+ * publish() swaps the current snapshot with one atomic exchange; readers
+ * pin the current snapshot by announcing it in their hazard slot, so a
+ * reader costs two atomic stores and a load and never waits for a loader.
+ * Replaced snapshots are retired and freed (unmapped) by the publishing or
+ * watching thread once no hazard slot holds them, so readers never pay for
+ * loading, page faults or reclamation.
+ * @param slots number of concurrent readers
+ */
+class registry {
+public:
+    static constexpr unsigned int slots = 64;
+
+    /**
+     * @brief one reader's hazard pointer, on its own cache line
+     */
+    struct alignas(64) slot {
+        std::atomic<const snapshot*> hazard{nullptr};   // pinned snapshot
+        std::atomic<bool> taken{false};                 // owned by a reader
+    };
+
+    /**
+     * @brief A reader thread's handle on the registry. Owns a hazard slot
+     * for its lifetime; pin() protects the current snapshot until unpin().
+     */
+    class reader {
+    public:
+        registry& models;       // registry read
+        slot* own;              // hazard slot
+
+        reader(registry&);
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+        ~reader();
+        const snapshot* pin();  // protect and return the current snapshot (nullptr if none)
+        void unpin();           // release it
+    };
+
+    std::atomic<const snapshot*> current;   // published snapshot
+    std::atomic<uint64_t> latest;           // its version (= number of publications)
+    slot hazards[slots];                    // reader slots
+    std::mutex retiring;                    // guards retired
+    std::vector<const snapshot*> retired;   // replaced, maybe still pinned
+    std::atomic<uint64_t> failures;         // rejected reloads
+
+    // background reloading
+    std::thread watcher;
+    std::mutex waiting;
+    std::condition_variable wake;
+    bool watching;
+
+    registry();
+    registry(const registry&) = delete;
+    registry& operator=(const registry&) = delete;
+    ~registry();
+
+    uint64_t publish(std::unique_ptr<snapshot>);    // make current, retire the previous one
+    uint64_t publish(const mlp&);                   // copy and publish
+    uint64_t load(const std::string& path);         // map and publish
+    size_t reclaim();                               // free unpinned retired snapshots
+    void watch(const std::string& path, std::chrono::milliseconds interval);     // reload on change
+    void stop();                                    // stop watching
+};
+
+#endif
@@ -0,0 +1,52 @@
+// serialize.hpp: binary model file layout for mlp
+#ifndef SERIALIZE_HPP
+#define SERIALIZE_HPP 1
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Fixed 64-byte header of an mlp model file. It is followed by
+ * doubles only (host byte order), so every array in the file is 8-byte
+ * aligned and the file can be used in place after mmap:
+ *      shift[in], scale[in]                    input normalisation
+ *      iweights[neurons][in]
+ *      weights[layers - 1][neurons][neurons]
+ *      oweights[out][neurons]
+ *      beta, gamma, mean, var[layers - 1][neurons]   hidden normalisation,
+ *                                              as many as normarrays() gives
+ * @param magic "MLPMODEL"
+ * @param version format version (1)
+ * @param method scaling method of the normalisation (enum value)
+ * @param fitted 1 if the normalisation is fitted
+ * @param normalize normalisation of the hidden layers (enum value); files
+ * without one read 0 here and are laid out as before
+ */
+struct modelheader {
+    char magic[8];          // "MLPMODEL"
+    uint32_t version;       // format version
+    uint32_t in;            // number of inputs
+    uint32_t out;           // number of outputs
+    uint32_t layers;        // number of layers
+    uint32_t neurons;       // neurons per hidden layer
+    uint32_t epochs;        // epochs trained
+    uint32_t method;        // scaling method
+    uint32_t fitted;        // normalisation fitted
+    double learning;        // learning rate
+    uint64_t bytes;         // total file size
+    uint32_t normalize;     // hidden-layer normalisation
+    uint8_t reserved[4];    // zero
+};
+
+static_assert(sizeof(modelheader) == 64, "model header must be 64 bytes");
+
+constexpr uint32_t MODEL_VERSION = 1;
+
+class mlp;
+
+size_t normarrays(uint32_t normalize);      // per-layer normalisation arrays stored: beta, gamma, mean, var
+size_t modelbytes(const modelheader&);      // file size implied by a header
+bool validheader(const modelheader&);       // magic, version and size consistent
+modelheader headerof(const mlp&);           // header describing a model
+
+#endif
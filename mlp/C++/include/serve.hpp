@@ -0,0 +1,143 @@
+// serve.hpp: request batching, metrics and a Unix socket server for mlp inference
+#ifndef SERVE_HPP
+#define SERVE_HPP 1
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include "mlp.hpp"
+#include "registry.hpp"
+
+/**
+ * @brief Lock-free latency histogram. Values (nanoseconds) fall into
+ * log-linear buckets, 8 per power of two, so any quantile is within about
+ * 6% of the true value; recording is one relaxed atomic increment.
+ */
+class latency {
+public:
+    static constexpr int sub = 8;               // buckets per power of two
+    static constexpr int buckets = 64 * sub;    // covers the full uint64 range
+    std::atomic<uint64_t> count[buckets];       // samples per bucket
+    std::atomic<uint64_t> total;                // samples recorded
+
+    latency();
+    void record(uint64_t ns);                   // add one sample
+    uint64_t quantile(double q) const;          // approximate quantile in ns
+    void reset();
+};
+
+/**
+ * @brief Serving counters: requests, batches, errors and latency of the
+ * whole request (queueing + compute) and of the batched compute alone
+ */
+struct servestats {
+    std::atomic<uint64_t> requests{0};          // requests answered
+    std::atomic<uint64_t> batches{0};           // batches run
+    std::atomic<uint64_t> errors{0};            // rejected requests
+    latency request;                            // submit to answer
+    latency compute;                            // batched forward pass
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::string report() const;                 // one-line summary
+};
+
+/**
+ * @brief Dynamic request batcher. Requests are queued; a dispatcher thread
+ * takes the oldest one, waits until maxBatch requests are queued or maxWait
+ * microseconds have passed since that request arrived, and runs everything
+ * it took as one batched inference. Several dispatcher threads can drain
+ * the same queue. Each batch runs on the registry's current snapshot, pinned
+ * for the batch, so a new model version can be published at any time and
+ * takes over from the next batch without stalling the one in flight.
+ * @param net model to serve (copied into a private registry)
+ * @param models registry to serve from (must outlive the batcher)
+ * @param maxBatch largest batch
+ * @param maxWait longest time (microseconds) a request waits for company
+ * @param threads dispatcher threads (each holds a registry reader slot, so at most registry::slots)
+ */
+class batcher {
+public:
+    struct request {
+        std::vector<double> x;                              // raw input
+        std::promise<std::vector<double>> done;             // output
+        std::chrono::steady_clock::time_point arrived;      // submit time
+    };
+
+    std::unique_ptr<registry> own;  // private registry (mlp constructor)
+    registry& models;               // served versions
+    unsigned int maxBatch;          // largest batch
+    unsigned int maxWait;           // microseconds
+    servestats stats;               // counters and histograms
+    std::deque<request> queue;      // pending requests
+    std::mutex lock;                // guards queue and stopping
+    std::condition_variable ready;  // queue changed
+    bool stopping;                  // no new requests, drain and exit
+    std::vector<std::thread> pool;  // dispatcher threads
+
+    batcher(const mlp& net, unsigned int maxBatch = 32, unsigned int maxWait = 200, unsigned int threads = 1);
+    batcher(registry& models, unsigned int maxBatch = 32, unsigned int maxWait = 200, unsigned int threads = 1);
+    std::future<std::vector<double>> submit(std::vector<double> x);     // queue one request
+    std::vector<double> infer(std::vector<double> x);                   // submit and wait
+    void stop();                                                        // drain and join
+    ~batcher();
+
+private:
+    void dispatch();                // dispatcher loop
+};
+
+/**
+ * @brief Unix domain socket front end for a batcher. Every connection gets
+ * its own thread, so concurrent clients are coalesced by the batcher.
+ * Protocol (host byte order):
+ *      on connect     server sends  u32 in, u32 out  (of the current version)
+ *      inference      client sends  u32 n (= in), n doubles
+ *                     server sends  u32 m (= out), m doubles  (m = 0 on error)
+ *      statistics     client sends  u32 0
+ *                     server sends  u32 length, length bytes of text
+ * @param path socket path (replaced if it exists)
+ */
+class server {
+public:
+    batcher& queue;                         // request batcher
+    std::string path;                       // socket path
+    int fd;                                 // listening socket
+    std::atomic<bool> running;              // accepting connections
+    std::thread acceptor;                   // accept loop
+    std::vector<std::thread> connections;   // one per client
+    std::vector<int> clients;               // open client sockets
+    std::vector<std::thread::id> finished;  // connection threads waiting to be joined
+    std::mutex lock;                        // guards connections and clients
+
+    server(batcher&, const std::string& path);
+    void start();                           // bind, listen and accept in the background
+    void stop();                            // close everything and join
+    ~server();
+
+private:
+    void serve(int client);                 // connection loop
+};
+
+/**
+ * @brief Blocking client for server
+ * @param path socket path
+ */
+class client {
+public:
+    int fd;                 // connected socket
+    unsigned int in;        // model inputs
+    unsigned int out;       // model outputs
+
+    client(const std::string& path);
+    std::vector<double> infer(const std::vector<double>& x);    // one request
+    std::string stats();                                        // server statistics
+    ~client();
+};
+
+#endif
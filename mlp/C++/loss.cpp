@@ -80,7 +80,8 @@ double computeLossWithL2(std::vector<double>& outputs, std::vector<double>& targ
 /**
  * @brief Computes the loss with dropout generalization. The loss is the sum of 
  * the squared difference between the predicted output and the target output.
- * The dropout generalization term is added to the loss.
+ * The dropout generalization term is added to the loss. This only rescales
+ * the loss; set mlp::dropout to drop hidden units in training workers.
  * @param outputs The predicted output of the network.
  * @param targets The target output of the network.
  * @param network The network to compute the loss for.
@@ -0,0 +1,223 @@
+// minibatch.cpp: mini-batch training of mlp with layer or batch normalisation
+#include "include/mlp.hpp"
+#include "include/dense.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+typedef std::vector<std::vector<double>> matrix;
+
+//----------------SETUP----------------//
+
+/**
+ * @brief Normalise the pre-activations of every hidden layer. gamma starts
+ * at 1, beta at 0 and the batchnorm running statistics at mean 0 and
+ * variance 1. folded adds a plain trainable bias (beta). none removes the
+ * normalisation.
+ * @param kind normalisation
+ */
+void mlp::addNormalization(normalization kind) {
+    normalize = kind;
+    const size_t hidden = kind == normalization::none ? 0 : layers - 1;
+    gamma.assign(hidden, std::vector<double>(neurons, 1.0));
+    beta.assign(hidden, std::vector<double>(neurons, 0.0));
+    mean.assign(hidden, std::vector<double>(neurons, 0.0));
+    var.assign(hidden, std::vector<double>(neurons, 1.0));
+}
+
+/**
+ * @brief Fold batch normalisation into the weights. At inference BatchNorm
+ * is the affine map s * z + (beta - mean * s) with s = gamma / sqrt(var + eps),
+ * so row j of the matrix feeding a layer is scaled by s_j and the rest
+ * becomes the layer's bias; inference then costs one add per neuron. The
+ * model's outputs are unchanged (to rounding).
+ * @throws std::runtime_error if the model is not batch normalised
+ */
+void mlp::fold() {
+    if (normalize != normalization::batch)
+        throw std::runtime_error("-_-ONLY BATCH NORMALISATION CAN BE FOLDED-_-");
+    for (unsigned int l = 0; l + 1 < layers; l++) {
+        matrix& w = l == 0 ? iweights : weights[l - 1];
+        for (unsigned int j = 0; j < neurons; j++) {
+            const double s = gamma[l][j] / std::sqrt(var[l][j] + NORM_EPSILON);
+            for (double& v : w[j]) v *= s;
+            beta[l][j] -= mean[l][j] * s;
+            gamma[l][j] = 1.0;
+            mean[l][j] = 0.0;
+            var[l][j] = 1.0;
+        }
+    }
+    normalize = normalization::folded;
+}
+
+//----------------TRAINING----------------//
+
+/**
+ * @brief Mini-batch gradient descent over whole-batch matrices: every layer
+ * is one matrix-matrix product over the batch, followed by its
+ * normalisation (LayerNorm per sample, BatchNorm per neuron over the batch,
+ * with running statistics updated by momentum; a folded model trains its
+ * bias) and the sigmoid. Backward runs the same way in reverse; every step
+ * applies the gradient averaged over the batch, so without normalisation
+ * and with batch 1 this is exactly per-sample forward/backward/update.
+ * Runs epochs passes over the samples in order, starting from cleared
+ * gradients.
+ * @param x samples (raw, normalised with the model's scaler)
+ * @param t targets of length out
+ * @param batch samples per step
+ * @return mean squared error of the last epoch
+ * @throws std::invalid_argument if batch is zero
+ * @throws std::runtime_error if x and t differ in length or a sample has the wrong size
+ */
+double mlp::train(const std::vector<std::vector<double>>& x, const std::vector<std::vector<double>>& t,
+                  unsigned int batch) {
+    if (x.size() != t.size())
+        throw std::runtime_error("-_-NUMBER OF SAMPLES AND TARGETS SHOULD MATCH-_-");
+    if (batch == 0)
+        throw std::invalid_argument("-_-BATCH SIZE MUST BE POSITIVE-_-");
+    for (size_t i = 0; i < x.size(); i++) {
+        if (x[i].size() != in || t[i].size() != out)
+            throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    }
+    if (normalize != normalization::none && gamma.size() != layers - 1)
+        addNormalization(normalize);
+
+    const unsigned int hidden = layers - 1, n = neurons;
+    const size_t B = batch;
+    std::vector<double> input(B * in), output(B * out), delta(B * n), below(B * n);
+    matrix z(hidden, std::vector<double>(B * n)), xhat(hidden, std::vector<double>(B * n));
+    matrix a(hidden, std::vector<double>(B * n)), rstd(hidden, std::vector<double>(std::max<size_t>(B, n)));
+    matrix dgamma(hidden, std::vector<double>(n)), dbeta(hidden, std::vector<double>(n));
+    std::vector<double> bmean(n), bvar(n);
+
+    auto zero = [](matrix& m) { for (auto& row : m) std::fill(row.begin(), row.end(), 0.0); };
+    // backward() and backprop() leave their last gradients behind
+    zero(giweights);
+    for (auto& m : gweights) zero(m);
+    zero(goweights);
+    for (unsigned int e = 0; e < epochs; e++) {
+        double total = 0.0;
+        for (size_t s = 0; s < x.size(); s += B) {
+            const size_t R = std::min(B, x.size() - s);
+            for (size_t r = 0; r < R; r++) {
+                std::copy(x[s + r].begin(), x[s + r].end(), input.data() + r * in);
+                norm.transform(input.data() + r * in);
+            }
+
+            // forward: z = a_prev W^T, normalise, sigmoid
+            for (unsigned int l = 0; l < hidden; l++) {
+                const double* prev = l == 0 ? input.data() : a[l - 1].data();
+                const unsigned int k = l == 0 ? in : n;
+                layerBatch(rowsOf(l == 0 ? iweights : weights[l - 1]), n, prev, k, R, k, z[l].data(), n, false);
+                double* act = a[l].data();
+                switch (normalize) {
+                    case normalization::none:
+                        std::copy(z[l].begin(), z[l].begin() + R * n, act);
+                        break;
+                    case normalization::layer:
+                        for (size_t r = 0; r < R; r++)
+                            layernorm(z[l].data() + r * n, n, gamma[l].data(), beta[l].data(), act + r * n,
+                                      xhat[l].data() + r * n, &rstd[l][r]);
+                        break;
+                    case normalization::batch:
+                        batchnorm(z[l].data(), R, n, n, gamma[l].data(), beta[l].data(), act, xhat[l].data(),
+                                  bmean.data(), bvar.data(), rstd[l].data());
+                        for (unsigned int j = 0; j < n; j++) {
+                            mean[l][j] += momentum * (bmean[j] - mean[l][j]);
+                            if (R > 1) var[l][j] += momentum * (bvar[j] * R / (R - 1) - var[l][j]);
+                        }
+                        break;
+                    case normalization::folded:
+                        for (size_t r = 0; r < R; r++) {
+                            for (unsigned int j = 0; j < n; j++) act[r * n + j] = z[l][r * n + j] + beta[l][j];
+                        }
+                        break;
+                }
+                for (size_t i = 0; i < R * n; i++) act[i] = sigmoid(act[i]);
+            }
+            layerBatch(rowsOf(oweights), out, a[hidden - 1].data(), n, R, n, output.data(), out, false);
+
+            // output layer: error, its gradient and the error reaching the top hidden layer
+            std::fill(delta.begin(), delta.begin() + R * n, 0.0);
+            for (size_t r = 0; r < R; r++) {
+                const double* top = a[hidden - 1].data() + r * n;
+                double* d = delta.data() + r * n;
+                for (unsigned int i = 0; i < out; i++) {
+                    const double err = output[r * out + i] - t[s + r][i];
+                    total += err * err / out;
+                    const double* w = oweights[i].data();
+                    double* g = goweights[i].data();
+                    for (unsigned int j = 0; j < n; j++) {
+                        g[j] += err * top[j];
+                        d[j] += err * w[j];
+                    }
+                }
+            }
+            // hidden layers, top down: sigmoid, normalisation, weights
+            for (unsigned int l = hidden; l-- > 0;) {
+                const double* act = a[l].data();
+                for (size_t i = 0; i < R * n; i++) delta[i] *= act[i] * (1.0 - act[i]);
+                switch (normalize) {
+                    case normalization::none:
+                        break;
+                    case normalization::layer:
+                        for (size_t r = 0; r < R; r++)
+                            layernormback(delta.data() + r * n, xhat[l].data() + r * n, n, rstd[l][r], gamma[l].data(),
+                                          delta.data() + r * n, dgamma[l].data(), dbeta[l].data());
+                        break;
+                    case normalization::batch:
+                        batchnormback(delta.data(), xhat[l].data(), R, n, n, rstd[l].data(), gamma[l].data(),
+                                      delta.data(), dgamma[l].data(), dbeta[l].data());
+                        break;
+                    case normalization::folded:
+                        for (size_t r = 0; r < R; r++) {
+                            for (unsigned int j = 0; j < n; j++) dbeta[l][j] += delta[r * n + j];
+                        }
+                        break;
+                }
+                const double* prev = l == 0 ? input.data() : a[l - 1].data();
+                const unsigned int k = l == 0 ? in : n;
+                matrix& w = l == 0 ? iweights : weights[l - 1];
+                matrix& g = l == 0 ? giweights : gweights[l - 1];
+                if (l > 0) std::fill(below.begin(), below.begin() + R * n, 0.0);
+                for (size_t r = 0; r < R; r++) {
+                    const double* p = prev + r * k;
+                    double* b = below.data() + r * n;
+                    for (unsigned int j = 0; j < n; j++) {
+                        const double d = delta[r * n + j];
+                        if (d == 0.0) continue;
+                        double* gj = g[j].data();
+                        for (unsigned int c = 0; c < k; c++) gj[c] += d * p[c];
+                        if (l > 0) {
+                            const double* wj = w[j].data();
+                            for (unsigned int c = 0; c < n; c++) b[c] += d * wj[c];
+                        }
+                    }
+                }
+                if (l > 0) std::swap(delta, below);
+            }
+
+            // step with the batch mean of the gradients
+            const double rate = learning / R;
+            auto descend = [rate](matrix& w, const matrix& g) {
+                for (size_t i = 0; i < w.size(); i++) {
+                    for (size_t j = 0; j < w[i].size(); j++) w[i][j] -= rate * g[i][j];
+                }
+            };
+            descend(iweights, giweights);
+            for (unsigned int l = 1; l < hidden; l++) descend(weights[l - 1], gweights[l - 1]);
+            descend(oweights, goweights);
+            if (normalize == normalization::layer || normalize == normalization::batch) descend(gamma, dgamma);
+            if (normalize != normalization::none) descend(beta, dbeta);
+            zero(giweights);
+            for (auto& m : gweights) zero(m);
+            zero(goweights);
+            zero(dgamma);
+            zero(dbeta);
+        }
+        mse = x.empty() ? 0.0 : total / x.size();
+        std::cout << "Epoch " << e + 1 << " Average MSE: " << mse << std::endl;
+    }
+    return mse;
+}
@@ -38,6 +38,43 @@ mlp::mlp(unsigned int in, unsigned int out, unsigned int epochs, double learning
 }
 
 
+/**
+ * @brief Constructor with explicit depth and width, for inputs too wide for
+ * the default in + out layers of in * out neurons (sparse features).
+ * @param in number of inputs
+ * @param out number of outputs
+ * @param layers number of layers (layers - 1 hidden layers)
+ * @param neurons number of neurons in each hidden layer
+ * @param epochs number of epochs for training
+ * @param learning learning rate for the network
+ * @throws std::invalid_argument if layers < 2 or neurons == 0
+ */
+mlp::mlp(unsigned int in, unsigned int out, unsigned int layers, unsigned int neurons,
+         unsigned int epochs, double learning)
+{
+    if(layers < 2 || neurons == 0)
+        throw std::invalid_argument("-_-MLP NEEDS AT LEAST ONE HIDDEN LAYER OF ONE NEURON-_-");
+    this->in = in;
+    this->out = out;
+    this->layers = layers;
+    this->neurons = neurons;
+    this->epochs = epochs;
+    this->learning = learning;
+    input.resize(in, 0.0);
+    output.resize(out, 0.0);
+    expected.resize(out, 0.0);
+    iweights.resize(neurons, std::vector<double>(in, 0.0));
+    oweights.resize(out, std::vector<double>(neurons, 0.0));
+    weights.resize(layers - 1, std::vector<std::vector<double>>(neurons, std::vector<double>(neurons, 0.0)));
+    hlayers.resize(layers, std::vector<double>(neurons, 0.0));
+    activations.resize(layers, std::vector<double>(neurons, 0.0));
+    giweights.resize(neurons, std::vector<double>(in, 0.0));
+    goweights.resize(out, std::vector<double>(neurons, 0.0));
+    gweights.resize(layers - 1, std::vector<std::vector<double>>(neurons, std::vector<double>(neurons, 0.0)));
+    initializeWeights();
+}
+
+
 /**
  * @brief Constructor for the mlp class. This constructor initializes the
  * multi-layer perceptron with the given parameters and sets the input,
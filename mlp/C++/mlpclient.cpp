@@ -0,0 +1,69 @@
+
+// mlpclient.cpp: load generator for mlpserve
+//
+// usage: mlpclient --socket path [--requests n] [--concurrency c]
+// Opens c connections, each sending n / c random requests back to back,
+// then prints the client-side latency quantiles, the throughput and the
+// server's own statistics.
+
+#include "include/serve.hpp"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> opt = {
+        {"socket", "/tmp/mlp.sock"}, {"requests", "10000"}, {"concurrency", "8"}
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        if (key.rfind("--", 0) != 0 || opt.find(key.substr(2)) == opt.end()) {
+            std::cerr << "mlpclient: unknown option " << key << std::endl;
+            return 1;
+        }
+        opt[key.substr(2)] = argv[i + 1];
+    }
+    const unsigned long requests = std::stoul(opt["requests"]);
+    const unsigned long concurrency = std::max(1ul, std::stoul(opt["concurrency"]));
+
+    try {
+        latency lat;
+        std::atomic<uint64_t> failed{0};
+        std::vector<std::thread> threads;
+        auto t0 = std::chrono::steady_clock::now();
+        for (unsigned long c = 0; c < concurrency; c++) {
+            threads.emplace_back([&, c] {
+                client conn(opt["socket"]);
+                std::mt19937 gen(c);
+                std::normal_distribution<double> dis(0.0, 1.0);
+                std::vector<double> x(conn.in);
+                for (unsigned long i = c; i < requests; i += concurrency) {
+                    for (double& v : x) v = dis(gen);
+                    auto s = std::chrono::steady_clock::now();
+                    try {
+                        conn.infer(x);
+                    }
+                    catch (const std::exception&) {
+                        failed++;
+                        continue;
+                    }
+                    lat.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s).count());
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "mlpclient: " << requests << " requests, " << failed << " failed, "
+                  << requests / secs << "/s, latency us p50 " << lat.quantile(0.5) / 1e3
+                  << " p99 " << lat.quantile(0.99) / 1e3 << " p99.9 " << lat.quantile(0.999) / 1e3 << std::endl;
+        client conn(opt["socket"]);
+        std::cout << "mlpserve: " << conn.stats() << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "mlpclient: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// mlphogwild.cpp: Hogwild against synchronous mini-batch SGD on sparse data
+//
+// usage: mlphogwild [--in n] [--nnz n] [--out n] [--layers n] [--neurons n]
+//                   [--samples n] [--epochs n] [--threads n] [--batch n]
+//                   [--learning x] [--seed n]
+// Builds a synthetic sparse regression set (nnz random features of in per
+// sample), then trains two identical models for the same number of epochs:
+// one with mlp::hogwild and one with synchronous mini-batches, where every
+// thread accumulates the gradient of its share of the batch in its own
+// worker and a barrier applies them as one step. After every epoch it
+// prints the held-out MSE against the cumulative training time, i.e.
+// convergence per wall-clock second.
+
+#include "include/mlp.hpp"
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+
+using clockwork = std::chrono::steady_clock;
+
+/**
+ * @brief mean squared error of the model on a sparse set
+ */
+static double evaluate(const mlp& net, const std::vector<sparsevec>& x, const std::vector<std::vector<double>>& t) {
+    worker w(net);
+    w.training = false;
+    double loss = 0.0;
+    for (size_t i = 0; i < x.size(); i++) {
+        net.forward(w, x[i]);
+        for (unsigned int j = 0; j < net.out; j++) loss += (w.output[j] - t[i][j]) * (w.output[j] - t[i][j]);
+    }
+    return x.empty() ? 0.0 : loss / (x.size() * net.out);
+}
+
+/**
+ * @brief One epoch of synchronous mini-batch SGD: threads persistent
+ * threads split every batch, and the barrier's completion step applies the
+ * workers' gradients averaged over the batch.
+ */
+static void synchronous(mlp& net, std::vector<worker>& workers, const std::vector<sparsevec>& x,
+                        const std::vector<std::vector<double>>& t, const std::vector<size_t>& order, unsigned int batch) {
+    const unsigned int threads = workers.size();
+    const size_t steps = (order.size() + batch - 1) / batch;
+    std::barrier sync(threads, [&]() noexcept { net.update(workers); });
+    auto run = [&](unsigned int id) {
+        worker& w = workers[id];
+        for (size_t s = 0; s < steps; s++) {
+            const size_t end = std::min(order.size(), (s + 1) * batch);
+            for (size_t i = s * batch + id; i < end; i += threads) {
+                w.expected = t[order[i]];
+                net.forward(w, x[order[i]]);
+                net.backward(w);
+            }
+            sync.arrive_and_wait();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned int id = 1; id < threads; id++) pool.emplace_back(run, id);
+    run(0);
+    for (std::thread& th : pool) th.join();
+}
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> opt = {
+        {"in", "10000"}, {"nnz", "20"}, {"out", "1"}, {"layers", "3"}, {"neurons", "32"},
+        {"samples", "20000"}, {"epochs", "10"}, {"threads", "4"}, {"batch", "32"},
+        {"learning", "0.05"}, {"seed", "1"}
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        if (key.rfind("--", 0) != 0 || opt.find(key.substr(2)) == opt.end()) {
+            std::cerr << "mlphogwild: unknown option " << key << std::endl;
+            return 1;
+        }
+        opt[key.substr(2)] = argv[i + 1];
+    }
+
+    try {
+        const unsigned int in = std::stoul(opt["in"]), nnz = std::stoul(opt["nnz"]), out = std::stoul(opt["out"]);
+        const unsigned int epochs = std::stoul(opt["epochs"]), threads = std::max(1ul, std::stoul(opt["threads"]));
+        const unsigned int batch = std::max(1ul, std::stoul(opt["batch"]));
+        const size_t samples = std::stoul(opt["samples"]), held = samples / 5;
+
+        // a sparse linear teacher squashed by tanh; every feature has its own weight
+        std::mt19937 gen(std::stoul(opt["seed"]));
+        std::uniform_int_distribution<unsigned int> feature(0, in - 1);
+        std::normal_distribution<double> g(0.0, 1.0);
+        std::vector<std::vector<double>> teacher(out, std::vector<double>(in));
+        for (auto& row : teacher) for (auto& v : row) v = g(gen);
+        std::vector<sparsevec> x(samples + held);
+        std::vector<std::vector<double>> t(samples + held, std::vector<double>(out));
+        for (size_t i = 0; i < x.size(); i++) {
+            for (unsigned int k = 0; k < nnz; k++) x[i].index.push_back(feature(gen));
+            std::sort(x[i].index.begin(), x[i].index.end());
+            x[i].index.erase(std::unique(x[i].index.begin(), x[i].index.end()), x[i].index.end());
+            for (size_t k = 0; k < x[i].index.size(); k++) x[i].value.push_back(1.0);
+            for (unsigned int j = 0; j < out; j++) {
+                double s = 0.0;
+                for (unsigned int k : x[i].index) s += teacher[j][k];
+                t[i][j] = std::tanh(s / std::sqrt((double)nnz));
+            }
+        }
+        std::vector<sparsevec> vx(x.begin() + samples, x.end());
+        std::vector<std::vector<double>> vt(t.begin() + samples, t.end());
+        x.resize(samples);
+        t.resize(samples);
+
+        // N(0, 1 / fan-in) weights, the same for both runs
+        mlp hog(in, out, std::stoul(opt["layers"]), std::stoul(opt["neurons"]), 1, std::stod(opt["learning"]));
+        for (auto& row : hog.iweights) for (auto& v : row) v = g(gen) / std::sqrt((double)nnz);
+        for (auto& m : hog.weights) for (auto& row : m) for (auto& v : row) v = g(gen) / std::sqrt((double)hog.neurons);
+        for (auto& row : hog.oweights) for (auto& v : row) v = g(gen) / std::sqrt((double)hog.neurons);
+        mlp syn = hog;
+
+        std::cout << "mlphogwild: " << samples << " samples, " << in << " features (" << nnz << " nonzero), "
+                  << hog.layers - 1 << "x" << hog.neurons << " hidden, " << threads << " threads, "
+                  << std::thread::hardware_concurrency() << " cores" << std::endl;
+        std::cout << "epoch  hogwild s  hogwild mse  sync(batch " << batch << ") s  sync mse" << std::endl;
+
+        std::vector<worker> workers;
+        for (unsigned int id = 0; id < threads; id++) workers.emplace_back(syn, id);
+        std::vector<size_t> order(samples);
+        std::iota(order.begin(), order.end(), 0);
+        double hogtime = 0.0, syntime = 0.0;
+        for (unsigned int e = 0; e < epochs; e++) {
+            // hogwild() shuffles with a fixed seed; permuting the set first
+            // gives it a new order every epoch
+            std::shuffle(order.begin(), order.end(), gen);
+            std::vector<sparsevec> ex(samples);
+            std::vector<std::vector<double>> et(samples);
+            for (size_t i = 0; i < samples; i++) {
+                ex[i] = x[order[i]];
+                et[i] = t[order[i]];
+            }
+            auto t0 = clockwork::now();
+            hog.hogwild(ex, et, threads);
+            hogtime += std::chrono::duration<double>(clockwork::now() - t0).count();
+
+            t0 = clockwork::now();
+            synchronous(syn, workers, x, t, order, batch);
+            syntime += std::chrono::duration<double>(clockwork::now() - t0).count();
+
+            std::cout << e + 1 << "  " << hogtime << "  " << evaluate(hog, vx, vt) << "  "
+                      << syntime << "  " << evaluate(syn, vx, vt) << std::endl;
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "mlphogwild: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,69 @@
+
+// mlpserve.cpp: batching inference daemon for a saved mlp
+//
+// usage: mlpserve --model file --socket path [--max-batch n] [--max-wait us]
+//                 [--threads n] [--report seconds] [--watch ms]
+// Runs until SIGINT or SIGTERM, printing the serving statistics every
+// --report seconds (0 = only at exit). The model file is mapped; with
+// --watch it is polled every ms milliseconds and a replaced file (e.g. by
+// mlp::save() in a training process) is hot-swapped without a restart.
+
+#include "include/serve.hpp"
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <string>
+
+static volatile std::sig_atomic_t quit = 0;
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> opt = {
+        {"model", ""}, {"socket", "/tmp/mlp.sock"}, {"max-batch", "32"}, {"max-wait", "200"},
+        {"threads", "1"}, {"report", "10"}, {"watch", "0"}
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        if (key.rfind("--", 0) != 0 || opt.find(key.substr(2)) == opt.end()) {
+            std::cerr << "mlpserve: unknown option " << key << std::endl;
+            return 1;
+        }
+        opt[key.substr(2)] = argv[i + 1];
+    }
+    if (opt["model"].empty()) {
+        std::cerr << "mlpserve: --model is required" << std::endl;
+        return 1;
+    }
+
+    try {
+        registry models;
+        models.load(opt["model"]);
+        if (std::stoul(opt["watch"]) > 0) models.watch(opt["model"], std::chrono::milliseconds(std::stoul(opt["watch"])));
+        batcher queue(models, std::stoul(opt["max-batch"]), std::stoul(opt["max-wait"]), std::stoul(opt["threads"]));
+        server front(queue, opt["socket"]);
+        front.start();
+        std::signal(SIGINT, [](int) { quit = 1; });
+        std::signal(SIGTERM, [](int) { quit = 1; });
+        {
+            registry::reader guard(models);
+            const snapshot* net = guard.pin();
+            std::cout << "mlpserve: " << net->header.in << " -> " << net->header.out << " model on " << opt["socket"] << std::endl;
+        }
+
+        const unsigned long report = std::stoul(opt["report"]) * 10;
+        for (unsigned long tick = 1; !quit; tick++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (report && tick % report == 0)
+                std::cout << "mlpserve: " << queue.stats.report() << " model version " << models.latest.load() << std::endl;
+        }
+        front.stop();
+        queue.stop();
+        models.stop();
+        std::cout << "mlpserve: " << queue.stats.report() << " model version " << models.latest.load()
+                  << " failed reloads " << models.failures.load() << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "mlpserve: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
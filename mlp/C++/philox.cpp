@@ -0,0 +1,181 @@
+// philox.cpp: Philox4x32-10 blocks, uniform and normal sampling
+#include "include/philox.hpp"
+#include <algorithm>
+#include <cmath>
+
+static constexpr uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;     // multipliers
+static constexpr uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;     // key schedule (golden ratio, sqrt 3 - 1)
+static constexpr unsigned int lanes = 16;                          // blocks generated together
+static constexpr double pi = 3.14159265358979323846;
+
+//----------------BLOCKS----------------//
+
+/**
+ * @brief Ten Philox rounds over lanes counters stored as four word arrays;
+ * the lanes are independent, so the loops vectorise (32 x 32 -> 64-bit
+ * multiplies).
+ */
+static void rounds(uint32_t* c0, uint32_t* c1, uint32_t* c2, uint32_t* c3, uint64_t seed) {
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (unsigned int r = 0; r < 10; r++) {
+        for (unsigned int i = 0; i < lanes; i++) {
+            const uint64_t p0 = (uint64_t)M0 * c0[i], p1 = (uint64_t)M1 * c2[i];
+            const uint32_t x1 = c1[i], x3 = c3[i];
+            c0[i] = (uint32_t)(p1 >> 32) ^ x1 ^ k0;
+            c1[i] = (uint32_t)p1;
+            c2[i] = (uint32_t)(p0 >> 32) ^ x3 ^ k1;
+            c3[i] = (uint32_t)p0;
+        }
+        k0 += W0;
+        k1 += W1;
+    }
+}
+
+/**
+ * @brief 53-bit uniform in [0, 1) from two words
+ */
+static inline double unit(uint32_t hi, uint32_t lo) {
+    return (double)((((uint64_t)hi << 32) | lo) >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Philox4x32-10 in place
+ * @param counter four counter words, replaced by the four output words
+ */
+void philox::block(uint32_t counter[4]) const {
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (unsigned int r = 0; r < 10; r++) {
+        const uint64_t p0 = (uint64_t)M0 * counter[0], p1 = (uint64_t)M1 * counter[2];
+        const uint32_t x1 = counter[1], x3 = counter[3];
+        counter[0] = (uint32_t)(p1 >> 32) ^ x1 ^ k0;
+        counter[1] = (uint32_t)p1;
+        counter[2] = (uint32_t)(p0 >> 32) ^ x3 ^ k1;
+        counter[3] = (uint32_t)p0;
+        k0 += W0;
+        k1 += W1;
+    }
+}
+
+//----------------SINGLE ELEMENTS----------------//
+
+/**
+ * @brief Uniform element of a stream
+ * @param stream stream (tensor) number
+ * @param index element number
+ * @return value in [0, 1)
+ */
+double philox::uniform(uint32_t stream, uint64_t index) const {
+    uint32_t c[4] = {(uint32_t)(index >> 1), (uint32_t)(index >> 33), stream, 0};
+    block(c);
+    return index & 1 ? unit(c[2], c[3]) : unit(c[0], c[1]);
+}
+
+/**
+ * @brief Standard normal element of a stream (Box-Muller over the block's
+ * two uniforms; the even element takes the cosine, the odd one the sine)
+ * @param stream stream (tensor) number
+ * @param index element number
+ * @return normal value
+ */
+double philox::normal(uint32_t stream, uint64_t index) const {
+    uint32_t c[4] = {(uint32_t)(index >> 1), (uint32_t)(index >> 33), stream, 0};
+    block(c);
+    const double r = std::sqrt(-2.0 * std::log1p(-unit(c[0], c[1])));
+    const double theta = 2.0 * pi * unit(c[2], c[3]);
+    return r * (index & 1 ? std::sin(theta) : std::cos(theta));
+}
+
+//----------------BULK----------------//
+
+/**
+ * @brief Run f(block, words) over every block covering elements
+ * first .. first + n - 1, lanes blocks at a time
+ */
+template<class F>
+static void blocks(uint64_t seed, uint32_t stream, uint64_t first, size_t n, F f) {
+    if (n == 0) return;
+    alignas(64) uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+    const uint64_t begin = first >> 1, end = ((first + n - 1) >> 1) + 1;
+    for (uint64_t b = begin; b < end; b += lanes) {
+        for (unsigned int i = 0; i < lanes; i++) {
+            c0[i] = (uint32_t)(b + i);
+            c1[i] = (uint32_t)((b + i) >> 32);
+            c2[i] = stream;
+            c3[i] = 0;
+        }
+        rounds(c0, c1, c2, c3, seed);
+        const unsigned int m = (unsigned int)std::min<uint64_t>(lanes, end - b);
+        for (unsigned int i = 0; i < m; i++) f(b + i, c0[i], c1[i], c2[i], c3[i]);
+    }
+}
+
+/**
+ * @brief Fill out with uniform elements first .. first + n - 1 of a stream;
+ * equal to calling uniform(stream, index) for each of them
+ * @param out n values in [0, 1)
+ * @param n number of values
+ * @param stream stream (tensor) number
+ * @param first index of out[0]
+ */
+void philox::uniform(double* out, size_t n, uint32_t stream, uint64_t first) const {
+    const uint64_t last = first + n;
+    blocks(seed, stream, first, n, [&](uint64_t b, uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3) {
+        const uint64_t e = 2 * b;
+        if (e >= first) out[e - first] = unit(w0, w1);
+        if (e + 1 < last) out[e + 1 - first] = unit(w2, w3);
+    });
+}
+
+/**
+ * @brief Fill out with normal elements first .. first + n - 1 of a stream;
+ * equal to mean + stddev * normal(stream, index) for each of them
+ * @param out n values
+ * @param n number of values
+ * @param stream stream (tensor) number
+ * @param first index of out[0]
+ * @param mean mean
+ * @param stddev standard deviation
+ */
+void philox::normal(double* out, size_t n, uint32_t stream, uint64_t first, double mean, double stddev) const {
+    const uint64_t last = first + n;
+    blocks(seed, stream, first, n, [&](uint64_t b, uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3) {
+        const uint64_t e = 2 * b;
+        const double r = std::sqrt(-2.0 * std::log1p(-unit(w0, w1)));
+        const double theta = 2.0 * pi * unit(w2, w3);
+        if (e >= first) out[e - first] = mean + stddev * (r * std::cos(theta));
+        if (e + 1 < last) out[e + 1 - first] = mean + stddev * (r * std::sin(theta));
+    });
+}
+
+/**
+ * @brief Fill mask words first .. first + words - 1 of a stream with
+ * independent Bernoulli(p) bits: one round of lanes = 16 blocks yields the
+ * 64 32-bit words of one mask word, each compared with p * 2^32
+ * @param mask words mask words
+ * @param words number of 64-bit words
+ * @param stream stream number
+ * @param first index of mask[0]
+ * @param p probability of a set bit
+ */
+void philox::bernoulli(uint64_t* mask, size_t words, uint32_t stream, uint64_t first, double p) const {
+    static_assert(lanes * 4 == 64, "one round of blocks per mask word");
+    const uint64_t threshold = p <= 0.0 ? 0 : p >= 1.0 ? (uint64_t)1 << 32 : (uint64_t)std::ldexp(p, 32);
+    alignas(64) uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+    for (size_t w = 0; w < words; w++) {
+        const uint64_t b = (first + w) * lanes;
+        for (unsigned int i = 0; i < lanes; i++) {
+            c0[i] = (uint32_t)(b + i);
+            c1[i] = (uint32_t)((b + i) >> 32);
+            c2[i] = stream;
+            c3[i] = 0;
+        }
+        rounds(c0, c1, c2, c3, seed);
+        uint64_t bits = 0;
+        for (unsigned int i = 0; i < lanes; i++) {
+            const uint64_t m = (uint64_t)(c0[i] < threshold) | (uint64_t)(c1[i] < threshold) << 1 |
+                               (uint64_t)(c2[i] < threshold) << 2 | (uint64_t)(c3[i] < threshold) << 3;
+            bits |= m << (4 * i);
+        }
+        mask[w] = bits;
+    }
+}
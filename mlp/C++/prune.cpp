@@ -0,0 +1,257 @@
+// prune.cpp: magnitude pruning (unstructured, block and neuron level) for mlp
+#include "include/prune.hpp"
+#include "include/mlp.hpp"
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+typedef std::vector<std::vector<double>> matrix;
+
+/**
+ * @brief every weight matrix of the model in order: iweights, weights[l], oweights
+ */
+static std::vector<matrix*> matrices(mlp& net) {
+    std::vector<matrix*> m;
+    m.push_back(&net.iweights);
+    for (auto& w : net.weights) m.push_back(&w);
+    m.push_back(&net.oweights);
+    return m;
+}
+
+//----------------PRUNER----------------//
+
+pruner::pruner(double target, unsigned int begin, unsigned int end, unsigned int frequency,
+               double initial, unsigned int br, unsigned int bc)
+    : initial(initial), target(target), begin(begin), end(end), frequency(frequency), br(br), bc(bc)
+{
+    if (target < 0.0 || target >= 1.0 || initial < 0.0 || initial > target)
+        throw std::invalid_argument("-_-SPARSITY MUST SATISFY 0 <= INITIAL <= TARGET < 1-_-");
+    if (end < begin || frequency == 0 || br == 0 || bc == 0)
+        throw std::invalid_argument("-_-INVALID PRUNING SCHEDULE-_-");
+}
+
+/**
+ * @brief cubic sparsity schedule
+ * @param step training step (epoch)
+ * @return sparsity to reach at that step
+ */
+double pruner::sparsity(unsigned int step) const {
+    if (end == begin) return step >= begin ? target : 0.0;
+    if (step < begin) return 0.0;
+    double t = std::min(1.0, (double)(step - begin) / (double)(end - begin));
+    return target + (initial - target) * (1.0 - t) * (1.0 - t) * (1.0 - t);
+}
+
+/**
+ * @brief Recompute the masks if a pruning step is due (begin, begin +
+ * frequency, ... up to end): in every matrix the groups with the smallest
+ * L2 norm are masked until the scheduled fraction is reached, then the
+ * masked weights are zeroed. Groups that were masked before have norm zero,
+ * so the masks only grow.
+ * @param net model to prune
+ * @param step training step (epoch)
+ * @return true if the masks were updated
+ */
+bool pruner::update(mlp& net, unsigned int step) {
+    if (step < begin || step > end || (step - begin) % frequency != 0)
+        return false;
+    std::vector<matrix*> m = matrices(net);
+    mask.resize(m.size());
+    double s = sparsity(step);
+    std::vector<double> score;
+    std::vector<size_t> order;
+    for (size_t i = 0; i < m.size(); i++) {
+        const matrix& w = *m[i];
+        size_t rows = w.size(), cols = rows ? w[0].size() : 0;
+        if (mask[i].size() != rows)
+            mask[i].assign(rows, std::vector<uint8_t>(cols, 1));
+        size_t nbr = (rows + br - 1) / br, nbc = (cols + bc - 1) / bc;
+        // squared L2 norm of each block of surviving weights
+        score.assign(nbr * nbc, 0.0);
+        for (size_t r = 0; r < rows; r++) {
+            for (size_t c = 0; c < cols; c++) {
+                double v = mask[i][r][c] ? w[r][c] : 0.0;
+                score[(r / br) * nbc + c / bc] += v * v;
+            }
+        }
+        size_t drop = (size_t)std::floor(s * (double)score.size());
+        if (drop == 0) continue;
+        order.resize(score.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::nth_element(order.begin(), order.begin() + (drop - 1), order.end(),
+                         [&score](size_t a, size_t b) { return score[a] < score[b]; });
+        for (size_t k = 0; k < drop; k++) {
+            size_t rb = order[k] / nbc, cb = order[k] % nbc;
+            for (size_t r = rb * br; r < std::min(rows, (rb + 1) * br); r++) {
+                for (size_t c = cb * bc; c < std::min(cols, (cb + 1) * bc); c++) {
+                    mask[i][r][c] = 0;
+                }
+            }
+        }
+    }
+    apply(net);
+    return true;
+}
+
+/**
+ * @brief Zero the masked weights. Called after every weight update while
+ * fine-tuning so that pruned weights stay pruned.
+ * @param net pruned model
+ * @throws std::runtime_error if the model no longer matches the masks
+ */
+void pruner::apply(mlp& net) const {
+    std::vector<matrix*> m = matrices(net);
+    if (mask.empty()) return;
+    if (mask.size() != m.size())
+        throw std::runtime_error("-_-PRUNING MASKS DO NOT MATCH THE MODEL-_-");
+    for (size_t i = 0; i < m.size(); i++) {
+        matrix& w = *m[i];
+        if (mask[i].size() != w.size())
+            throw std::runtime_error("-_-PRUNING MASKS DO NOT MATCH THE MODEL-_-");
+        for (size_t r = 0; r < w.size(); r++) {
+            for (size_t c = 0; c < w[r].size(); c++) {
+                if (!mask[i][r][c]) w[r][c] = 0.0;
+            }
+        }
+    }
+}
+
+//----------------PRUNING----------------//
+
+/**
+ * @brief One-shot magnitude pruning of every weight matrix
+ * @param net model to prune
+ * @param sparsity fraction of groups removed from each matrix
+ * @param br block rows (1 for unstructured pruning)
+ * @param bc block columns (1 for unstructured pruning)
+ */
+void prune(mlp& net, double sparsity, unsigned int br, unsigned int bc) {
+    pruner p(sparsity, 0, 0, 1, sparsity, br, bc);
+    p.update(net, 0);
+}
+
+/**
+ * @brief Gradual pruning with fine-tuning. Each epoch first lets the pruner
+ * update its masks (following its schedule), then trains on every sample and
+ * reapplies the masks after each weight update.
+ * @param net model to prune
+ * @param p pruning schedule and masks
+ * @param inputs training samples
+ * @param epochs number of passes over the samples
+ */
+void finetune(mlp& net, pruner& p, const std::vector<std::vector<double>>& inputs, unsigned int epochs) {
+    for (unsigned int e = 0; e < epochs; e++) {
+        p.update(net, e);
+        double total_mse = 0.0;
+        for (const auto& single_input : inputs) {
+            net.loadInput(single_input);
+            net.forward();
+            total_mse += MSE(net.output, net.expected);
+            net.backward();
+            p.apply(net);
+        }
+        total_mse /= inputs.size();
+        net.mse = total_mse;
+        std::cout << "Epoch " << e + 1 << " Sparsity: " << p.sparsity(e) << " Average MSE: " << total_mse << std::endl;
+    }
+}
+
+/**
+ * @brief Structured pruning: keep the strongest neurons of every hidden layer
+ * and physically remove the rest, so all dense kernels run on smaller
+ * matrices. A neuron is scored by the product of the L2 norms of its incoming
+ * row and its outgoing column; each layer keeps its own top neurons and the
+ * surviving rows and columns of every matrix are compacted in order, as
+ * are the normalisation parameters and statistics of a normalised model.
+ * Gradients and activation buffers are resized to match. Fine-tune afterwards
+ * with train().
+ * @param net model to shrink
+ * @param keep neurons kept in each hidden layer
+ * @return the new number of neurons
+ * @throws std::invalid_argument if keep is zero or larger than the layer
+ */
+unsigned int shrink(mlp& net, unsigned int keep) {
+    if (keep == 0 || keep > net.neurons)
+        throw std::invalid_argument("-_-NEURONS KEPT MUST BE IN [1, NEURONS]-_-");
+    if (keep == net.neurons) return keep;
+    const unsigned int n = net.neurons;
+    const unsigned int hidden = net.layers - 1;
+    // hidden layer l is fed by in(l) and read by out(l)
+    auto in = [&net](unsigned int l) -> const matrix& { return l == 0 ? net.iweights : net.weights[l - 1]; };
+    auto out = [&net, hidden](unsigned int l) -> const matrix& { return l + 1 == hidden ? net.oweights : net.weights[l]; };
+
+    std::vector<std::vector<unsigned int>> kept(hidden);
+    std::vector<double> score(n);
+    for (unsigned int l = 0; l < hidden; l++) {
+        const matrix& wi = in(l);
+        const matrix& wo = out(l);
+        for (unsigned int j = 0; j < n; j++) {
+            double si = 0.0, so = 0.0;
+            for (double v : wi[j]) si += v * v;
+            for (const auto& row : wo) so += row[j] * row[j];
+            score[j] = std::sqrt(si * so);
+        }
+        std::vector<unsigned int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::nth_element(order.begin(), order.begin() + (keep - 1), order.end(),
+                         [&score](unsigned int a, unsigned int b) { return score[a] > score[b]; });
+        order.resize(keep);
+        std::sort(order.begin(), order.end());
+        kept[l] = order;
+    }
+
+    // compact rows (neurons of layer l) and columns (neurons of layer l - 1)
+    auto compact = [](const matrix& w, const std::vector<unsigned int>* rows, const std::vector<unsigned int>* cols) {
+        size_t nr = rows ? rows->size() : w.size();
+        size_t nc = cols ? cols->size() : w[0].size();
+        matrix m(nr, std::vector<double>(nc));
+        for (size_t r = 0; r < nr; r++) {
+            const std::vector<double>& src = w[rows ? (*rows)[r] : r];
+            for (size_t c = 0; c < nc; c++) m[r][c] = src[cols ? (*cols)[c] : c];
+        }
+        return m;
+    };
+    net.iweights = compact(net.iweights, &kept[0], nullptr);
+    for (unsigned int l = 1; l < hidden; l++)
+        net.weights[l - 1] = compact(net.weights[l - 1], &kept[l], &kept[l - 1]);
+    net.oweights = compact(net.oweights, nullptr, &kept[hidden - 1]);
+    // matrices past the last hidden layer are not used by forward(); keep their shape consistent
+    std::vector<unsigned int> first(keep);
+    std::iota(first.begin(), first.end(), 0);
+    for (size_t l = hidden - 1; l < net.weights.size(); l++)
+        net.weights[l] = compact(net.weights[l], &first, &first);
+    // per-neuron normalisation state follows its neuron
+    for (auto* m : {&net.gamma, &net.beta, &net.mean, &net.var}) {
+        for (unsigned int l = 0; l < m->size() && l < hidden; l++) {
+            std::vector<double> v(keep);
+            for (unsigned int j = 0; j < keep; j++) v[j] = (*m)[l][kept[l][j]];
+            (*m)[l] = std::move(v);
+        }
+    }
+
+    net.neurons = keep;
+    for (auto& h : net.hlayers) h.assign(keep, 0.0);
+    for (auto& a : net.activations) a.assign(keep, 0.0);
+    net.giweights.assign(keep, std::vector<double>(net.in, 0.0));
+    net.goweights.assign(net.out, std::vector<double>(keep, 0.0));
+    for (auto& g : net.gweights) g.assign(keep, std::vector<double>(keep, 0.0));
+    return keep;
+}
+
+/**
+ * @brief fraction of exactly zero weights over all matrices of the model
+ */
+double sparsity(const mlp& net) {
+    size_t zeros = 0, total = 0;
+    auto count = [&zeros, &total](const matrix& w) {
+        for (const auto& row : w) {
+            for (double v : row) { zeros += (v == 0.0); total++; }
+        }
+    };
+    count(net.iweights);
+    for (const auto& w : net.weights) count(w);
+    count(net.oweights);
+    return total ? (double)zeros / (double)total : 0.0;
+}
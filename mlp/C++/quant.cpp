@@ -0,0 +1,325 @@
+// quant.cpp: post-training int8 quantization and integer inference for mlp
+#include "include/quant.hpp"
+#include "include/mlp.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+//----------------KERNELS----------------//
+
+#if defined(__AVX2__)
+/**
+ * @brief horizontal sum of eight int32 lanes
+ */
+static inline int32_t hsum(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+#endif
+
+/**
+ * @brief uint8 x int8 -> int32 dot product. With AVX-512 VNNI (or AVX-VNNI)
+ * vpdpbusd multiplies and accumulates four byte pairs per lane in one
+ * instruction. The plain AVX2 path widens both operands to int16 and uses
+ * vpmaddwd instead of vpmaddubsw: the latter adds two 255 * 127 products into
+ * a saturating int16, which clips as soon as activations and weights are
+ * both near full range.
+ * @param a uint8 activations
+ * @param w int8 weights
+ * @param n length, a multiple of 32
+ * @return exact int32 dot product
+ */
+int32_t qdot(const uint8_t* a, const int8_t* w, size_t n) {
+#if (defined(__AVX512VNNI__) && defined(__AVX512VL__)) || defined(__AVXVNNI__)
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i w0 = _mm256_loadu_si256((const __m256i*)(w + i));
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 32));
+        __m256i w1 = _mm256_loadu_si256((const __m256i*)(w + i + 32));
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+        acc0 = _mm256_dpbusd_epi32(acc0, a0, w0);
+        acc1 = _mm256_dpbusd_epi32(acc1, a1, w1);
+#else
+        acc0 = _mm256_dpbusd_avx_epi32(acc0, a0, w0);
+        acc1 = _mm256_dpbusd_avx_epi32(acc1, a1, w1);
+#endif
+    }
+    for (; i < n; i += 32) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i w0 = _mm256_loadu_si256((const __m256i*)(w + i));
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+        acc0 = _mm256_dpbusd_epi32(acc0, a0, w0);
+#else
+        acc0 = _mm256_dpbusd_avx_epi32(acc0, a0, w0);
+#endif
+    }
+    return hsum(_mm256_add_epi32(acc0, acc1));
+#elif defined(__AVX2__)
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    for (size_t i = 0; i < n; i += 32) {
+        __m256i a0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m256i w0 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + i)));
+        __m256i a1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i + 16)));
+        __m256i w1 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + i + 16)));
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(a0, w0));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(a1, w1));
+    }
+    return hsum(_mm256_add_epi32(acc0, acc1));
+#else
+    int32_t acc[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < n; i += 4) {
+        acc[0] += (int32_t)a[i] * w[i];
+        acc[1] += (int32_t)a[i + 1] * w[i + 1];
+        acc[2] += (int32_t)a[i + 2] * w[i + 2];
+        acc[3] += (int32_t)a[i + 3] * w[i + 3];
+    }
+    return acc[0] + acc[1] + acc[2] + acc[3];
+#endif
+}
+
+/**
+ * @brief name of the dot kernel selected at compile time
+ */
+const char* qkernel() {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return "avx512-vnni";
+#elif defined(__AVXVNNI__)
+    return "avx-vnni";
+#elif defined(__AVX2__)
+    return "avx2";
+#else
+    return "scalar";
+#endif
+}
+
+//----------------CALIBRATION----------------//
+
+/**
+ * @brief running range of one channel over the calibration set
+ */
+struct qrange {
+    double lo = INFINITY;
+    double hi = -INFINITY;
+    void push(double x) { lo = std::min(lo, x); hi = std::max(hi, x); }
+};
+
+/**
+ * @brief affine uint8 code x = s * (q - z) covering [lo, hi]. Very narrow
+ * ranges are widened so that the zero point and the per-row corrections stay
+ * well inside their integer types.
+ * @param r observed range
+ * @param s (out) scale
+ * @param z (out) zero point
+ */
+static void affine(const qrange& r, double& s, int32_t& z) {
+    double lo = r.lo, hi = r.hi;
+    double width = std::max(1e-6, 1e-3 * std::max(std::fabs(lo), std::fabs(hi)));
+    if (hi - lo < width) {
+        double mid = 0.5 * (lo + hi);
+        lo = mid - 0.5 * width;
+        hi = mid + 0.5 * width;
+    }
+    s = (hi - lo) / 255.0;
+    z = (int32_t)std::lrint(-lo / s);
+}
+
+/**
+ * @brief quantize one weight matrix whose input channels use the codes
+ * (s, z): the scales are folded into the columns, then each row gets its own
+ * symmetric int8 scale and the zero points collapse into one int64 per row.
+ * @param m weight matrix, rows x cols
+ * @param s input scales
+ * @param z input zero points
+ * @return quantized layer (without output requantization)
+ */
+static qlayer quantize(const std::vector<std::vector<double>>& m,
+                       const std::vector<double>& s, const std::vector<int32_t>& z) {
+    qlayer q;
+    q.rows = m.size();
+    q.cols = s.size();
+    q.ld = (q.cols + 31) / 32 * 32;
+    q.w.assign((size_t)q.rows * q.ld, 0);
+    q.scale.resize(q.rows);
+    q.zero.resize(q.rows);
+    std::vector<double> folded(q.cols);
+    for (unsigned int r = 0; r < q.rows; r++) {
+        if (m[r].size() < q.cols)
+            throw std::runtime_error("-_-WEIGHT MATRIX SMALLER THAN ITS LAYER-_-");
+        double amax = 0.0;
+        for (unsigned int c = 0; c < q.cols; c++) {
+            folded[c] = m[r][c] * s[c];
+            amax = std::max(amax, std::fabs(folded[c]));
+        }
+        double sw = amax > 0.0 ? amax / 127.0 : 1.0;
+        int8_t* row = q.w.data() + (size_t)r * q.ld;
+        int64_t zero = 0;
+        for (unsigned int c = 0; c < q.cols; c++) {
+            long v = std::lrint(folded[c] / sw);
+            row[c] = (int8_t)std::clamp(v, -127L, 127L);
+            zero += (int64_t)row[c] * z[c];
+        }
+        q.scale[r] = (float)sw;
+        q.zero[r] = zero;
+    }
+    return q;
+}
+
+/**
+ * @brief Quantize a trained mlp. The double network is run once over the
+ * calibration samples (after the model's input normalisation) to record the
+ * range of every input feature and hidden neuron; these ranges set the
+ * per-channel activation codes, and the weights are quantized per row.
+ * @param net trained model
+ * @param calibration representative raw input samples
+ * @throws std::runtime_error if the calibration set is empty, a sample has the wrong size or the model is normalised
+ */
+qmlp::qmlp(const mlp& net, const std::vector<std::vector<double>>& calibration)
+    : in(net.in), out(net.out), norm(net.norm)
+{
+    if (calibration.empty())
+        throw std::runtime_error("-_-CALIBRATION SET IS EMPTY-_-");
+    if (net.normalize != normalization::none)
+        throw std::runtime_error("-_-NORMALISED MLP CANNOT BE QUANTIZED-_-");
+    const unsigned int hidden = net.layers - 1;        // sigmoid layers
+    const unsigned int n = net.neurons;
+
+    // record ranges with the double forward pass
+    std::vector<qrange> irange(in);
+    std::vector<std::vector<qrange>> hrange(hidden, std::vector<qrange>(n));
+    std::vector<double> x(in), prev(n), cur(n);
+    for (const auto& sample : calibration) {
+        if (sample.size() != in)
+            throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+        x.assign(sample.begin(), sample.end());
+        norm.transform(x.data());
+        for (unsigned int c = 0; c < in; c++) irange[c].push(x[c]);
+        for (unsigned int l = 0; l < hidden; l++) {
+            for (unsigned int r = 0; r < n; r++) {
+                const std::vector<double>& w = l == 0 ? net.iweights[r] : net.weights[l - 1][r];
+                const std::vector<double>& a = l == 0 ? x : prev;
+                double sum = 0.0;
+                for (size_t c = 0; c < a.size(); c++) sum += w[c] * a[c];
+                cur[r] = sigmoid(sum);
+                hrange[l][r].push(cur[r]);
+            }
+            std::swap(prev, cur);
+        }
+    }
+
+    // input codes
+    std::vector<double> s(in);
+    std::vector<int32_t> z(in);
+    iinv.resize(in);
+    izero.resize(in);
+    for (unsigned int c = 0; c < in; c++) {
+        affine(irange[c], s[c], z[c]);
+        iinv[c] = (float)(1.0 / s[c]);
+        izero[c] = z[c];
+    }
+
+    // hidden layers, each followed by the requantization of its sigmoid
+    layer.reserve(hidden + 1);
+    for (unsigned int l = 0; l < hidden; l++) {
+        layer.push_back(quantize(l == 0 ? net.iweights : net.weights[l - 1], s, z));
+        qlayer& q = layer.back();
+        s.resize(n);
+        z.resize(n);
+        q.oinv.resize(n);
+        q.ozero.resize(n);
+        for (unsigned int r = 0; r < n; r++) {
+            affine(hrange[l][r], s[r], z[r]);
+            q.oinv[r] = (float)(1.0 / s[r]);
+            q.ozero[r] = z[r];
+        }
+    }
+    // linear output layer
+    layer.push_back(quantize(net.oweights, s, z));
+}
+
+//----------------INFERENCE----------------//
+
+/**
+ * @brief scratch buffers sized to the widest layer of this model
+ */
+qworkspace qmlp::workspace() const {
+    size_t width = (in + 31) / 32 * 32;
+    for (const qlayer& q : layer) width = std::max<size_t>({width, q.ld, q.rows});
+    qworkspace ws;
+    ws.x.resize(in);
+    ws.a.assign(width, 0);
+    ws.b.assign(width, 0);
+    return ws;
+}
+
+/**
+ * @brief Integer inference of one sample. The input is normalised and coded
+ * per feature; every hidden row is an int32 dot product whose dequantization,
+ * sigmoid and requantization to the next layer's uint8 code happen in the
+ * same step, so no float activation vector is ever stored. The output layer
+ * is dequantized to double. Padding columns carry zero weights, so whatever
+ * the ping-pong buffers hold past a layer's width never contributes.
+ * @param x raw input of length in
+ * @param y output of length out
+ * @param ws scratch from workspace()
+ */
+void qmlp::infer(const double* x, double* y, qworkspace& ws) const {
+    double* xn = ws.x.data();
+    std::copy(x, x + in, xn);
+    norm.transform(xn);
+    uint8_t* a = ws.a.data();
+    uint8_t* b = ws.b.data();
+    for (unsigned int c = 0; c < in; c++) {
+        long q = std::lrint((float)xn[c] * iinv[c]) + izero[c];
+        a[c] = (uint8_t)std::clamp(q, 0L, 255L);
+    }
+    for (size_t l = 0; l + 1 < layer.size(); l++) {
+        const qlayer& q = layer[l];
+        for (unsigned int r = 0; r < q.rows; r++) {
+            int32_t acc = qdot(a, q.w.data() + (size_t)r * q.ld, q.ld);
+            float pre = q.scale[r] * (float)(acc - q.zero[r]);
+            float act = 1.0f / (1.0f + std::exp(-pre));
+            long code = std::lrint(act * q.oinv[r]) + q.ozero[r];
+            b[r] = (uint8_t)std::clamp(code, 0L, 255L);
+        }
+        std::swap(a, b);
+    }
+    const qlayer& q = layer.back();
+    for (unsigned int r = 0; r < q.rows; r++) {
+        int32_t acc = qdot(a, q.w.data() + (size_t)r * q.ld, q.ld);
+        y[r] = (double)q.scale[r] * (double)(acc - q.zero[r]);
+    }
+}
+
+/**
+ * @brief Integer inference of one sample with a temporary workspace
+ * @param x raw input of length in
+ * @return output of length out
+ * @throws std::runtime_error if the input has the wrong size
+ */
+std::vector<double> qmlp::infer(const std::vector<double>& x) const {
+    if (x.size() != in)
+        throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    qworkspace ws = workspace();
+    std::vector<double> y(out);
+    infer(x.data(), y.data(), ws);
+    return y;
+}
+
+/**
+ * @brief bytes held by the quantized weights, scales and zero points
+ */
+size_t qmlp::bytes() const {
+    size_t total = iinv.size() * sizeof(float) + izero.size() * sizeof(int32_t);
+    for (const qlayer& q : layer) {
+        total += q.w.size() + q.scale.size() * sizeof(float) + q.zero.size() * sizeof(int64_t)
+               + q.oinv.size() * sizeof(float) + q.ozero.size() * sizeof(int32_t);
+    }
+    return total;
+}
@@ -0,0 +1,326 @@
+// registry.cpp: read-only model snapshots and lock-free hot swapping
+#include "include/registry.hpp"
+#include "include/dense.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//----------------SNAPSHOT----------------//
+
+/**
+ * @brief point the arrays at a flat buffer laid out as a model file body
+ * @param p first double after the header
+ */
+void snapshot::bind(const double* p) {
+    const size_t in = header.in, n = header.neurons;
+    shift = p;
+    scale = shift + in;
+    iweights = scale + in;
+    weights = iweights + n * in;
+    oweights = weights + (size_t)(header.layers - 1) * n * n;
+    const double** norms[] = {&beta, &gamma, &mean, &var};
+    const double* next = oweights + header.out * n;
+    for (size_t k = 0; k < 4; k++) {
+        *norms[k] = k < normarrays(header.normalize) ? next : nullptr;
+        if (*norms[k]) next += (size_t)(header.layers - 1) * n;
+    }
+}
+
+/**
+ * @brief Copy a trained model into a snapshot
+ * @param net model (unchanged)
+ */
+snapshot::snapshot(const mlp& net) : header(headerof(net)), version(0), map(nullptr), length(0) {
+    const size_t in = net.in;
+    storage.reserve((header.bytes - sizeof(modelheader)) / sizeof(double));
+    if (header.fitted) {
+        storage.insert(storage.end(), net.norm.shift.begin(), net.norm.shift.end());
+        storage.insert(storage.end(), net.norm.scale.begin(), net.norm.scale.end());
+    }
+    else {
+        storage.insert(storage.end(), in, 0.0);
+        storage.insert(storage.end(), in, 1.0);
+    }
+    for (const auto& row : net.iweights) storage.insert(storage.end(), row.begin(), row.end());
+    for (const auto& m : net.weights) {
+        for (const auto& row : m) storage.insert(storage.end(), row.begin(), row.end());
+    }
+    for (const auto& row : net.oweights) storage.insert(storage.end(), row.begin(), row.end());
+    const std::vector<std::vector<double>>* norms[] = {&net.beta, &net.gamma, &net.mean, &net.var};
+    for (size_t k = 0; k < normarrays(header.normalize); k++) {
+        for (const auto& row : *norms[k]) storage.insert(storage.end(), row.begin(), row.end());
+    }
+    bind(storage.data());
+}
+
+/**
+ * @brief Map a model file written by mlp::save(). Every page is touched
+ * here, on the loading thread, so the first requests served from the new
+ * version do not take the page faults.
+ * @param path model file
+ * @throws std::runtime_error if the file is missing, not a model or truncated
+ */
+snapshot::snapshot(const std::string& path) : version(0), map(nullptr), length(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("-_-CANNOT OPEN MODEL FILE-_-");
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(modelheader)) {
+        close(fd);
+        throw std::runtime_error("-_-NOT AN MLP MODEL FILE-_-");
+    }
+    length = (size_t)st.st_size;
+    map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        map = nullptr;
+        throw std::runtime_error("-_-CANNOT MAP MODEL FILE-_-");
+    }
+    std::memcpy(&header, map, sizeof(header));
+    if (!validheader(header) || header.bytes != length) {
+        munmap(map, length);
+        throw std::runtime_error("-_-NOT AN MLP MODEL FILE-_-");
+    }
+    madvise(map, length, MADV_WILLNEED);
+    const long page = sysconf(_SC_PAGESIZE);
+    volatile char sink = 0;
+    for (size_t off = 0; off < length; off += (size_t)page) sink = sink + ((const char*)map)[off];
+    bind((const double*)((const char*)map + sizeof(modelheader)));
+}
+
+snapshot::~snapshot() {
+    if (map) munmap(map, length);
+}
+
+/**
+ * @brief Batched inference, the same computation as mlp::infer on the
+ * snapshot's arrays
+ * @param x raw inputs, rows x in, row-major
+ * @param y outputs, rows x out, row-major
+ * @param rows number of samples
+ * @param ws scratch for this thread (grown to rows x widest layer)
+ * @throws std::runtime_error if x or y has the wrong length
+ */
+void snapshot::infer(std::span<const double> x, std::span<double> y, size_t rows, workspace& ws) const {
+    const size_t in = header.in, out = header.out, n = header.neurons;
+    if (x.size() != rows * in || y.size() != rows * out)
+        throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    size_t width = std::max({in, n, out});
+    if (ws.a.size() < rows * width) ws.a.resize(rows * width);
+    if (ws.b.size() < rows * width) ws.b.resize(rows * width);
+    double* a = ws.a.data();
+    double* b = ws.b.data();
+    std::copy(x.begin(), x.end(), a);
+    if (header.fitted && header.method != (uint32_t)scaling::none) {
+        for (size_t r = 0; r < rows; r++) {
+            for (size_t i = 0; i < in; i++) a[r * in + i] = (a[r * in + i] - shift[i]) * scale[i];
+        }
+    }
+
+    // normalised layers take the sigmoid after their normalisation
+    const normalization kind = (normalization)header.normalize;
+    const bool plain = kind == normalization::none;
+    auto activate = [&](unsigned int l, double* h) {
+        auto at = [l, n](const double* p) { return p ? p + l * n : nullptr; };
+        for (size_t r = 0; r < rows; r++) {
+            double* z = h + r * n;
+            normalized(kind, z, z, n, at(gamma), at(beta), at(mean), at(var));
+            for (size_t j = 0; j < n; j++) z[j] = sigmoid(z[j]);
+        }
+    };
+    layerBatch(rowsOf(iweights, in), n, a, in, rows, in, b, n, plain);
+    if (!plain) activate(0, b);
+    std::swap(a, b);
+    for (unsigned int l = 1; l + 1 < header.layers; l++) {
+        layerBatch(rowsOf(weights + (size_t)(l - 1) * n * n, n), n, a, n, rows, n, b, n, plain);
+        if (!plain) activate(l, b);
+        std::swap(a, b);
+    }
+    layerBatch(rowsOf(oweights, n), out, a, n, rows, n, y.data(), out, false);
+}
+
+/**
+ * @brief Inference of one sample with its own scratch
+ * @param x raw input of length in
+ * @return output of length out
+ * @throws std::runtime_error if the input has the wrong size
+ */
+std::vector<double> snapshot::infer(const std::vector<double>& x) const {
+    workspace ws;
+    std::vector<double> y(header.out);
+    infer(x, y, 1, ws);
+    return y;
+}
+
+//----------------READER----------------//
+
+/**
+ * @brief claim a free hazard slot
+ * @throws std::runtime_error if all registry::slots are taken
+ */
+registry::reader::reader(registry& models) : models(models), own(nullptr) {
+    for (slot& s : models.hazards) {
+        bool expected = false;
+        if (!s.taken.load(std::memory_order_relaxed)
+            && s.taken.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            own = &s;
+            return;
+        }
+    }
+    throw std::runtime_error("-_-NO FREE READER SLOT IN REGISTRY-_-");
+}
+
+registry::reader::~reader() {
+    own->hazard.store(nullptr, std::memory_order_release);
+    own->taken.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief Protect the current snapshot. The pointer is announced in the
+ * hazard slot and the current one read again: if it is unchanged, a
+ * reclaimer scanning after the swap is guaranteed to see the announcement.
+ * @return current snapshot, valid until unpin() (nullptr if none published)
+ */
+const snapshot* registry::reader::pin() {
+    const snapshot* p = models.current.load(std::memory_order_seq_cst);
+    for (;;) {
+        own->hazard.store(p, std::memory_order_seq_cst);
+        const snapshot* q = models.current.load(std::memory_order_seq_cst);
+        if (q == p) return p;
+        p = q;
+    }
+}
+
+void registry::reader::unpin() {
+    own->hazard.store(nullptr, std::memory_order_release);
+}
+
+//----------------REGISTRY----------------//
+
+registry::registry() : current(nullptr), latest(0), failures(0), watching(false) {}
+
+/**
+ * @brief Stop watching and free every snapshot. No reader may be alive.
+ */
+registry::~registry() {
+    stop();
+    delete current.load();
+    for (const snapshot* s : retired) delete s;
+}
+
+/**
+ * @brief Make a snapshot current. The previous one is retired and freed as
+ * soon as no reader has it pinned; readers that pinned it keep using it
+ * until they unpin.
+ * @param s new snapshot (ownership moves to the registry)
+ * @return version given to the snapshot
+ */
+uint64_t registry::publish(std::unique_ptr<snapshot> s) {
+    uint64_t v;
+    {
+        std::lock_guard<std::mutex> lk(retiring);
+        v = latest.load() + 1;
+        s->version = v;
+        const snapshot* old = current.exchange(s.release(), std::memory_order_seq_cst);
+        latest.store(v);
+        if (old) retired.push_back(old);
+    }
+    reclaim();
+    return v;
+}
+
+/**
+ * @brief copy a model and publish it
+ * @return version given to it
+ */
+uint64_t registry::publish(const mlp& net) {
+    return publish(std::make_unique<snapshot>(net));
+}
+
+/**
+ * @brief map a model file and publish it
+ * @return version given to it
+ * @throws std::runtime_error if the file is not a valid model (the current
+ * version stays)
+ */
+uint64_t registry::load(const std::string& path) {
+    return publish(std::make_unique<snapshot>(path));
+}
+
+/**
+ * @brief Free the retired snapshots that no hazard slot holds. Runs under
+ * the retiring lock so every snapshot in the list was swapped out before
+ * the slots are scanned.
+ * @return number of retired snapshots still pinned
+ */
+size_t registry::reclaim() {
+    std::lock_guard<std::mutex> lk(retiring);
+    if (retired.empty()) return 0;
+    std::vector<const snapshot*> pinned;
+    for (const slot& s : hazards) {
+        const snapshot* p = s.hazard.load(std::memory_order_seq_cst);
+        if (p) pinned.push_back(p);
+    }
+    auto keep = std::partition(retired.begin(), retired.end(), [&pinned](const snapshot* s) {
+        return std::find(pinned.begin(), pinned.end(), s) != pinned.end();
+    });
+    for (auto it = keep; it != retired.end(); ++it) delete *it;
+    retired.erase(keep, retired.end());
+    return retired.size();
+}
+
+/**
+ * @brief Watch a model file on a background thread and publish it whenever
+ * it is replaced (new inode, size or modification time), for example by
+ * mlp::save() from a training process. A file that fails to load is counted
+ * in failures and the current version keeps serving. Retired snapshots are
+ * reclaimed on every poll.
+ * @param path model file (loaded now if nothing is published yet)
+ * @param interval polling period
+ * @throws std::runtime_error if nothing is published and the file cannot be loaded
+ */
+void registry::watch(const std::string& path, std::chrono::milliseconds interval) {
+    stop();
+    auto identity = [path]() {
+        struct stat st;
+        if (stat(path.c_str(), &st) < 0) return std::vector<int64_t>();
+        return std::vector<int64_t>{(int64_t)st.st_dev, (int64_t)st.st_ino, (int64_t)st.st_size, (int64_t)st.st_mtime};
+    };
+    std::vector<int64_t> seen = identity();
+    if (!current.load()) load(path);
+    watching = true;
+    watcher = std::thread([this, path, interval, identity, seen]() mutable {
+        std::unique_lock<std::mutex> lk(waiting);
+        while (!wake.wait_for(lk, interval, [this] { return !watching; })) {
+            lk.unlock();
+            std::vector<int64_t> now = identity();
+            if (!now.empty() && now != seen) {
+                seen = now;
+                try {
+                    load(path);
+                }
+                catch (const std::exception&) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            reclaim();
+            lk.lock();
+        }
+    });
+}
+
+/**
+ * @brief stop the watcher thread, if any
+ */
+void registry::stop() {
+    {
+        std::lock_guard<std::mutex> lk(waiting);
+        watching = false;
+    }
+    wake.notify_all();
+    if (watcher.joinable()) watcher.join();
+}
@@ -0,0 +1,232 @@
+// scaler.cpp: streaming feature normalisation
+#include "include/scaler.hpp"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+//----------------P2QUANTILE----------------//
+
+p2quantile::p2quantile(double q) : q(q), count(0)
+{
+    for (int i = 0; i < 5; i++) {
+        height[i] = 0.0;
+        pos[i] = i + 1;
+    }
+    desired[0] = 1.0;  desired[1] = 1.0 + 2.0 * q;  desired[2] = 1.0 + 4.0 * q;
+    desired[3] = 3.0 + 2.0 * q;  desired[4] = 5.0;
+    step[0] = 0.0;  step[1] = q / 2.0;  step[2] = q;  step[3] = (1.0 + q) / 2.0;  step[4] = 1.0;
+}
+
+/**
+ * @brief add one sample; the first five samples seed the markers, after that
+ * the middle markers are moved with piecewise-parabolic interpolation
+ * @param x sample
+ */
+void p2quantile::push(double x)
+{
+    if (std::isnan(x)) return;
+    if (count < 5) {
+        height[count++] = x;
+        if (count == 5) std::sort(height, height + 5);
+        return;
+    }
+    count++;
+
+    // find the cell of x and update the extreme markers
+    int k;
+    if (x < height[0]) { height[0] = x; k = 0; }
+    else if (x >= height[4]) { height[4] = x; k = 3; }
+    else {
+        k = 0;
+        while (k < 3 && x >= height[k + 1]) k++;
+    }
+    for (int i = k + 1; i < 5; i++) pos[i] += 1.0;
+    for (int i = 0; i < 5; i++) desired[i] += step[i];
+
+    // adjust the middle markers
+    for (int i = 1; i < 4; i++) {
+        double d = desired[i] - pos[i];
+        if ((d >= 1.0 && pos[i + 1] - pos[i] > 1.0) || (d <= -1.0 && pos[i - 1] - pos[i] < -1.0)) {
+            double s = (d > 0.0) ? 1.0 : -1.0;
+            double hp = height[i] + s / (pos[i + 1] - pos[i - 1]) *
+                ((pos[i] - pos[i - 1] + s) * (height[i + 1] - height[i]) / (pos[i + 1] - pos[i]) +
+                 (pos[i + 1] - pos[i] - s) * (height[i] - height[i - 1]) / (pos[i] - pos[i - 1]));
+            if (height[i - 1] < hp && hp < height[i + 1])
+                height[i] = hp;
+            else {
+                int j = i + (int)s;
+                height[i] += s * (height[j] - height[i]) / (pos[j] - pos[i]);
+            }
+            pos[i] += s;
+        }
+    }
+}
+
+/**
+ * @brief current estimate (exact order statistic while fewer than five samples)
+ */
+double p2quantile::value() const
+{
+    if (count == 0) return 0.0;
+    if (count < 5) {
+        double h[5];
+        std::copy(height, height + count, h);
+        std::sort(h, h + count);
+        size_t i = (size_t)std::min<double>((double)count - 1.0, std::round(q * (double)(count - 1)));
+        return h[i];
+    }
+    return height[2];
+}
+
+//----------------SCALER----------------//
+
+scaler::scaler() : method(scaling::none), features(0), n(0), fitted(false) {}
+
+/**
+ * @brief empty scaler ready for partialFit()
+ * @param features number of features
+ * @param method normalisation method
+ */
+scaler::scaler(unsigned int features, scaling method) : method(method), features(features),
+    n(0), fitted(false), shift(features, 0.0), scale(features, 1.0)
+{
+    if (method == scaling::standard) {
+        mean.assign(features, 0.0);
+        m2.assign(features, 0.0);
+    }
+    else if (method == scaling::minmax) {
+        minv.assign(features, std::numeric_limits<double>::infinity());
+        maxv.assign(features, -std::numeric_limits<double>::infinity());
+    }
+    else if (method == scaling::robust) {
+        q1.assign(features, p2quantile(0.25));
+        q2.assign(features, p2quantile(0.5));
+        q3.assign(features, p2quantile(0.75));
+    }
+}
+
+/**
+ * @brief add one sample to the statistics of the chosen method
+ * @param x sample of length features
+ */
+void scaler::partialFit(const double* x)
+{
+    n++;
+    switch (method) {
+    case scaling::standard: {
+        double inv = 1.0 / (double)n;
+        for (unsigned int i = 0; i < features; i++) {
+            double d = x[i] - mean[i];
+            mean[i] += d * inv;
+            m2[i] += d * (x[i] - mean[i]);
+        }
+        break;
+    }
+    case scaling::minmax:
+        for (unsigned int i = 0; i < features; i++) {
+            minv[i] = std::min(minv[i], x[i]);
+            maxv[i] = std::max(maxv[i], x[i]);
+        }
+        break;
+    case scaling::robust:
+        for (unsigned int i = 0; i < features; i++) {
+            q1[i].push(x[i]);
+            q2[i].push(x[i]);
+            q3[i].push(x[i]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void scaler::partialFit(const std::vector<double>& x)
+{
+    if (x.size() != features)
+        throw std::runtime_error("-_-SAMPLE SIZE DOES NOT MATCH SCALER FEATURES-_-");
+    partialFit(x.data());
+}
+
+/**
+ * @brief turn the accumulated statistics into shift and scale. Features with
+ * zero spread keep scale 1 so constant columns only get centred.
+ */
+void scaler::finalize()
+{
+    for (unsigned int i = 0; i < features; i++) {
+        double spread = 0.0;
+        switch (method) {
+        case scaling::standard:
+            shift[i] = mean[i];
+            spread = (n > 1) ? std::sqrt(m2[i] / (double)(n - 1)) : 0.0;
+            break;
+        case scaling::minmax:
+            shift[i] = (n > 0) ? minv[i] : 0.0;
+            spread = (n > 0) ? maxv[i] - minv[i] : 0.0;
+            break;
+        case scaling::robust:
+            shift[i] = q2[i].value();
+            spread = q3[i].value() - q1[i].value();
+            break;
+        default:
+            break;
+        }
+        scale[i] = (spread > 0.0) ? 1.0 / spread : 1.0;
+    }
+    fitted = true;
+}
+
+/**
+ * @brief fit over a whole dataset in one pass
+ * @param x samples, each of length features
+ */
+void scaler::fit(const std::vector<std::vector<double>>& x)
+{
+    for (const auto& s : x) partialFit(s);
+    finalize();
+}
+
+/**
+ * @brief normalise one sample in place (no-op until fitted)
+ * @param x sample of length features
+ */
+void scaler::transform(double* x) const
+{
+    if (!fitted || method == scaling::none) return;
+    for (unsigned int i = 0; i < features; i++)
+        x[i] = (x[i] - shift[i]) * scale[i];
+}
+
+void scaler::transform(std::vector<double>& x) const
+{
+    if (x.size() != features)
+        throw std::runtime_error("-_-SAMPLE SIZE DOES NOT MATCH SCALER FEATURES-_-");
+    transform(x.data());
+}
+
+/**
+ * @brief scale the nonzeros of a sparse sample in place. The shift is not
+ * applied because it would make every zero feature nonzero, so sparse inputs
+ * are scaled but not centred.
+ * @param index feature index of each nonzero
+ * @param value nonzero values
+ * @param nnz number of nonzeros
+ */
+void scaler::transform(const unsigned int* index, double* value, size_t nnz) const
+{
+    if (!fitted || method == scaling::none) return;
+    for (size_t k = 0; k < nnz; k++)
+        value[k] *= scale[index[k]];
+}
+
+/**
+ * @brief map a normalised sample back to the original units
+ * @param x sample of length features
+ */
+void scaler::inverse(double* x) const
+{
+    if (!fitted || method == scaling::none) return;
+    for (unsigned int i = 0; i < features; i++)
+        x[i] = x[i] / scale[i] + shift[i];
+}
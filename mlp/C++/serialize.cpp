@@ -0,0 +1,173 @@
+// serialize.cpp: saving and loading mlp models
+#include "include/serialize.hpp"
+#include "include/mlp.hpp"
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+
+//----------------HEADER----------------//
+
+/**
+ * @brief how many of beta, gamma, mean and var (in that order) a model
+ * file stores for each hidden layer: a folded model needs only its bias
+ * @param normalize normalisation (enum value)
+ * @return 0 to 4
+ */
+size_t normarrays(uint32_t normalize) {
+    switch ((normalization)normalize) {
+        case normalization::layer: return 2;
+        case normalization::batch: return 4;
+        case normalization::folded: return 1;
+        default: return 0;
+    }
+}
+
+/**
+ * @brief file size implied by the dimensions in a header
+ * @param h header
+ * @return header plus all arrays, in bytes
+ */
+size_t modelbytes(const modelheader& h) {
+    size_t doubles = 2 * (size_t)h.in + (size_t)h.neurons * h.in
+                   + (size_t)(h.layers - 1) * h.neurons * h.neurons + (size_t)h.out * h.neurons
+                   + normarrays(h.normalize) * (h.layers - 1) * h.neurons;
+    return sizeof(modelheader) + doubles * sizeof(double);
+}
+
+/**
+ * @brief check magic, version, dimensions and recorded size of a header
+ * @param h header
+ * @return true if the header describes a readable model
+ */
+bool validheader(const modelheader& h) {
+    return std::memcmp(h.magic, "MLPMODEL", 8) == 0 && h.version == MODEL_VERSION
+        && h.in > 0 && h.out > 0 && h.layers >= 2 && h.neurons > 0
+        && h.method <= (uint32_t)scaling::robust && h.normalize <= (uint32_t)normalization::folded
+        && h.bytes == modelbytes(h);
+}
+
+/**
+ * @brief header describing a model: dimensions, normalisation and the
+ * size of the file save() writes for it
+ * @param net model
+ * @return filled header
+ */
+modelheader headerof(const mlp& net) {
+    modelheader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "MLPMODEL", 8);
+    h.version = MODEL_VERSION;
+    h.in = net.in;
+    h.out = net.out;
+    h.layers = net.layers;
+    h.neurons = net.neurons;
+    h.epochs = net.epochs;
+    h.method = (uint32_t)net.norm.method;
+    h.fitted = net.norm.fitted && net.norm.features == net.in;
+    h.normalize = (uint32_t)net.normalize;
+    h.learning = net.learning;
+    h.bytes = modelbytes(h);
+    return h;
+}
+
+//----------------MLP----------------//
+
+/**
+ * @brief Write the model (dimensions, normalisation, weights and hidden-layer
+ * normalisation) to a file
+ * in the layout of modelheader. Training buffers are not saved. The file is
+ * replaced atomically, so it can be rewritten while a registry maps it.
+ * @param path output file
+ * @throws std::runtime_error if the file cannot be written
+ */
+void mlp::save(const std::string& path) const {
+    modelheader h = headerof(*this);
+    // write a sibling file and rename it over the target, so a reader (or a
+    // registry that has the old file mapped) never sees a partial model
+    const std::string tmp = path + ".tmp";
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("-_-CANNOT OPEN MODEL FILE-_-");
+    auto put = [&f](const double* p, size_t n) { f.write((const char*)p, n * sizeof(double)); };
+    f.write((const char*)&h, sizeof(h));
+    std::vector<double> shift(in, 0.0), scale(in, 1.0);
+    if (h.fitted) {
+        shift = norm.shift;
+        scale = norm.scale;
+    }
+    put(shift.data(), in);
+    put(scale.data(), in);
+    for (const auto& row : iweights) put(row.data(), in);
+    for (const auto& m : weights) {
+        for (const auto& row : m) put(row.data(), neurons);
+    }
+    for (const auto& row : oweights) put(row.data(), neurons);
+    const std::vector<std::vector<double>>* norms[] = {&beta, &gamma, &mean, &var};
+    for (size_t k = 0; k < normarrays(h.normalize); k++) {
+        for (const auto& row : *norms[k]) put(row.data(), neurons);
+    }
+    f.close();
+    std::error_code err;
+    if (f) std::filesystem::rename(tmp, path, err);
+    if (!f || err) {
+        std::filesystem::remove(tmp, err);
+        throw std::runtime_error("-_-CANNOT WRITE MODEL FILE-_-");
+    }
+}
+
+/**
+ * @brief Replace this model with one read from a file written by save().
+ * All training and forward buffers are reallocated for the stored sizes.
+ * @param path model file
+ * @throws std::runtime_error if the file is missing, not a model or truncated
+ */
+void mlp::load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("-_-CANNOT OPEN MODEL FILE-_-");
+    modelheader h;
+    if (!f.read((char*)&h, sizeof(h)) || !validheader(h))
+        throw std::runtime_error("-_-NOT AN MLP MODEL FILE-_-");
+    auto get = [&f](double* p, size_t n) {
+        if (!f.read((char*)p, n * sizeof(double)))
+            throw std::runtime_error("-_-TRUNCATED MODEL FILE-_-");
+    };
+
+    in = h.in;
+    out = h.out;
+    layers = h.layers;
+    neurons = h.neurons;
+    epochs = h.epochs;
+    learning = h.learning;
+    mse = 0.0;
+    status = true;
+    norm = scaler(in, (scaling)h.method);
+    get(norm.shift.data(), in);
+    get(norm.scale.data(), in);
+    norm.fitted = h.fitted != 0;
+
+    iweights.assign(neurons, std::vector<double>(in));
+    weights.assign(layers - 1, std::vector<std::vector<double>>(neurons, std::vector<double>(neurons)));
+    oweights.assign(out, std::vector<double>(neurons));
+    for (auto& row : iweights) get(row.data(), in);
+    for (auto& m : weights) {
+        for (auto& row : m) get(row.data(), neurons);
+    }
+    for (auto& row : oweights) get(row.data(), neurons);
+    addNormalization((normalization)h.normalize);
+    std::vector<std::vector<double>>* norms[] = {&beta, &gamma, &mean, &var};
+    for (size_t k = 0; k < normarrays(h.normalize); k++) {
+        for (auto& row : *norms[k]) get(row.data(), neurons);
+    }
+
+    input.assign(in, 0.0);
+    output.assign(out, 0.0);
+    expected.assign(out, 0.0);
+    sinput = sparsevec();
+    hlayers.assign(layers, std::vector<double>(neurons, 0.0));
+    activations.assign(layers, std::vector<double>(neurons, 0.0));
+    giweights.assign(neurons, std::vector<double>(in, 0.0));
+    goweights.assign(out, std::vector<double>(neurons, 0.0));
+    gweights.assign(layers - 1, std::vector<std::vector<double>>(neurons, std::vector<double>(neurons, 0.0)));
+}
@@ -0,0 +1,469 @@
+// serve.cpp: request batching, metrics and a Unix socket server for mlp inference
+#include "include/serve.hpp"
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock sclock;
+
+static uint64_t nanos(sclock::duration d) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+//----------------LATENCY----------------//
+
+latency::latency() {
+    reset();
+}
+
+/**
+ * @brief bucket of a value: exact below 8, then 8 linear steps per octave
+ */
+static int bucketof(uint64_t v) {
+    if (v < (uint64_t)latency::sub) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    int m = (int)((v >> (e - 3)) & (latency::sub - 1));
+    return latency::sub + (e - 3) * latency::sub + m;
+}
+
+/**
+ * @brief midpoint of a bucket
+ */
+static uint64_t bucketmid(int b) {
+    if (b < latency::sub) return (uint64_t)b;
+    int e = (b - latency::sub) / latency::sub + 3;
+    uint64_t m = (uint64_t)((b - latency::sub) % latency::sub);
+    uint64_t lo = (latency::sub + m) << (e - 3);
+    return lo + ((uint64_t)1 << (e - 3)) / 2;
+}
+
+/**
+ * @brief record one sample
+ * @param ns latency in nanoseconds
+ */
+void latency::record(uint64_t ns) {
+    count[bucketof(ns)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief approximate quantile of the recorded samples
+ * @param q quantile in [0, 1]
+ * @return latency in nanoseconds (0 if nothing was recorded)
+ */
+uint64_t latency::quantile(double q) const {
+    uint64_t n = total.load(std::memory_order_relaxed);
+    if (n == 0) return 0;
+    uint64_t rank = (uint64_t)std::clamp(q * (double)n, 1.0, (double)n);
+    uint64_t seen = 0;
+    for (int b = 0; b < buckets; b++) {
+        seen += count[b].load(std::memory_order_relaxed);
+        if (seen >= rank) return bucketmid(b);
+    }
+    return bucketmid(buckets - 1);
+}
+
+void latency::reset() {
+    for (auto& c : count) c.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief requests, batches, throughput and latency quantiles on one line
+ */
+std::string servestats::report() const {
+    double secs = std::chrono::duration<double>(sclock::now() - start).count();
+    uint64_t r = requests.load(), b = batches.load();
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(1)
+      << "requests " << r << " batches " << b << " mean batch " << (b ? (double)r / b : 0.0)
+      << " errors " << errors.load() << " throughput " << (secs > 0 ? r / secs : 0.0) << "/s"
+      << " latency us p50 " << request.quantile(0.50) / 1e3 << " p99 " << request.quantile(0.99) / 1e3
+      << " p99.9 " << request.quantile(0.999) / 1e3
+      << " compute us p50 " << compute.quantile(0.50) / 1e3 << " p99 " << compute.quantile(0.99) / 1e3;
+    return s.str();
+}
+
+//----------------BATCHER----------------//
+
+/**
+ * @brief Serve a copy of net from a private registry (see the class)
+ * @throws std::invalid_argument if threads exceeds registry::slots
+ */
+batcher::batcher(const mlp& net, unsigned int maxBatch, unsigned int maxWait, unsigned int threads)
+    : own(std::make_unique<registry>()), models(*own), maxBatch(std::max(1u, maxBatch)), maxWait(maxWait),
+      stopping(false)
+{
+    if (threads > registry::slots)
+        throw std::invalid_argument("-_-MORE DISPATCHER THREADS THAN REGISTRY READER SLOTS-_-");
+    own->publish(net);
+    for (unsigned int t = 0; t < std::max(1u, threads); t++)
+        pool.emplace_back(&batcher::dispatch, this);
+}
+
+/**
+ * @brief Serve the current version of models (see the class). Every
+ * dispatcher holds a reader slot for its lifetime, so they must fit in
+ * registry::slots; a dispatcher without one could only terminate.
+ * @throws std::invalid_argument if threads exceeds registry::slots
+ */
+batcher::batcher(registry& models, unsigned int maxBatch, unsigned int maxWait, unsigned int threads)
+    : models(models), maxBatch(std::max(1u, maxBatch)), maxWait(maxWait), stopping(false)
+{
+    if (threads > registry::slots)
+        throw std::invalid_argument("-_-MORE DISPATCHER THREADS THAN REGISTRY READER SLOTS-_-");
+    for (unsigned int t = 0; t < std::max(1u, threads); t++)
+        pool.emplace_back(&batcher::dispatch, this);
+}
+
+/**
+ * @brief Queue one request
+ * @param x raw input of the served model's length
+ * @return future holding the output, or the error if the input is rejected
+ */
+std::future<std::vector<double>> batcher::submit(std::vector<double> x) {
+    request r;
+    r.x = std::move(x);
+    r.arrived = sclock::now();
+    std::future<std::vector<double>> f = r.done.get_future();
+    size_t queued;
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        if (stopping) {
+            stats.errors.fetch_add(1, std::memory_order_relaxed);
+            r.done.set_exception(std::make_exception_ptr(std::runtime_error("-_-BATCHER IS STOPPED-_-")));
+            return f;
+        }
+        queue.push_back(std::move(r));
+        queued = queue.size();
+    }
+    if (queued >= maxBatch) ready.notify_all();
+    else ready.notify_one();
+    return f;
+}
+
+/**
+ * @brief submit one request and wait for its output
+ * @param x raw input of the served model's length
+ * @return output of the served model's length
+ */
+std::vector<double> batcher::infer(std::vector<double> x) {
+    return submit(std::move(x)).get();
+}
+
+/**
+ * @brief Dispatcher loop: take the oldest request, wait for the batch to
+ * fill or its deadline (arrival + maxWait) to pass, then run the batch on
+ * the current snapshot. Requests that do not match its input size fail
+ * alone. While stopping the deadline is ignored and the queue is drained.
+ */
+void batcher::dispatch() {
+    registry::reader guard(models);
+    workspace ws;
+    std::vector<request> batch, rejected;
+    std::vector<double> x, y;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            ready.wait(lk, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            sclock::time_point deadline = queue.front().arrived + std::chrono::microseconds(maxWait);
+            ready.wait_until(lk, deadline, [this] { return stopping || queue.size() >= maxBatch; });
+            if (queue.empty()) continue;     // another dispatcher took them
+            size_t n = std::min<size_t>(maxBatch, queue.size());
+            batch.clear();
+            for (size_t i = 0; i < n; i++) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+        const snapshot* net = guard.pin();
+        const size_t in = net ? net->header.in : 0, out = net ? net->header.out : 0;
+        rejected.clear();
+        auto bad = std::stable_partition(batch.begin(), batch.end(), [in](const request& r) { return r.x.size() == in; });
+        std::move(bad, batch.end(), std::back_inserter(rejected));
+        batch.erase(bad, batch.end());
+        for (request& r : rejected)
+            r.done.set_exception(std::make_exception_ptr(std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-")));
+        stats.errors.fetch_add(rejected.size(), std::memory_order_relaxed);
+        const size_t n = batch.size();
+        if (n == 0) {
+            guard.unpin();
+            continue;
+        }
+        x.resize(n * in);
+        y.resize(n * out);
+        for (size_t i = 0; i < n; i++) std::copy(batch[i].x.begin(), batch[i].x.end(), x.begin() + i * in);
+        sclock::time_point t0 = sclock::now();
+        try {
+            net->infer(x, y, n, ws);
+        }
+        catch (...) {
+            guard.unpin();
+            for (request& r : batch) r.done.set_exception(std::current_exception());
+            stats.errors.fetch_add(n, std::memory_order_relaxed);
+            continue;
+        }
+        guard.unpin();
+        sclock::time_point t1 = sclock::now();
+        stats.compute.record(nanos(t1 - t0));
+        for (size_t i = 0; i < n; i++) {
+            batch[i].done.set_value(std::vector<double>(y.begin() + i * out, y.begin() + (i + 1) * out));
+            stats.request.record(nanos(sclock::now() - batch[i].arrived));
+        }
+        stats.requests.fetch_add(n, std::memory_order_relaxed);
+        stats.batches.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief stop accepting requests, answer the queued ones and join the dispatchers
+ */
+void batcher::stop() {
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (std::thread& t : pool) {
+        if (t.joinable()) t.join();
+    }
+}
+
+batcher::~batcher() {
+    stop();
+}
+
+//----------------SOCKETS----------------//
+
+/**
+ * @brief read exactly n bytes
+ * @return false on end of stream or error
+ */
+static bool readall(int fd, void* p, size_t n) {
+    char* c = (char*)p;
+    while (n > 0) {
+        ssize_t k = recv(fd, c, n, 0);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        c += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+/**
+ * @brief write exactly n bytes (no SIGPIPE on a closed peer)
+ * @return false on error
+ */
+static bool writeall(int fd, const void* p, size_t n) {
+    const char* c = (const char*)p;
+    while (n > 0) {
+        ssize_t k = send(fd, c, n, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        c += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+/**
+ * @brief socket address for a path
+ * @throws std::runtime_error if the path is too long
+ */
+static sockaddr_un address(const std::string& path) {
+    sockaddr_un a;
+    std::memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(a.sun_path))
+        throw std::runtime_error("-_-SOCKET PATH IS TOO LONG-_-");
+    std::memcpy(a.sun_path, path.c_str(), path.size());
+    return a;
+}
+
+//----------------SERVER----------------//
+
+server::server(batcher& queue, const std::string& path) : queue(queue), path(path), fd(-1), running(false) {}
+
+/**
+ * @brief Bind the socket (replacing a stale one), listen, and accept
+ * connections on a background thread
+ * @throws std::runtime_error if the socket cannot be created or bound
+ */
+void server::start() {
+    sockaddr_un a = address(path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error("-_-CANNOT CREATE SOCKET-_-");
+    unlink(path.c_str());
+    if (bind(fd, (sockaddr*)&a, sizeof(a)) < 0 || listen(fd, 128) < 0) {
+        close(fd);
+        fd = -1;
+        throw std::runtime_error("-_-CANNOT BIND SOCKET " + path + "-_-");
+    }
+    running = true;
+    acceptor = std::thread([this] {
+        while (running) {
+            int c = accept(fd, nullptr, nullptr);
+            if (c < 0) {
+                if (running && (errno == EINTR || errno == ECONNABORTED)) continue;
+                break;
+            }
+            std::lock_guard<std::mutex> lk(lock);
+            // join connection threads that have returned
+            for (std::thread::id id : finished) {
+                auto t = std::find_if(connections.begin(), connections.end(),
+                                      [id](const std::thread& t) { return t.get_id() == id; });
+                if (t != connections.end()) {
+                    t->join();
+                    connections.erase(t);
+                }
+            }
+            finished.clear();
+            clients.push_back(c);
+            connections.emplace_back(&server::serve, this, c);
+        }
+    });
+}
+
+/**
+ * @brief One connection: send the current model's shape, then answer
+ * requests until the client disconnects. Each request blocks only this
+ * thread, so the batcher sees every connection's requests concurrently.
+ * @param c client socket
+ */
+void server::serve(int c) {
+    uint32_t shape[2] = {0, 0};
+    try {
+        registry::reader guard(queue.models);
+        if (const snapshot* net = guard.pin()) {
+            shape[0] = net->header.in;
+            shape[1] = net->header.out;
+        }
+    }
+    catch (const std::exception&) {
+        // no free reader slot: the client sees an empty shape
+    }
+    bool ok = writeall(c, shape, sizeof(shape));
+    std::vector<double> x;
+    while (ok) {
+        uint32_t n;
+        if (!readall(c, &n, sizeof(n))) break;
+        if (n == 0) {
+            std::string text = queue.stats.report() + " model version " + std::to_string(queue.models.latest.load());
+            uint32_t len = text.size();
+            ok = writeall(c, &len, sizeof(len)) && writeall(c, text.data(), len);
+            continue;
+        }
+        if (n > (1u << 24)) break;          // not a sane request, drop the connection
+        x.resize(n);
+        if (!readall(c, x.data(), n * sizeof(double))) break;
+        std::vector<double> y;
+        try {
+            y = queue.submit(std::move(x)).get();
+        }
+        catch (const std::exception&) {
+            y.clear();
+        }
+        uint32_t m = y.size();
+        ok = writeall(c, &m, sizeof(m)) && writeall(c, y.data(), m * sizeof(double));
+        x.clear();
+    }
+    std::lock_guard<std::mutex> lk(lock);
+    clients.erase(std::remove(clients.begin(), clients.end(), c), clients.end());
+    finished.push_back(std::this_thread::get_id());
+    close(c);
+}
+
+/**
+ * @brief stop accepting, disconnect every client, join all threads and
+ * remove the socket file
+ */
+void server::stop() {
+    if (!running.exchange(false)) return;
+    shutdown(fd, SHUT_RDWR);
+    if (acceptor.joinable()) acceptor.join();
+    close(fd);
+    fd = -1;
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        for (int c : clients) shutdown(c, SHUT_RDWR);
+        threads.swap(connections);
+    }
+    for (std::thread& t : threads) t.join();
+    unlink(path.c_str());
+}
+
+server::~server() {
+    stop();
+}
+
+//----------------CLIENT----------------//
+
+/**
+ * @brief connect and read the model shape
+ * @param path socket path
+ * @throws std::runtime_error if the server cannot be reached
+ */
+client::client(const std::string& path) : fd(-1), in(0), out(0) {
+    sockaddr_un a = address(path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&a, sizeof(a)) < 0) {
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("-_-CANNOT CONNECT TO " + path + "-_-");
+    }
+    uint32_t shape[2];
+    if (!readall(fd, shape, sizeof(shape))) {
+        close(fd);
+        throw std::runtime_error("-_-CANNOT CONNECT TO " + path + "-_-");
+    }
+    in = shape[0];
+    out = shape[1];
+}
+
+/**
+ * @brief send one request and wait for the answer
+ * @param x raw input of length in
+ * @return output of length out
+ * @throws std::runtime_error if the connection fails or the server rejects the request
+ */
+std::vector<double> client::infer(const std::vector<double>& x) {
+    uint32_t n = x.size();
+    if (n == 0 || !writeall(fd, &n, sizeof(n)) || !writeall(fd, x.data(), n * sizeof(double)))
+        throw std::runtime_error("-_-CANNOT SEND REQUEST-_-");
+    uint32_t m;
+    if (!readall(fd, &m, sizeof(m)))
+        throw std::runtime_error("-_-CONNECTION CLOSED-_-");
+    if (m == 0)
+        throw std::runtime_error("-_-SERVER REJECTED THE REQUEST-_-");
+    std::vector<double> y(m);
+    if (!readall(fd, y.data(), m * sizeof(double)))
+        throw std::runtime_error("-_-CONNECTION CLOSED-_-");
+    return y;
+}
+
+/**
+ * @brief the server's statistics line
+ */
+std::string client::stats() {
+    uint32_t n = 0, len;
+    if (!writeall(fd, &n, sizeof(n)) || !readall(fd, &len, sizeof(len)))
+        throw std::runtime_error("-_-CONNECTION CLOSED-_-");
+    std::string text(len, '\0');
+    if (!readall(fd, text.data(), len))
+        throw std::runtime_error("-_-CONNECTION CLOSED-_-");
+    return text;
+}
+
+client::~client() {
+    if (fd >= 0) close(fd);
+}
@@ -1,8 +1,10 @@
 
 // train.cpp: Training, Validation and Testing Functions for MLP
 #include "include/mlp.hpp"
+#include <cmath>
 #include <iostream>
 #include <vector>
+#include <stdexcept>
 
 /**
  * @brief Training fucntion for MLP (error threshold: 10^-6)
@@ -32,8 +34,8 @@ void mlp::train(std::vector<std::vector<double>> inputs) {
     double total_mse = 0.0;
     while (1) {
         for (const auto& single_input : inputs) {
-            // Set the current input
-            input = single_input;
+            // Load the current input (normalised in place)
+            loadInput(single_input);
             // Perform forward propagation
             forward();
             // Calculate mean squared error for the current input
@@ -56,6 +58,62 @@ void mlp::train(std::vector<std::vector<double>> inputs) {
     mse = total_mse;
 }
 
+/**
+ * @brief Training function using multiple sparse inputs for MLP
+ * (error threshold: 10^-7, at most epochs passes)
+ * @param inputs sparse input vectors, one per sample
+ */
+void mlp::train(std::vector<sparsevec> inputs) {
+    unsigned int e = 0;
+    double total_mse = 0.0;
+    while (e < epochs) {
+        total_mse = 0.0;
+        for (const auto& single_input : inputs) {
+            // Perform forward propagation on the nonzeros only
+            forward(single_input);
+            // Calculate mean squared error for the current input
+            double current_mse = 0.0;
+            for (size_t i = 0; i < output.size(); ++i) {
+                current_mse += std::pow(expected[i] - output[i], 2);
+            }
+            current_mse /= output.size();
+            total_mse += current_mse;
+            // Perform backward propagation
+            backward();
+        }
+        e++;
+        // Calculate average MSE for the epoch
+        total_mse /= inputs.size();
+        std::cout << "Epoch " << e << " Average MSE: " << total_mse << std::endl;
+        if(total_mse < 1e-7)
+            break;
+    }
+    mse = total_mse;
+}
+
+/**
+ * @brief Fit the input normalisation in one pass over the training samples.
+ * The fitted statistics are kept in the model (norm) and applied to every
+ * sample as it is loaded, so the dataset itself is never rewritten.
+ * @param inputs training samples
+ * @param method normalisation method
+ */
+void mlp::fitScaler(const std::vector<std::vector<double>>& inputs, scaling method) {
+    norm = scaler(in, method);
+    norm.fit(inputs);
+}
+
+/**
+ * @brief Copy a sample into the input buffer and normalise it in place
+ * @param x sample of length in
+ */
+void mlp::loadInput(const std::vector<double>& x) {
+    if (x.size() != in)
+        throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+    input.assign(x.begin(), x.end());
+    norm.transform(input.data());
+}
+
 /**
  * @brief Validation function for MLP
  */
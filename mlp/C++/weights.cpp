@@ -1,36 +1,112 @@
 
 #include "include/mlp.hpp"
+#include "include/philox.hpp"
 #include <random>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <stdexcept>
 
 /**
- * @brief Function to initialize the weights of the multi-layer perceptron.
- * This function initializes the weights of the mlp using a normal distribution
- * with a mean of 0.0 and a standard deviation of 1.0.
+ * @brief Run f(i) for i in [0, count) on threads threads, i = id, id + threads, ...
  */
-void mlp::initializeWeights() {
-    // random number generator
-    std::random_device rd;      // device
-    std::mt19937 gen(rd());     // generator
-    std::normal_distribution<double> dis(0.0, 1.0);     // min and max of distribution
+template<class F>
+static void parallel(unsigned int threads, size_t count, F f) {
+    threads = (unsigned int)std::min<size_t>(std::max(1u, threads), std::max<size_t>(1, count));
+    auto run = [&](unsigned int id) {
+        for (size_t i = id; i < count; i += threads) f(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned int id = 1; id < threads; id++) pool.emplace_back(run, id);
+    run(0);
+    for (std::thread& th : pool) th.join();
+}
 
-    // initialize input to hidden weights
-    for(int i = 0; i < neurons; i++) {
-        for(int j = 0; j < in; j++) {
-            iweights[i][j] = dis(gen) * (j+1);
-        }
+/**
+ * @brief Make the rows (if rows <= cols) or else the columns of a matrix
+ * orthonormal, by modified Gram-Schmidt applied twice (which keeps the
+ * result orthogonal to rounding even when the input is nearly dependent)
+ */
+static void orthonormalize(std::vector<std::vector<double>>& m) {
+    const size_t rows = m.size(), cols = rows ? m[0].size() : 0;
+    const bool byrows = rows <= cols;
+    const size_t count = byrows ? rows : cols, length = byrows ? cols : rows;
+    std::vector<std::vector<double>> v(count, std::vector<double>(length));
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) (byrows ? v[i][j] : v[j][i]) = m[i][j];
     }
-    // initialize hidden to hidden weights
-    for(int i = 0; i < layers-1; i++) {
-        for(int j = 0; j < neurons; j++) {
-            for(int k = 0; k < neurons; k++) {
-                weights[i][j][k] = (i+j + dis(gen)) / (k+1);
+    for (size_t i = 0; i < count; i++) {
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t k = 0; k < i; k++) {
+                double d = 0.0;
+                for (size_t j = 0; j < length; j++) d += v[i][j] * v[k][j];
+                for (size_t j = 0; j < length; j++) v[i][j] -= d * v[k][j];
             }
         }
+        double norm = 0.0;
+        for (double x : v[i]) norm += x * x;
+        norm = std::sqrt(norm);
+        if (norm == 0.0)
+            throw std::runtime_error("-_-CANNOT ORTHOGONALIZE A RANK-DEFICIENT MATRIX-_-");
+        for (double& x : v[i]) x /= norm;
+    }
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) m[i][j] = byrows ? v[i][j] : v[j][i];
     }
-    // initialize hidden to output weights
-    for(int i = 0; i < out; i++) {
-        for(int j = 0; j < neurons; j++) {
-            oweights[i][j] = dis(gen) * (j+1);
+}
+
+/**
+ * @brief Function to initialize the weights of the multi-layer perceptron
+ * with Xavier (Glorot) normal weights from a fresh random seed; use the
+ * seeded overload for reproducible runs.
+ */
+void mlp::initializeWeights() {
+    std::random_device rd;
+    initializeWeights(initialization::xavier, ((uint64_t)rd() << 32) | rd());
+}
+
+/**
+ * @brief Initialize the weights from a counter-based generator: weight
+ * (row, col) of tensor s is element row * cols + col of Philox stream s
+ * (iweights is stream 0, weights[l] stream l + 1, oweights stream layers),
+ * so the result depends only on the seed, never on threads.
+ * - he: N(0, 2 / fan_in), for ReLU-like layers
+ * - xavier: N(0, 2 / (fan_in + fan_out)), for sigmoid/tanh layers
+ * - orthogonal: Gaussian matrices made row- (or column-) orthonormal,
+ *   which keeps the norm of signals and gradients through deep stacks
+ * @param scheme initialization scheme
+ * @param seed generator seed
+ * @param threads number of threads filling the tensors
+ */
+void mlp::initializeWeights(initialization scheme, uint64_t seed, unsigned int threads) {
+    struct tensor {
+        std::vector<std::vector<double>>* m;
+        uint32_t stream;
+        double stddev;
+    };
+    auto stddev = [scheme](double fanin, double fanout) {
+        switch (scheme) {
+            case initialization::he: return std::sqrt(2.0 / fanin);
+            case initialization::xavier: return std::sqrt(2.0 / (fanin + fanout));
+            default: return 1.0;
         }
+    };
+    std::vector<tensor> tensors;
+    tensors.push_back({&iweights, 0, stddev(in, neurons)});
+    for (unsigned int l = 0; l < weights.size(); l++) tensors.push_back({&weights[l], l + 1, stddev(neurons, neurons)});
+    tensors.push_back({&oweights, layers, stddev(neurons, out)});
+
+    // rows of every tensor are independent work items
+    std::vector<std::pair<unsigned int, size_t>> rows;
+    for (unsigned int s = 0; s < tensors.size(); s++) {
+        for (size_t i = 0; i < tensors[s].m->size(); i++) rows.push_back({s, i});
     }
+    const philox gen(seed);
+    parallel(threads, rows.size(), [&](size_t r) {
+        const tensor& t = tensors[rows[r].first];
+        std::vector<double>& row = (*t.m)[rows[r].second];
+        gen.normal(row.data(), row.size(), t.stream, rows[r].second * row.size(), 0.0, t.stddev);
+    });
+    if (scheme == initialization::orthogonal)
+        parallel(threads, tensors.size(), [&](size_t s) { orthonormalize(*tensors[s].m); });
 }
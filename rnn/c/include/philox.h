@@ -0,0 +1,16 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Philox4x32-10 counter-based random numbers: element index of stream is a
+// pure function of (seed, stream, index), so tensors can be filled in any
+// order or in parallel with identical results. Same bits as the C++ philox.
+void philox_block(uint64_t seed, uint32_t counter[4]);
+double philox_uniform(uint64_t seed, uint32_t stream, uint64_t index);
+double philox_normal(uint64_t seed, uint32_t stream, uint64_t index);
+void philox_fill_normal(double* out, size_t n, uint64_t seed, uint32_t stream, uint64_t first,
+                        double mean, double stddev);
+
+#endif // PHILOX_H
@@ -15,8 +15,18 @@
 #define RNN_H 1
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "activations.h"
 
+/**
+ * @brief Weight initialization schemes (see rnn_initialize_weights_seeded)
+ */
+typedef enum rnn_init {
+    RNN_INIT_HE,                // N(0, 2 / fan_in)
+    RNN_INIT_XAVIER,            // N(0, 2 / (fan_in + fan_out))
+    RNN_INIT_ORTHOGONAL         // orthonormal rows or columns
+} rnn_init_t;
+
 /**
  * @brief Recurrent Neural Network structure
  */
@@ -72,6 +82,7 @@ void rnn_train_sequences(rnn_t* rnn, double**** sequences, unsigned int num_sequ
 void rnn_validate(rnn_t* rnn);
 void rnn_test(rnn_t* rnn);
 void rnn_initialize_weights(rnn_t* rnn);
+int rnn_initialize_weights_seeded(rnn_t* rnn, rnn_init_t scheme, uint64_t seed);  // reproducible
 
 double** rnn_predict(rnn_t* rnn, double*** input_sequence);
 
@@ -0,0 +1,113 @@
+
+#include "include/philox.h"
+#include <math.h>
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_LANES 16
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * @brief Philox4x32-10 block (Salmon et al., SC 2011)
+ * @param[in] seed The 64-bit key
+ * @param[in,out] counter The four counter words, replaced by the output words
+ */
+void philox_block(uint64_t seed, uint32_t counter[4]) {
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (int r = 0; r < 10; r++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * counter[0], p1 = (uint64_t)PHILOX_M1 * counter[2];
+        uint32_t x1 = counter[1], x3 = counter[3];
+        counter[0] = (uint32_t)(p1 >> 32) ^ x1 ^ k0;
+        counter[1] = (uint32_t)p1;
+        counter[2] = (uint32_t)(p0 >> 32) ^ x3 ^ k1;
+        counter[3] = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+// 53-bit uniform in [0, 1) from two words
+static double philox_unit(uint32_t hi, uint32_t lo) {
+    return (double)((((uint64_t)hi << 32) | lo) >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Uniform element of a stream; element index uses block index / 2
+ * @param[in] seed The generator seed
+ * @param[in] stream The stream (tensor) number
+ * @param[in] index The element number
+ * @return A value in [0, 1)
+ */
+double philox_uniform(uint64_t seed, uint32_t stream, uint64_t index) {
+    uint32_t c[4] = {(uint32_t)(index >> 1), (uint32_t)(index >> 33), stream, 0};
+    philox_block(seed, c);
+    return (index & 1) ? philox_unit(c[2], c[3]) : philox_unit(c[0], c[1]);
+}
+
+/**
+ * @brief Standard normal element of a stream (Box-Muller over the block's
+ * two uniforms: cosine for even elements, sine for odd ones)
+ * @param[in] seed The generator seed
+ * @param[in] stream The stream (tensor) number
+ * @param[in] index The element number
+ * @return A normal value
+ */
+double philox_normal(uint64_t seed, uint32_t stream, uint64_t index) {
+    uint32_t c[4] = {(uint32_t)(index >> 1), (uint32_t)(index >> 33), stream, 0};
+    philox_block(seed, c);
+    double r = sqrt(-2.0 * log1p(-philox_unit(c[0], c[1])));
+    double theta = 2.0 * M_PI * philox_unit(c[2], c[3]);
+    return r * ((index & 1) ? sin(theta) : cos(theta));
+}
+
+/**
+ * @brief Fill out with normal elements first .. first + n - 1 of a stream,
+ * PHILOX_LANES blocks at a time so the rounds vectorise; equal to
+ * mean + stddev * philox_normal() for each element
+ * @param[out] out The n values
+ * @param[in] n The number of values
+ * @param[in] seed The generator seed
+ * @param[in] stream The stream (tensor) number
+ * @param[in] first The index of out[0]
+ * @param[in] mean The mean
+ * @param[in] stddev The standard deviation
+ */
+void philox_fill_normal(double* out, size_t n, uint64_t seed, uint32_t stream, uint64_t first,
+                        double mean, double stddev) {
+    if (n == 0) return;
+    uint32_t c0[PHILOX_LANES], c1[PHILOX_LANES], c2[PHILOX_LANES], c3[PHILOX_LANES];
+    const uint64_t last = first + n, begin = first >> 1, end = ((last - 1) >> 1) + 1;
+    for (uint64_t b = begin; b < end; b += PHILOX_LANES) {
+        for (int i = 0; i < PHILOX_LANES; i++) {
+            c0[i] = (uint32_t)(b + i);
+            c1[i] = (uint32_t)((b + i) >> 32);
+            c2[i] = stream;
+            c3[i] = 0;
+        }
+        uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+        for (int r = 0; r < 10; r++) {
+            for (int i = 0; i < PHILOX_LANES; i++) {
+                uint64_t p0 = (uint64_t)PHILOX_M0 * c0[i], p1 = (uint64_t)PHILOX_M1 * c2[i];
+                uint32_t x1 = c1[i], x3 = c3[i];
+                c0[i] = (uint32_t)(p1 >> 32) ^ x1 ^ k0;
+                c1[i] = (uint32_t)p1;
+                c2[i] = (uint32_t)(p0 >> 32) ^ x3 ^ k1;
+                c3[i] = (uint32_t)p0;
+            }
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        for (int i = 0; i < PHILOX_LANES && b + i < end; i++) {
+            uint64_t e = 2 * (b + i);
+            double r = sqrt(-2.0 * log1p(-philox_unit(c0[i], c1[i])));
+            double theta = 2.0 * M_PI * philox_unit(c2[i], c3[i]);
+            if (e >= first) out[e - first] = mean + stddev * (r * cos(theta));
+            if (e + 1 < last) out[e + 1 - first] = mean + stddev * (r * sin(theta));
+        }
+    }
+}
@@ -2,7 +2,6 @@
 #include "include/rnn.h"
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include <math.h>
 
 /**
@@ -83,24 +82,8 @@ int rnn_init(rnn_t *rnn, int input_size, int hidden_size, int output_size) {
     rnn->expected = NULL;
     rnn->hidden_states = NULL;
     
-    // Initialize weights with small random values
-    srand(time(NULL));
-    for (int i = 0; i < hidden_size; i++) {
-        for (int j = 0; j < input_size; j++) {
-            rnn->Wxh[i][j] = ((double)rand() / RAND_MAX) * 0.1 - 0.05;
-        }
-        for (int j = 0; j < hidden_size; j++) {
-            rnn->Whh[i][j] = ((double)rand() / RAND_MAX) * 0.1 - 0.05;
-        }
-        rnn->bh[i] = 0.0;
-    }
-    
-    for (int i = 0; i < output_size; i++) {
-        for (int j = 0; j < hidden_size; j++) {
-            rnn->Why[i][j] = ((double)rand() / RAND_MAX) * 0.1 - 0.05;
-        }
-        rnn->by[i] = 0.0;
-    }
+    // Initialize weights (Xavier) and zero biases
+    rnn_initialize_weights(rnn);
     
     return 1; // Success
 }
\ No newline at end of file
@@ -1,75 +1,102 @@
 
 #include "include/rnn.h"
+#include "include/philox.h"
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-/**
- * @brief Generate a random number from a normal distribution
- * @param[in] mean The mean of the distribution
- * @param[in] stddev The standard deviation of the distribution
- * @return A random number from the specified normal distribution
- */
-double normal_random(double mean, double stddev) {
-    // Generate two uniform random numbers between 0 and 1
-    double u1 = (double)rand() / RAND_MAX;
-    double u2 = (double)rand() / RAND_MAX;
-    
-    // Apply the Box-Muller transform to get a standard normal random number
-    double z = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
-    
-    // Scale and shift the number to match the desired mean and standard deviation
-    return mean + stddev * z;
-}
-
 /**
- * @brief Initialize the weights of a recurrent neural network with random values
- * @param[in] net The RNN to initialize
+ * @brief Make the rows (if rows <= cols) or else the columns of a matrix
+ * orthonormal with modified Gram-Schmidt, applied twice for stability
+ * @param[in,out] m The matrix [rows][cols]
+ * @param[in] rows The number of rows
+ * @param[in] cols The number of columns
+ * @return 1 if successful, 0 if out of memory or the matrix is rank-deficient
  */
-void initializeWeights(struct rnn* net) {
-    // Seed the random number generator
-    srand((unsigned int)time(NULL));
-
-    // Xavier/Glorot initialization scaling factor for input weights
-    double input_scale = sqrt(2.0 / (net->in + net->hidden));
-    
-    // Xavier/Glorot initialization scaling factor for recurrent weights
-    double recurrent_scale = sqrt(2.0 / (net->hidden * 2));
-    
-    // Xavier/Glorot initialization scaling factor for output weights
-    double output_scale = sqrt(2.0 / (net->hidden + net->out));
-
-    // Initialize input to hidden weights
-    for (int i = 0; i < net->hidden; i++) {
-        for (int j = 0; j < net->in; j++) {
-            net->inputs[i][j] = normal_random(0.0, input_scale);
+static int orthonormalize(double** m, unsigned int rows, unsigned int cols) {
+    int byrows = rows <= cols;
+    size_t count = byrows ? rows : cols, length = byrows ? cols : rows;
+    double* v = (double*)malloc(count * length * sizeof(double));
+    if (!v) return 0;
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            if (byrows) v[i * length + j] = m[i][j];
+            else v[j * length + i] = m[i][j];
         }
     }
-
-    // Initialize hidden to hidden (recurrent) weights
-    for (int i = 0; i < net->hidden; i++) {
-        for (int j = 0; j < net->hidden; j++) {
-            net->hidden_states[i][j] = normal_random(0.0, recurrent_scale);
+    for (size_t i = 0; i < count; i++) {
+        double* vi = v + i * length;
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t k = 0; k < i; k++) {
+                const double* vk = v + k * length;
+                double d = 0.0;
+                for (size_t j = 0; j < length; j++) d += vi[j] * vk[j];
+                for (size_t j = 0; j < length; j++) vi[j] -= d * vk[j];
+            }
         }
-    }
-
-    // Initialize hidden to output weights
-    for (int i = 0; i < net->out; i++) {
-        for (int j = 0; j < net->hidden; j++) {
-            net->outputs[i][j] = normal_random(0.0, output_scale);
+        double norm = 0.0;
+        for (size_t j = 0; j < length; j++) norm += vi[j] * vi[j];
+        norm = sqrt(norm);
+        if (norm == 0.0) {
+            free(v);
+            return 0;
         }
+        for (size_t j = 0; j < length; j++) vi[j] /= norm;
     }
-    
-    // Initialize biases to zero
-    for (int i = 0; i < net->hidden; i++) {
-        net->bh[i] = 0.0;
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) m[i][j] = byrows ? v[i * length + j] : v[j * length + i];
     }
-    
-    for (int i = 0; i < net->out; i++) {
-        net->by[i] = 0.0;
+    free(v);
+    return 1;
+}
+
+/**
+ * @brief Fill a weight matrix from a Philox stream: weight (row, col) is
+ * element row * cols + col, then orthonormalise it for RNN_INIT_ORTHOGONAL
+ * @return 1 if successful, 0 otherwise
+ */
+static int fill(double** m, unsigned int rows, unsigned int cols, uint64_t seed, uint32_t stream,
+                rnn_init_t scheme) {
+    double stddev = 1.0;
+    if (scheme == RNN_INIT_HE) stddev = sqrt(2.0 / cols);
+    else if (scheme == RNN_INIT_XAVIER) stddev = sqrt(2.0 / (cols + rows));
+    for (unsigned int i = 0; i < rows; i++) {
+        philox_fill_normal(m[i], cols, seed, stream, (uint64_t)i * cols, 0.0, stddev);
     }
+    return scheme == RNN_INIT_ORTHOGONAL ? orthonormalize(m, rows, cols) : 1;
+}
+
+/**
+ * @brief Initialize the weights of a recurrent neural network from a
+ * counter-based generator, so the values depend only on the seed: Wxh, Whh
+ * and Why are Philox streams 0, 1 and 2. Biases start at zero.
+ * - RNN_INIT_HE: N(0, 2 / fan_in)
+ * - RNN_INIT_XAVIER: N(0, 2 / (fan_in + fan_out)), suits the tanh hidden layer
+ * - RNN_INIT_ORTHOGONAL: orthonormal rows (or columns); an orthogonal Whh
+ *   neither grows nor shrinks the hidden state through time
+ * @param[in,out] rnn The RNN to initialize
+ * @param[in] scheme The initialization scheme
+ * @param[in] seed The generator seed
+ * @return 1 if successful, 0 otherwise
+ */
+int rnn_initialize_weights_seeded(rnn_t* rnn, rnn_init_t scheme, uint64_t seed) {
+    if (!rnn) return 0;
+    if (!fill(rnn->Wxh, rnn->hidden, rnn->in, seed, 0, scheme) ||
+        !fill(rnn->Whh, rnn->hidden, rnn->hidden, seed, 1, scheme) ||
+        !fill(rnn->Why, rnn->out, rnn->hidden, seed, 2, scheme))
+        return 0;
+    for (unsigned int i = 0; i < rnn->hidden; i++) rnn->bh[i] = 0.0;
+    for (unsigned int i = 0; i < rnn->out; i++) rnn->by[i] = 0.0;
+    return 1;
+}
+
+/**
+ * @brief Initialize the weights of a recurrent neural network with Xavier
+ * (Glorot) normal values from a time-based seed; use
+ * rnn_initialize_weights_seeded() for reproducible runs
+ * @param[in,out] rnn The RNN to initialize
+ */
+void rnn_initialize_weights(rnn_t* rnn) {
+    uint64_t seed = ((uint64_t)time(NULL) << 32) ^ (uint64_t)clock() ^ (uint64_t)(uintptr_t)rnn;
+    rnn_initialize_weights_seeded(rnn, RNN_INIT_XAVIER, seed);
 }
@@ -0,0 +1,202 @@
+// backprop.cpp: backpropagation through time (BPTT) for rnn
+#include "include/rnn.hpp"
+#include <cmath>
+#include <algorithm>
+
+typedef std::vector<std::vector<double>> matrix;
+
+//----------------KERNELS----------------//
+
+/**
+ * @brief BPTT for the Elman network of forprop.cpp: the gradient of
+ * 1/2 sum_t ||y[t] - expected[t]||^2 (over the steps that have a target) is
+ * added to the gradient arguments. With layer normalisation the error
+ * passes back through the LayerNorm after the tanh, and bh gets the
+ * gradient of its shift. Reads only the weights and the forward state
+ * passed in.
+ * @param net model
+ * @param inputs input sequence
+ * @param expected targets (steps past expected.size() are not scored)
+ * @param hs hidden states from the forward pass
+ * @param ys outputs from the forward pass
+ * @param xh normalised pre-activations from the forward pass (layer norm only)
+ * @param rs 1 / std of each step from the forward pass (layer norm only)
+ * @param dWxh, dWhh, dWhy, dbh, dby, dgamma gradients (accumulated)
+ * @param dh scratch of length hidden
+ * @param dhnext scratch of length hidden
+ * @return mean squared error over the scored steps
+ */
+static double bptt(const rnn& net, const matrix& inputs, const matrix& expected, const matrix& hs,
+                   const matrix& ys, const matrix& xh, const std::vector<double>& rs,
+                   matrix& dWxh, matrix& dWhh, matrix& dWhy,
+                   std::vector<double>& dbh, std::vector<double>& dby, std::vector<double>& dgamma,
+                   std::vector<double>& dh, std::vector<double>& dhnext) {
+    const unsigned int H = net.hidden;
+    const bool ln = net.normalize == normalization::layer;
+    const size_t steps = inputs.size();
+    double loss = 0.0;
+    size_t scored = 0;
+    std::fill(dhnext.begin(), dhnext.end(), 0.0);
+    for (size_t t = steps; t-- > 0;) {
+        const std::vector<double>& h = hs[t + 1];
+        const std::vector<double>& prev = hs[t];
+        // error carried back from step t + 1, plus the output error of this step
+        std::copy(dhnext.begin(), dhnext.end(), dh.begin());
+        if (t < expected.size()) {
+            for (unsigned int i = 0; i < net.out; i++) {
+                double e = ys[t][i] - expected[t][i];
+                loss += e * e;
+                dby[i] += e;
+                for (unsigned int j = 0; j < H; j++) {
+                    dWhy[i][j] += e * h[j];
+                    dh[j] += e * net.Why[i][j];
+                }
+            }
+            scored++;
+        }
+        // through the tanh
+        for (unsigned int j = 0; j < H; j++) dh[j] *= 1.0 - h[j] * h[j];
+        if (ln) layernormback(dh.data(), xh[t].data(), H, rs[t], net.gamma.data(), dh.data(), dgamma.data(), dbh.data());
+        std::fill(dhnext.begin(), dhnext.end(), 0.0);
+        const std::vector<double>& x = inputs[t];
+        for (unsigned int j = 0; j < H; j++) {
+            double d = dh[j];
+            if (!ln) dbh[j] += d;
+            if (d == 0.0) continue;
+            for (size_t k = 0; k < x.size(); k++) dWxh[j][k] += d * x[k];
+            for (unsigned int k = 0; k < H; k++) {
+                dWhh[j][k] += d * prev[k];
+                dhnext[k] += d * net.Whh[j][k];
+            }
+        }
+    }
+    return scored ? loss / (scored * net.out) : 0.0;
+}
+
+/**
+ * @brief scale the gradients so that their global L2 norm is at most threshold
+ */
+static void clip(matrix& dWxh, matrix& dWhh, matrix& dWhy, std::vector<double>& dbh,
+                 std::vector<double>& dby, std::vector<double>& dgamma, double threshold) {
+    double sq = 0.0;
+    for (const auto& row : dWxh) for (double v : row) sq += v * v;
+    for (const auto& row : dWhh) for (double v : row) sq += v * v;
+    for (const auto& row : dWhy) for (double v : row) sq += v * v;
+    for (double v : dbh) sq += v * v;
+    for (double v : dby) sq += v * v;
+    for (double v : dgamma) sq += v * v;
+    double norm = std::sqrt(sq);
+    if (norm <= threshold || norm == 0.0) return;
+    double s = threshold / norm;
+    for (auto& row : dWxh) for (double& v : row) v *= s;
+    for (auto& row : dWhh) for (double& v : row) v *= s;
+    for (auto& row : dWhy) for (double& v : row) v *= s;
+    for (double& v : dbh) v *= s;
+    for (double& v : dby) v *= s;
+    for (double& v : dgamma) v *= s;
+}
+
+/**
+ * @brief gradient descent step on every weight and bias
+ */
+static void descend(rnn& net, const matrix& dWxh, const matrix& dWhh, const matrix& dWhy,
+                    const std::vector<double>& dbh, const std::vector<double>& dby,
+                    const std::vector<double>& dgamma, double rate) {
+    auto step = [rate](matrix& w, const matrix& g) {
+        for (size_t i = 0; i < w.size(); i++) {
+            for (size_t j = 0; j < w[i].size(); j++) w[i][j] -= rate * g[i][j];
+        }
+    };
+    step(net.Wxh, dWxh);
+    step(net.Whh, dWhh);
+    step(net.Why, dWhy);
+    for (size_t i = 0; i < net.bh.size(); i++) net.bh[i] -= rate * dbh[i];
+    for (size_t i = 0; i < net.by.size(); i++) net.by[i] -= rate * dby[i];
+    for (size_t i = 0; i < net.gamma.size() && i < dgamma.size(); i++) net.gamma[i] -= rate * dgamma[i];
+}
+
+//----------------MODEL STATE----------------//
+
+/**
+ * @brief Backward pass through time over the loaded sequence. The gradients
+ * (dWxh, dWhh, dWhy, dbh, dby) are recomputed from zero; call forward()
+ * first and update_weights() after.
+ */
+void rnn::backward() {
+    for (auto& row : dWxh) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& row : dWhh) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& row : dWhy) std::fill(row.begin(), row.end(), 0.0);
+    std::fill(dbh.begin(), dbh.end(), 0.0);
+    std::fill(dby.begin(), dby.end(), 0.0);
+    dgamma.assign(gamma.size(), 0.0);
+    std::vector<double> dh(hidden), dhnext(hidden);
+    mse = bptt(*this, inputs, expected, hidden_states, outputs, xhat, rstd, dWxh, dWhh, dWhy, dbh, dby, dgamma,
+               dh, dhnext);
+}
+
+/**
+ * @brief gradient descent step with the gradients of backward()
+ */
+void rnn::update_weights() {
+    descend(*this, dWxh, dWhh, dWhy, dbh, dby, dgamma, learning);
+}
+
+/**
+ * @brief Rescale the gradients to a global L2 norm of at most threshold
+ * @param threshold largest allowed gradient norm
+ */
+void rnn::clip_gradients(double threshold) {
+    clip(dWxh, dWhh, dWhy, dbh, dby, dgamma, threshold);
+}
+
+//----------------WORKER STATE----------------//
+
+/**
+ * @brief BPTT over a worker's sequence. The gradient is added to the
+ * worker's accumulators; the weights are only read, so workers can run
+ * concurrently. Call forward(w) first.
+ * @param w worker
+ * @return mean squared error of the sequence
+ */
+double rnn::backward(worker& w) const {
+    if (w.dgamma.size() != gamma.size()) w.dgamma.assign(gamma.size(), 0.0);
+    double loss = bptt(*this, w.inputs, w.expected, w.hidden_states, w.outputs, w.xhat, w.rstd,
+                       w.dWxh, w.dWhh, w.dWhy, w.dbh, w.dby, w.dgamma, w.dh, w.dhnext);
+    w.samples++;
+    return loss;
+}
+
+/**
+ * @brief Rescale a worker's gradients to a global L2 norm of at most threshold
+ * @param w worker
+ * @param threshold largest allowed gradient norm
+ */
+void rnn::clip_gradients(worker& w, double threshold) const {
+    clip(w.dWxh, w.dWhh, w.dWhy, w.dbh, w.dby, w.dgamma, threshold);
+}
+
+/**
+ * @brief Apply a worker's accumulated gradient (averaged over its sequences)
+ * and clear it. Not thread-safe: one thread updates while no worker runs.
+ * @param w worker
+ */
+void rnn::update(worker& w) {
+    if (w.samples > 0)
+        descend(*this, w.dWxh, w.dWhh, w.dWhy, w.dbh, w.dby, w.dgamma, learning / w.samples);
+    w.zero();
+}
+
+/**
+ * @brief Apply the gradients of several workers as one step averaged over
+ * all of their sequences, then clear them
+ * @param workers workers that ran on disjoint parts of a batch
+ */
+void rnn::update(std::vector<worker>& workers) {
+    unsigned int total = 0;
+    for (const worker& w : workers) total += w.samples;
+    for (worker& w : workers) {
+        if (total > 0 && w.samples > 0)
+            descend(*this, w.dWxh, w.dWhh, w.dWhy, w.dbh, w.dby, w.dgamma, learning / total);
+        w.zero();
+    }
+}
@@ -0,0 +1,137 @@
+// compiled.cpp: training rnn through a compiled computation graph
+#include "include/rnn.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+//----------------GRAPH----------------//
+
+/**
+ * @brief Build the unrolled training step of a batch of sequences as a
+ * graph: inputs x[t] (in x batch, one sequence per column, node t) and
+ * targets (out x batch, node time_steps + t) for every step,
+ *      h[t + 1] = tanh(Wxh x[t] + Whh h[t] + bh),  y[t] = Why h[t + 1] + by
+ * with h[0] = 0, and the loss ½ Σ_t ||y[t] - target[t]||² (an output), with
+ * its reverse pass (BPTT) adding into dWxh, dWhh, dWhy, dbh and dby. The
+ * bias, tanh and their derivatives fuse into the passes that read the
+ * products, and the steps' states share the planned memory.
+ * @param batch sequences per run
+ * @param threads workers for run()
+ * @return the compiled graph; it refers to the model's weights and gradients
+ * @throws std::invalid_argument if batch is zero
+ * @throws std::runtime_error if the model is layer normalised
+ */
+graph rnn::compile(size_t batch, unsigned int threads) {
+    if (batch == 0)
+        throw std::invalid_argument("-_-BATCH SIZE MUST BE POSITIVE-_-");
+    if (normalize != normalization::none)
+        throw std::runtime_error("-_-GRAPH TRAINING DOES NOT SUPPORT NORMALISATION-_-");
+    graph g;
+    std::vector<unsigned int> x(time_steps), t(time_steps);
+    for (unsigned int s = 0; s < time_steps; s++) x[s] = g.input(in, batch);
+    for (unsigned int s = 0; s < time_steps; s++) t[s] = g.input(out, batch);
+    const unsigned int wxh = g.parameter(Wxh, &dWxh), whh = g.parameter(Whh, &dWhh);
+    const unsigned int why = g.parameter(Why, &dWhy);
+    const unsigned int b = g.parameter(bh, &dbh), c = g.parameter(by, &dby);
+    unsigned int h = 0, loss = 0;
+    for (unsigned int s = 0; s < time_steps; s++) {
+        unsigned int z = g.matmul(wxh, x[s]);
+        if (s > 0) z = g.add(z, g.matmul(whh, h));
+        h = g.tanh(g.add(z, b));
+        const unsigned int e = g.sub(g.add(g.matmul(why, h), c), t[s]);
+        const unsigned int l = g.sum(g.mul(e, e));
+        loss = s == 0 ? l : g.add(loss, l);
+    }
+    loss = g.scale(loss, 0.5);
+    g.output(loss);
+    g.gradient(loss);
+    g.compile(threads);
+    return g;
+}
+
+//----------------TRAINING----------------//
+
+/**
+ * @brief Mini-batch BPTT with the step compiled once (see
+ * compile(size_t, unsigned int)); a shorter last batch gets its own graph.
+ * Every step applies the gradient averaged over its sequences, like
+ * update(worker&) after backward(worker&) on each of them.
+ * @param sequences input sequences of time_steps steps (raw, normalised with the model's scaler)
+ * @param targets expected outputs of every step
+ * @param batch sequences per step
+ * @param threads workers for each step
+ * @return mean squared error of the last epoch
+ * @throws std::invalid_argument if batch is zero
+ * @throws std::runtime_error if sequences and targets differ in length, a sequence or step has
+ * the wrong size or the model is layer normalised
+ */
+double rnn::fit(const std::vector<std::vector<std::vector<double>>>& sequences,
+                const std::vector<std::vector<std::vector<double>>>& targets,
+                unsigned int batch, unsigned int threads) {
+    if (sequences.size() != targets.size())
+        throw std::runtime_error("-_-NUMBER OF SEQUENCES AND TARGETS SHOULD MATCH-_-");
+    for (size_t i = 0; i < sequences.size(); i++) {
+        if (sequences[i].size() != time_steps || targets[i].size() != time_steps)
+            throw std::runtime_error("-_-SEQUENCE LENGTH SHOULD MATCH TIME STEPS-_-");
+        for (size_t s = 0; s < time_steps; s++) {
+            if (sequences[i][s].size() != in || targets[i][s].size() != out)
+                throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+        }
+    }
+    graph step = compile(batch, threads), tail;
+    const size_t B = batch;
+    std::vector<std::vector<double>> input(time_steps, std::vector<double>(in * B));
+    std::vector<std::vector<double>> target(time_steps, std::vector<double>(out * B));
+    std::vector<double> sample(in);
+
+    auto descend = [](std::vector<std::vector<double>>& w, std::vector<std::vector<double>>& g, double rate) {
+        for (size_t i = 0; i < w.size(); i++) {
+            for (size_t j = 0; j < w[i].size(); j++) {
+                w[i][j] -= rate * g[i][j];
+                g[i][j] = 0.0;
+            }
+        }
+    };
+    auto shift = [](std::vector<double>& b, std::vector<double>& g, double rate) {
+        for (size_t i = 0; i < b.size(); i++) {
+            b[i] -= rate * g[i];
+            g[i] = 0.0;
+        }
+    };
+    for (auto* m : {&dWxh, &dWhh, &dWhy}) {
+        for (auto& row : *m) std::fill(row.begin(), row.end(), 0.0);
+    }
+    std::fill(dbh.begin(), dbh.end(), 0.0);
+    std::fill(dby.begin(), dby.end(), 0.0);
+    for (unsigned int e = 0; e < epochs; e++) {
+        double total = 0.0;
+        for (size_t s = 0; s < sequences.size(); s += B) {
+            const size_t R = std::min(B, sequences.size() - s);
+            if (R < B && tail.outputs().empty()) tail = compile(R, threads);
+            graph& g = R < B ? tail : step;
+            // one sequence per column
+            for (unsigned int k = 0; k < time_steps; k++) {
+                for (size_t r = 0; r < R; r++) {
+                    std::copy(sequences[s + r][k].begin(), sequences[s + r][k].end(), sample.begin());
+                    norm.transform(sample.data());
+                    for (unsigned int i = 0; i < in; i++) input[k][i * R + r] = sample[i];
+                    for (unsigned int i = 0; i < out; i++) target[k][i * R + r] = targets[s + r][k][i];
+                }
+                g.bind(k, input[k].data());
+                g.bind(time_steps + k, target[k].data());
+            }
+            g.run();
+            total += 2.0 * g.value(g.outputs()[0])[0] / ((double)time_steps * out);
+
+            const double rate = learning / R;
+            descend(Wxh, dWxh, rate);
+            descend(Whh, dWhh, rate);
+            descend(Why, dWhy, rate);
+            shift(bh, dbh, rate);
+            shift(by, dby, rate);
+        }
+        mse = sequences.empty() ? 0.0 : total / sequences.size();
+        std::cout << "Epoch " << e + 1 << " Average MSE: " << mse << std::endl;
+    }
+    return mse;
+}
@@ -0,0 +1,80 @@
+// distributed.cpp: data-parallel training of rnn over a ring of processes
+#include "include/rnn.hpp"
+#include "include/ring.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief Synchronous data-parallel training; every process of the ring
+ * calls it with the same data. Each step takes batch sequences per rank,
+ * accumulates their BPTT gradients in a worker and all-reduces them in
+ * buckets, then every rank takes the same step averaged over all sequences
+ * of the step, so the replicas stay identical (rank 0's weights and
+ * normalisation are copied to the others first). BPTT adds to every weight
+ * at every time step, so no gradient is final before the pass ends and the
+ * reduction starts after it. Runs epochs passes over the data.
+ * @param comm ring of processes (its compress flag selects fp16 gradients)
+ * @param sequences input sequences (raw, normalised with the model's scaler)
+ * @param targets expected outputs of each sequence
+ * @param batch sequences per rank per step
+ * @param bucket gradient bucket size in bytes
+ * @return mean squared error of the last epoch over all ranks
+ * @throws std::invalid_argument if batch is zero
+ * @throws std::runtime_error if sequences and targets differ in length or the ring fails
+ */
+double rnn::train(ring& comm, const std::vector<std::vector<std::vector<double>>>& sequences,
+                  const std::vector<std::vector<std::vector<double>>>& targets,
+                  unsigned int batch, size_t bucket) {
+    if (sequences.size() != targets.size())
+        throw std::runtime_error("-_-NUMBER OF SEQUENCES AND TARGETS SHOULD MATCH-_-");
+    if (batch == 0)
+        throw std::invalid_argument("-_-BATCH SIZE MUST BE POSITIVE-_-");
+
+    // identical replicas
+    for (auto* m : {&Wxh, &Whh, &Why}) {
+        for (auto& row : *m) comm.broadcast(row.data(), row.size());
+    }
+    comm.broadcast(bh.data(), bh.size());
+    comm.broadcast(by.data(), by.size());
+    if (!gamma.empty()) comm.broadcast(gamma.data(), gamma.size());
+    if (norm.fitted) {
+        comm.broadcast(norm.shift.data(), norm.shift.size());
+        comm.broadcast(norm.scale.data(), norm.scale.size());
+    }
+
+    worker w(*this);
+    reducer sync(comm, bucket);
+    sync.add(w.dWhy);
+    sync.add(w.dby);
+    sync.add(w.dWhh);
+    sync.add(w.dWxh);
+    sync.add(w.dbh);
+    if (!w.dgamma.empty()) sync.add(w.dgamma);
+
+    const size_t n = sequences.size(), stride = (size_t)comm.size * batch;
+    const size_t steps = (n + stride - 1) / stride;
+    for (unsigned int e = 0; e < epochs; e++) {
+        double sums[2] = {0.0, 0.0};        // loss, sequences
+        for (size_t s = 0; s < steps; s++) {
+            const size_t begin = std::min(n, s * stride + (size_t)comm.rank * batch);
+            const size_t end = std::min(n, begin + batch);
+            for (size_t i = begin; i < end; i++) {
+                loadSequence(w, sequences[i]);
+                w.expected = targets[i];
+                forward(w);
+                sums[0] += backward(w);
+            }
+            sync.wait();
+            sums[1] += end - begin;
+            // every rank knows how many sequences the step had in total
+            w.samples = std::min(n, (s + 1) * stride) - s * stride;
+            update(w);
+        }
+        comm.allreduce(sums, 2, true);
+        mse = sums[1] > 0 ? sums[0] / sums[1] : 0.0;
+        if (comm.rank == 0)
+            std::cout << "Epoch " << e + 1 << " Average MSE: " << mse << std::endl;
+    }
+    return mse;
+}
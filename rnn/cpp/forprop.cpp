@@ -0,0 +1,139 @@
+// forprop.cpp: forward propagation through time for rnn
+#include "include/rnn.hpp"
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+typedef std::vector<std::vector<double>> matrix;
+
+//----------------KERNELS----------------//
+
+/**
+ * @brief Elman forward pass over a sequence:
+ *      h[t + 1] = tanh(Wxh x[t] + Whh h[t] + bh),  y[t] = Why h[t + 1] + by
+ * with h[0] = 0; with layer normalisation the sum without bh is normalised,
+ * scaled by gamma and shifted by bh before the tanh. Reads only the
+ * weights, so it serves both the model's buffers and a worker's.
+ * @param net model
+ * @param inputs input sequence
+ * @param hs hidden states, resized to inputs.size() + 1
+ * @param ys outputs, resized to inputs.size()
+ * @param xh normalised pre-activations of each step (layer norm only)
+ * @param rs 1 / std of each step (layer norm only)
+ */
+static void unroll(const rnn& net, const matrix& inputs, matrix& hs, matrix& ys, matrix& xh,
+                   std::vector<double>& rs) {
+    const size_t steps = inputs.size();
+    const bool ln = net.normalize == normalization::layer;
+    if (hs.size() < steps + 1) hs.resize(steps + 1);
+    if (ys.size() < steps) ys.resize(steps);
+    if (ln && xh.size() < steps) xh.resize(steps, std::vector<double>(net.hidden));
+    if (ln && rs.size() < steps) rs.resize(steps);
+    hs[0].assign(net.hidden, 0.0);
+    for (size_t t = 0; t < steps; t++) {
+        const std::vector<double>& x = inputs[t];
+        const std::vector<double>& prev = hs[t];
+        std::vector<double>& h = hs[t + 1];
+        h.resize(net.hidden);
+        for (unsigned int i = 0; i < net.hidden; i++) {
+            double sum = ln ? 0.0 : net.bh[i];
+            sum += std::inner_product(x.begin(), x.end(), net.Wxh[i].begin(), 0.0);
+            sum += std::inner_product(prev.begin(), prev.end(), net.Whh[i].begin(), 0.0);
+            h[i] = ln ? sum : std::tanh(sum);
+        }
+        if (ln) {
+            layernorm(h.data(), net.hidden, net.gamma.data(), net.bh.data(), h.data(), xh[t].data(), &rs[t]);
+            for (double& v : h) v = std::tanh(v);
+        }
+        std::vector<double>& y = ys[t];
+        y.resize(net.out);
+        for (unsigned int i = 0; i < net.out; i++) {
+            y[i] = net.by[i] + std::inner_product(h.begin(), h.end(), net.Why[i].begin(), 0.0);
+        }
+    }
+}
+
+//----------------MODEL STATE----------------//
+
+/**
+ * @brief Forward pass through time over the loaded sequence (inputs),
+ * filling hidden_states and outputs
+ */
+void rnn::forward() {
+    unroll(*this, inputs, hidden_states, outputs, xhat, rstd);
+}
+
+/**
+ * @brief Run a sequence through the network and return the output of the
+ * last time step. The model is not modified.
+ * @param input_sequence raw input vectors, one per time step
+ * @return output after the last step
+ */
+std::vector<double> rnn::predict(std::vector<std::vector<double>> input_sequence) {
+    worker w(*this);
+    loadSequence(w, input_sequence);
+    forward(w);
+    return w.inputs.empty() ? std::vector<double>(out, 0.0) : w.outputs[w.inputs.size() - 1];
+}
+
+//----------------WORKER STATE----------------//
+
+/**
+ * @brief Shape a worker like the model and clear its gradients
+ * @param net model the worker will train or evaluate
+ */
+worker::worker(const rnn& net) : samples(0) {
+    inputs.assign(net.time_steps, std::vector<double>(net.in, 0.0));
+    expected.assign(net.time_steps, std::vector<double>(net.out, 0.0));
+    outputs.assign(net.time_steps, std::vector<double>(net.out, 0.0));
+    hidden_states.assign(net.time_steps + 1, std::vector<double>(net.hidden, 0.0));
+    dWxh.assign(net.hidden, std::vector<double>(net.in, 0.0));
+    dWhh.assign(net.hidden, std::vector<double>(net.hidden, 0.0));
+    dWhy.assign(net.out, std::vector<double>(net.hidden, 0.0));
+    dbh.assign(net.hidden, 0.0);
+    dby.assign(net.out, 0.0);
+    dh.assign(net.hidden, 0.0);
+    dhnext.assign(net.hidden, 0.0);
+    dgamma.assign(net.gamma.size(), 0.0);
+}
+
+/**
+ * @brief clear the accumulated gradients
+ */
+void worker::zero() {
+    for (auto& row : dWxh) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& row : dWhh) std::fill(row.begin(), row.end(), 0.0);
+    for (auto& row : dWhy) std::fill(row.begin(), row.end(), 0.0);
+    std::fill(dbh.begin(), dbh.end(), 0.0);
+    std::fill(dby.begin(), dby.end(), 0.0);
+    std::fill(dgamma.begin(), dgamma.end(), 0.0);
+    samples = 0;
+}
+
+/**
+ * @brief Copy a sequence into a worker and normalise it
+ * @param w worker
+ * @param seq input vectors, one per time step
+ * @throws std::runtime_error if the sequence is too long or a step has the wrong size
+ */
+void rnn::loadSequence(worker& w, const std::vector<std::vector<double>>& seq) const {
+    if (seq.size() > time_steps)
+        throw std::runtime_error("-_-SEQUENCE IS LONGER THAN TIME STEPS-_-");
+    w.inputs.resize(seq.size());
+    for (size_t t = 0; t < seq.size(); t++) {
+        if (seq[t].size() != in)
+            throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+        w.inputs[t].assign(seq[t].begin(), seq[t].end());
+        norm.transform(w.inputs[t].data());
+    }
+}
+
+/**
+ * @brief Forward pass through time of the worker's sequence. Only the
+ * weights are read; everything written belongs to the worker.
+ * @param w worker
+ */
+void rnn::forward(worker& w) const {
+    unroll(*this, w.inputs, w.hidden_states, w.outputs, w.xhat, w.rstd);
+}
@@ -0,0 +1,96 @@
+// graph.hpp: static computation graphs with fused, memory-planned, parallel execution
+#ifndef GRAPH_HPP
+#define GRAPH_HPP 1
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Static computation graph. Build it once with the operations below
+ * (every value is a rows x cols row-major matrix; a sample is a column),
+ * append its reverse pass with gradient(), compile() it, then bind the
+ * inputs and run() it every step. compile() turns the nodes into kernels:
+ * - fusion: an elementwise node whose only consumer is an elementwise node
+ *   of the same shape is computed inside its consumer's loop, so a chain
+ *   such as matmul -> bias -> tanh or the whole loss gradient is one pass
+ *   over memory, its intermediates living in per-thread L1 tiles
+ * - scheduling: each kernel gets a level one past the producers it reads;
+ *   the kernels of a level are independent and run in parallel on a
+ *   persistent pool, large ones split by rows
+ * - memory planning: only kernel outputs and packed parameters get
+ *   buffers, placed in one block by first fit over their lifetimes in
+ *   levels, so values that are never live together share memory
+ * Operands of elementwise nodes may be full, a column (rows x 1, repeated
+ * across the columns) or a scalar (1 x 1). Parameters are read from the
+ * model's vectors at every run and their gradients added back into the
+ * vectors given with them, which must not be resized while the graph lives.
+ * @param stats sizes after compile(): nodes, kernels, levels, and the
+ * doubles a node-per-buffer execution would need against the planned block
+ */
+class graph {
+public:
+    struct statistics {
+        size_t nodes = 0;           // nodes in the graph
+        size_t kernels = 0;         // passes over memory per run
+        size_t levels = 0;          // parallel steps per run
+        size_t naive = 0;           // doubles with one buffer per node
+        size_t planned = 0;         // doubles in the planned block
+    } stats;
+
+    graph();
+    graph(graph&&) noexcept;
+    graph& operator=(graph&&) noexcept;
+    ~graph();
+
+    unsigned int input(size_t rows, size_t cols);                    // bound before run()
+    unsigned int constant(double value);                             // 1 x 1
+    unsigned int parameter(const std::vector<std::vector<double>>& w, std::vector<std::vector<double>>* g = nullptr);
+    unsigned int parameter(const std::vector<double>& b, std::vector<double>* g = nullptr);   // column
+
+    unsigned int add(unsigned int a, unsigned int b);
+    unsigned int sub(unsigned int a, unsigned int b);
+    unsigned int mul(unsigned int a, unsigned int b);               // Hadamard product
+    unsigned int scale(unsigned int a, double s);
+    unsigned int sigmoid(unsigned int a);
+    unsigned int tanh(unsigned int a);
+    unsigned int relu(unsigned int a);
+    unsigned int selu(unsigned int a);
+    unsigned int matmul(unsigned int a, unsigned int b, bool ta = false, bool tb = false);  // op(a) op(b)
+    unsigned int sum(unsigned int a);                               // 1 x 1
+    unsigned int rowsum(unsigned int a);                            // rows x 1
+
+    void output(unsigned int a);                    // keep a's value after run()
+    const std::vector<unsigned int>& outputs() const { return kept; }
+    void gradient(unsigned int loss);               // reverse pass into every parameter with a gradient
+    void compile(unsigned int threads = 1);
+    void bind(unsigned int input, const double* x);
+    void run();
+    const double* value(unsigned int a) const;      // after run(): outputs and inputs
+    size_t rows(unsigned int a) const;
+    size_t cols(unsigned int a) const;
+
+private:
+    enum class op : uint8_t;
+    struct node;
+    struct kernel;
+    struct task;
+    struct pool;
+    std::vector<node> nodes;
+    std::vector<unsigned int> kept;                 // outputs, in order
+    std::vector<kernel> kernels;
+    std::vector<std::vector<task>> schedule;        // kernel pieces of each level
+    std::vector<double> memory;                     // planned block
+    std::vector<std::vector<double>> scratch;       // fused-loop tiles, one per thread
+    std::unique_ptr<pool> workers;
+    bool compiled = false;
+
+    unsigned int push(op kind, size_t rows, size_t cols, unsigned int a = 0, unsigned int b = 0, double s = 0.0);
+    unsigned int elementwise(op kind, unsigned int a, unsigned int b);
+    unsigned int reduce(unsigned int g, size_t rows, size_t cols);
+    double* address(unsigned int a) const;
+    void execute(const kernel&, size_t begin, size_t end, unsigned int thread);
+};
+
+#endif
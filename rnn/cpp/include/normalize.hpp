@@ -0,0 +1,37 @@
+// normalize.hpp: layer and batch normalisation kernels
+#ifndef NORMALIZE_HPP
+#define NORMALIZE_HPP 1
+
+#include <cstddef>
+
+/**
+ * @brief Normalisation of the hidden pre-activations z of a layer, applied
+ * before the activation:
+ * - none: z
+ * - layer: LayerNorm, statistics over the neurons of one sample
+ * - batch: BatchNorm, statistics of each neuron over a batch while
+ *   training, running averages at inference
+ * - folded: z + beta, a BatchNorm whose inference-time affine map
+ *   was folded into the preceding weights
+ */
+enum class normalization { none, layer, batch, folded };
+
+constexpr double NORM_EPSILON = 1e-5;       // added to every variance
+
+// y = gamma * (x - mean) / sqrt(var + eps) + beta over one vector; xhat and rstd are saved for backward if non-null
+void layernorm(const double* x, size_t n, const double* gamma, const double* beta, double* y,
+               double* xhat = nullptr, double* rstd = nullptr);
+// gradient of layernorm: dx from dy, dgamma and dbeta accumulated
+void layernormback(const double* dy, const double* xhat, size_t n, double rstd, const double* gamma,
+                   double* dx, double* dgamma, double* dbeta);
+// per-column normalisation of a rows x n matrix (row stride ld); batch mean, variance and 1 / std returned per column
+void batchnorm(const double* x, size_t rows, size_t n, size_t ld, const double* gamma, const double* beta,
+               double* y, double* xhat, double* mean, double* var, double* rstd);
+// gradient of batchnorm: dx from dy, dgamma and dbeta accumulated
+void batchnormback(const double* dy, const double* xhat, size_t rows, size_t n, size_t ld, const double* rstd,
+                   const double* gamma, double* dx, double* dgamma, double* dbeta);
+// inference-time normalisation of one vector (in place allowed); mean and var are read only for batch
+void normalized(normalization kind, const double* z, double* y, size_t n, const double* gamma,
+                const double* beta, const double* mean, const double* var);
+
+#endif
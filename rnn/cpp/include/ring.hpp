@@ -0,0 +1,113 @@
+// ring.hpp: ring all-reduce over TCP for data-parallel training
+#ifndef RING_HPP
+#define RING_HPP 1
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+uint16_t tohalf(float);         // IEEE binary16, round to nearest even
+float fromhalf(uint16_t);       // exact
+
+/**
+ * @brief One process of a ring of size processes. Each rank listens on its
+ * own host:port, connects to rank + 1 and accepts rank - 1, so every
+ * process keeps exactly two TCP connections whatever the ring size.
+ * allreduce() is the bandwidth-optimal ring algorithm: a reduce-scatter
+ * then an all-gather, 2 (size - 1) steps in which every rank sends and
+ * receives one chunk of n / size elements at the same time, so each rank
+ * moves 2 (size - 1) / size of the buffer regardless of size. With
+ * compress, chunks travel as fp16 scaled by a power of two per chunk (a
+ * quarter of the bytes of double); the owner of each reduced chunk rounds
+ * it the same way before the all-gather, so all ranks end bit-identical.
+ * A ring is used by one thread at a time.
+ * @param rank this process, in [0, size)
+ * @param hosts "host:port" of every rank (localhost for a single machine)
+ * @param compress send fp16 instead of double
+ * @param timeout seconds to wait for the neighbours to come up, and for
+ * any single transfer before the peer is declared dead
+ */
+class ring {
+public:
+    unsigned int rank;              // this process
+    unsigned int size;              // processes in the ring
+    bool compress;                  // fp16 on the wire
+    unsigned int timeout;           // seconds a collective may stall
+    int next;                       // socket to rank + 1
+    int prev;                       // socket from rank - 1
+    uint64_t sent;                  // bytes sent
+    double seconds;                 // time spent in collectives
+    std::vector<char> sendbuf;      // encoded outgoing chunk
+    std::vector<char> recvbuf;      // encoded incoming chunk
+
+    ring(unsigned int rank, const std::vector<std::string>& hosts, bool compress = false, unsigned int timeout = 60);
+    ring(const ring&) = delete;
+    ring& operator=(const ring&) = delete;
+    ~ring();
+
+    void allreduce(double* data, size_t n, bool exact = false);    // in-place sum over all ranks
+    void allreduce(std::vector<double>&, bool exact = false);
+    void broadcast(double* data, size_t n);         // rank 0's values everywhere (exact)
+    void barrier();
+
+private:
+    void exchange(size_t sendbytes, size_t recvbytes);      // send and receive at once
+};
+
+/**
+ * @brief Bucketed gradient all-reduce that overlaps with the backward pass.
+ * Gradient tensors are registered in the order backward() finishes them and
+ * grouped into buckets of at least bucket bytes; when the last tensor of a
+ * bucket is ready the bucket is copied into a flat buffer and reduced on a
+ * background thread while backward() carries on with the layers below. Every
+ * rank registers the same tensors, so buckets go round the ring in the same
+ * order everywhere.
+ * @param comm ring (only the reducer's thread uses it between the first
+ * finished() of a step and wait())
+ * @param bucket bucket size in bytes (of doubles, before compression)
+ */
+class reducer {
+public:
+    typedef std::vector<std::pair<double*, size_t>> tensor;    // contiguous pieces
+
+    ring& comm;
+    size_t bucket;                          // target bucket size in bytes
+    std::vector<tensor> tensors;            // in backward order
+    std::vector<std::pair<size_t, size_t>> buckets;     // [first, last) tensors
+    std::vector<std::vector<double>> flat;  // bucket buffers
+    size_t launched;                        // buckets handed to the thread
+    size_t ready;                           // tensors finished this step
+    size_t done;                            // buckets reduced this step
+    double waited;                          // seconds wait() blocked (communication not hidden)
+    std::deque<size_t> queue;               // buckets to reduce
+    std::exception_ptr failure;             // error from the reducing thread
+    std::mutex lock;
+    std::condition_variable changed;
+    bool stopping;
+    std::thread reducing;                   // reducing thread
+
+    reducer(ring& comm, size_t bucket = 1 << 20);
+    reducer(const reducer&) = delete;
+    reducer& operator=(const reducer&) = delete;
+    ~reducer();
+
+    void add(std::vector<double>&);                         // register a vector
+    void add(std::vector<std::vector<double>>&);            // register a matrix (one piece per row)
+    void add(double* p, size_t n);                          // register a buffer
+    void finished(size_t t);                                // tensors up to t hold their final local gradient
+    void wait();                                            // launch the rest, wait, start a new step
+
+private:
+    void plan();                                            // group tensors into buckets
+    void launch(size_t b);                                  // copy bucket b out and queue it
+    void loop();                                            // reducing thread
+};
+
+#endif
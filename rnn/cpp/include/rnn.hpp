@@ -15,7 +15,52 @@
 #define RNN_HPP 1
 
 #include <vector>
+#include <cstdint>
 #include "activations.hpp"
+#include "scaler.hpp"
+#include "normalize.hpp"
+#include "graph.hpp"
+
+/**
+ * @brief Weight initialization schemes (see rnn::initializeWeights)
+ * - he: N(0, 2 / fan_in)
+ * - xavier: N(0, 2 / (fan_in + fan_out))
+ * - orthogonal: orthonormal rows or columns
+ */
+enum class initialization { he, xavier, orthogonal };
+
+class rnn;
+class ring;
+
+/**
+ * @brief Per-thread state for a shared rnn: one sequence, the hidden states
+ * and outputs of every time step, and gradient accumulators shaped like the
+ * weights. forward(worker&) and backward(worker&) only read the model, so N
+ * workers can run concurrently on one set of weights; update() is the single
+ * writer that applies their gradients.
+ * @param samples number of sequences accumulated since the last update
+ */
+struct worker {
+    std::vector<std::vector<double>> inputs;        // normalised input sequence
+    std::vector<std::vector<double>> expected;      // expected outputs
+    std::vector<std::vector<double>> outputs;       // outputs at each time step
+    std::vector<std::vector<double>> hidden_states; // hidden states (index 0 is the initial state)
+    std::vector<std::vector<double>> dWxh;          // gradient of input to hidden weights
+    std::vector<std::vector<double>> dWhh;          // gradient of hidden to hidden weights
+    std::vector<std::vector<double>> dWhy;          // gradient of hidden to output weights
+    std::vector<double> dbh;                        // gradient of hidden bias
+    std::vector<double> dby;                        // gradient of output bias
+    std::vector<double> dh;                         // BPTT scratch
+    std::vector<double> dhnext;                     // BPTT scratch (carried to t - 1)
+    std::vector<std::vector<double>> xhat;          // normalised pre-activations of each step (layer norm)
+    std::vector<double> rstd;                       // 1 / std of each step's pre-activations (layer norm)
+    std::vector<double> dgamma;                     // gradient of the layer norm scale
+    unsigned int samples;                           // sequences accumulated in the gradients
+
+    worker() = default;
+    worker(const rnn&);                             // shaped like the model
+    void zero();                                    // clear the gradients
+};
 
 /**
  * @brief Recurrent Neural Network class
@@ -36,6 +81,7 @@ public:
     std::vector<std::vector<double>> outputs;      // sequence of output vectors
     std::vector<std::vector<double>> expected;     // expected output sequences
     std::vector<std::vector<double>> hidden_states; // hidden states at each time step
+    scaler norm;                                   // input normalisation, applied when sequences are loaded
     
     std::vector<std::vector<double>> Wxh;          // input to hidden weights
     std::vector<std::vector<double>> Whh;          // hidden to hidden weights (recurrent)
@@ -43,6 +89,8 @@ public:
     
     std::vector<double> bh;                        // hidden bias
     std::vector<double> by;                        // output bias
+    normalization normalize = normalization::none; // none, or layer: LayerNorm of the hidden pre-activations
+    std::vector<double> gamma;                     // layer norm scale (bh is its shift)
     
     // Gradients
     std::vector<std::vector<double>> dWxh;         // gradients for input to hidden weights
@@ -50,6 +98,9 @@ public:
     std::vector<std::vector<double>> dWhy;         // gradients for hidden to output weights
     std::vector<double> dbh;                       // gradients for hidden bias
     std::vector<double> dby;                       // gradients for output bias
+    std::vector<double> dgamma;                    // gradients for layer norm scale
+    std::vector<std::vector<double>> xhat;         // layer norm state of each time step
+    std::vector<double> rstd;
 
 // member functions
     // default constructor
@@ -59,19 +110,37 @@ public:
     rnn(std::vector<std::vector<double>> inputs, std::vector<std::vector<double>> expected,
         unsigned int hidden, unsigned int time_steps, unsigned int epochs, double learning);
 
+    void addNormalization(normalization);          // layer (or none)
     double getL1Penalty();
     double getL2Penalty();
 
+    void fitScaler(const std::vector<std::vector<std::vector<double>>>&, scaling);  // fit normalisation over sequences
+    void loadSequence(const std::vector<std::vector<double>>&);    // copy a sequence into inputs, normalised
     void forward();                                // forward pass through time
     void backward();                               // backward pass through time (BPTT)
     void update_weights();                         // update weights after backprop
     void clip_gradients(double threshold);         // clip gradients to prevent explosion
+
+    void loadSequence(worker&, const std::vector<std::vector<double>>&) const;
+    void forward(worker&) const;                   // forward pass into a worker
+    double backward(worker&) const;                // BPTT, gradients added to the worker
+    void clip_gradients(worker&, double threshold) const;
+    void update(worker&);                          // apply one worker's gradients
+    void update(std::vector<worker>&);             // apply several workers' gradients as one step
     
     void train();
     void train(std::vector<std::vector<std::vector<double>>> sequences);
+    double train(ring&, const std::vector<std::vector<std::vector<double>>>& sequences,
+                 const std::vector<std::vector<std::vector<double>>>& targets,
+                 unsigned int batch, size_t bucket = 1 << 20);                   // data-parallel
+    graph compile(size_t batch, unsigned int threads = 1);                       // training step as a graph
+    double fit(const std::vector<std::vector<std::vector<double>>>& sequences,
+               const std::vector<std::vector<std::vector<double>>>& targets,
+               unsigned int batch, unsigned int threads = 1);                    // mini-batch, compiled
     void validate();
     void test();
     void initializeWeights();
+    void initializeWeights(initialization, uint64_t seed, unsigned int threads = 1);   // reproducible
     
     std::vector<double> predict(std::vector<std::vector<double>> input_sequence);
     
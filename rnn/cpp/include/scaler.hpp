@@ -0,0 +1,79 @@
+// scaler.hpp: feature normalisation fitted in one streaming pass
+#ifndef SCALER_HPP
+#define SCALER_HPP 1
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief P-square estimator of a single quantile (Jain and Chlamtac).
+ * Keeps five markers, so memory is constant however long the stream is.
+ * @param q quantile to track, in (0, 1)
+ */
+class p2quantile {
+public:
+    double q;               // tracked quantile
+    uint64_t count;         // samples seen
+    double height[5];       // marker heights
+    double pos[5];          // actual marker positions
+    double desired[5];      // desired marker positions
+    double step[5];         // increments of the desired positions
+
+    p2quantile(double q = 0.5);
+    void push(double);      // add one sample
+    double value() const;   // current estimate
+};
+
+/**
+ * @brief Normalisation methods for scaler
+ * - none: identity
+ * - standard: (x - mean) / stddev
+ * - minmax: (x - min) / (max - min), maps the fitted range onto [0, 1]
+ * - robust: (x - median) / IQR, insensitive to outliers
+ */
+enum class scaling { none, standard, minmax, robust };
+
+/**
+ * @brief Per-feature affine normalisation x' = (x - shift) * scale.
+ * Statistics are accumulated sample by sample with partialFit() (Welford for
+ * mean/variance, running min/max and P-square quartiles), so fitting reads
+ * the data once and never sorts or stores it. After finalize() only shift and
+ * scale are needed, and transform() works in place on a loaded buffer.
+ * @param method normalisation method
+ * @param features number of features
+ */
+class scaler {
+public:
+    scaling method;                 // normalisation method
+    unsigned int features;          // number of features
+    uint64_t n;                     // samples seen while fitting
+    bool fitted;                    // shift and scale are valid
+    std::vector<double> shift;      // subtracted from each feature
+    std::vector<double> scale;      // multiplied after the shift
+    // streaming fit state
+    std::vector<double> mean;       // running means
+    std::vector<double> m2;         // running sums of squared deviations
+    std::vector<double> minv;       // running minima
+    std::vector<double> maxv;       // running maxima
+    std::vector<p2quantile> q1;     // first quartiles
+    std::vector<p2quantile> q2;     // medians
+    std::vector<p2quantile> q3;     // third quartiles
+
+    scaler();
+    scaler(unsigned int features, scaling method);
+
+    void partialFit(const double*);                     // add one sample
+    void partialFit(const std::vector<double>&);        // add one sample
+    void finalize();                                    // compute shift and scale
+    void fit(const std::vector<std::vector<double>>&);  // partialFit over all samples + finalize
+
+    void transform(double*) const;                      // normalise one sample in place
+    void transform(std::vector<double>&) const;         // normalise one sample in place
+    void transform(const unsigned int*, double*, size_t) const;    // scale nonzeros of a sparse sample
+    void inverse(double*) const;                        // undo the normalisation in place
+
+    ~scaler() {};
+};
+
+#endif
@@ -0,0 +1,216 @@
+// normalize.cpp: layer and batch normalisation, Welford statistics fused with scale and shift
+#include "include/normalize.hpp"
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+//----------------STATISTICS----------------//
+
+/**
+ * @brief Mean and sum of squared deviations of x in one pass: four
+ * interleaved Welford accumulators (independent, so the updates pipeline
+ * and vectorise) merged with Chan's formula, then the tail. Numerically
+ * this is Welford's method, not the cancelling E[x^2] - E[x]^2.
+ */
+static void moments(const double* x, size_t n, double& mean, double& m2) {
+    constexpr size_t lanes = 4;
+    double mu[lanes] = {0.0, 0.0, 0.0, 0.0}, q[lanes] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0, k = 0;
+    for (; i + lanes <= n; i += lanes) {
+        const double inv = 1.0 / (double)++k;
+        for (size_t l = 0; l < lanes; l++) {
+            const double d = x[i + l] - mu[l];
+            mu[l] += d * inv;
+            q[l] += d * (x[i + l] - mu[l]);
+        }
+    }
+    double count = (double)k;
+    mean = mu[0];
+    m2 = q[0];
+    for (size_t l = 1; l < lanes && k > 0; l++) {
+        const double total = count + k, d = mu[l] - mean;
+        mean += d * k / total;
+        m2 += q[l] + d * d * count * k / total;
+        count = total;
+    }
+    for (; i < n; i++) {
+        count += 1.0;
+        const double d = x[i] - mean;
+        mean += d / count;
+        m2 += d * (x[i] - mean);
+    }
+}
+
+//----------------LAYER NORM----------------//
+
+/**
+ * @brief LayerNorm of one vector: statistics in one Welford pass, then one
+ * fused pass that normalises, scales and shifts
+ * @param x input of length n
+ * @param n number of features
+ * @param gamma scale
+ * @param beta shift
+ * @param y output (may be x)
+ * @param xhat normalised input, saved for backward (may be null)
+ * @param rstd 1 / sqrt(var + eps), saved for backward (may be null)
+ */
+void layernorm(const double* x, size_t n, const double* gamma, const double* beta, double* y,
+               double* xhat, double* rstd) {
+    double mean, m2;
+    moments(x, n, mean, m2);
+    const double r = 1.0 / std::sqrt(m2 / n + NORM_EPSILON);
+    if (rstd) *rstd = r;
+    for (size_t j = 0; j < n; j++) {
+        const double h = (x[j] - mean) * r;
+        if (xhat) xhat[j] = h;
+        y[j] = gamma[j] * h + beta[j];
+    }
+}
+
+/**
+ * @brief Gradient of layernorm. With g = dy * gamma,
+ * dx = rstd * (g - mean(g) - xhat * mean(g * xhat)); one pass gathers the
+ * two means together with dgamma and dbeta, a second writes dx.
+ * @param dy gradient of the output
+ * @param xhat normalised input from the forward pass
+ * @param n number of features
+ * @param rstd 1 / std from the forward pass
+ * @param gamma scale
+ * @param dx gradient of the input (may be dy)
+ * @param dgamma gradient of gamma (accumulated)
+ * @param dbeta gradient of beta (accumulated)
+ */
+void layernormback(const double* dy, const double* xhat, size_t n, double rstd, const double* gamma,
+                   double* dx, double* dgamma, double* dbeta) {
+    double s1 = 0.0, s2 = 0.0;
+    for (size_t j = 0; j < n; j++) {
+        const double g = dy[j] * gamma[j];
+        s1 += g;
+        s2 += g * xhat[j];
+        dgamma[j] += dy[j] * xhat[j];
+        dbeta[j] += dy[j];
+    }
+    s1 /= n;
+    s2 /= n;
+    for (size_t j = 0; j < n; j++) dx[j] = rstd * (dy[j] * gamma[j] - s1 - xhat[j] * s2);
+}
+
+//----------------BATCH NORM----------------//
+
+/**
+ * @brief BatchNorm of the columns of a rows x n matrix: Welford over the
+ * rows, updating all n column accumulators per row (vectorised across
+ * columns), then one fused pass that normalises, scales and shifts
+ * @param x input, rows x n with row stride ld
+ * @param rows batch size
+ * @param n number of features
+ * @param ld row stride of x, y and xhat
+ * @param gamma scale
+ * @param beta shift
+ * @param y output (may be x)
+ * @param xhat normalised input, saved for backward
+ * @param mean batch mean of each column
+ * @param var biased batch variance of each column
+ * @param rstd 1 / sqrt(var + eps) of each column
+ */
+void batchnorm(const double* x, size_t rows, size_t n, size_t ld, const double* gamma, const double* beta,
+               double* y, double* xhat, double* mean, double* var, double* rstd) {
+    std::fill(mean, mean + n, 0.0);
+    std::fill(var, var + n, 0.0);       // sum of squared deviations until the end
+    for (size_t r = 0; r < rows; r++) {
+        const double* row = x + r * ld;
+        const double inv = 1.0 / (double)(r + 1);
+        for (size_t j = 0; j < n; j++) {
+            const double d = row[j] - mean[j];
+            mean[j] += d * inv;
+            var[j] += d * (row[j] - mean[j]);
+        }
+    }
+    for (size_t j = 0; j < n; j++) {
+        var[j] = rows ? var[j] / rows : 0.0;
+        rstd[j] = 1.0 / std::sqrt(var[j] + NORM_EPSILON);
+    }
+    for (size_t r = 0; r < rows; r++) {
+        const double* in = x + r * ld;
+        double* h = xhat + r * ld;
+        double* out = y + r * ld;
+        for (size_t j = 0; j < n; j++) {
+            h[j] = (in[j] - mean[j]) * rstd[j];
+            out[j] = gamma[j] * h[j] + beta[j];
+        }
+    }
+}
+
+/**
+ * @brief Gradient of batchnorm over the batch. Per column, with
+ * g = dy * gamma, dx = rstd * (g - mean(g) - xhat * mean(g * xhat)): one
+ * pass over the rows gathers the column sums with dgamma and dbeta, a
+ * second writes dx.
+ * @param dy gradient of the output, rows x n with row stride ld
+ * @param xhat normalised input from the forward pass
+ * @param rows batch size
+ * @param n number of features
+ * @param ld row stride
+ * @param rstd 1 / std of each column from the forward pass
+ * @param gamma scale
+ * @param dx gradient of the input (may be dy)
+ * @param dgamma gradient of gamma (accumulated)
+ * @param dbeta gradient of beta (accumulated)
+ */
+void batchnormback(const double* dy, const double* xhat, size_t rows, size_t n, size_t ld, const double* rstd,
+                   const double* gamma, double* dx, double* dgamma, double* dbeta) {
+    std::vector<double> s1(n, 0.0), s2(n, 0.0);
+    for (size_t r = 0; r < rows; r++) {
+        const double* d = dy + r * ld;
+        const double* h = xhat + r * ld;
+        for (size_t j = 0; j < n; j++) {
+            s1[j] += d[j];
+            s2[j] += d[j] * h[j];
+        }
+    }
+    for (size_t j = 0; j < n; j++) {
+        dgamma[j] += s2[j];
+        dbeta[j] += s1[j];
+        // means of g and g * xhat
+        s1[j] *= gamma[j] / rows;
+        s2[j] *= gamma[j] / rows;
+    }
+    for (size_t r = 0; r < rows; r++) {
+        const double* d = dy + r * ld;
+        const double* h = xhat + r * ld;
+        double* out = dx + r * ld;
+        for (size_t j = 0; j < n; j++) out[j] = rstd[j] * (d[j] * gamma[j] - s1[j] - h[j] * s2[j]);
+    }
+}
+
+//----------------INFERENCE----------------//
+
+/**
+ * @brief Inference-time normalisation of one sample's pre-activations:
+ * LayerNorm uses the sample's own statistics, BatchNorm the running ones
+ * @param kind normalisation
+ * @param z pre-activations
+ * @param y output (may be z)
+ * @param n number of features
+ * @param gamma scale (layer, batch)
+ * @param beta shift (layer, batch, folded)
+ * @param mean running mean (batch)
+ * @param var running variance (batch)
+ */
+void normalized(normalization kind, const double* z, double* y, size_t n, const double* gamma,
+                const double* beta, const double* mean, const double* var) {
+    switch (kind) {
+        case normalization::none:
+            if (y != z) std::copy(z, z + n, y);
+            break;
+        case normalization::layer:
+            layernorm(z, n, gamma, beta, y);
+            break;
+        case normalization::batch:
+            for (size_t j = 0; j < n; j++) y[j] = gamma[j] * (z[j] - mean[j]) / std::sqrt(var[j] + NORM_EPSILON) + beta[j];
+            break;
+        case normalization::folded:
+            for (size_t j = 0; j < n; j++) y[j] = z[j] + beta[j];
+            break;
+    }
+}
@@ -0,0 +1,523 @@
+// ring.cpp: ring all-reduce over TCP and overlapped gradient buckets
+#include "include/ring.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock sclock;
+
+//----------------FP16----------------//
+
+/**
+ * @brief float to IEEE binary16 with round to nearest even; out of range
+ * values become infinity, NaN stays NaN
+ * @param f value
+ * @return half precision bits
+ */
+uint16_t tohalf(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, 4);
+    const uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+    uint16_t h;
+    if (u >= 0x47800000u) {                 // |f| >= 65536, inf or nan
+        h = u > 0x7f800000u ? 0x7e00 : 0x7c00;
+    }
+    else if (u < 0x38800000u) {             // below 2^-14: subnormal half
+        // adding 0.5 lines the half mantissa up with the float's low bits
+        // and lets the FPU do the rounding
+        float g;
+        std::memcpy(&g, &u, 4);
+        g += 0.5f;
+        std::memcpy(&u, &g, 4);
+        h = (uint16_t)(u - 0x3f000000u);
+    }
+    else {                                  // normal: rebias and round to even
+        const uint32_t odd = (u >> 13) & 1;
+        u += 0xc8000fffu + odd;
+        h = (uint16_t)(u >> 13);
+    }
+    return h | (uint16_t)(sign >> 16);
+}
+
+/**
+ * @brief IEEE binary16 to float (exact)
+ * @param h half precision bits
+ * @return value
+ */
+float fromhalf(uint16_t h) {
+    uint32_t u = (uint32_t)(h & 0x7fff) << 13;
+    const uint32_t exp = u & 0x0f800000u;
+    u += 0x38000000u;                       // rebias 15 -> 127
+    if (exp == 0x0f800000u) {               // inf or nan
+        u += 0x38000000u;
+    }
+    else if (exp == 0) {                    // subnormal: renormalise through the FPU
+        u += 0x00800000u;
+        float f;
+        std::memcpy(&f, &u, 4);
+        f -= 6.103515625e-05f;              // 2^-14
+        std::memcpy(&u, &f, 4);
+    }
+    u |= (uint32_t)(h & 0x8000) << 16;
+    float f;
+    std::memcpy(&f, &u, 4);
+    return f;
+}
+
+//----------------CHUNKS----------------//
+
+/**
+ * @brief bytes of an encoded chunk of n values
+ */
+static size_t chunkbytes(size_t n, bool half) {
+    return half ? sizeof(int32_t) + n * sizeof(uint16_t) : n * sizeof(double);
+}
+
+/**
+ * @brief Encode a chunk: doubles as they are, or a power-of-two exponent
+ * followed by the values divided by it in fp16. The exponent puts the
+ * largest magnitude in [0.5, 1), so the scaling is exact and gradients of
+ * any size keep fp16's 11 significant bits instead of underflowing.
+ * @return bytes written
+ */
+static size_t pack(const double* x, size_t n, bool half, char* out) {
+    if (!half) {
+        std::memcpy(out, x, n * sizeof(double));
+        return n * sizeof(double);
+    }
+    double m = 0.0;
+    for (size_t i = 0; i < n; i++) m = std::max(m, std::abs(x[i]));
+    int e = 0;
+    if (m > 0.0 && std::isfinite(m)) std::frexp(m, &e);
+    const int32_t e32 = e;
+    std::memcpy(out, &e32, sizeof(e32));
+    uint16_t* h = (uint16_t*)(out + sizeof(e32));
+    const double inv = std::ldexp(1.0, -e);
+    for (size_t i = 0; i < n; i++) h[i] = tohalf((float)(x[i] * inv));
+    return chunkbytes(n, true);
+}
+
+/**
+ * @brief decode a chunk into x, adding to it or overwriting it
+ */
+static void unpack(const char* in, double* x, size_t n, bool half, bool add) {
+    if (!half) {
+        const double* v = (const double*)in;
+        if (add) for (size_t i = 0; i < n; i++) x[i] += v[i];
+        else std::memcpy(x, v, n * sizeof(double));
+        return;
+    }
+    int32_t e;
+    std::memcpy(&e, in, sizeof(e));
+    const uint16_t* h = (const uint16_t*)(in + sizeof(e));
+    const double scale = std::ldexp(1.0, e);
+    if (add) for (size_t i = 0; i < n; i++) x[i] += (double)fromhalf(h[i]) * scale;
+    else for (size_t i = 0; i < n; i++) x[i] = (double)fromhalf(h[i]) * scale;
+}
+
+//----------------SOCKETS----------------//
+
+/**
+ * @brief split "host:port" (the last colon separates the port)
+ * @throws std::invalid_argument if there is no port
+ */
+static std::pair<std::string, std::string> hostport(const std::string& s) {
+    size_t c = s.rfind(':');
+    if (c == std::string::npos || c + 1 == s.size())
+        throw std::invalid_argument("-_-RING ADDRESS SHOULD BE HOST:PORT-_-");
+    return {s.substr(0, c), s.substr(c + 1)};
+}
+
+/**
+ * @brief blocking transfer of exactly n bytes on a blocking socket
+ */
+static bool sendall(int fd, const void* p, size_t n) {
+    const char* c = (const char*)p;
+    while (n > 0) {
+        ssize_t k = send(fd, c, n, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        c += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+static bool recvall(int fd, void* p, size_t n) {
+    char* c = (char*)p;
+    while (n > 0) {
+        ssize_t k = recv(fd, c, n, 0);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        c += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+/**
+ * @brief listening socket on every interface
+ * @throws std::runtime_error if the port cannot be bound
+ */
+static int listener(const std::string& port) {
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(nullptr, port.c_str(), &hints, &res) != 0)
+        throw std::runtime_error("-_-CANNOT RESOLVE RING PORT " + port + "-_-");
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    int one = 1;
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (fd < 0 || bind(fd, res->ai_addr, res->ai_addrlen) < 0 || listen(fd, 4) < 0) {
+        if (fd >= 0) close(fd);
+        freeaddrinfo(res);
+        throw std::runtime_error("-_-CANNOT LISTEN ON RING PORT " + port + "-_-");
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+/**
+ * @brief connect to a neighbour, retrying until it listens or the deadline
+ * passes (processes of a ring start in any order)
+ * @throws std::runtime_error at the deadline
+ */
+static int dial(const std::string& address, sclock::time_point deadline) {
+    auto [host, port] = hostport(address);
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
+        throw std::runtime_error("-_-CANNOT RESOLVE RING HOST " + address + "-_-");
+    for (;;) {
+        int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) == 0) {
+            freeaddrinfo(res);
+            return fd;
+        }
+        if (fd >= 0) close(fd);
+        if (sclock::now() > deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    freeaddrinfo(res);
+    throw std::runtime_error("-_-CANNOT CONNECT TO RING NEIGHBOUR " + address + "-_-");
+}
+
+//----------------RING----------------//
+
+/**
+ * @brief Join the ring: listen on this rank's port, connect to the next
+ * rank, accept the previous one and check that both neighbours agree on
+ * their ranks
+ * @throws std::invalid_argument if rank is not in [0, hosts.size())
+ * @throws std::runtime_error if a neighbour is unreachable within timeout
+ */
+ring::ring(unsigned int rank, const std::vector<std::string>& hosts, bool compress, unsigned int timeout)
+    : rank(rank), size(hosts.size()), compress(compress), timeout(timeout), next(-1), prev(-1), sent(0), seconds(0.0)
+{
+    if (rank >= size)
+        throw std::invalid_argument("-_-RANK OUT OF RANGE OF THE RING-_-");
+    if (size == 1) return;
+    const sclock::time_point deadline = sclock::now() + std::chrono::seconds(timeout);
+    int lfd = listener(hostport(hosts[rank]).second);
+    try {
+        next = dial(hosts[(rank + 1) % size], deadline);
+        pollfd p{lfd, POLLIN, 0};
+        int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - sclock::now()).count();
+        if (poll(&p, 1, std::max(ms, 0)) <= 0 || (prev = accept(lfd, nullptr, nullptr)) < 0)
+            throw std::runtime_error("-_-RING NEIGHBOUR DID NOT CONNECT-_-");
+        uint32_t mine = rank, theirs = 0;
+        if (!sendall(next, &mine, sizeof(mine)) || !recvall(prev, &theirs, sizeof(theirs))
+            || theirs != (rank + size - 1) % size)
+            throw std::runtime_error("-_-RING NEIGHBOURS DISAGREE ON RANKS-_-");
+    }
+    catch (...) {
+        close(lfd);
+        if (next >= 0) close(next);
+        if (prev >= 0) close(prev);
+        throw;
+    }
+    close(lfd);
+    int one = 1;
+    for (int fd : {next, prev}) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+ring::~ring() {
+    if (next >= 0) close(next);
+    if (prev >= 0) close(prev);
+}
+
+/**
+ * @brief Send sendbytes of sendbuf to the next rank while receiving
+ * recvbytes into recvbuf from the previous one. Both directions progress
+ * together, so the ring cannot deadlock on full socket buffers.
+ * @throws std::runtime_error if a neighbour closes or stalls past timeout
+ */
+void ring::exchange(size_t sendbytes, size_t recvbytes) {
+    size_t so = 0, ro = 0;
+    while (so < sendbytes || ro < recvbytes) {
+        pollfd p[2];
+        int k = 0, is = -1, ir = -1;
+        if (so < sendbytes) { is = k; p[k++] = {next, POLLOUT, 0}; }
+        if (ro < recvbytes) { ir = k; p[k++] = {prev, POLLIN, 0}; }
+        int r = poll(p, k, (int)timeout * 1000);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0)
+            throw std::runtime_error("-_-RING TIMED OUT-_-");
+        if (is >= 0 && p[is].revents) {
+            ssize_t n = send(next, sendbuf.data() + so, sendbytes - so, MSG_NOSIGNAL);
+            if (n > 0) so += (size_t)n;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                throw std::runtime_error("-_-RING NEIGHBOUR DISCONNECTED-_-");
+        }
+        if (ir >= 0 && p[ir].revents) {
+            ssize_t n = recv(prev, recvbuf.data() + ro, recvbytes - ro, 0);
+            if (n > 0) ro += (size_t)n;
+            else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                throw std::runtime_error("-_-RING NEIGHBOUR DISCONNECTED-_-");
+        }
+    }
+    sent += sendbytes;
+}
+
+/**
+ * @brief In-place sum over all ranks. Reduce-scatter: in step s each rank
+ * passes chunk rank - s on and adds the chunk it receives, so after
+ * size - 1 steps rank r holds the full sum of chunk r + 1. All-gather: the
+ * reduced chunks travel round once more, each rank forwarding the bytes it
+ * just received.
+ * @param data buffer of n values (same n on every rank)
+ * @param n number of values
+ * @param exact send doubles even if the ring compresses (counters, losses)
+ * @throws std::runtime_error if a neighbour fails
+ */
+void ring::allreduce(double* data, size_t n, bool exact) {
+    if (size == 1 || n == 0) return;
+    const bool compress = this->compress && !exact;
+    const sclock::time_point t0 = sclock::now();
+    auto first = [n, this](size_t c) { return n * c / size; };
+    auto len = [&first](size_t c) { return first(c + 1) - first(c); };
+    const size_t most = chunkbytes(n / size + 1, compress);
+    if (sendbuf.size() < most) sendbuf.resize(most);
+    if (recvbuf.size() < most) recvbuf.resize(most);
+
+    for (unsigned int s = 0; s + 1 < size; s++) {
+        const size_t si = (rank + size - s) % size, ri = (rank + size - s - 1) % size;
+        size_t b = pack(data + first(si), len(si), compress, sendbuf.data());
+        exchange(b, chunkbytes(len(ri), compress));
+        unpack(recvbuf.data(), data + first(ri), len(ri), compress, true);
+    }
+
+    const size_t own = (rank + 1) % size;
+    size_t b = pack(data + first(own), len(own), compress, sendbuf.data());
+    // the owner keeps exactly what the others will decode
+    if (compress) unpack(sendbuf.data(), data + first(own), len(own), true, false);
+    for (unsigned int s = 0; s + 1 < size; s++) {
+        const size_t ri = (rank + size - s) % size;
+        const size_t rb = chunkbytes(len(ri), compress);
+        exchange(b, rb);
+        unpack(recvbuf.data(), data + first(ri), len(ri), compress, false);
+        std::swap(sendbuf, recvbuf);
+        b = rb;
+    }
+    seconds += std::chrono::duration<double>(sclock::now() - t0).count();
+}
+
+void ring::allreduce(std::vector<double>& v, bool exact) {
+    allreduce(v.data(), v.size(), exact);
+}
+
+/**
+ * @brief Copy rank 0's buffer to every rank, exactly (never compressed).
+ * The buffer is pipelined round the ring in pieces.
+ * @param data buffer of n values
+ * @param n number of values
+ */
+void ring::broadcast(double* data, size_t n) {
+    if (size == 1 || n == 0) return;
+    const sclock::time_point t0 = sclock::now();
+    const size_t piece = 1 << 16;
+    const size_t most = std::min(n, piece) * sizeof(double);
+    if (sendbuf.size() < most) sendbuf.resize(most);
+    if (recvbuf.size() < most) recvbuf.resize(most);
+    for (size_t off = 0; off < n; off += piece) {
+        const size_t m = std::min(piece, n - off), bytes = m * sizeof(double);
+        if (rank == 0) {
+            std::memcpy(sendbuf.data(), data + off, bytes);
+            exchange(bytes, 0);
+            continue;
+        }
+        exchange(0, bytes);
+        std::memcpy(data + off, recvbuf.data(), bytes);
+        if (rank + 1 < size) {
+            std::swap(sendbuf, recvbuf);
+            exchange(bytes, 0);
+        }
+    }
+    seconds += std::chrono::duration<double>(sclock::now() - t0).count();
+}
+
+/**
+ * @brief return once every rank has called barrier()
+ */
+void ring::barrier() {
+    double x = 0.0;
+    allreduce(&x, 1, true);
+}
+
+//----------------REDUCER----------------//
+
+reducer::reducer(ring& comm, size_t bucket)
+    : comm(comm), bucket(bucket), launched(0), ready(0), done(0), waited(0.0), stopping(false)
+{
+    reducing = std::thread(&reducer::loop, this);
+}
+
+reducer::~reducer() {
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    reducing.join();
+}
+
+void reducer::add(std::vector<double>& v) {
+    add(v.data(), v.size());
+}
+
+void reducer::add(std::vector<std::vector<double>>& m) {
+    tensor t;
+    for (auto& row : m) t.emplace_back(row.data(), row.size());
+    tensors.push_back(std::move(t));
+    buckets.clear();
+}
+
+void reducer::add(double* p, size_t n) {
+    tensors.push_back(tensor{{p, n}});
+    buckets.clear();
+}
+
+/**
+ * @brief group consecutive tensors into buckets of at least bucket bytes
+ */
+void reducer::plan() {
+    buckets.clear();
+    size_t first = 0, bytes = 0;
+    for (size_t t = 0; t < tensors.size(); t++) {
+        for (const auto& piece : tensors[t]) bytes += piece.second * sizeof(double);
+        if (bytes >= bucket) {
+            buckets.emplace_back(first, t + 1);
+            first = t + 1;
+            bytes = 0;
+        }
+    }
+    if (first < tensors.size()) buckets.emplace_back(first, tensors.size());
+    flat.assign(buckets.size(), std::vector<double>());
+    for (size_t b = 0; b < buckets.size(); b++) {
+        size_t n = 0;
+        for (size_t t = buckets[b].first; t < buckets[b].second; t++) {
+            for (const auto& piece : tensors[t]) n += piece.second;
+        }
+        flat[b].resize(n);
+    }
+}
+
+/**
+ * @brief copy bucket b into its flat buffer and hand it to the reducing thread
+ */
+void reducer::launch(size_t b) {
+    double* p = flat[b].data();
+    for (size_t t = buckets[b].first; t < buckets[b].second; t++) {
+        for (const auto& piece : tensors[t]) {
+            std::copy(piece.first, piece.first + piece.second, p);
+            p += piece.second;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        queue.push_back(b);
+        launched++;
+    }
+    changed.notify_all();
+}
+
+/**
+ * @brief Mark tensors 0..t as final for this step and launch every bucket
+ * they complete. Call from the backward pass as each layer finishes.
+ * @param t index of a registered tensor
+ */
+void reducer::finished(size_t t) {
+    if (buckets.empty()) plan();
+    ready = std::max(ready, t + 1);
+    while (launched < buckets.size() && buckets[launched].second <= ready) launch(launched);
+}
+
+/**
+ * @brief Launch the buckets not launched yet, wait until every bucket of
+ * the step is reduced and written back, and get ready for the next step.
+ * The time spent blocked here is the communication the backward pass did
+ * not hide.
+ * @throws std::runtime_error (or whatever the ring threw) if a reduction failed
+ */
+void reducer::wait() {
+    if (tensors.empty()) return;
+    finished(tensors.size() - 1);
+    const sclock::time_point t0 = sclock::now();
+    std::unique_lock<std::mutex> lk(lock);
+    changed.wait(lk, [this] { return done == launched; });
+    waited += std::chrono::duration<double>(sclock::now() - t0).count();
+    launched = ready = done = 0;
+    if (failure) std::rethrow_exception(failure);
+}
+
+/**
+ * @brief reducing thread: all-reduce queued buckets in order and scatter
+ * the sums back into the tensors
+ */
+void reducer::loop() {
+    std::unique_lock<std::mutex> lk(lock);
+    for (;;) {
+        changed.wait(lk, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return;
+        size_t b = queue.front();
+        queue.pop_front();
+        bool failed = (bool)failure;
+        lk.unlock();
+        if (!failed) {
+            try {
+                comm.allreduce(flat[b].data(), flat[b].size());
+                const double* p = flat[b].data();
+                for (size_t t = buckets[b].first; t < buckets[b].second; t++) {
+                    for (const auto& piece : tensors[t]) {
+                        std::copy(p, p + piece.second, piece.first);
+                        p += piece.second;
+                    }
+                }
+            }
+            catch (...) {
+                lk.lock();
+                failure = std::current_exception();
+                lk.unlock();
+            }
+        }
+        lk.lock();
+        done++;
+        changed.notify_all();
+    }
+}
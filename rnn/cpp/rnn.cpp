@@ -1,5 +1,6 @@
 
 #include "rnn.hpp"
+#include <stdexcept>
 
 /**
  * @brief Default constructor for the rnn class. This constructor initializes the
@@ -95,4 +96,22 @@ rnn::rnn(std::vector<std::vector<double>> inputs, std::vector<std::vector<double
     
     // Initialize weights with random values
     initializeWeights();
-}
\ No newline at end of file
+}
+
+/**
+ * @brief LayerNorm the hidden pre-activations of every step,
+ *      h[t + 1] = tanh(LN(Wxh x[t] + Whh h[t]) * gamma + bh)
+ * (Ba et al., "Layer Normalization", 2016); bh becomes the shift. gamma
+ * starts at 1. BatchNorm does not fit a network trained one sequence at a
+ * time, so only layer (or none, which removes it) is accepted.
+ * @param kind normalisation
+ * @throws std::invalid_argument for batch or folded
+ */
+void rnn::addNormalization(normalization kind) {
+    if (kind != normalization::none && kind != normalization::layer)
+        throw std::invalid_argument("-_-RNN SUPPORTS LAYER NORMALISATION ONLY-_-");
+    normalize = kind;
+    const size_t n = kind == normalization::layer ? hidden : 0;
+    gamma.assign(n, 1.0);
+    dgamma.assign(n, 0.0);
+}
@@ -0,0 +1,35 @@
+
+// train.cpp: Training functions for RNN
+#include "include/rnn.hpp"
+#include <stdexcept>
+
+/**
+ * @brief Fit the input normalisation in one pass over every time step of the
+ * training sequences. The statistics are stored in the model (norm).
+ * @param sequences training sequences, each a list of input vectors
+ * @param method normalisation method
+ */
+void rnn::fitScaler(const std::vector<std::vector<std::vector<double>>>& sequences, scaling method) {
+    norm = scaler(in, method);
+    for (const auto& seq : sequences) {
+        for (const auto& x : seq)
+            norm.partialFit(x);
+    }
+    norm.finalize();
+}
+
+/**
+ * @brief Copy a sequence into the input buffer and normalise it in place
+ * @param seq input vectors, one per time step
+ */
+void rnn::loadSequence(const std::vector<std::vector<double>>& seq) {
+    if (seq.size() > time_steps)
+        throw std::runtime_error("-_-SEQUENCE IS LONGER THAN TIME STEPS-_-");
+    inputs.resize(seq.size());
+    for (size_t t = 0; t < seq.size(); t++) {
+        if (seq[t].size() != in)
+            throw std::runtime_error("-_-SIZE OF SAMPLE AND INPUT SHOULD MATCH-_-");
+        inputs[t].assign(seq[t].begin(), seq[t].end());
+        norm.transform(inputs[t].data());
+    }
+}